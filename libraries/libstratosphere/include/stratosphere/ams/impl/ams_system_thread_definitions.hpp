@@ -35,6 +35,7 @@ namespace ams::impl {
 
     /* Loader. */
     AMS_DEFINE_SYSTEM_THREAD(21, ldr, Main);
+    AMS_DEFINE_SYSTEM_THREAD(21, ldr, LoadWorker);
 
     /* Process Manager. */
     AMS_DEFINE_SYSTEM_THREAD(21, pm, Main);
@@ -49,6 +50,7 @@ namespace ams::impl {
     /* FS. */
     AMS_DEFINE_SYSTEM_THREAD(11, sdmmc, DeviceDetector);
     AMS_DEFINE_SYSTEM_THREAD(16, fs,    WorkerThreadPool);
+    AMS_DEFINE_SYSTEM_THREAD(16, fs,    DecompressionWorker);
     AMS_DEFINE_SYSTEM_THREAD(17, fs,    Main);
     AMS_DEFINE_SYSTEM_THREAD(17, fs,    WorkerRealTimeAccess);
     AMS_DEFINE_SYSTEM_THREAD(18, fs,    WorkerNormalPriorityAccess);
@@ -64,6 +66,7 @@ namespace ams::impl {
     AMS_DEFINE_SYSTEM_THREAD(-1, mitm_sf,         QueryServerProcessThread);
     AMS_DEFINE_SYSTEM_THREAD(16, mitm_fs,         RomFileSystemInitializeThread);
     AMS_DEFINE_SYSTEM_THREAD(16, mitm_fs,         RomFileSystemFinalizeThread);
+    AMS_DEFINE_SYSTEM_THREAD(16, mitm_fs,         RomFileSystemScanThread);
     AMS_DEFINE_SYSTEM_THREAD(21, mitm,            DebugThrowThread);
     AMS_DEFINE_SYSTEM_THREAD(21, mitm_sysupdater, IpcServer);
     AMS_DEFINE_SYSTEM_THREAD(21, mitm_sysupdater, AsyncPrepareSdCardUpdateTask);
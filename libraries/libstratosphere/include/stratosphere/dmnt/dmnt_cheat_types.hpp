@@ -63,4 +63,49 @@ namespace ams::dmnt::cheat {
         FrozenAddressValue value;
     };
 
+    struct CheatProcessMemoryAccessStatistics {
+        u32 read_count;
+        u32 write_count;
+        u32 read_svc_count;
+        u32 write_svc_count;
+        u32 max_svc_count;
+        u32 write_failure_count;
+        u64 tick_count;
+    };
+    static_assert(util::is_pod<CheatProcessMemoryAccessStatistics>::value, "CheatProcessMemoryAccessStatistics");
+
+    enum MemorySearchComparison : u8 {
+        MemorySearchComparison_Equal     = 0,
+        MemorySearchComparison_InRange   = 1,
+        MemorySearchComparison_Changed   = 2,
+        MemorySearchComparison_Increased = 3,
+    };
+
+    /* Values are compared unsigned, at addresses aligned to the width. */
+    /* Changed and Increased compare against the value found by the previous pass, so they can only narrow a search. */
+    struct MemorySearchCondition {
+        u64 value;
+        u64 value_max;
+        u8 width;
+        u8 comparison;
+        u8 reserved[6];
+    };
+
+    /* Selects the regions a search scans. A zero address_max or state_mask places no limit. */
+    struct MemorySearchRegionFilter {
+        u64 address_min;
+        u64 address_max;
+        u32 permission;
+        u32 state_mask;
+    };
+
+    struct MemorySearchResult {
+        u64 address;
+        u64 value;
+    };
+
+    static_assert(util::is_pod<MemorySearchCondition>::value, "MemorySearchCondition");
+    static_assert(util::is_pod<MemorySearchRegionFilter>::value, "MemorySearchRegionFilter");
+    static_assert(util::is_pod<MemorySearchResult>::value, "MemorySearchResult");
+
 }
@@ -99,6 +99,14 @@ namespace ams::fs {
                     Result SetByPosition(Position pos, const Value &value) {
                         R_RETURN(Base::SetByPosition(pos, value));
                     }
+
+                    Result InitializeIndex(const void *kv_buffer) {
+                        R_RETURN(Base::InitializeIndex(kv_buffer, [](const ImplKey &key, const void *aux, size_t aux_size) -> u32 {
+                            ClientKey client_key = { key, {} };
+                            client_key.name.Initialize(static_cast<const RomPathChar *>(aux), aux_size / sizeof(RomPathChar));
+                            return client_key.Hash();
+                        }));
+                    }
             };
 
             struct RomEntryKey {
@@ -150,6 +158,8 @@ namespace ams::fs {
             Result Initialize(SubStorage dir_bucket, SubStorage dir_entry, SubStorage file_bucket, SubStorage file_entry);
             void Finalize();
 
+            Result InitializeIndex(const void *dir_entry_buffer, const void *file_entry_buffer);
+
             Result CreateRootDirectory();
             Result CreateDirectory(RomDirectoryId *out, const RomPathChar *path);
             Result CreateFile(RomFileId *out, const RomPathChar *path, const FileInfo &info);
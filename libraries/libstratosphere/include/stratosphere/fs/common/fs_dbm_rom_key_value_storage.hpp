@@ -45,12 +45,21 @@ namespace ams::fs {
                 StorageSizeType size;
             };
             static_assert(util::is_pod<Element>::value);
+
+            struct IndexSlot {
+                u32 hash_key;
+                Position pos;
+            };
+            static_assert(util::is_pod<IndexSlot>::value);
         private:
             s64 m_bucket_count;
             SubStorage m_bucket_storage;
             SubStorage m_kv_storage;
             s64 m_total_entry_size;
             u32 m_entry_count;
+            const u8 *m_index_kv_buffer;
+            IndexSlot *m_index;
+            size_t m_index_slot_count;
         public:
             static constexpr s64 QueryBucketStorageSize(s64 num) {
                 return num * sizeof(Position);
@@ -72,7 +81,11 @@ namespace ams::fs {
                 R_SUCCEED();
             }
         public:
-            constexpr KeyValueRomStorageTemplate() : m_bucket_count(), m_bucket_storage(), m_kv_storage(), m_total_entry_size(), m_entry_count() { /* ... */ }
+            constexpr KeyValueRomStorageTemplate() : m_bucket_count(), m_bucket_storage(), m_kv_storage(), m_total_entry_size(), m_entry_count(), m_index_kv_buffer(), m_index(), m_index_slot_count() { /* ... */ }
+
+            ~KeyValueRomStorageTemplate() {
+                this->FinalizeIndex();
+            }
 
             Result Initialize(const SubStorage &bucket, s64 count, const SubStorage &kv) {
                 AMS_ASSERT(count > 0);
@@ -83,6 +96,8 @@ namespace ams::fs {
             }
 
             void Finalize() {
+                this->FinalizeIndex();
+
                 m_bucket_storage = SubStorage();
                 m_bucket_count   = 0;
                 m_kv_storage     = SubStorage();
@@ -91,7 +106,96 @@ namespace ams::fs {
             s64 GetTotalEntrySize() const {
                 return m_total_entry_size;
             }
+
+            bool IsIndexEnabled() const {
+                return m_index != nullptr;
+            }
         protected:
+            /* Builds an in-memory open-addressing index over every entry reachable from the buckets, so that lookups need no storage reads. */
+            /* kv_buffer must be the memory backing the entry storage, and hash_func must compute the same hash that callers look up with. */
+            template<typename HashFunction>
+            Result InitializeIndex(const void *kv_buffer, HashFunction hash_func) {
+                AMS_ASSERT(kv_buffer != nullptr);
+                AMS_ASSERT(m_bucket_count > 0);
+
+                this->FinalizeIndex();
+
+                s64 kv_size;
+                R_TRY(m_kv_storage.GetSize(std::addressof(kv_size)));
+
+                /* Count our entries, checking that every chain is well-formed. */
+                const u8 *buffer = static_cast<const u8 *>(kv_buffer);
+                const size_t kv_end          = static_cast<size_t>(kv_size);
+                const size_t max_entry_count = kv_end / sizeof(Element);
+                size_t entry_count = 0;
+                for (BucketIndex ind = 0; ind < m_bucket_count; ++ind) {
+                    Position cur;
+                    R_TRY(this->ReadBucket(std::addressof(cur), ind));
+
+                    while (cur != InvalidPosition) {
+                        R_UNLESS((++entry_count) <= max_entry_count,               fs::ResultDbmInvalidOperation());
+                        R_UNLESS(util::IsAligned(cur, alignof(Element)),           fs::ResultDbmInvalidOperation());
+                        R_UNLESS(static_cast<size_t>(cur) + sizeof(Element) <= kv_end, fs::ResultDbmInvalidOperation());
+
+                        Element elem;
+                        std::memcpy(std::addressof(elem), buffer + cur, sizeof(elem));
+                        R_UNLESS(elem.size <= MaxAuxiliarySize,                                fs::ResultDbmInvalidOperation());
+                        R_UNLESS(static_cast<size_t>(cur) + sizeof(Element) + elem.size <= kv_end, fs::ResultDbmInvalidOperation());
+
+                        /* Entries in the wrong bucket can never be found by a lookup, so the index mustn't find them either. */
+                        R_UNLESS(HashToBucket(hash_func(elem.key, buffer + cur + sizeof(Element), static_cast<size_t>(elem.size))) == ind, fs::ResultDbmInvalidOperation());
+
+                        cur = elem.next;
+                    }
+                }
+
+                /* Allocate our slots, keeping the table at most half full so that probes stay short. */
+                const size_t slot_count = std::max<size_t>(util::CeilingPowerOfTwo(entry_count * 2), 2);
+                IndexSlot *index = static_cast<IndexSlot *>(::ams::fs::impl::Allocate(sizeof(IndexSlot) * slot_count));
+                R_UNLESS(index != nullptr, fs::ResultAllocationMemoryFailedInDbmRomKeyValueStorage());
+
+                for (size_t i = 0; i < slot_count; ++i) {
+                    index[i] = { 0, InvalidPosition };
+                }
+
+                /* Insert every entry. */
+                for (BucketIndex ind = 0; ind < m_bucket_count; ++ind) {
+                    Position cur;
+                    R_TRY(this->ReadBucket(std::addressof(cur), ind));
+
+                    while (cur != InvalidPosition) {
+                        Element elem;
+                        std::memcpy(std::addressof(elem), buffer + cur, sizeof(elem));
+
+                        const u32 hash_key = hash_func(elem.key, buffer + cur + sizeof(Element), static_cast<size_t>(elem.size));
+
+                        size_t slot = hash_key & (slot_count - 1);
+                        while (index[slot].pos != InvalidPosition) {
+                            slot = (slot + 1) & (slot_count - 1);
+                        }
+                        index[slot] = { hash_key, cur };
+
+                        cur = elem.next;
+                    }
+                }
+
+                /* Set our index. */
+                m_index_kv_buffer  = buffer;
+                m_index            = index;
+                m_index_slot_count = slot_count;
+                R_SUCCEED();
+            }
+
+            void FinalizeIndex() {
+                if (m_index != nullptr) {
+                    ::ams::fs::impl::Deallocate(m_index, sizeof(IndexSlot) * m_index_slot_count);
+
+                    m_index_kv_buffer  = nullptr;
+                    m_index            = nullptr;
+                    m_index_slot_count = 0;
+                }
+            }
+
             Result AddInternal(Position *out, const Key &key, u32 hash_key, const void *aux, size_t aux_size, const Value &value) {
                 AMS_ASSERT(out != nullptr);
                 AMS_ASSERT(aux != nullptr || aux_size == 0);
@@ -106,6 +210,9 @@ namespace ams::fs {
                     R_UNLESS(fs::ResultDbmKeyNotFound::Includes(find_res), find_res);
                 }
 
+                /* Our index only describes the entries which existed when it was built. */
+                this->FinalizeIndex();
+
                 Position pos;
                 R_TRY(this->AllocateEntry(std::addressof(pos), static_cast<StorageSizeType>(aux_size)));
 
@@ -182,6 +289,13 @@ namespace ams::fs {
                 *out_pos = 0;
                 *out_prev = 0;
 
+                /* If we have an index, we can find the entry without touching storage. */
+                /* NOTE: The index doesn't know an entry's predecessor, so out_prev is left as zero. This is fine, as */
+                /* AddInternal and GetInternal, our only callers, never read it; a caller which needs it must not use the index. */
+                if (m_index != nullptr) {
+                    R_RETURN(this->FindInIndex(out_pos, out_elem, key, hash_key, aux, aux_size));
+                }
+
                 const BucketIndex ind = HashToBucket(hash_key);
 
                 Position cur;
@@ -211,6 +325,27 @@ namespace ams::fs {
                 }
             }
 
+            Result FindInIndex(Position *out_pos, Element *out_elem, const Key &key, u32 hash_key, const void *aux, size_t aux_size) const {
+                AMS_ASSERT(m_index != nullptr);
+
+                const size_t mask = m_index_slot_count - 1;
+                for (size_t slot = hash_key & mask; m_index[slot].pos != InvalidPosition; slot = (slot + 1) & mask) {
+                    if (m_index[slot].hash_key != hash_key) {
+                        continue;
+                    }
+
+                    const Position cur = m_index[slot].pos;
+                    std::memcpy(out_elem, m_index_kv_buffer + cur, sizeof(*out_elem));
+
+                    if (key.IsEqual(out_elem->key, aux, aux_size, m_index_kv_buffer + cur + sizeof(Element), out_elem->size)) {
+                        *out_pos = cur;
+                        R_SUCCEED();
+                    }
+                }
+
+                R_THROW(fs::ResultDbmKeyNotFound());
+            }
+
             Result AllocateEntry(Position *out, StorageSizeType aux_size) {
                 AMS_ASSERT(out != nullptr);
 
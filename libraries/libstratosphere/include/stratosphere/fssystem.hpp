@@ -48,6 +48,7 @@
 #include <stratosphere/fssystem/fssystem_service_context.hpp>
 #include <stratosphere/fssystem/fssystem_alignment_matching_storage_impl.hpp>
 #include <stratosphere/fssystem/fssystem_alignment_matching_storage.hpp>
+#include <stratosphere/fssystem/fssystem_decompression_worker_pool.hpp>
 #include <stratosphere/fssystem/fssystem_compressed_storage.hpp>
 #include <stratosphere/fssystem/fssystem_buffered_storage.hpp>
 #include <stratosphere/fssystem/fssystem_hierarchical_integrity_verification_storage.hpp>
@@ -29,6 +29,8 @@ namespace ams::fssystem {
 
             static constexpr size_t NodeSizeMin = 1_KB;
             static constexpr size_t NodeSizeMax = 512_KB;
+
+            static constexpr size_t CacheAlignment = 0x40;
         public:
             class Visitor;
 
@@ -238,16 +240,27 @@ namespace ams::fssystem {
             s32 m_offset_count;
             s32 m_entry_set_count;
             OffsetCache m_offset_cache;
+            char *m_cache;
+            size_t m_cache_size;
+            char *m_cached_entry_sets;
+            s64 *m_cached_entry_offsets;
+            bool m_is_cache_valid;
         public:
-            BucketTree() : m_node_storage(), m_entry_storage(), m_node_l1(), m_node_size(), m_entry_size(), m_entry_count(), m_offset_count(), m_entry_set_count(), m_offset_cache() { /* ... */ }
+            BucketTree() : m_node_storage(), m_entry_storage(), m_node_l1(), m_node_size(), m_entry_size(), m_entry_count(), m_offset_count(), m_entry_set_count(), m_offset_cache(), m_cache(), m_cache_size(), m_cached_entry_sets(), m_cached_entry_offsets(), m_is_cache_valid() { /* ... */ }
             ~BucketTree() { this->Finalize(); }
 
+            /* Sets how much memory trees may use in total to keep their L2 nodes and entry sets in memory. */
+            /* Trees initialized while the budget allows are searched without reading their storages. By default, nothing is cached. */
+            static void SetCacheMemorySizeMax(size_t size);
+            static size_t GetCacheMemorySize();
+
             Result Initialize(IAllocator *allocator, fs::SubStorage node_storage, fs::SubStorage entry_storage, size_t node_size, size_t entry_size, s32 entry_count);
             void Initialize(size_t node_size, s64 end_offset);
             void Finalize();
 
             bool IsInitialized() const { return m_node_size > 0; }
             bool IsEmpty() const { return m_entry_size == 0; }
+            bool IsCached() const { return m_is_cache_valid; }
 
             Result Find(Visitor *visitor, s64 virtual_address);
             Result InvalidateCache();
@@ -285,6 +298,19 @@ namespace ams::fssystem {
             }
 
             Result EnsureOffsetCache();
+
+            static size_t QueryCacheSize(size_t node_size, size_t entry_size, s32 node_l2_count, s32 entry_set_count);
+
+            void LoadCache();
+            Result LoadCacheImpl();
+            void FreeCache();
+
+            s32 GetCachedEntryCountPerSet() const { return GetEntryCount(m_node_size, m_entry_size); }
+            const char *GetCachedNodeL2(s32 node_index) const { return m_cache + node_index * m_node_size; }
+            const char *GetCachedEntrySet(s32 entry_set_index) const { return m_cached_entry_sets + entry_set_index * m_node_size; }
+            const s64 *GetCachedEntryOffsets(s32 entry_set_index) const { return m_cached_entry_offsets + entry_set_index * this->GetCachedEntryCountPerSet(); }
+
+            Result ReadEntryStorage(s64 offset, void *buffer, size_t size) const;
     };
 
     /* ACCURATE_TO_VERSION: Unknown */
@@ -346,10 +372,12 @@ namespace ams::fssystem {
             Result FindEntrySet(s32 *out_index, s64 virtual_address, s32 node_index);
             Result FindEntrySetWithBuffer(s32 *out_index, s64 virtual_address, s32 node_index, char *buffer);
             Result FindEntrySetWithoutBuffer(s32 *out_index, s64 virtual_address, s32 node_index);
+            Result FindEntrySetWithCache(s32 *out_index, s64 virtual_address, s32 node_index);
 
             Result FindEntry(s64 virtual_address, s32 entry_set_index);
             Result FindEntryWithBuffer(s64 virtual_address, s32 entry_set_index, char *buffer);
             Result FindEntryWithoutBuffer(s64 virtual_address, s32 entry_set_index);
+            Result FindEntryWithCache(s64 virtual_address, s32 entry_set_index);
     };
 
 }
@@ -45,19 +45,27 @@ namespace ams::fssystem {
         R_UNLESS(entry.GetVirtualOffset() <= cur_offset, fs::ResultOutOfRange());
 
         /* Create a pooled buffer for our scan. */
-        PooledBuffer pool(m_node_size, 1);
-        char *buffer = nullptr;
+        PooledBuffer pool;
+        const char *buffer = nullptr;
 
-        s64 entry_storage_size;
-        R_TRY(m_entry_storage.GetSize(std::addressof(entry_storage_size)));
+        /* Get the node, either from our cache or by reading it. */
+        if (m_is_cache_valid) {
+            R_UNLESS(0 <= param.entry_set.index && param.entry_set.index < m_entry_set_count, fs::ResultInvalidBucketTreeNodeEntryCount());
 
-        /* Read the node. */
-        if (m_node_size <= pool.GetSize()) {
-            buffer = pool.GetBuffer();
-            const auto ofs = param.entry_set.index * static_cast<s64>(m_node_size);
-            R_UNLESS(m_node_size + ofs <= static_cast<size_t>(entry_storage_size), fs::ResultInvalidBucketTreeNodeEntryCount());
+            buffer = this->GetCachedEntrySet(param.entry_set.index);
+        } else {
+            pool.Allocate(m_node_size, 1);
 
-            R_TRY(m_entry_storage.Read(ofs, buffer, m_node_size));
+            s64 entry_storage_size;
+            R_TRY(m_entry_storage.GetSize(std::addressof(entry_storage_size)));
+
+            if (m_node_size <= pool.GetSize()) {
+                const auto ofs = param.entry_set.index * static_cast<s64>(m_node_size);
+                R_UNLESS(m_node_size + ofs <= static_cast<size_t>(entry_storage_size), fs::ResultInvalidBucketTreeNodeEntryCount());
+
+                R_TRY(m_entry_storage.Read(ofs, pool.GetBuffer(), m_node_size));
+                buffer = pool.GetBuffer();
+            }
         }
 
         /* Calculate extents. */
@@ -18,6 +18,7 @@
 #include <stratosphere/fssystem/fssystem_asynchronous_access.hpp>
 #include <stratosphere/fssystem/fssystem_bucket_tree.hpp>
 #include <stratosphere/fssystem/fssystem_compression_common.hpp>
+#include <stratosphere/fssystem/fssystem_decompression_worker_pool.hpp>
 #include <stratosphere/fs/fs_i_buffer_manager.hpp>
 #include <stratosphere/fssystem/impl/fssystem_block_cache_manager.hpp>
 
@@ -62,8 +63,9 @@ namespace ams::fssystem {
                     BucketTree m_table;
                     fs::SubStorage m_data_storage;
                     GetDecompressorFunction m_get_decompressor_function;
+                    DecompressionWorkerPool *m_decompression_worker_pool;
                 public:
-                    CompressedStorageCore() : m_table(), m_data_storage() { /* ... */ }
+                    CompressedStorageCore() : m_table(), m_data_storage(), m_decompression_worker_pool(nullptr) { /* ... */ }
 
                     ~CompressedStorageCore() {
                         this->Finalize();
@@ -95,6 +97,8 @@ namespace ams::fssystem {
                         }
                     }
 
+                    void SetDecompressionWorkerPool(DecompressionWorkerPool *pool) { m_decompression_worker_pool = pool; }
+
                     fs::IStorage *GetDataStorage() { return std::addressof(m_data_storage); }
 
                     Result GetDataStorageSize(s64 *out) {
@@ -484,7 +488,14 @@ namespace ams::fssystem {
                         R_SUCCEED();
                     }
                 public:
-                    using ReadImplFunction = util::IFunction<Result(void *, size_t)>;
+                    enum class ReadImplMode {
+                        /* The destination is filled before read_impl returns. */
+                        Immediate,
+                        /* The destination may be filled at any point before Read returns. */
+                        Deferred,
+                    };
+
+                    using ReadImplFunction = util::IFunction<Result(void *, size_t, ReadImplMode)>;
                     using ReadFunction     = util::IFunction<Result(size_t, const ReadImplFunction &)>;
                 public:
                     Result Read(s64 offset, s64 size, const ReadFunction &read_func) {
@@ -527,17 +538,27 @@ namespace ams::fssystem {
                                     pooled_buffer.AllocateParticularlyLarge(std::min<size_t>(total_required_size, PooledBuffer::GetAllocatableParticularlyLargeSizeMax()), m_block_size_max);
                                 }
 
+                                /* Prepare to hand decompression off to our workers, if we have any. */
+                                /* If the buffer is large enough, we split it in half so that each physical read overlaps with decompression of the previous one. */
+                                DecompressionWorkerPool::Batch decompression_batch(m_decompression_worker_pool);
+                                const bool use_worker_pool   = m_decompression_worker_pool != nullptr;
+                                const size_t half_size       = util::AlignDown(pooled_buffer.GetSize() / 2, CompressionBlockAlignment);
+                                const bool use_double_buffer = use_worker_pool && half_size >= m_block_size_max + CompressionBlockAlignment;
+                                const size_t buffer_size     = use_double_buffer ? half_size : pooled_buffer.GetSize();
+                                size_t buffer_index          = 0;
+
                                 /* Read each of the entries. */
-                                for (s32 entry_idx = 0; entry_idx < entry_count; ++entry_idx) {
+                                /* NOTE: Decompression advances entry_idx past every entry in the chunk, so we only advance it here for direct reads. */
+                                for (s32 entry_idx = 0; entry_idx < entry_count; /* ... */) {
                                     /* Determine the current read size. */
                                     bool will_use_pooled_buffer = false;
                                     const size_t cur_read_size = [&] () ALWAYS_INLINE_LAMBDA -> size_t {
-                                        if (const size_t target_entry_size = static_cast<size_t>(entries[entry_idx].physical_size) + static_cast<size_t>(entries[entry_idx].gap_from_prev); target_entry_size <= pooled_buffer.GetSize()) {
+                                        if (const size_t target_entry_size = static_cast<size_t>(entries[entry_idx].physical_size) + static_cast<size_t>(entries[entry_idx].gap_from_prev); target_entry_size <= buffer_size) {
                                             /* We'll be using the pooled buffer. */
                                             will_use_pooled_buffer = true;
 
                                             /* Determine how much we can read. */
-                                            const size_t max_size = std::min<size_t>(required_access_physical_size, pooled_buffer.GetSize());
+                                            const size_t max_size = std::min<size_t>(required_access_physical_size, buffer_size);
 
                                             size_t read_size = 0;
                                             for (auto n = entry_idx; n < entry_count; ++n) {
@@ -562,8 +583,17 @@ namespace ams::fssystem {
                                     /* Perform the read based on whether or not we'll use the pooled buffer. */
                                     if (will_use_pooled_buffer) {
                                         /* Read the compressed data into the pooled buffer. */
-                                        auto * const buffer = pooled_buffer.GetBuffer();
-                                        R_TRY(m_data_storage.Read(required_access_physical_offset, buffer, cur_read_size));
+                                        auto * const buffer = pooled_buffer.GetBuffer() + buffer_index * buffer_size;
+                                        if (use_double_buffer) {
+                                            /* The other half may still be being decompressed, so let that finish while we read. */
+                                            buffer_index ^= 1;
+                                            R_TRY(m_data_storage.Read(required_access_physical_offset, buffer, cur_read_size));
+                                            R_TRY(decompression_batch.Wait());
+                                        } else {
+                                            /* We can't overwrite data that is still being decompressed. */
+                                            R_TRY(decompression_batch.Wait());
+                                            R_TRY(m_data_storage.Read(required_access_physical_offset, buffer, cur_read_size));
+                                        }
 
                                         /* Temporarily increase our thread priority, while we decompress the data. */
                                         ScopedThreadPriorityChanger cp(+1, ScopedThreadPriorityChanger::Mode::Relative);
@@ -582,10 +612,10 @@ namespace ams::fssystem {
                                                         AMS_ASSERT(buffer_offset + entries[entry_idx].virtual_size <= cur_read_size);
 
                                                         /* Perform no decompression. */
-                                                        R_TRY(read_func(entries[entry_idx].virtual_size, util::MakeIFunction([&] (void *dst, size_t dst_size) -> Result {
+                                                        R_TRY(read_func(entries[entry_idx].virtual_size, util::MakeIFunction([&] (void *dst, size_t dst_size, ReadImplMode mode) -> Result {
                                                             /* Check that the size is valid. */
                                                             AMS_ASSERT(dst_size == entries[entry_idx].virtual_size);
-                                                            AMS_UNUSED(dst_size);
+                                                            AMS_UNUSED(dst_size, mode);
 
                                                             /* We have no compression, so just copy the data out. */
                                                             std::memcpy(dst, buffer + buffer_offset, entries[entry_idx].virtual_size);
@@ -599,10 +629,10 @@ namespace ams::fssystem {
                                                         AMS_ASSERT(buffer_offset <= cur_read_size);
 
                                                         /* Zero the memory. */
-                                                        R_TRY(read_func(entries[entry_idx].virtual_size, util::MakeIFunction([&] (void *dst, size_t dst_size) -> Result {
+                                                        R_TRY(read_func(entries[entry_idx].virtual_size, util::MakeIFunction([&] (void *dst, size_t dst_size, ReadImplMode mode) -> Result {
                                                             /* Check that the size is valid. */
                                                             AMS_ASSERT(dst_size == entries[entry_idx].virtual_size);
-                                                            AMS_UNUSED(dst_size);
+                                                            AMS_UNUSED(dst_size, mode);
 
                                                             /* The data is zeroes, so zero the buffer. */
                                                             std::memset(dst, 0, entries[entry_idx].virtual_size);
@@ -620,11 +650,17 @@ namespace ams::fssystem {
                                                         R_UNLESS(decompressor != nullptr, fs::ResultUnexpectedInCompressedStorageB());
 
                                                         /* Decompress the data. */
-                                                        R_TRY(read_func(entries[entry_idx].virtual_size, util::MakeIFunction([&] (void *dst, size_t dst_size) -> Result {
+                                                        R_TRY(read_func(entries[entry_idx].virtual_size, util::MakeIFunction([&] (void *dst, size_t dst_size, ReadImplMode mode) -> Result {
                                                             /* Check that the size is valid. */
                                                             AMS_ASSERT(dst_size == entries[entry_idx].virtual_size);
                                                             AMS_UNUSED(dst_size);
 
+                                                            /* If the caller allows it, let our workers perform the decompression. */
+                                                            if (use_worker_pool && mode == ReadImplMode::Deferred) {
+                                                                decompression_batch.Submit(decompressor, dst, entries[entry_idx].virtual_size, buffer + buffer_offset, entries[entry_idx].physical_size);
+                                                                R_SUCCEED();
+                                                            }
+
                                                             /* Perform the decompression. */
                                                             R_RETURN(decompressor(dst, entries[entry_idx].virtual_size, buffer + buffer_offset, entries[entry_idx].physical_size));
                                                         })));
@@ -641,14 +677,17 @@ namespace ams::fssystem {
                                         required_access_physical_size   -= entries[entry_idx].gap_from_prev;
 
                                         /* We don't need the buffer (as the data is uncompressed), so just execute the read. */
-                                        R_TRY(read_func(cur_read_size, util::MakeIFunction([&] (void *dst, size_t dst_size) -> Result {
+                                        R_TRY(read_func(cur_read_size, util::MakeIFunction([&] (void *dst, size_t dst_size, ReadImplMode mode) -> Result {
                                             /* Check that the size is valid. */
                                             AMS_ASSERT(dst_size == cur_read_size);
-                                            AMS_UNUSED(dst_size);
+                                            AMS_UNUSED(dst_size, mode);
 
                                             /* Perform the read. */
                                             R_RETURN(m_data_storage.Read(required_access_physical_offset, dst, cur_read_size));
                                         })));
+
+                                        /* We consumed exactly one entry. */
+                                        ++entry_idx;
                                     }
 
                                     /* Advance on. */
@@ -656,16 +695,19 @@ namespace ams::fssystem {
                                     required_access_physical_size   -= cur_read_size;
                                 }
 
+                                /* Wait for any outstanding decompression to complete. */
+                                R_TRY(decompression_batch.Wait());
+
                                 /* Verify that we have nothing remaining to read. */
                                 AMS_ASSERT(required_access_physical_size == 0);
 
                                 R_SUCCEED();
                             } else {
                                 /* We don't need a buffer, so just execute the read. */
-                                R_TRY(read_func(total_required_size, util::MakeIFunction([&] (void *dst, size_t dst_size) -> Result {
+                                R_TRY(read_func(total_required_size, util::MakeIFunction([&] (void *dst, size_t dst_size, ReadImplMode mode) -> Result {
                                     /* Check that the size is valid. */
                                     AMS_ASSERT(dst_size == total_required_size);
-                                    AMS_UNUSED(dst_size);
+                                    AMS_UNUSED(dst_size, mode);
 
                                     /* Perform the read. */
                                     R_RETURN(m_data_storage.Read(required_access_physical_offset, dst, total_required_size));
@@ -759,10 +801,10 @@ namespace ams::fssystem {
                                     };
                                 } else {
                                     /* We have no entries, so we can just perform the read. */
-                                    R_TRY(read_func(static_cast<size_t>(read_size), util::MakeIFunction([&] (void *dst, size_t dst_size) -> Result {
+                                    R_TRY(read_func(static_cast<size_t>(read_size), util::MakeIFunction([&] (void *dst, size_t dst_size, ReadImplMode mode) -> Result {
                                         /* Check the space we should zero is correct. */
                                         AMS_ASSERT(dst_size == static_cast<size_t>(read_size));
-                                        AMS_UNUSED(dst_size);
+                                        AMS_UNUSED(dst_size, mode);
 
                                         /* Zero the memory. */
                                         std::memset(dst, 0, read_size);
@@ -1031,7 +1073,7 @@ namespace ams::fssystem {
                                 AMS_ASSERT(size_buffer_required <= cur_size);
 
                                 /* Perform the read. */
-                                R_TRY(read_impl(cur_dst, size_buffer_required));
+                                R_TRY(read_impl(cur_dst, size_buffer_required, CompressedStorageCore::ReadImplMode::Deferred));
 
                                 /* Advance. */
                                 cur_dst    += size_buffer_required;
@@ -1057,7 +1099,7 @@ namespace ams::fssystem {
                                 pooled_buffer.Allocate(size_buffer_required, size_buffer_required);
 
                                 /* Perform read. */
-                                R_TRY(read_impl(pooled_buffer.GetBuffer(), size_buffer_required));
+                                R_TRY(read_impl(pooled_buffer.GetBuffer(), size_buffer_required, CompressedStorageCore::ReadImplMode::Immediate));
 
                                 /* Copy the data we read to the destination. */
                                 const size_t skip_size = cur_offset - unaligned_range->virtual_offset;
@@ -1384,6 +1426,10 @@ namespace ams::fssystem {
                 m_core.Finalize();
             }
 
+            void SetDecompressionWorkerPool(DecompressionWorkerPool *pool) {
+                m_core.SetDecompressionWorkerPool(pool);
+            }
+
             fs::IStorage *GetDataStorage() {
                 return m_core.GetDataStorage();
             }
@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) Atmosphère-NX
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <vapours.hpp>
+#include <stratosphere/os.hpp>
+#include <stratosphere/fssystem/fssystem_compression_common.hpp>
+
+namespace ams::fssystem {
+
+    class DecompressionWorkerPool {
+        NON_COPYABLE(DecompressionWorkerPool);
+        NON_MOVEABLE(DecompressionWorkerPool);
+        public:
+            static constexpr s32 WorkerCountMax = 8;
+            static constexpr s32 TaskCountMax   = 0x100;
+
+            class Batch;
+        private:
+            struct Task : public util::IntrusiveListBaseNode<Task> {
+                Batch *batch;
+                s32 index;
+                DecompressorFunction decompressor;
+                void *dst;
+                size_t dst_size;
+                const void *src;
+                size_t src_size;
+            };
+
+            using TaskList = util::IntrusiveListBaseTraits<Task>::ListType;
+        public:
+            /* A batch groups the decompressions issued by a single read. */
+            /* Results are reported in submission order, regardless of the order in which workers finish. */
+            class Batch {
+                NON_COPYABLE(Batch);
+                NON_MOVEABLE(Batch);
+                friend class DecompressionWorkerPool;
+                private:
+                    DecompressionWorkerPool *m_pool;
+                    s32 m_submitted_count;
+                    s32 m_pending_count;
+                    s32 m_failed_index;
+                    Result m_failed_result;
+                    os::SdkConditionVariable m_cv;
+                public:
+                    explicit Batch(DecompressionWorkerPool *pool) : m_pool(pool), m_submitted_count(0), m_pending_count(0), m_failed_index(-1), m_failed_result(ResultSuccess()), m_cv() { /* ... */ }
+
+                    ~Batch() {
+                        /* Any submitted task refers to memory owned by our caller, so we must not leave before they're done. */
+                        static_cast<void>(this->Wait());
+                    }
+
+                    void Submit(DecompressorFunction decompressor, void *dst, size_t dst_size, const void *src, size_t src_size);
+                    Result Wait();
+                private:
+                    void SetResult(s32 index, Result result);
+            };
+        private:
+            os::ThreadType m_threads[WorkerCountMax];
+            Task m_tasks[TaskCountMax];
+            TaskList m_free_list;
+            TaskList m_queue;
+            os::SdkMutex m_mutex;
+            os::SdkConditionVariable m_cv;
+            s32 m_worker_count;
+            bool m_is_exiting;
+        public:
+            DecompressionWorkerPool() : m_free_list(), m_queue(), m_mutex(), m_cv(), m_worker_count(0), m_is_exiting(false) { /* ... */ }
+
+            ~DecompressionWorkerPool() {
+                this->Finalize();
+            }
+
+            Result Initialize(void *stack_buffer, size_t stack_buffer_size, s32 worker_count, s32 priority);
+            void Finalize();
+
+            bool IsInitialized() const { return m_worker_count > 0; }
+            s32 GetWorkerCount() const { return m_worker_count; }
+        private:
+            static void WorkerThreadEntry(void *arg) {
+                static_cast<DecompressionWorkerPool *>(arg)->WorkerThread();
+            }
+
+            void WorkerThread();
+
+            Task *AllocateTask();
+            void FreeTask(Task *task);
+            Task *DequeueTask(const Batch *batch);
+
+            void ExecuteTask(Task *task);
+    };
+
+    /* Compressed storages created by the nca file system driver decompress on the registered pool, if there is one. */
+    void RegisterDecompressionWorkerPool(DecompressionWorkerPool *pool);
+    DecompressionWorkerPool *GetRegisteredDecompressionWorkerPool();
+
+}
@@ -72,9 +72,28 @@ namespace ams::fssystem {
 
                 return this->DoGenerateHash(dst, dst_size, src, src_size);
             }
+
+            void GenerateHashes(void *dst, size_t dst_size, const void *src, size_t src_size, size_t block_size) {
+                /* Check pre-conditions. */
+                AMS_ASSERT(dst != nullptr);
+                AMS_ASSERT(src != nullptr);
+                AMS_ASSERT(block_size > 0);
+                AMS_ASSERT(util::IsAligned(src_size, block_size));
+                AMS_ASSERT(dst_size == (src_size / block_size) * IHash256Generator::HashSize);
+
+                return this->DoGenerateHashes(dst, dst_size, src, src_size, block_size);
+            }
         protected:
             virtual Result DoCreate(std::unique_ptr<IHash256Generator> *out) = 0;
             virtual void DoGenerateHash(void *dst, size_t dst_size, const void *src, size_t src_size) = 0;
+
+            virtual void DoGenerateHashes(void *dst, size_t dst_size, const void *src, size_t src_size, size_t block_size) {
+                /* By default, hash each block individually. */
+                AMS_UNUSED(dst_size);
+                for (size_t i = 0; i < src_size / block_size; ++i) {
+                    this->DoGenerateHash(static_cast<u8 *>(dst) + i * IHash256Generator::HashSize, IHash256Generator::HashSize, static_cast<const u8 *>(src) + i * block_size, block_size);
+                }
+            }
     };
 
     /* ACCURATE_TO_VERSION: 14.3.0.0 */
@@ -35,6 +35,8 @@ namespace ams::fssystem {
                 u8 hash[HashSize];
             };
             static_assert(util::is_pod<BlockHash>::value);
+        private:
+            static constexpr size_t HashBatchCountMax = 0x10;
         private:
             fs::SubStorage m_hash_storage;
             fs::SubStorage m_data_storage;
@@ -76,9 +78,10 @@ namespace ams::fssystem {
         private:
             Result ReadBlockSignature(void *dst, size_t dst_size, s64 offset, size_t size);
             Result WriteBlockSignature(const void *src, size_t src_size, s64 offset, size_t size);
-            Result VerifyHash(const void *buf, BlockHash *hash, std::unique_ptr<fssystem::IHash256Generator> &generator);
+            Result VerifyHash(BlockHash *hash, const BlockHash &calc_hash);
 
             void CalcBlockHash(BlockHash *out, const void *buffer, size_t block_size, std::unique_ptr<fssystem::IHash256Generator> &generator) const;
+            void CalcBlockHashes(BlockHash *out, const void *buffer, size_t block_count, std::unique_ptr<fssystem::IHash256Generator> &generator) const;
 
             Result IsCleared(bool *is_cleared, const BlockHash &hash);
         private:
@@ -67,6 +67,10 @@ namespace ams::fssystem {
                 virtual void DoGenerateHash(void *dst, size_t dst_size, const void *src, size_t src_size) override {
                     Traits::Generate(dst, dst_size, src, src_size);
                 }
+
+                virtual void DoGenerateHashes(void *dst, size_t dst_size, const void *src, size_t src_size, size_t block_size) override {
+                    Traits::GenerateHashes(dst, dst_size, src, src_size, block_size);
+                }
         };
 
         struct Sha256Traits {
@@ -75,6 +79,10 @@ namespace ams::fssystem {
             static ALWAYS_INLINE void Generate(void *dst, size_t dst_size, const void *src, size_t src_size) {
                 return crypto::GenerateSha256(dst, dst_size, src, src_size);
             }
+
+            static ALWAYS_INLINE void GenerateHashes(void *dst, size_t dst_size, const void *src, size_t src_size, size_t block_size) {
+                return crypto::GenerateSha256Hashes(dst, dst_size, src, src_size, block_size);
+            }
         };
 
         struct Sha3256Traits {
@@ -83,6 +91,14 @@ namespace ams::fssystem {
             static ALWAYS_INLINE void Generate(void *dst, size_t dst_size, const void *src, size_t src_size) {
                 return crypto::GenerateSha3256(dst, dst_size, src, src_size);
             }
+
+            static ALWAYS_INLINE void GenerateHashes(void *dst, size_t dst_size, const void *src, size_t src_size, size_t block_size) {
+                /* Sha3 has no multi-buffer implementation, so hash each block individually. */
+                AMS_UNUSED(dst_size);
+                for (size_t i = 0; i < src_size / block_size; ++i) {
+                    crypto::GenerateSha3256(static_cast<u8 *>(dst) + i * Generator::HashSize, Generator::HashSize, static_cast<const u8 *>(src) + i * block_size, block_size);
+                }
+            }
         };
     }
 
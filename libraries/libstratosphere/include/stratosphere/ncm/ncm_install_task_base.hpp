@@ -81,6 +81,28 @@ namespace ams::ncm {
     class InstallTaskBase {
         NON_COPYABLE(InstallTaskBase);
         NON_MOVEABLE(InstallTaskBase);
+        public:
+            static constexpr size_t PlaceHolderWriteSlotCountMax   = 4;
+            static constexpr size_t PlaceHolderWriteThreadCountMax = 2;
+        private:
+            enum PlaceHolderWriteSlotState {
+                PlaceHolderWriteSlotState_Free,
+                PlaceHolderWriteSlotState_Pending,
+                PlaceHolderWriteSlotState_Writing,
+            };
+
+            struct PlaceHolderWriteSlot {
+                PlaceHolderWriteSlotState state;
+                u64 sequence;
+                void *buffer;
+                size_t buffer_size;
+                size_t size;
+                s64 offset;
+                InstallContentInfo *content_info;
+                crypto::Sha256Context context;
+                u8 buffered_data[crypto::Sha256Generator::BlockSize];
+                size_t buffered_data_size;
+            };
         private:
             crypto::Sha256Generator m_sha256_generator{};
             StorageId m_install_storage{};
@@ -94,6 +116,18 @@ namespace ams::ncm {
             TimeSpan m_throughput_start_time{};
             os::SdkMutex m_throughput_mutex{};
             FirmwareVariationId m_firmware_variation_id{};
+            PlaceHolderWriteSlot m_write_slots[PlaceHolderWriteSlotCountMax]{};
+            size_t m_write_slot_count{};
+            size_t m_write_slot_pending{};
+            u64 m_write_sequence{};
+            Result m_write_result = ResultSuccess();
+            s64 m_write_offset{};
+            bool m_is_write_pipeline_active{};
+            bool m_exit_write_thread{};
+            os::SdkMutex m_write_mutex{};
+            os::SdkConditionVariable m_write_cv{};
+            os::ThreadType m_write_threads[PlaceHolderWriteThreadCountMax]{};
+            size_t m_write_thread_count{};
         private:
             ALWAYS_INLINE Result SetLastResultOnFailure(Result result) {
                 if (R_FAILED(result)) {
@@ -134,8 +168,12 @@ namespace ams::ncm {
             Result PrepareContentMeta(const InstallContentMetaInfo &meta_info, util::optional<ContentMetaKey> key, util::optional<u32> source_version);
             Result PrepareContentMeta(ContentId content_id, s64 size, ContentMetaType meta_type, AutoBuffer *buffer);
             Result WritePlaceHolderBuffer(InstallContentInfo *content_info, const void *data, size_t data_size);
+            s64 GetPlaceHolderWriteOffset() const { return m_write_offset; }
             void PrepareAgain();
 
+            /* Provides buffers to copy placeholder data into, so that it can be written while more is produced. */
+            void SetPlaceHolderWriteBuffer(void *buffer, size_t buffer_size, size_t slot_count);
+
             Result CountInstallContentMetaData(s32 *out_count);
             Result GetInstallContentMetaData(InstallContentMeta *out_content_meta, s32 index);
             Result DeleteInstallContentMetaData(const ContentMetaKey *keys, s32 num_keys);
@@ -169,11 +207,23 @@ namespace ams::ncm {
             virtual Result OnExecuteComplete() { R_SUCCEED(); }
 
             Result WritePlaceHolder(const ContentMetaKey &key, InstallContentInfo *content_info);
+            Result WritePlaceHolderData(const ContentMetaKey &key, InstallContentInfo *content_info);
+            Result InstallTicketForPlaceHolder(const InstallContentInfo *content_info);
             virtual Result OnWritePlaceHolder(const ContentMetaKey &key, InstallContentInfo *content_info) = 0;
 
             bool IsNecessaryInstallTicket(const fs::RightsId &rights_id);
             virtual Result InstallTicket(const fs::RightsId &rights_id, ContentMetaType meta_type) = 0;
 
+            void BeginPlaceHolderWrites();
+            void EndPlaceHolderWrites();
+            Result WaitPlaceHolderWrites();
+            Result SubmitPlaceHolderWrite(InstallContentInfo *content_info, const void *data, size_t data_size);
+            Result WritePlaceHolderSlot(ContentStorage *storage, util::optional<StorageId> *storage_id, const PlaceHolderWriteSlot &slot);
+            PlaceHolderWriteSlot *FindFreePlaceHolderWriteSlot();
+            PlaceHolderWriteSlot *FindWritablePlaceHolderWriteSlot();
+            void ProcessPlaceHolderWrites();
+            static void PlaceHolderWriteThreadFunction(void *arg);
+
             Result IsNewerThanInstalled(bool *out, const ContentMetaKey &key);
             Result PreparePlaceHolder();
 
@@ -22,6 +22,9 @@ namespace ams::ncm {
     class PackageInstallTaskBase : public InstallTaskBase {
         private:
             using PackagePath = kvdb::BoundedString<256>;
+
+            static constexpr size_t PlaceHolderWriteSlotCount   = 3;
+            static constexpr size_t PlaceHolderWriteSlotSizeMin = 64_KB;
         private:
             PackagePath m_package_root;
             void *m_buffer{};
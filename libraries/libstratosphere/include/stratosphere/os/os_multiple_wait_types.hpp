@@ -34,7 +34,11 @@ namespace ams::os {
 
         u8 state;
         bool is_waiting;
+        #if defined(ATMOSPHERE_OS_LINUX)
+        util::TypedStorage<impl::MultiWaitImpl, util::AlignUp(sizeof(util::IntrusiveListNode) + sizeof(impl::InternalCriticalSection) + 3 * sizeof(void *) + 4 * sizeof(NativeHandle), alignof(void *)), alignof(void *)> impl_storage;
+        #else
         util::TypedStorage<impl::MultiWaitImpl, util::AlignUp(sizeof(util::IntrusiveListNode) + sizeof(impl::InternalCriticalSection) + 2 * sizeof(void *) + sizeof(NativeHandle), alignof(void *)), alignof(void *)> impl_storage;
+        #endif
     };
     static_assert(std::is_trivial<MultiWaitType>::value);
 
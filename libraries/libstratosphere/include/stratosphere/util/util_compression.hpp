@@ -25,4 +25,9 @@ namespace ams::util {
     /* Decompression utilities. */
     int DecompressLZ4(void *dst, size_t dst_size, const void *src, size_t src_size);
 
+    /* Decompresses an LZ4 block, invoking the callback on each unit_size region of output as soon as it is final. */
+    /* The callback also receives any final partial region, and returns false to abort decompression. */
+    using DecompressLZ4Callback = bool (*)(const void *data, size_t size, void *arg);
+    int DecompressLZ4(void *dst, size_t dst_size, const void *src, size_t src_size, size_t unit_size, DecompressLZ4Callback callback, void *arg);
+
 }
\ No newline at end of file
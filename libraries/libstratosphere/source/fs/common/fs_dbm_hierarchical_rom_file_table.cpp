@@ -59,6 +59,16 @@ namespace ams::fs {
         R_SUCCEED();
     }
 
+    Result HierarchicalRomFileTable::InitializeIndex(const void *dir_entry_buffer, const void *file_entry_buffer) {
+        AMS_ASSERT(dir_entry_buffer != nullptr);
+        AMS_ASSERT(file_entry_buffer != nullptr);
+
+        R_TRY(m_dir_table.InitializeIndex(dir_entry_buffer));
+        R_TRY(m_file_table.InitializeIndex(file_entry_buffer));
+
+        R_SUCCEED();
+    }
+
     void HierarchicalRomFileTable::Finalize() {
         m_dir_table.Finalize();
         m_file_table.Finalize();
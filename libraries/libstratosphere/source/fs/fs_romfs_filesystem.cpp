@@ -367,6 +367,8 @@ namespace ams::fs {
         R_TRY(ReadFileHeader(base, std::addressof(header)));
 
         /* Set up our storages. */
+        const void *dir_entry_cache  = nullptr;
+        const void *file_entry_cache = nullptr;
         if (use_cache) {
             const size_t needed_size = CalculateRequiredWorkingMemorySize(header);
             R_UNLESS(work_size >= needed_size, fs::ResultPreconditionViolation());
@@ -377,6 +379,9 @@ namespace ams::fs {
             auto file_bucket_buf = buf; buf += header.file_bucket_size;
             auto file_entry_buf  = buf; buf += header.file_entry_size;
 
+            dir_entry_cache  = dir_entry_buf;
+            file_entry_cache = file_entry_buf;
+
             R_TRY(ReadFile(base, header.directory_bucket_offset, dir_bucket_buf,  header.directory_bucket_size));
             R_TRY(ReadFile(base, header.directory_entry_offset,  dir_entry_buf,   header.directory_entry_size));
             R_TRY(ReadFile(base, header.file_bucket_offset,      file_bucket_buf, header.file_bucket_size));
@@ -409,6 +414,12 @@ namespace ams::fs {
             R_TRY(m_rom_file_table.Initialize(db, de, fb, fe));
         }
 
+        /* If our tables are cached, index them so that path lookups need no storage reads. */
+        /* NOTE: The index is purely an optimization, so we fall back to walking the tables if we can't build it. */
+        if (use_cache) {
+            static_cast<void>(m_rom_file_table.InitializeIndex(dir_entry_cache, file_entry_cache));
+        }
+
         /* Set members. */
         m_entry_size = header.body_offset;
         m_base_storage = base;
@@ -25,6 +25,48 @@ namespace ams::fssystem {
 
         constexpr inline s32 NodeHeaderSize = sizeof(BucketTree::NodeHeader);
 
+        /* Searches switch to a linear count once this few offsets remain, which the compiler can vectorize. */
+        constexpr inline s32 LinearSearchCountMax = 8;
+
+        constinit std::atomic<size_t> g_cache_memory_size_max = 0;
+        constinit std::atomic<size_t> g_cache_memory_size     = 0;
+
+        bool ReserveCacheMemory(size_t size) {
+            size_t cur_size = g_cache_memory_size;
+            do {
+                if (size > g_cache_memory_size_max || cur_size > g_cache_memory_size_max - size) {
+                    return false;
+                }
+            } while (!g_cache_memory_size.compare_exchange_weak(cur_size, cur_size + size));
+
+            return true;
+        }
+
+        void ReleaseCacheMemory(size_t size) {
+            g_cache_memory_size -= size;
+        }
+
+        /* Finds the index of the last offset not greater than the virtual address in a sorted array, or -1 if there is none. */
+        ALWAYS_INLINE s32 FindOffsetIndex(const s64 *offsets, s32 count, s64 virtual_address) {
+            /* Narrow the window without branching on the comparison. Everything before the window is not */
+            /* greater than the address, and everything after it is greater. */
+            const s64 *pos = offsets;
+            s32 len = count;
+            while (len > LinearSearchCountMax) {
+                const s32 half = len / 2;
+                pos  = (pos[half] <= virtual_address) ? pos + half : pos;
+                len -= half;
+            }
+
+            /* Count the offsets in the window which are not greater than the address. */
+            s32 found = 0;
+            for (s32 i = 0; i < len; ++i) {
+                found += (pos[i] <= virtual_address) ? 1 : 0;
+            }
+
+            return static_cast<s32>(pos - offsets) + found - 1;
+        }
+
         class StorageNode {
             private:
                 class Offset {
@@ -113,6 +155,14 @@ namespace ams::fssystem {
 
     }
 
+    void BucketTree::SetCacheMemorySizeMax(size_t size) {
+        g_cache_memory_size_max = size;
+    }
+
+    size_t BucketTree::GetCacheMemorySize() {
+        return g_cache_memory_size;
+    }
+
     void BucketTree::Header::Format(s32 entry_count) {
         AMS_ASSERT(entry_count >= 0);
 
@@ -191,10 +241,114 @@ namespace ams::fssystem {
         m_offset_cache.offsets.end_offset   = end_offset;
         m_offset_cache.is_initialized       = true;
 
+        /* Keep our nodes and entry sets in memory, if we're allowed to. */
+        this->LoadCache();
+
         /* We succeeded. */
         R_SUCCEED();
     }
 
+    size_t BucketTree::QueryCacheSize(size_t node_size, size_t entry_size, s32 node_l2_count, s32 entry_set_count) {
+        /* The cache holds the L2 nodes and entry sets as stored, followed by the offsets of every entry. */
+        const size_t node_cache_size   = (node_l2_count + entry_set_count) * node_size;
+        const size_t offset_cache_size = entry_set_count * GetEntryCount(node_size, entry_size) * sizeof(s64);
+        return node_cache_size + util::AlignUp(offset_cache_size, CacheAlignment);
+    }
+
+    void BucketTree::LoadCache() {
+        AMS_ASSERT(m_cache == nullptr);
+
+        /* Determine how much memory we need. */
+        const s32 node_l2_count = this->IsExistL2() ? GetNodeL2Count(m_node_size, m_entry_size, m_entry_count) : 0;
+        const size_t cache_size = QueryCacheSize(m_node_size, m_entry_size, node_l2_count, m_entry_set_count);
+
+        /* Reserve the memory from our budget. If we can't, we just won't cache. */
+        if (!ReserveCacheMemory(cache_size)) {
+            return;
+        }
+
+        /* Allocate the cache. */
+        m_cache = static_cast<char *>(this->GetAllocator()->Allocate(cache_size, CacheAlignment));
+        if (m_cache == nullptr) {
+            ReleaseCacheMemory(cache_size);
+            return;
+        }
+
+        m_cache_size           = cache_size;
+        m_cached_entry_sets    = m_cache + node_l2_count * m_node_size;
+        m_cached_entry_offsets = reinterpret_cast<s64 *>(m_cached_entry_sets + m_entry_set_count * m_node_size);
+
+        /* Load the cache. If we fail, lookups will read the storages and report any errors themselves. */
+        if (R_FAILED(this->LoadCacheImpl())) {
+            this->FreeCache();
+        }
+    }
+
+    Result BucketTree::LoadCacheImpl() {
+        AMS_ASSERT(m_cache != nullptr);
+        AMS_ASSERT(!m_is_cache_valid);
+
+        /* Load and verify the L2 nodes. */
+        if (this->IsExistL2()) {
+            const s32 node_l2_count = m_node_l1->count;
+            R_UNLESS(node_l2_count <= GetNodeL2Count(m_node_size, m_entry_size, m_entry_count), fs::ResultInvalidBucketTreeNodeEntryCount());
+
+            R_TRY(m_node_storage.Read(m_node_size, m_cache, node_l2_count * m_node_size));
+
+            for (s32 i = 0; i < node_l2_count; ++i) {
+                NodeHeader header;
+                std::memcpy(std::addressof(header), this->GetCachedNodeL2(i), NodeHeaderSize);
+                R_TRY(header.Verify(i, m_node_size, sizeof(s64)));
+            }
+        }
+
+        /* Load and verify the entry sets. */
+        R_TRY(m_entry_storage.Read(0, m_cached_entry_sets, m_entry_set_count * m_node_size));
+
+        /* Gather the offsets of each entry set's entries into a dense array, so that they can be searched directly. */
+        const s32 entry_count_per_set = this->GetCachedEntryCountPerSet();
+        for (s32 i = 0; i < m_entry_set_count; ++i) {
+            NodeHeader header;
+            std::memcpy(std::addressof(header), this->GetCachedEntrySet(i), NodeHeaderSize);
+            R_TRY(header.Verify(i, m_node_size, m_entry_size));
+
+            const char *entries = this->GetCachedEntrySet(i) + NodeHeaderSize;
+            s64 *offsets        = m_cached_entry_offsets + i * entry_count_per_set;
+            for (s32 j = 0; j < entry_count_per_set; ++j) {
+                offsets[j] = j < header.count ? impl::SafeValue::GetInt64(entries + j * m_entry_size) : std::numeric_limits<s64>::max();
+            }
+        }
+
+        m_is_cache_valid = true;
+        R_SUCCEED();
+    }
+
+    void BucketTree::FreeCache() {
+        m_is_cache_valid = false;
+
+        if (m_cache != nullptr) {
+            this->GetAllocator()->Deallocate(m_cache, m_cache_size, CacheAlignment);
+            ReleaseCacheMemory(m_cache_size);
+
+            m_cache                = nullptr;
+            m_cache_size           = 0;
+            m_cached_entry_sets    = nullptr;
+            m_cached_entry_offsets = nullptr;
+        }
+    }
+
+    Result BucketTree::ReadEntryStorage(s64 offset, void *buffer, size_t size) const {
+        /* If we have the entry sets cached, copy from the cache. */
+        if (m_is_cache_valid) {
+            R_UNLESS(0 <= offset && offset + static_cast<s64>(size) <= m_entry_set_count * static_cast<s64>(m_node_size), fs::ResultOutOfRange());
+
+            std::memcpy(buffer, m_cached_entry_sets + offset, size);
+            R_SUCCEED();
+        }
+
+        R_RETURN(m_entry_storage.Read(offset, buffer, size));
+    }
+
     void BucketTree::Initialize(size_t node_size, s64 end_offset) {
         AMS_ASSERT(NodeSizeMin <= node_size && node_size <= NodeSizeMax);
         AMS_ASSERT(util::IsPowerOfTwo(node_size));
@@ -210,6 +364,8 @@ namespace ams::fssystem {
 
     void BucketTree::Finalize() {
         if (this->IsInitialized()) {
+            this->FreeCache();
+
             m_node_storage    = fs::SubStorage();
             m_entry_storage   = fs::SubStorage();
             m_node_l1.Free(m_node_size);
@@ -247,8 +403,14 @@ namespace ams::fssystem {
         /* Invalidate the entry storage cache. */
         R_TRY(m_entry_storage.OperateRange(fs::OperationId::Invalidate, 0, std::numeric_limits<s64>::max()));
 
-        /* Reset our offsets. */
-        m_offset_cache.is_initialized = false;
+        /* Invalidate our cache and reset our offsets, under the offset cache's lock so that we don't race a reload. */
+        /* Our cache will be reloaded along with our offsets. */
+        {
+            std::scoped_lock lk(m_offset_cache.mutex);
+
+            m_is_cache_valid              = false;
+            m_offset_cache.is_initialized = false;
+        }
 
         R_SUCCEED();
     }
@@ -283,7 +445,13 @@ namespace ams::fssystem {
 
         m_offset_cache.offsets.start_offset = start_offset;
         m_offset_cache.offsets.end_offset   = end_offset;
-        m_offset_cache.is_initialized       = true;
+
+        /* Reload our cache, if we have one. */
+        if (m_cache != nullptr && R_FAILED(this->LoadCacheImpl())) {
+            this->FreeCache();
+        }
+
+        m_offset_cache.is_initialized = true;
 
         R_SUCCEED();
     }
@@ -319,7 +487,7 @@ namespace ams::fssystem {
             const auto entry_set_size   = m_tree->m_node_size;
             const auto entry_set_offset = entry_set_index * static_cast<s64>(entry_set_size);
 
-            R_TRY(m_tree->m_entry_storage.Read(entry_set_offset, std::addressof(m_entry_set), sizeof(EntrySetHeader)));
+            R_TRY(m_tree->ReadEntryStorage(entry_set_offset, std::addressof(m_entry_set), sizeof(EntrySetHeader)));
             R_TRY(m_entry_set.header.Verify(entry_set_index, entry_set_size, m_tree->m_entry_size));
 
             R_UNLESS(m_entry_set.info.start == end && m_entry_set.info.start < m_entry_set.info.end, fs::ResultInvalidBucketTreeEntrySetOffset());
@@ -332,7 +500,7 @@ namespace ams::fssystem {
         /* Read the new entry. */
         const auto entry_size   = m_tree->m_entry_size;
         const auto entry_offset = impl::GetBucketTreeEntryOffset(m_entry_set.info.index, m_tree->m_node_size, entry_size, entry_index);
-        R_TRY(m_tree->m_entry_storage.Read(entry_offset, m_entry, entry_size));
+        R_TRY(m_tree->ReadEntryStorage(entry_offset, m_entry, entry_size));
 
         /* Note that we changed index. */
         m_entry_index = entry_index;
@@ -355,7 +523,7 @@ namespace ams::fssystem {
             const auto entry_set_index  = m_entry_set.info.index - 1;
             const auto entry_set_offset = entry_set_index * static_cast<s64>(entry_set_size);
 
-            R_TRY(m_tree->m_entry_storage.Read(entry_set_offset, std::addressof(m_entry_set), sizeof(EntrySetHeader)));
+            R_TRY(m_tree->ReadEntryStorage(entry_set_offset, std::addressof(m_entry_set), sizeof(EntrySetHeader)));
             R_TRY(m_entry_set.header.Verify(entry_set_index, entry_set_size, m_tree->m_entry_size));
 
             R_UNLESS(m_entry_set.info.end == start && m_entry_set.info.start < m_entry_set.info.end, fs::ResultInvalidBucketTreeEntrySetOffset());
@@ -370,7 +538,7 @@ namespace ams::fssystem {
         /* Read the new entry. */
         const auto entry_size   = m_tree->m_entry_size;
         const auto entry_offset = impl::GetBucketTreeEntryOffset(m_entry_set.info.index, m_tree->m_node_size, entry_size, entry_index);
-        R_TRY(m_tree->m_entry_storage.Read(entry_offset, m_entry, entry_size));
+        R_TRY(m_tree->ReadEntryStorage(entry_offset, m_entry, entry_size));
 
         /* Note that we changed index. */
         m_entry_index = entry_index;
@@ -390,26 +558,24 @@ namespace ams::fssystem {
             const auto start = node->GetEnd();
             const auto end   = node->GetBegin() + m_tree->m_offset_count;
 
-            auto pos = std::upper_bound(start, end, virtual_address);
-            R_UNLESS(start < pos, fs::ResultOutOfRange());
-            --pos;
+            const auto index = FindOffsetIndex(start, static_cast<s32>(end - start), virtual_address);
+            R_UNLESS(index >= 0, fs::ResultOutOfRange());
 
-            entry_set_index = static_cast<s32>(pos - start);
+            entry_set_index = index;
         } else {
             const auto start = node->GetBegin();
             const auto end   = node->GetEnd();
 
-            auto pos = std::upper_bound(start, end, virtual_address);
-            R_UNLESS(start < pos, fs::ResultOutOfRange());
-            --pos;
+            const auto index = FindOffsetIndex(start, static_cast<s32>(end - start), virtual_address);
+            R_UNLESS(index >= 0, fs::ResultOutOfRange());
 
             if (m_tree->IsExistL2()) {
-                const auto node_index = static_cast<s32>(pos - start);
+                const auto node_index = index;
                 R_UNLESS(0 <= node_index && node_index < m_tree->m_offset_count, fs::ResultInvalidBucketTreeNodeOffset());
 
                 R_TRY(this->FindEntrySet(std::addressof(entry_set_index), virtual_address, node_index));
             } else {
-                entry_set_index = static_cast<s32>(pos - start);
+                entry_set_index = index;
             }
         }
 
@@ -425,6 +591,11 @@ namespace ams::fssystem {
     }
 
     Result BucketTree::Visitor::FindEntrySet(s32 *out_index, s64 virtual_address, s32 node_index) {
+        /* If the tree is cached, search the cached node. */
+        if (m_tree->IsCached()) {
+            R_RETURN(this->FindEntrySetWithCache(out_index, virtual_address, node_index));
+        }
+
         const auto node_size = m_tree->m_node_size;
 
         PooledBuffer pool(node_size, 1);
@@ -481,7 +652,28 @@ namespace ams::fssystem {
         R_SUCCEED();
     }
 
+    Result BucketTree::Visitor::FindEntrySetWithCache(s32 *out_index, s64 virtual_address, s32 node_index) {
+        /* Get the node. Its header was verified when it was cached. */
+        const char *buffer = m_tree->GetCachedNodeL2(node_index);
+
+        NodeHeader header;
+        std::memcpy(std::addressof(header), buffer, NodeHeaderSize);
+
+        /* Find the entry set. */
+        const auto index = FindOffsetIndex(reinterpret_cast<const s64 *>(buffer + NodeHeaderSize), header.count, virtual_address);
+        R_UNLESS(index >= 0, fs::ResultInvalidBucketTreeVirtualOffset());
+
+        /* Return the index. */
+        *out_index = m_tree->GetEntrySetIndex(header.index, index);
+        R_SUCCEED();
+    }
+
     Result BucketTree::Visitor::FindEntry(s64 virtual_address, s32 entry_set_index) {
+        /* If the tree is cached, search the cached entry set. */
+        if (m_tree->IsCached()) {
+            R_RETURN(this->FindEntryWithCache(virtual_address, entry_set_index));
+        }
+
         const auto entry_set_size = m_tree->m_node_size;
 
         PooledBuffer pool(entry_set_size, 1);
@@ -554,4 +746,27 @@ namespace ams::fssystem {
         R_SUCCEED();
     }
 
+    Result BucketTree::Visitor::FindEntryWithCache(s64 virtual_address, s32 entry_set_index) {
+        /* Get the entry set. Its header was verified when it was cached. */
+        const auto entry_size = m_tree->m_entry_size;
+        const char *buffer    = m_tree->GetCachedEntrySet(entry_set_index);
+
+        EntrySetHeader entry_set;
+        std::memcpy(std::addressof(entry_set), buffer, sizeof(EntrySetHeader));
+
+        /* Find the entry, using the dense array of entry offsets. */
+        const auto entry_index = FindOffsetIndex(m_tree->GetCachedEntryOffsets(entry_set_index), entry_set.info.count, virtual_address);
+        R_UNLESS(entry_index >= 0, fs::ResultOutOfRange());
+
+        /* Copy the data into entry. */
+        const auto entry_offset = impl::GetBucketTreeEntryOffset(0, entry_size, entry_index);
+        std::memcpy(m_entry, buffer + entry_offset, entry_size);
+
+        /* Set our entry set/index. */
+        m_entry_set   = entry_set;
+        m_entry_index = entry_index;
+
+        R_SUCCEED();
+    }
+
 }
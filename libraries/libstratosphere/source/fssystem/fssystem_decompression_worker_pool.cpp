@@ -0,0 +1,256 @@
+/*
+ * Copyright (c) Atmosphère-NX
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stratosphere.hpp>
+
+namespace ams::fssystem {
+
+    namespace {
+
+        constinit DecompressionWorkerPool *g_registered_decompression_worker_pool = nullptr;
+
+    }
+
+    void RegisterDecompressionWorkerPool(DecompressionWorkerPool *pool) {
+        AMS_ASSERT(pool == nullptr || pool->IsInitialized());
+        g_registered_decompression_worker_pool = pool;
+    }
+
+    DecompressionWorkerPool *GetRegisteredDecompressionWorkerPool() {
+        return g_registered_decompression_worker_pool;
+    }
+
+    Result DecompressionWorkerPool::Initialize(void *stack_buffer, size_t stack_buffer_size, s32 worker_count, s32 priority) {
+        /* Check pre-conditions. */
+        AMS_ASSERT(!this->IsInitialized());
+        AMS_ASSERT(stack_buffer != nullptr);
+        AMS_ASSERT(util::IsAligned(reinterpret_cast<uintptr_t>(stack_buffer), os::ThreadStackAlignment));
+        AMS_ASSERT(0 < worker_count && worker_count <= WorkerCountMax);
+
+        /* Determine the stack size for each worker. */
+        const size_t stack_size = util::AlignDown(stack_buffer_size / worker_count, os::ThreadStackAlignment);
+        R_UNLESS(stack_size > 0, fs::ResultInvalidSize());
+
+        /* Set up our task free list. */
+        m_is_exiting = false;
+        for (auto &task : m_tasks) {
+            m_free_list.push_back(task);
+        }
+
+        /* Create our worker threads. */
+        s32 created_count = 0;
+        ON_RESULT_FAILURE {
+            for (s32 i = 0; i < created_count; ++i) {
+                os::DestroyThread(std::addressof(m_threads[i]));
+            }
+            m_free_list.clear();
+        };
+
+        for (created_count = 0; created_count < worker_count; ++created_count) {
+            R_TRY(os::CreateThread(std::addressof(m_threads[created_count]), WorkerThreadEntry, this, static_cast<u8 *>(stack_buffer) + created_count * stack_size, stack_size, priority));
+            os::SetThreadNamePointer(std::addressof(m_threads[created_count]), "fssystem.DecompressionWorker");
+        }
+
+        /* Start our worker threads. */
+        m_worker_count = worker_count;
+        for (s32 i = 0; i < m_worker_count; ++i) {
+            os::StartThread(std::addressof(m_threads[i]));
+        }
+
+        R_SUCCEED();
+    }
+
+    void DecompressionWorkerPool::Finalize() {
+        /* If we're not initialized, there's nothing to do. */
+        if (!this->IsInitialized()) {
+            return;
+        }
+
+        /* Tell our workers to exit. */
+        {
+            std::scoped_lock lk(m_mutex);
+
+            AMS_ASSERT(m_queue.empty());
+            m_is_exiting = true;
+            m_cv.Broadcast();
+        }
+
+        /* Wait for our workers to exit. */
+        for (s32 i = 0; i < m_worker_count; ++i) {
+            os::WaitThread(std::addressof(m_threads[i]));
+            os::DestroyThread(std::addressof(m_threads[i]));
+        }
+
+        /* Reset our state. */
+        m_free_list.clear();
+        m_worker_count = 0;
+    }
+
+    void DecompressionWorkerPool::WorkerThread() {
+        std::scoped_lock lk(m_mutex);
+
+        while (true) {
+            /* Wait for a task to become available. */
+            while (m_queue.empty() && !m_is_exiting) {
+                m_cv.Wait(m_mutex);
+            }
+
+            /* If we have nothing to do and are exiting, we're done. */
+            if (m_queue.empty()) {
+                break;
+            }
+
+            /* Take the oldest task. */
+            Task *task = std::addressof(m_queue.front());
+            m_queue.pop_front();
+
+            /* Execute the task. */
+            this->ExecuteTask(task);
+        }
+    }
+
+    DecompressionWorkerPool::Task *DecompressionWorkerPool::AllocateTask() {
+        /* Check pre-conditions. */
+        AMS_ASSERT(m_mutex.IsLockedByCurrentThread());
+
+        /* If we have no free tasks, the caller will decompress on its own. */
+        if (m_free_list.empty()) {
+            return nullptr;
+        }
+
+        Task *task = std::addressof(m_free_list.front());
+        m_free_list.pop_front();
+        return task;
+    }
+
+    void DecompressionWorkerPool::FreeTask(Task *task) {
+        /* Check pre-conditions. */
+        AMS_ASSERT(m_mutex.IsLockedByCurrentThread());
+
+        m_free_list.push_back(*task);
+    }
+
+    DecompressionWorkerPool::Task *DecompressionWorkerPool::DequeueTask(const Batch *batch) {
+        /* Check pre-conditions. */
+        AMS_ASSERT(m_mutex.IsLockedByCurrentThread());
+
+        /* Find the oldest queued task belonging to the batch. */
+        for (auto it = m_queue.begin(); it != m_queue.end(); ++it) {
+            if (it->batch == batch) {
+                Task *task = std::addressof(*it);
+                m_queue.erase(it);
+                return task;
+            }
+        }
+
+        return nullptr;
+    }
+
+    void DecompressionWorkerPool::ExecuteTask(Task *task) {
+        /* Check pre-conditions. */
+        AMS_ASSERT(m_mutex.IsLockedByCurrentThread());
+
+        /* Perform the decompression without holding our lock. */
+        Result result;
+        {
+            m_mutex.Unlock();
+            ON_SCOPE_EXIT { m_mutex.Lock(); };
+
+            result = task->decompressor(task->dst, task->dst_size, task->src, task->src_size);
+        }
+
+        /* Notify the batch that the task has completed. */
+        Batch *batch = task->batch;
+        batch->SetResult(task->index, result);
+        if ((--batch->m_pending_count) == 0) {
+            batch->m_cv.Broadcast();
+        }
+
+        /* Return the task to the free list. */
+        this->FreeTask(task);
+    }
+
+    void DecompressionWorkerPool::Batch::SetResult(s32 index, Result result) {
+        /* We only track the earliest failure, so that our result is independent of completion order. */
+        if (R_FAILED(result) && (m_failed_index < 0 || index < m_failed_index)) {
+            m_failed_index  = index;
+            m_failed_result = result;
+        }
+    }
+
+    void DecompressionWorkerPool::Batch::Submit(DecompressorFunction decompressor, void *dst, size_t dst_size, const void *src, size_t src_size) {
+        /* Check pre-conditions. */
+        AMS_ASSERT(decompressor != nullptr);
+
+        /* Determine the submission index. */
+        const s32 index = m_submitted_count++;
+
+        /* If we can, hand the task to our pool. */
+        if (m_pool != nullptr && m_pool->IsInitialized()) {
+            std::scoped_lock lk(m_pool->m_mutex);
+
+            if (Task *task = m_pool->AllocateTask(); task != nullptr) {
+                /* Set up the task. */
+                task->batch        = this;
+                task->index        = index;
+                task->decompressor = decompressor;
+                task->dst          = dst;
+                task->dst_size     = dst_size;
+                task->src          = src;
+                task->src_size     = src_size;
+
+                /* Enqueue the task. */
+                ++m_pending_count;
+                m_pool->m_queue.push_back(*task);
+                m_pool->m_cv.Signal();
+                return;
+            }
+        }
+
+        /* We couldn't get a worker task, so decompress on the calling thread. */
+        const Result result = decompressor(dst, dst_size, src, src_size);
+        if (m_pool != nullptr) {
+            std::scoped_lock lk(m_pool->m_mutex);
+            this->SetResult(index, result);
+        } else {
+            this->SetResult(index, result);
+        }
+    }
+
+    Result DecompressionWorkerPool::Batch::Wait() {
+        /* Wait for all of our tasks to complete. */
+        if (m_pool != nullptr) {
+            std::scoped_lock lk(m_pool->m_mutex);
+
+            while (m_pending_count > 0) {
+                /* Rather than sleeping, help out with any of our tasks that no worker has picked up yet. */
+                if (Task *task = m_pool->DequeueTask(this); task != nullptr) {
+                    m_pool->ExecuteTask(task);
+                } else {
+                    m_cv.Wait(m_pool->m_mutex);
+                }
+            }
+        }
+
+        /* Reset our state, so that we can be re-used. */
+        const Result result = m_failed_result;
+        m_submitted_count = 0;
+        m_failed_index    = -1;
+        m_failed_result   = ResultSuccess();
+
+        R_RETURN(result);
+    }
+
+}
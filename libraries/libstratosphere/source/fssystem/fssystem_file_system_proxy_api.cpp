@@ -36,9 +36,16 @@ namespace ams::fssystem {
         constexpr size_t DeviceBufferSize      = 1_MB;
         constexpr size_t BufferManagerHeapSize = 1_MB;
 
+        /* Bucket trees (for patched, sparse and compressed ncas) may keep up to 256 KB of their tables in memory, out of the buffer pool. */
+        constexpr size_t BucketTreeCacheMemorySize = 256_KB;
+
         constexpr size_t MaxCacheCount = 1024;
         constexpr size_t BlockSize     = 16_KB;
 
+        /* Compressed ncas decompress on a small worker pool, so that reads overlap with decompression. */
+        constexpr s32 DecompressionWorkerCount        = 2;
+        constexpr size_t DecompressionWorkerStackSize = 16_KB;
+
         alignas(os::MemoryPageSize) constinit u8 g_exp_heap_buffer[ExpHeapSize];
         constinit lmem::HeapHandle g_exp_heap_handle = nullptr;
         constinit fssrv::PeakCheckableMemoryResourceFromExpHeap g_exp_allocator(ExpHeapSize);
@@ -83,6 +90,18 @@ namespace ams::fssystem {
         constinit util::TypedStorage<fssystem::FileSystemBufferManager> g_buffer_manager = {};
         alignas(os::MemoryPageSize) constinit u8 g_buffer_manager_heap[BufferManagerHeapSize] = {};
 
+        constinit util::TypedStorage<fssystem::DecompressionWorkerPool> g_decompression_worker_pool = {};
+        alignas(os::ThreadStackAlignment) constinit u8 g_decompression_worker_stack[DecompressionWorkerCount * DecompressionWorkerStackSize] = {};
+
+        void InitializeDecompressionWorkerPool() {
+            util::ConstructAt(g_decompression_worker_pool);
+
+            /* NOTE: If we can't create our workers, compressed storages just decompress on the reading thread. */
+            if (R_SUCCEEDED(GetReference(g_decompression_worker_pool).Initialize(g_decompression_worker_stack, sizeof(g_decompression_worker_stack), DecompressionWorkerCount, AMS_GET_SYSTEM_THREAD_PRIORITY(fs, DecompressionWorker)))) {
+                fssystem::RegisterDecompressionWorkerPool(GetPointer(g_decompression_worker_pool));
+            }
+        }
+
         /* FileSystem creators. */
         constinit util::TypedStorage<fssrv::fscreator::RomFileSystemCreator>       g_rom_fs_creator = {};
         constinit util::TypedStorage<fssrv::fscreator::PartitionFileSystemCreator> g_partition_fs_creator = {};
@@ -119,6 +138,7 @@ namespace ams::fssystem {
         /* Initialize buffer allocator. */
         util::ConstructAt(g_buffer_allocator, g_buffer_pool, BufferPoolSize);
         util::ConstructAt(g_allocator, GetPointer(g_buffer_allocator));
+        fssystem::BucketTree::SetCacheMemorySizeMax(BucketTreeCacheMemorySize);
 
         /* Set allocators. */
         /* TODO FS-REIMPL: sf::SetGlobalDefaultMemoryResource() */
@@ -135,6 +155,9 @@ namespace ams::fssystem {
         /* TODO FS-REIMPL: fssrv::storage::CreateDeviceAddressSpace(...); */
         fssystem::InitializeBufferPool(reinterpret_cast<char *>(g_device_buffer), DeviceBufferSize);
 
+        /* Initialize the decompression worker pool. */
+        InitializeDecompressionWorkerPool();
+
         /* TODO FS-REIMPL: Create Pooled Threads/Stack Usage Reporter, fssystem::RegisterThreadPool. */
 
         /* TODO FS-REIMPL: fssrv::GetFileSystemProxyServices(), some service creation. */
@@ -221,6 +244,7 @@ namespace ams::fssystem {
         /* Initialize buffer allocator. */
         util::ConstructAt(g_buffer_allocator, g_buffer_pool, BufferPoolSize);
         util::ConstructAt(g_allocator, GetPointer(g_buffer_allocator));
+        fssystem::BucketTree::SetCacheMemorySizeMax(BucketTreeCacheMemorySize);
 
         /* Set allocators. */
         /* TODO FS-REIMPL: sf::SetGlobalDefaultMemoryResource() */
@@ -237,6 +261,9 @@ namespace ams::fssystem {
         /* TODO FS-REIMPL: fssrv::storage::CreateDeviceAddressSpace(...); */
         fssystem::InitializeBufferPool(reinterpret_cast<char *>(g_device_buffer), DeviceBufferSize);
 
+        /* Initialize the decompression worker pool. */
+        InitializeDecompressionWorkerPool();
+
         /* TODO FS-REIMPL: Create Pooled Threads/Stack Usage Reporter, fssystem::RegisterThreadPool. */
 
         /* TODO FS-REIMPL: fssrv::GetFileSystemProxyServices(), some service creation. */
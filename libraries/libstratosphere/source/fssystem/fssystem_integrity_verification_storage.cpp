@@ -136,22 +136,31 @@ namespace ams::fssystem {
             /* Temporarily increase our priority. */
             ScopedThreadPriorityChanger cp(+1, ScopedThreadPriorityChanger::Mode::Relative);
 
-            /* Loop over each signature we read. */
-            for (size_t i = 0; i < cur_count && R_SUCCEEDED(cur_result); ++i) {
-                const auto verified_size = (verified_count + i) << m_verification_block_order;
-                u8 *cur_buf = static_cast<u8 *>(buffer) + verified_size;
-                cur_result = this->VerifyHash(cur_buf, reinterpret_cast<BlockHash *>(signature_buffer.GetBuffer()) + i, generator);
-
-                /* If the data is corrupted, clear the corrupted parts. */
-                if (fs::ResultIntegrityVerificationStorageCorrupted::Includes(cur_result)) {
-                    std::memset(cur_buf, 0, m_verification_block_size);
-
-                    /* Set the result if we should. */
-                    if (!fs::ResultClearedRealDataVerificationFailed::Includes(cur_result) && !m_allow_cleared_blocks) {
-                        verify_hash_result = cur_result;
+            /* Loop over the signatures we read, hashing several blocks at once so that the hash generator can process them in parallel. */
+            for (size_t batch_start = 0; batch_start < cur_count && R_SUCCEEDED(cur_result); batch_start += HashBatchCountMax) {
+                const auto batch_count = std::min(HashBatchCountMax, cur_count - batch_start);
+                u8 *batch_buf = static_cast<u8 *>(buffer) + ((verified_count + batch_start) << m_verification_block_order);
+
+                /* Calculate the hashes for the batch. */
+                BlockHash calc_hashes[HashBatchCountMax];
+                this->CalcBlockHashes(calc_hashes, batch_buf, batch_count, generator);
+
+                /* Verify each hash in the batch. */
+                for (size_t i = 0; i < batch_count && R_SUCCEEDED(cur_result); ++i) {
+                    u8 *cur_buf = batch_buf + (i << m_verification_block_order);
+                    cur_result = this->VerifyHash(reinterpret_cast<BlockHash *>(signature_buffer.GetBuffer()) + batch_start + i, calc_hashes[i]);
+
+                    /* If the data is corrupted, clear the corrupted parts. */
+                    if (fs::ResultIntegrityVerificationStorageCorrupted::Includes(cur_result)) {
+                        std::memset(cur_buf, 0, m_verification_block_size);
+
+                        /* Set the result if we should. */
+                        if (!fs::ResultClearedRealDataVerificationFailed::Includes(cur_result) && !m_allow_cleared_blocks) {
+                            verify_hash_result = cur_result;
+                        }
+
+                        cur_result = ResultSuccess();
                     }
-
-                    cur_result = ResultSuccess();
                 }
             }
 
@@ -232,10 +241,8 @@ namespace ams::fssystem {
                 {
                     ScopedThreadPriorityChanger cp(+1, ScopedThreadPriorityChanger::Mode::Relative);
 
-                    for (size_t i = 0; i < cur_count; ++i) {
-                        const auto updated_size = (updated_count + i) << m_verification_block_order;
-                        this->CalcBlockHash(reinterpret_cast<BlockHash *>(signature_buffer.GetBuffer()) + i, reinterpret_cast<const u8 *>(buffer) + updated_size, generator);
-                    }
+                    const auto updated_size = updated_count << m_verification_block_order;
+                    this->CalcBlockHashes(reinterpret_cast<BlockHash *>(signature_buffer.GetBuffer()), reinterpret_cast<const u8 *>(buffer) + updated_size, cur_count, generator);
                 }
 
                 /* Write the new block signatures. */
@@ -393,6 +400,26 @@ namespace ams::fssystem {
         }
     }
 
+    void IntegrityVerificationStorage::CalcBlockHashes(BlockHash *out, const void *buffer, size_t block_count, std::unique_ptr<fssystem::IHash256Generator> &generator) const {
+        /* Salted hashes can't be batched, so calculate them one at a time. */
+        if (m_is_writable && m_salt.has_value()) {
+            for (size_t i = 0; i < block_count; ++i) {
+                this->CalcBlockHash(out + i, static_cast<const u8 *>(buffer) + (i << m_verification_block_order), generator);
+            }
+            return;
+        }
+
+        /* Calculate all the hashes at once. */
+        m_hash_generator_factory->GenerateHashes(out, block_count * sizeof(*out), buffer, block_count << m_verification_block_order, static_cast<size_t>(m_verification_block_size));
+
+        /* If we're writable, set the validation bits. */
+        if (m_is_writable) {
+            for (size_t i = 0; i < block_count; ++i) {
+                SetValidationBit(out + i);
+            }
+        }
+    }
+
     Result IntegrityVerificationStorage::ReadBlockSignature(void *dst, size_t dst_size, s64 offset, size_t size) {
         /* Validate preconditions. */
         AMS_ASSERT(dst != nullptr);
@@ -441,9 +468,8 @@ namespace ams::fssystem {
         R_SUCCEED();
     }
 
-    Result IntegrityVerificationStorage::VerifyHash(const void *buf, BlockHash *hash, std::unique_ptr<fssystem::IHash256Generator> &generator) {
+    Result IntegrityVerificationStorage::VerifyHash(BlockHash *hash, const BlockHash &calc_hash) {
         /* Validate preconditions. */
-        AMS_ASSERT(buf != nullptr);
         AMS_ASSERT(hash != nullptr);
 
         /* Get the comparison hash. */
@@ -456,10 +482,6 @@ namespace ams::fssystem {
             R_UNLESS(!is_cleared, fs::ResultClearedRealDataVerificationFailed());
         }
 
-        /* Get the calculated hash. */
-        BlockHash calc_hash;
-        this->CalcBlockHash(std::addressof(calc_hash), buf, generator);
-
         /* Check that the signatures are equal. */
         if (!crypto::IsSameBytes(std::addressof(cmp_hash), std::addressof(calc_hash), sizeof(BlockHash))) {
             /* Clear the comparison hash. */
@@ -1246,6 +1246,9 @@ namespace ams::fssystem {
         /* Initialize the compressed storage. */
         R_TRY(compressed_storage->Initialize(allocator, buffer_manager, fs::SubStorage(base_storage, 0, table_offset), fs::SubStorage(base_storage, table_offset, node_size), fs::SubStorage(base_storage, table_offset + node_size, entry_size), header.entry_count, 64_KB, 640_KB, get_decompressor, 16_KB, 16_KB, 32));
 
+        /* Decompress on our worker pool, if one has been registered. */
+        compressed_storage->SetDecompressionWorkerPool(GetRegisteredDecompressionWorkerPool());
+
         /* Potentially set the output compressed storage. */
         if (out_cmp) {
             *out_cmp = compressed_storage;
@@ -234,6 +234,8 @@ namespace ams::fssystem {
         R_TRY(base->Read(0, std::addressof(header), sizeof(header)));
 
         /* Set up our storages. */
+        const void *dir_entry_cache  = nullptr;
+        const void *file_entry_cache = nullptr;
         if (use_cache) {
             const size_t needed_size = CalculateRequiredWorkingMemorySize(header);
             R_UNLESS(work_size >= needed_size, fs::ResultAllocationMemoryFailedInRomFsFileSystemA());
@@ -244,6 +246,9 @@ namespace ams::fssystem {
             auto file_bucket_buf = buf; buf += header.file_bucket_size;
             auto file_entry_buf  = buf; buf += header.file_entry_size;
 
+            dir_entry_cache  = dir_entry_buf;
+            file_entry_cache = file_entry_buf;
+
             R_TRY(base->Read(header.directory_bucket_offset, dir_bucket_buf,  static_cast<size_t>(header.directory_bucket_size)));
             R_TRY(base->Read(header.directory_entry_offset,  dir_entry_buf,   static_cast<size_t>(header.directory_entry_size)));
             R_TRY(base->Read(header.file_bucket_offset,      file_bucket_buf, static_cast<size_t>(header.file_bucket_size)));
@@ -272,6 +277,12 @@ namespace ams::fssystem {
                                           fs::SubStorage(m_file_bucket_storage.get(), 0, static_cast<u32>(header.file_bucket_size)),
                                           fs::SubStorage(m_file_entry_storage.get(),  0, static_cast<u32>(header.file_entry_size))));
 
+        /* If our tables are cached, index them so that path lookups need no storage reads. */
+        /* NOTE: The index is purely an optimization, so we fall back to walking the tables if we can't build it. */
+        if (use_cache) {
+            static_cast<void>(m_rom_file_table.InitializeIndex(dir_entry_cache, file_entry_cache));
+        }
+
         /* Set members. */
         m_entry_size = header.body_offset;
         m_base_storage = base;
@@ -124,7 +124,16 @@ namespace ams::lm::srv {
 
             /* Do flush loop. */
             do {
-                if (LogBuffer::GetDefaultInstance().Flush()) {
+                /* If the sd card logger is holding batched logs, make sure we wake up in time to commit them. */
+                bool flushed;
+                if (TimeSpan timeout; SdCardLogger::GetInstance().GetTimeUntilFlush(std::addressof(timeout))) {
+                    flushed = LogBuffer::GetDefaultInstance().TimedFlush(timeout);
+                    SdCardLogger::GetInstance().FlushIfExpired();
+                } else {
+                    flushed = LogBuffer::GetDefaultInstance().Flush();
+                }
+
+                if (flushed) {
                     EventLogTransmitter::GetDefaultInstance().PushLogPacketDropCountIfExists();
                 }
             } while (WaitForFlush());
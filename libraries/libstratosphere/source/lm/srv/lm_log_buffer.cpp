@@ -93,8 +93,8 @@ namespace ams::lm::srv {
     }
 
     void LogBuffer::CancelPush() {
-        /* Acquire exclusive access to the push buffer. */
-        std::scoped_lock lk(m_push_buffer_mutex);
+        /* Acquire exclusive access to the wait state. */
+        std::scoped_lock lk(m_wait_mutex);
 
         /* Cancel any pending pushes. */
         if (m_push_ready_wait_count > 0) {
@@ -103,9 +103,89 @@ namespace ams::lm::srv {
         }
     }
 
+    bool LogBuffer::WaitPushReady(u64 index) {
+        /* Acquire exclusive access to the wait state. */
+        std::scoped_lock lk(m_wait_mutex);
+
+        /* Note that we're waiting before checking, so that the flush thread can't miss us. */
+        ++m_push_ready_wait_count;
+
+        /* Wait for the flush thread to free the chunk we want to push to. */
+        bool is_ready = true;
+        while (this->IsChunkInUse(index)) {
+            m_cv_push_ready.Wait(m_wait_mutex);
+
+            /* Check if push was canceled. */
+            if (m_push_canceled) {
+                is_ready = false;
+                break;
+            }
+        }
+
+        /* The last waiter clears any cancellation. */
+        if ((--m_push_ready_wait_count) == 0) {
+            m_push_canceled = false;
+        }
+
+        return is_ready;
+    }
+
+    void LogBuffer::NotifyPushReady() {
+        /* Only take the lock if someone's waiting. */
+        if (m_push_ready_wait_count > 0) {
+            std::scoped_lock lk(m_wait_mutex);
+            m_cv_push_ready.Broadcast();
+        }
+    }
+
+    template<typename F>
+    bool LogBuffer::WaitFlushReady(F is_ready, bool blocking, util::optional<TimeSpan> timeout) {
+        /* Check if we're already ready. */
+        if (is_ready()) {
+            return true;
+        }
+
+        /* Only block if we're allowed to. */
+        if (!blocking) {
+            return false;
+        }
+
+        /* Acquire exclusive access to the wait state. */
+        std::scoped_lock lk(m_wait_mutex);
+
+        /* Determine when we should stop waiting, if we should. */
+        const os::Tick end_tick = timeout.has_value() ? os::GetSystemTick() + os::ConvertToTick(*timeout) : os::Tick();
+
+        /* Wait for us to be ready to flush. */
+        m_is_flush_ready_waiting = true;
+        ON_SCOPE_EXIT { m_is_flush_ready_waiting = false; };
+
+        while (!is_ready()) {
+            if (timeout.has_value()) {
+                const os::Tick cur_tick = os::GetSystemTick();
+                if (cur_tick >= end_tick) {
+                    return false;
+                }
+
+                m_cv_flush_ready.TimedWait(m_wait_mutex, (end_tick - cur_tick).ToTimeSpan());
+            } else {
+                m_cv_flush_ready.Wait(m_wait_mutex);
+            }
+        }
+
+        return true;
+    }
+
+    void LogBuffer::NotifyFlushReady() {
+        /* Only take the lock if the flush thread is waiting. */
+        if (m_is_flush_ready_waiting) {
+            std::scoped_lock lk(m_wait_mutex);
+            m_cv_flush_ready.Signal();
+        }
+    }
+
     bool LogBuffer::PushImpl(const void *data, size_t size, bool blocking) {
         /* Check pre-conditions. */
-        AMS_ASSERT(size <= m_buffer_size);
         AMS_ASSERT(data != nullptr || size == 0);
 
         /* Check that we have data to push. */
@@ -113,95 +193,103 @@ namespace ams::lm::srv {
             return true;
         }
 
-        /* Wait to be able to push. */
-        u8 *dst;
-        {
-            /* Acquire exclusive access to the push buffer. */
-            std::scoped_lock lk(m_push_buffer_mutex);
+        /* Check that the data fits in a chunk. */
+        if (size > m_chunk_size) {
+            return false;
+        }
+
+        while (true) {
+            /* Get the chunk currently being pushed to. */
+            u64 index = m_push_index;
 
-            /* Wait for enough space to be available. */
-            while (size > m_buffer_size - m_push_buffer->m_stored_size) {
+            /* If the chunk hasn't been flushed since its last lap, wait for it to be. */
+            if (this->IsChunkInUse(index)) {
                 /* Only block if we're allowed to. */
-                if (!blocking) {
+                if (!blocking || !this->WaitPushReady(index)) {
                     return false;
                 }
 
-                /* Wait for push to be ready. */
-                {
-                    ++m_push_ready_wait_count;
-                    m_cv_push_ready.Wait(m_push_buffer_mutex);
-                    --m_push_ready_wait_count;
-                }
+                continue;
+            }
 
-                /* Check if push was canceled. */
-                if (m_push_canceled) {
-                    if (m_push_ready_wait_count == 0) {
-                        m_push_canceled = false;
-                    }
+            /* Try to reserve space in the chunk. */
+            Chunk &chunk = m_chunks[index % ChunkCount];
+            const u32 lap = static_cast<u32>(index / ChunkCount);
 
-                    return false;
-                }
-            }
+            u64 state = chunk.state;
+            while (GetLap(state) == lap && !IsSealed(state)) {
+                const size_t reserved_size = GetReservedSize(state);
 
-            /* Set the destination. */
-            dst = m_push_buffer->m_head + m_push_buffer->m_stored_size;
+                /* If the chunk is full, seal it so that it can be flushed. */
+                if (reserved_size + size > m_chunk_size) {
+                    chunk.state.compare_exchange_weak(state, state | StateSealedFlag);
+                    continue;
+                }
 
-            /* Advance the push buffer. */
-            m_push_buffer->m_stored_size += size;
-            ++m_push_buffer->m_reference_count;
-        }
+                /* Reserve space for our data. */
+                if (chunk.state.compare_exchange_weak(state, state + size)) {
+                    /* Copy the data to the chunk. */
+                    std::memcpy(this->GetChunkBuffer(index) + reserved_size, data, size);
 
-        /* Copy the data to the push buffer. */
-        std::memcpy(dst, data, size);
+                    /* Commit the data, and signal that we can flush. */
+                    chunk.committed_size += size;
+                    this->NotifyFlushReady();
 
-        /* Close our push buffer reference, and signal that we can flush. */
-        {
-            /* Acquire exclusive access to the push buffer. */
-            std::scoped_lock lk(m_push_buffer_mutex);
+                    return true;
+                }
+            }
 
-            /* If there are no pending pushes, signal that we can flush. */
-            if ((--m_push_buffer->m_reference_count) == 0) {
-                m_cv_flush_ready.Signal();
+            /* The chunk is sealed, so advance to the next one. */
+            if (GetLap(state) == lap) {
+                m_push_index.compare_exchange_strong(index, index + 1);
             }
         }
-
-        return true;
     }
 
-    bool LogBuffer::FlushImpl(bool blocking) {
-        /* Acquire exclusive access to the flush buffer. */
-        std::scoped_lock lk(m_flush_buffer_mutex);
+    bool LogBuffer::FlushImpl(bool blocking, util::optional<TimeSpan> timeout) {
+        /* Acquire exclusive access to flushing. */
+        std::scoped_lock lk(m_flush_mutex);
 
-        /* If we don't have data to flush, wait for us to have data. */
-        if (m_flush_buffer->m_stored_size == 0) {
-            /* Acquire exclusive access to the push buffer. */
-            std::scoped_lock lk(m_push_buffer_mutex);
+        /* Wait for there to be pushed data. */
+        const u64 first_index = m_flush_index;
+        if (!this->WaitFlushReady([&] { return m_chunks[first_index % ChunkCount].committed_size > 0; }, blocking, timeout)) {
+            return false;
+        }
 
-            /* Wait for there to be pushed data. */
-            while (m_push_buffer->m_stored_size == 0 || m_push_buffer->m_reference_count != 0) {
-                /* Only block if we're allowed to. */
-                if (!blocking) {
-                    return false;
-                }
+        /* Flush every chunk with data, in order, for at most one lap of the ring. */
+        for (u64 index = first_index; index - first_index < ChunkCount; ++index) {
+            Chunk &chunk = m_chunks[index % ChunkCount];
 
-                /* Wait for us to be ready to flush. */
-                m_cv_flush_ready.Wait(m_push_buffer_mutex);
+            /* Seal the chunk, so that further pushes go to the next one. */
+            u64 state = chunk.state;
+            while (GetReservedSize(state) > 0 && !IsSealed(state) && !chunk.state.compare_exchange_weak(state, state | StateSealedFlag)) {
+                /* ... */
             }
 
-            /* Swap the push buffer and the flush buffer pointers. */
-            std::swap(m_push_buffer, m_flush_buffer);
+            /* If the chunk is empty, we're done. */
+            const size_t size = GetReservedSize(state);
+            if (size == 0) {
+                break;
+            }
 
-            /* Signal that we can push. */
-            m_cv_push_ready.Broadcast();
-        }
+            /* Advance the push index past the chunk, if nobody else has. */
+            u64 push_index = index;
+            m_push_index.compare_exchange_strong(push_index, index + 1);
 
-        /* Flush any data. */
-        if (!m_flush_function(m_flush_buffer->m_head, m_flush_buffer->m_stored_size)) {
-            return false;
-        }
+            /* Wait for any pushes still copying into the chunk. */
+            this->WaitFlushReady([&] { return chunk.committed_size == size; }, true, util::nullopt);
+
+            /* Flush the chunk. If we fail, it'll be flushed again next time. */
+            if (!m_flush_function(this->GetChunkBuffer(index), size)) {
+                return false;
+            }
 
-        /* Reset the flush buffer. */
-        m_flush_buffer->m_stored_size = 0;
+            /* Reset the chunk for its next lap, and signal that we can push. */
+            chunk.committed_size = 0;
+            chunk.state          = MakeState(index / ChunkCount + 1, 0);
+            m_flush_index        = index + 1;
+            this->NotifyPushReady();
+        }
 
         return true;
     }
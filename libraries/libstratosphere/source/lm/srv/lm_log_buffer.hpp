@@ -18,56 +18,83 @@
 
 namespace ams::lm::srv {
 
+    /* A multi-producer ring of fixed-size chunks. Producers claim space in the current chunk with atomics, */
+    /* and only take a lock to wait when the ring is full. The flush thread drains every filled chunk in order. */
     class LogBuffer {
         NON_COPYABLE(LogBuffer);
         NON_MOVEABLE(LogBuffer);
-        private:
-            struct BufferInfo {
-                u8 *m_head;
-                size_t m_stored_size;
-                size_t m_reference_count;
-            };
         public:
             using FlushFunction = bool (*)(const u8 *data, size_t size);
+
+            static constexpr size_t ChunkCount = 16;
+        private:
+            /* A chunk's state holds the lap of the ring it's being filled for in the upper half, */
+            /* and whether it's sealed and how much of it has been reserved in the lower half. */
+            struct Chunk {
+                std::atomic<u64> state;
+                std::atomic<u32> committed_size;
+            };
+
+            static constexpr u64 StateSealedFlag       = (UINT64_C(1) << 31);
+            static constexpr u64 StateReservedSizeMask = StateSealedFlag - 1;
+
+            static constexpr u64 MakeState(u64 lap, size_t reserved_size) { return (lap << 32) | reserved_size; }
+            static constexpr u32 GetLap(u64 state) { return static_cast<u32>(state >> 32); }
+            static constexpr bool IsSealed(u64 state) { return (state & StateSealedFlag) != 0; }
+            static constexpr size_t GetReservedSize(u64 state) { return static_cast<size_t>(state & StateReservedSizeMask); }
         private:
-            BufferInfo m_buffers[2];
-            BufferInfo *m_push_buffer;
-            BufferInfo *m_flush_buffer;
-            size_t m_buffer_size;
+            Chunk m_chunks[ChunkCount];
+            u8 *m_buffer;
+            size_t m_chunk_size;
             FlushFunction m_flush_function;
-            os::SdkMutex m_push_buffer_mutex;
-            os::SdkMutex m_flush_buffer_mutex;
+            std::atomic<u64> m_push_index;
+            std::atomic<u64> m_flush_index;
+            std::atomic<size_t> m_push_ready_wait_count;
+            std::atomic<bool> m_is_flush_ready_waiting;
+            os::SdkMutex m_flush_mutex;
+            os::SdkMutex m_wait_mutex;
             os::SdkConditionVariable m_cv_push_ready;
             os::SdkConditionVariable m_cv_flush_ready;
             bool m_push_canceled;
-            size_t m_push_ready_wait_count;
         public:
             constexpr explicit LogBuffer(u8 *buffer, size_t buffer_size, FlushFunction f)
-                : m_buffers{}, m_push_buffer(m_buffers + 0), m_flush_buffer(m_buffers + 1),
-                  m_buffer_size(buffer_size / 2), m_flush_function(f), m_push_buffer_mutex{},
-                  m_flush_buffer_mutex{}, m_cv_push_ready{}, m_cv_flush_ready{},
-                  m_push_canceled(false), m_push_ready_wait_count(0)
+                : m_chunks{}, m_buffer(buffer), m_chunk_size(buffer_size / ChunkCount), m_flush_function(f),
+                  m_push_index(0), m_flush_index(0), m_push_ready_wait_count(0), m_is_flush_ready_waiting(false),
+                  m_flush_mutex{}, m_wait_mutex{}, m_cv_push_ready{}, m_cv_flush_ready{}, m_push_canceled(false)
             {
                 AMS_ASSERT(buffer != nullptr);
-                AMS_ASSERT(buffer_size > 0);
+                AMS_ASSERT(buffer_size >= ChunkCount);
+                AMS_ASSERT(buffer_size / ChunkCount <= StateReservedSizeMask);
                 AMS_ASSERT(f != nullptr);
-
-                m_buffers[0].m_head = buffer;
-                m_buffers[1].m_head = buffer + (buffer_size / 2);
             }
 
             static LogBuffer &GetDefaultInstance();
 
+            size_t GetPushSizeMax() const { return m_chunk_size; }
+
             bool Push(const void *data, size_t size) { return this->PushImpl(data, size, true); }
             bool TryPush(const void *data, size_t size) { return this->PushImpl(data, size, false); }
 
             void CancelPush();
 
-            bool Flush() { return this->FlushImpl(true); }
-            bool TryFlush() { return this->FlushImpl(false); }
+            bool Flush() { return this->FlushImpl(true, util::nullopt); }
+            bool TryFlush() { return this->FlushImpl(false, util::nullopt); }
+            bool TimedFlush(TimeSpan timeout) { return this->FlushImpl(true, timeout); }
         private:
             bool PushImpl(const void *data, size_t size, bool blocking);
-            bool FlushImpl(bool blocking);
+            bool FlushImpl(bool blocking, util::optional<TimeSpan> timeout);
+
+            u8 *GetChunkBuffer(u64 index) const { return m_buffer + (index % ChunkCount) * m_chunk_size; }
+
+            /* NOTE: The index may be stale, and so behind the flush index. */
+            bool IsChunkInUse(u64 index) const { return index >= m_flush_index + ChunkCount; }
+
+            bool WaitPushReady(u64 index);
+            void NotifyPushReady();
+
+            template<typename F>
+            bool WaitFlushReady(F is_ready, bool blocking, util::optional<TimeSpan> timeout);
+            void NotifyFlushReady();
     };
 
 }
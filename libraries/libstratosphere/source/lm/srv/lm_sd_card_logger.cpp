@@ -27,11 +27,15 @@ namespace ams::lm::srv {
         constexpr const char SettingName[]               = "lm";
         constexpr const char SettingKeyLoggingEnabled[]  = "enable_sd_card_logging";
         constexpr const char SettingKeyOutputDirectory[] = "sd_card_log_output_directory";
+        constexpr const char SettingKeyCompression[]     = "enable_sd_card_log_compression";
 
         constexpr inline size_t LogFileHeaderSize = 8;
         constexpr inline u32 LogFileHeaderMagic   = util::ReverseFourCC<'p','h','p','h'>::Code;
         constexpr inline u8 LogFileHeaderVersion  = 1;
 
+        /* NOTE: This is an extension; compressed logs use a new version, so that readers of the official format reject them. */
+        constexpr inline u8 LogFileHeaderVersionLz4Compressed = 2;
+
         struct LogFileHeader {
             u32 magic;
             u8 version;
@@ -107,6 +111,13 @@ namespace ams::lm::srv {
             *out_status_changed = status_changed;
         }
 
+        bool GetSdCardLogCompressionEnabled() {
+            /* NOTE: This is an extension; if the setting doesn't exist, we don't compress. */
+            u8 enabled;
+            const auto size = settings::fwdbg::GetSettingsItemValue(std::addressof(enabled), sizeof(enabled), SettingName, SettingKeyCompression);
+            return size == sizeof(enabled) && enabled != 0;
+        }
+
         bool GetSdCardLogOutputDirectory(char *dst, size_t size) {
             /* Get the output directory size. */
             const auto value_size = settings::fwdbg::GetSettingsItemValueSize(SettingName, SettingKeyOutputDirectory);
@@ -185,42 +196,27 @@ namespace ams::lm::srv {
             return false;
         }
 
-        Result WriteLogFileHeaderImpl(const char *path) {
-            /* Open the log file. */
-            fs::FileHandle file;
-            R_TRY(fs::OpenFile(std::addressof(file), path, fs::OpenMode_Write | fs::OpenMode_AllowAppend));
-            ON_SCOPE_EXIT { fs::CloseFile(file); };
-
+        Result WriteLogFileHeaderImpl(fs::FileHandle file, bool is_compressed) {
             /* Write the log file header. */
             const LogFileHeader header = {
                 .magic   = LogFileHeaderMagic,
-                .version = LogFileHeaderVersion
+                .version = is_compressed ? LogFileHeaderVersionLz4Compressed : LogFileHeaderVersion,
             };
 
             R_RETURN(fs::WriteFile(file, 0, std::addressof(header), sizeof(header), fs::WriteOption::Flush));
         }
 
-        bool WriteLogFileHeader(const char *path) {
-            return R_SUCCEEDED(WriteLogFileHeaderImpl(path));
+        bool WriteLogFileHeader(fs::FileHandle file, bool is_compressed) {
+            return R_SUCCEEDED(WriteLogFileHeaderImpl(file, is_compressed));
         }
 
-        Result WriteLogFileBodyImpl(const char *path, s64 offset, const u8 *data, size_t size) {
-            /* Open the log file. */
-            fs::FileHandle file;
-            R_TRY(fs::OpenFile(std::addressof(file), path, fs::OpenMode_Write | fs::OpenMode_AllowAppend));
-            ON_SCOPE_EXIT { fs::CloseFile(file); };
-
-            /* Write the data. */
-            R_RETURN(fs::WriteFile(file, offset, data, size, fs::WriteOption::Flush));
-        }
-
-        bool WriteLogFileBody(const char *path, s64 offset, const u8 *data, size_t size) {
-            return R_SUCCEEDED(WriteLogFileBodyImpl(path, offset, data, size));
+        bool OpenLogFile(fs::FileHandle *out, const char *path) {
+            return R_SUCCEEDED(fs::OpenFile(out, path, fs::OpenMode_Write | fs::OpenMode_AllowAppend));
         }
 
     }
 
-    SdCardLogger::SdCardLogger() : m_logging_observer_mutex(), m_is_enabled(false), m_is_sd_card_mounted(false), m_is_sd_card_status_unknown(false), m_log_file_offset(0), m_logging_observer(nullptr) {
+    SdCardLogger::SdCardLogger() : m_logging_observer_mutex(), m_mutex(), m_is_enabled(false), m_is_sd_card_mounted(false), m_is_sd_card_status_unknown(false), m_is_log_file_open(false), m_is_compression_enabled(false), m_log_file_offset(0), m_batch_size(0), m_batch_start_tick(), m_logging_observer(nullptr) {
         /* ... */
     }
 
@@ -300,38 +296,169 @@ namespace ams::lm::srv {
             return false;
         }
 
+        /* Open the log file, which we keep open for as long as we're logging to it. */
+        if (!OpenLogFile(std::addressof(m_log_file), m_log_file_path)) {
+            return false;
+        }
+
+        /* Note that the log file is open. */
+        m_is_log_file_open = true;
+
         /* Write the log file header. */
-        if (!WriteLogFileHeader(m_log_file_path)) {
+        m_is_compression_enabled = GetSdCardLogCompressionEnabled();
+        if (!WriteLogFileHeader(m_log_file, m_is_compression_enabled)) {
             return false;
         }
 
         /* Set our initial offset. */
         m_log_file_offset = LogFileHeaderSize;
+        m_batch_size      = 0;
 
         return true;
     }
 
     void SdCardLogger::Finalize() {
+        std::scoped_lock lk(m_mutex);
+
+        /* Commit anything we have batched. */
+        if (this->GetEnabled()) {
+            this->FlushBatch();
+        }
+
         this->SetEnabled(false);
+        this->CloseLogFile();
         if (m_is_sd_card_mounted) {
             fs::Unmount(SdCardMountName);
             m_is_sd_card_mounted = false;
         }
     }
 
+    void SdCardLogger::CloseLogFile() {
+        if (m_is_log_file_open) {
+            fs::CloseFile(m_log_file);
+            m_is_log_file_open = false;
+        }
+
+        /* Any data we haven't committed is lost with the file. */
+        m_batch_size = 0;
+    }
+
+    void SdCardLogger::HandleWriteFailure() {
+        this->CloseLogFile();
+        if (m_is_sd_card_mounted) {
+            fs::Unmount(SdCardMountName);
+            m_is_sd_card_mounted        = false;
+            m_is_sd_card_status_unknown = true;
+        }
+    }
+
+    bool SdCardLogger::WriteBlock(const u8 *data, size_t size) {
+        AMS_ASSERT(size <= BatchSizeMax);
+
+        /* If we're not compressing, write the data as-is. */
+        if (!m_is_compression_enabled) {
+            if (R_FAILED(fs::WriteFile(m_log_file, m_log_file_offset, data, size, fs::WriteOption::None))) {
+                return false;
+            }
+
+            m_log_file_offset += size;
+            return true;
+        }
+
+        /* Compress the data. */
+        auto *header = reinterpret_cast<CompressedBlockHeader *>(m_compress_buffer);
+        u8 *block    = m_compress_buffer + sizeof(*header);
+        int compressed_size = util::CompressLZ4(block, sizeof(m_compress_buffer) - sizeof(*header), data, size);
+
+        /* If the data didn't compress, store it uncompressed; blocks whose sizes match are stored. */
+        if (compressed_size <= 0 || static_cast<size_t>(compressed_size) >= size) {
+            std::memcpy(block, data, size);
+            compressed_size = static_cast<int>(size);
+        }
+
+        *header = { static_cast<u32>(compressed_size), static_cast<u32>(size) };
+
+        /* Write the block. */
+        const size_t block_size = sizeof(*header) + compressed_size;
+        if (R_FAILED(fs::WriteFile(m_log_file, m_log_file_offset, m_compress_buffer, block_size, fs::WriteOption::None))) {
+            return false;
+        }
+
+        m_log_file_offset += block_size;
+        return true;
+    }
+
+    bool SdCardLogger::FlushBatch() {
+        /* If we have nothing batched, there's nothing to do. */
+        if (m_batch_size == 0) {
+            return true;
+        }
+
+        /* Write the batch, and commit it to the sd card. */
+        const size_t batch_size = m_batch_size;
+        m_batch_size = 0;
+
+        if (!this->WriteBlock(m_batch_buffer, batch_size)) {
+            return false;
+        }
+
+        return R_SUCCEEDED(fs::FlushFile(m_log_file));
+    }
+
+    bool SdCardLogger::Flush() {
+        std::scoped_lock lk(m_mutex);
+
+        /* If we're not logging, there's nothing to flush. */
+        if (!this->GetEnabled()) {
+            return false;
+        }
+
+        /* Flush our batch. */
+        if (!this->FlushBatch()) {
+            this->HandleWriteFailure();
+            this->SetEnabled(false);
+            return false;
+        }
+
+        return true;
+    }
+
+    bool SdCardLogger::FlushIfExpired() {
+        /* If our batch hasn't expired, we don't need to flush. */
+        if (TimeSpan remaining; !this->GetTimeUntilFlush(std::addressof(remaining)) || remaining > TimeSpan(0)) {
+            return true;
+        }
+
+        return this->Flush();
+    }
+
+    bool SdCardLogger::GetTimeUntilFlush(TimeSpan *out) {
+        std::scoped_lock lk(m_mutex);
+
+        /* If nothing is batched, we don't need to flush. */
+        if (!this->GetEnabled() || m_batch_size == 0) {
+            return false;
+        }
+
+        /* Determine how long we can hold on to our batch. */
+        const auto elapsed = (os::GetSystemTick() - m_batch_start_tick).ToTimeSpan();
+        *out = elapsed < BatchIntervalMax ? BatchIntervalMax - elapsed : TimeSpan(0);
+        return true;
+    }
+
     bool SdCardLogger::Write(const u8 *data, size_t size) {
         /* Only write if sd card logging is enabled. */
         if (!GetSdCardLoggingEnabled()) {
             return false;
         }
 
+        std::scoped_lock lk(m_mutex);
+
         /* Ensure we keep our pre and post-conditions in check. */
         bool success = false;
         ON_SCOPE_EXIT {
-            if (!success && m_is_sd_card_mounted) {
-                fs::Unmount(SdCardMountName);
-                m_is_sd_card_mounted        = false;
-                m_is_sd_card_status_unknown = true;
+            if (!success) {
+                this->HandleWriteFailure();
             }
             this->SetEnabled(success);
         };
@@ -341,13 +468,29 @@ namespace ams::lm::srv {
             return false;
         }
 
-        /* Try to write the log file. */
-        if (!WriteLogFileBody(m_log_file_path, m_log_file_offset, data, size)) {
-            return false;
+        /* Add the data to our batch, committing the batch whenever it fills. */
+        while (size > 0) {
+            if (m_batch_size == 0) {
+                m_batch_start_tick = os::GetSystemTick();
+            }
+
+            const size_t cur_size = std::min(size, BatchSizeMax - m_batch_size);
+            std::memcpy(m_batch_buffer + m_batch_size, data, cur_size);
+            m_batch_size += cur_size;
+            data         += cur_size;
+            size         -= cur_size;
+
+            if (m_batch_size == BatchSizeMax && !this->FlushBatch()) {
+                return false;
+            }
         }
 
-        /* Advance. */
-        m_log_file_offset += size;
+        /* If we've held our batch for too long, commit it. */
+        if (m_batch_size > 0 && (os::GetSystemTick() - m_batch_start_tick).ToTimeSpan() >= BatchIntervalMax) {
+            if (!this->FlushBatch()) {
+                return false;
+            }
+        }
 
         /* We succeeded. */
         success = true;
@@ -22,25 +22,61 @@ namespace ams::lm::srv {
         AMS_SINGLETON_TRAITS(SdCardLogger);
         public:
             using LoggingObserver = void (*)(bool available);
+
+            /* Writes are batched, and only committed to the log file when one of these thresholds is reached. */
+            static constexpr size_t BatchSizeMax       = 32_KB;
+            static constexpr TimeSpan BatchIntervalMax = TimeSpan::FromSeconds(1);
+
+            /* When compression is enabled, each batch is written as a block header followed by LZ4 block data. */
+            struct CompressedBlockHeader {
+                u32 compressed_size;
+                u32 uncompressed_size;
+            };
+            static_assert(sizeof(CompressedBlockHeader) == 8);
+
+            static constexpr size_t CompressBufferSize = sizeof(CompressedBlockHeader) + BatchSizeMax + BatchSizeMax / 0xFF + 0x10;
         private:
             os::SdkMutex m_logging_observer_mutex;
+            os::SdkMutex m_mutex;
             bool m_is_enabled;
             bool m_is_sd_card_mounted;
             bool m_is_sd_card_status_unknown;
+            bool m_is_log_file_open;
+            bool m_is_compression_enabled;
             char m_log_file_path[0x80];
+            fs::FileHandle m_log_file;
             s64 m_log_file_offset;
+            size_t m_batch_size;
+            os::Tick m_batch_start_tick;
             LoggingObserver m_logging_observer;
+            u8 m_batch_buffer[BatchSizeMax];
+            u8 m_compress_buffer[CompressBufferSize];
         public:
             void Finalize();
 
             void SetLoggingObserver(LoggingObserver observer);
 
             bool Write(const u8 *data, size_t size);
+
+            /* Commits any batched data to the log file. */
+            bool Flush();
+
+            /* Commits batched data to the log file if it has been held for longer than the batch interval. */
+            bool FlushIfExpired();
+
+            /* Gets the time until batched data must be committed, or false if nothing is batched. */
+            bool GetTimeUntilFlush(TimeSpan *out);
         private:
             bool GetEnabled() const;
             void SetEnabled(bool enabled);
 
             bool Initialize();
+
+            bool FlushBatch();
+            bool WriteBlock(const u8 *data, size_t size);
+
+            void CloseLogFile();
+            void HandleWriteFailure();
     };
 
 }
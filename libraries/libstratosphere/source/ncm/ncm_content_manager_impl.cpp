@@ -33,6 +33,10 @@ namespace ams::ncm {
         ContentMetaMemoryResource g_gamecard_content_meta_memory_resource(g_gamecard_content_meta_database_heap, sizeof(g_gamecard_content_meta_database_heap));
         ContentMetaMemoryResource g_sd_and_user_content_meta_memory_resource(g_sd_and_user_content_meta_database_heap, sizeof(g_sd_and_user_content_meta_database_heap));
 
+        /* NOTE: Content meta database indices share a bounded heap; databases whose index doesn't fit scan their kvs instead. */
+        alignas(os::MemoryPageSize) u8 g_content_meta_database_index_heap[512_KB];
+        ContentMetaMemoryResource g_content_meta_database_index_memory_resource(g_content_meta_database_index_heap, sizeof(g_content_meta_database_index_heap));
+
         constexpr fs::SystemSaveDataId BuiltInSystemSaveDataId = 0x8000000000000120;
         constexpr u64 BuiltInSystemSaveDataSize                = 0x6c000;
         constexpr u64 BuiltInSystemSaveDataJournalSize         = 0x6c000;
@@ -546,7 +550,7 @@ namespace ams::ncm {
             R_TRY(root.kvs->Load());
 
             /* Create the content meta database. */
-            root.content_meta_database = sf::CreateSharedObjectEmplaced<IContentMetaDatabase, ContentMetaDatabaseImpl>(std::addressof(*root.kvs), root.mount_name);
+            root.content_meta_database = sf::CreateSharedObjectEmplaced<IContentMetaDatabase, ContentMetaDatabaseImpl>(std::addressof(*root.kvs), root.mount_name, std::addressof(g_content_meta_database_index_memory_resource));
         } else {
             if (root.storage_id == StorageId::BuiltInSystem) {
                 /* Create a temporary mount name, and mount the partition. */
@@ -570,13 +574,13 @@ namespace ams::ncm {
                 R_TRY(root.kvs->Load());
 
                 /* Create an on memory content meta database. */
-                root.content_meta_database = sf::CreateSharedObjectEmplaced<IContentMetaDatabase, OnMemoryContentMetaDatabaseImpl>(std::addressof(*root.kvs));
+                root.content_meta_database = sf::CreateSharedObjectEmplaced<IContentMetaDatabase, OnMemoryContentMetaDatabaseImpl>(std::addressof(*root.kvs), std::addressof(g_content_meta_database_index_memory_resource));
             } else {
                 /* Initialize the key value store. */
                 R_TRY(root.kvs->Initialize(root.max_content_metas, root.memory_resource));
 
                 /* Create an on memory content meta database. */
-                root.content_meta_database = sf::CreateSharedObjectEmplaced<IContentMetaDatabase, OnMemoryContentMetaDatabaseImpl>(std::addressof(*root.kvs));
+                root.content_meta_database = sf::CreateSharedObjectEmplaced<IContentMetaDatabase, OnMemoryContentMetaDatabaseImpl>(std::addressof(*root.kvs), std::addressof(g_content_meta_database_index_memory_resource));
             }
         }
 
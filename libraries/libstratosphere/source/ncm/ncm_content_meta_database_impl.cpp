@@ -51,7 +51,19 @@ namespace ams::ncm {
 
     Result ContentMetaDatabaseImpl::Set(const ContentMetaKey &key, const sf::InBuffer &value) {
         R_TRY(this->EnsureEnabled());
-        R_RETURN(m_kvs->Set(key, value.GetPointer(), value.GetSize()));
+
+        /* Remove any existing value from our index, as it is about to be replaced. */
+        this->RemoveFromIndex(key);
+
+        /* If we fail to set the value, our index no longer matches the kvs. */
+        ON_RESULT_FAILURE { m_index.Invalidate(); };
+
+        /* Set the value. */
+        R_TRY(m_kvs->Set(key, value.GetPointer(), value.GetSize()));
+
+        /* Add the new value to our index. */
+        this->AddToIndex(key);
+        R_SUCCEED();
     }
 
     Result ContentMetaDatabaseImpl::Get(sf::Out<u64> out_size, const ContentMetaKey &key, const sf::OutBuffer &out_value) {
@@ -70,6 +82,12 @@ namespace ams::ncm {
     Result ContentMetaDatabaseImpl::Remove(const ContentMetaKey &key) {
         R_TRY(this->EnsureEnabled());
 
+        /* Remove the value from our index. */
+        this->RemoveFromIndex(key);
+
+        /* If we fail to remove the value, our index no longer matches the kvs. */
+        ON_RESULT_FAILURE { m_index.Invalidate(); };
+
         R_TRY_CATCH(m_kvs->Remove(key)) {
             R_CONVERT(kvdb::ResultKeyNotFound, ncm::ResultContentMetaNotFound())
         } R_END_TRY_CATCH;
@@ -109,36 +127,60 @@ namespace ams::ncm {
         size_t entries_total = 0;
         size_t entries_written = 0;
 
-        /* Iterate over all entries. */
-        for (auto &entry : *m_kvs) {
-            const ContentMetaKey key = entry.GetKey();
+        /* Define helpers for matching and writing keys. */
+        auto IsMatchingKey = [&](const ContentMetaKey &key) ALWAYS_INLINE_LAMBDA -> bool {
+            return (meta_type == ContentMetaType::Unknown || key.type == meta_type) && (min <= key.id && key.id <= max) && (install_type == ContentInstallType::Unknown || key.install_type == install_type);
+        };
+
+        auto WriteKey = [&](const ContentMetaKey &key) ALWAYS_INLINE_LAMBDA {
+            /* Write the entry to the output buffer. */
+            if (entries_written < out_info.GetSize()) {
+                out_info[entries_written++] = key;
+            }
+            entries_total++;
+        };
 
-            /* Check if this entry matches the given filters. */
-            if (!((meta_type == ContentMetaType::Unknown || key.type == meta_type) && (min <= key.id && key.id <= max) && (install_type == ContentInstallType::Unknown || key.install_type == install_type))) {
-                continue;
+        if (application_id != InvalidApplicationId && this->EnsureIndex() && m_index.GetNonApplicationCount() == 0) {
+            /* Every content meta belongs to an application, so only the desired application's content metas can match. */
+            for (const auto &entry : m_index.GetApplicationRange(application_id)) {
+                if (IsMatchingKey(entry.key)) {
+                    WriteKey(entry.key);
+                }
             }
+        } else if (application_id != InvalidApplicationId) {
+            /* Content metas without an application id match any application id, so check every entry. */
+            for (auto &entry : *m_kvs) {
+                const ContentMetaKey key = entry.GetKey();
 
-            /* If application id is present, check if it matches the filter. */
-            if (application_id != InvalidApplicationId) {
-                /* Obtain the content meta for the key. */
-                const void *meta;
-                size_t meta_size;
-                R_TRY(this->GetContentMetaPointer(&meta, &meta_size, key));
+                /* Check if this entry matches the given filters. */
+                if (!IsMatchingKey(key)) {
+                    continue;
+                }
 
                 /* Create a reader. */
-                ContentMetaReader reader(meta, meta_size);
+                ContentMetaReader reader(entry.GetValuePointer(), entry.GetValueSize());
 
                 /* Ensure application id matches, if present. */
                 if (const auto entry_application_id = reader.GetApplicationId(key); entry_application_id && application_id != *entry_application_id) {
                     continue;
                 }
-            }
 
-            /* Write the entry to the output buffer. */
-            if (entries_written < out_info.GetSize()) {
-                out_info[entries_written++] = key;
+                WriteKey(key);
+            }
+        } else if (meta_type != ContentMetaType::Unknown && this->EnsureIndex()) {
+            /* Only content metas of the desired type can match. */
+            for (const auto &entry : m_index.GetTypeRange(meta_type)) {
+                if (IsMatchingKey(entry.key)) {
+                    WriteKey(entry.key);
+                }
+            }
+        } else {
+            /* Keys are sorted by id, so only entries within the id range can match. */
+            for (auto entry = m_kvs->lower_bound(ContentMetaKey::MakeUnknownType(min, 0)); entry != m_kvs->end() && entry->GetKey().id <= max; entry++) {
+                if (IsMatchingKey(entry->GetKey())) {
+                    WriteKey(entry->GetKey());
+                }
             }
-            entries_total++;
         }
 
         out_entries_total.SetValue(entries_total);
@@ -177,24 +219,38 @@ namespace ams::ncm {
         size_t entries_total = 0;
         size_t entries_written = 0;
 
-        /* Iterate over all entries. */
-        for (auto &entry : *m_kvs) {
-            const ContentMetaKey key = entry.GetKey();
+        /* Define a helper for writing keys. */
+        auto WriteKey = [&](const ContentMetaKey &key, ApplicationId application_id) ALWAYS_INLINE_LAMBDA {
+            /* Write the entry to the output buffer. */
+            if (entries_written < out_keys.GetSize()) {
+                out_keys[entries_written++] = { key, application_id };
+            }
+            entries_total++;
+        };
 
-            /* Check if this entry matches the given filters. */
-            if (!(type == ContentMetaType::Unknown || key.type == type)) {
-                continue;
+        if (type != ContentMetaType::Unknown && this->EnsureIndex()) {
+            /* Only content metas of the desired type can match, and the index knows their application ids. */
+            for (const auto &entry : m_index.GetTypeRange(type)) {
+                if (entry.has_application_id) {
+                    WriteKey(entry.key, entry.application_id);
+                }
             }
+        } else {
+            /* Iterate over all entries. */
+            for (auto &entry : *m_kvs) {
+                const ContentMetaKey key = entry.GetKey();
 
-            /* Check if the entry has an application id. */
-            ContentMetaReader reader(entry.GetValuePointer(), entry.GetValueSize());
+                /* Check if this entry matches the given filters. */
+                if (!(type == ContentMetaType::Unknown || key.type == type)) {
+                    continue;
+                }
+
+                /* Check if the entry has an application id. */
+                ContentMetaReader reader(entry.GetValuePointer(), entry.GetValueSize());
 
-            if (const auto entry_application_id = reader.GetApplicationId(key); entry_application_id) {
-                /* Write the entry to the output buffer. */
-                if (entries_written < out_keys.GetSize()) {
-                    out_keys[entries_written++] = { key, *entry_application_id };
+                if (const auto entry_application_id = reader.GetApplicationId(key); entry_application_id) {
+                    WriteKey(key, *entry_application_id);
                 }
-                entries_total++;
             }
         }
 
@@ -306,6 +362,9 @@ namespace ams::ncm {
 
     Result ContentMetaDatabaseImpl::DisableForcibly() {
         m_disabled = true;
+
+        /* We'll no longer be queried, so we don't need our index. */
+        m_index.Invalidate();
         R_SUCCEED();
     }
 
@@ -318,6 +377,15 @@ namespace ams::ncm {
             out_orphaned[i] = true;
         }
 
+        /* If we have an index, we can look up each content id directly. */
+        if (this->EnsureIndex()) {
+            for (size_t i = 0; i < content_ids.GetSize(); i++) {
+                out_orphaned[i] = !m_index.HasContent(content_ids[i]);
+            }
+
+            R_SUCCEED();
+        }
+
         auto IsOrphanedContent = [](const sf::InArray<ContentId> &list, const ncm::ContentId &id) ALWAYS_INLINE_LAMBDA -> util::optional<size_t> {
             /* Check if any input content ids match our found content id. */
             for (size_t i = 0; i < list.GetSize(); i++) {
@@ -16,15 +16,42 @@
 #pragma once
 #include <stratosphere.hpp>
 #include "ncm_content_meta_database_impl_base.hpp"
+#include "ncm_content_meta_database_index.hpp"
 
 namespace ams::ncm {
 
     class ContentMetaDatabaseImpl : public ContentMetaDatabaseImplBase {
+        private:
+            ContentMetaDatabaseIndex m_index;
         public:
-            ContentMetaDatabaseImpl(ContentMetaKeyValueStore *kvs, const char *mount_name) : ContentMetaDatabaseImplBase(kvs, mount_name) { /* ... */ }
-            ContentMetaDatabaseImpl(ContentMetaKeyValueStore *kvs) : ContentMetaDatabaseImplBase(kvs) { /* ... */ }
+            ContentMetaDatabaseImpl(ContentMetaKeyValueStore *kvs, const char *mount_name, MemoryResource *index_mr) : ContentMetaDatabaseImplBase(kvs, mount_name), m_index(index_mr) { /* ... */ }
+            ContentMetaDatabaseImpl(ContentMetaKeyValueStore *kvs, MemoryResource *index_mr) : ContentMetaDatabaseImplBase(kvs), m_index(index_mr) { /* ... */ }
         private:
             /* Helpers. */
+            bool EnsureIndex() {
+                /* Build the index if we don't have one; if there isn't memory to do so, callers will fall back to scanning the kvs. */
+                if (!m_index.IsValid()) {
+                    m_index.Build(*m_kvs);
+                }
+                return m_index.IsValid();
+            }
+
+            void AddToIndex(const ContentMetaKey &key) {
+                const void *meta;
+                size_t meta_size;
+                if (R_SUCCEEDED(this->GetContentMetaPointer(&meta, &meta_size, key))) {
+                    m_index.Add(key, meta, meta_size);
+                }
+            }
+
+            void RemoveFromIndex(const ContentMetaKey &key) {
+                const void *meta;
+                size_t meta_size;
+                if (R_SUCCEEDED(this->GetContentMetaPointer(&meta, &meta_size, key))) {
+                    m_index.Remove(key, meta, meta_size);
+                }
+            }
+
             Result GetContentInfoImpl(ContentInfo *out, const ContentMetaKey &key, ContentType type, util::optional<u8> id_offset) const;
 
             Result GetContentIdImpl(ContentId *out, const ContentMetaKey &key, ContentType type, util::optional<u8> id_offset) const {
@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) Atmosphère-NX
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stratosphere.hpp>
+#include "ncm_content_meta_database_index.hpp"
+
+namespace ams::ncm {
+
+    bool ContentMetaDatabaseIndex::Build(const ContentMetaKeyValueStore &kvs) {
+        /* Clear any existing indices. */
+        this->Invalidate();
+
+        /* Determine how many entries each table needs. */
+        size_t meta_count = 0, application_count = 0, content_count = 0;
+        for (const auto &entry : kvs) {
+            ContentMetaReader reader(entry.GetValuePointer(), entry.GetValueSize());
+
+            ++meta_count;
+            if (reader.GetApplicationId(entry.GetKey())) {
+                ++application_count;
+            }
+            content_count += reader.GetContentCount();
+        }
+
+        /* Allocate the tables up front, so that building is a single sort per table. */
+        if (!m_type_table.Reserve(meta_count) || !m_application_table.Reserve(application_count) || !m_content_table.Reserve(content_count)) {
+            this->Invalidate();
+            return false;
+        }
+
+        /* Add all entries. */
+        for (const auto &entry : kvs) {
+            const ContentMetaKey key = entry.GetKey();
+            ContentMetaReader reader(entry.GetValuePointer(), entry.GetValueSize());
+
+            const auto application_id = reader.GetApplicationId(key);
+            m_type_table.PushBackUnsafe({ key, application_id.value_or(InvalidApplicationId), application_id.has_value() });
+            if (application_id) {
+                m_application_table.PushBackUnsafe({ *application_id, key });
+            }
+
+            for (size_t i = 0; i < reader.GetContentCount(); ++i) {
+                m_content_table.PushBackUnsafe({ reader.GetContentInfo(i)->GetId(), key });
+            }
+        }
+
+        /* Sort the tables. */
+        m_type_table.Sort();
+        m_application_table.Sort();
+        m_content_table.Sort();
+
+        m_is_valid = true;
+        return true;
+    }
+
+    void ContentMetaDatabaseIndex::Invalidate() {
+        m_application_table.Clear();
+        m_type_table.Clear();
+        m_content_table.Clear();
+        m_is_valid = false;
+    }
+
+    void ContentMetaDatabaseIndex::Add(const ContentMetaKey &key, const void *meta, size_t meta_size) {
+        /* If we're not valid, there's nothing to maintain. */
+        if (!m_is_valid) {
+            return;
+        }
+
+        ContentMetaReader reader(meta, meta_size);
+
+        /* Add the key to each of our tables. If we run out of memory, drop the indices; they'll be rebuilt when next needed. */
+        const auto application_id = reader.GetApplicationId(key);
+        if (!m_type_table.Insert({ key, application_id.value_or(InvalidApplicationId), application_id.has_value() })) {
+            this->Invalidate();
+            return;
+        }
+
+        if (application_id && !m_application_table.Insert({ *application_id, key })) {
+            this->Invalidate();
+            return;
+        }
+
+        for (size_t i = 0; i < reader.GetContentCount(); ++i) {
+            if (!m_content_table.Insert({ reader.GetContentInfo(i)->GetId(), key })) {
+                this->Invalidate();
+                return;
+            }
+        }
+    }
+
+    void ContentMetaDatabaseIndex::Remove(const ContentMetaKey &key, const void *meta, size_t meta_size) {
+        /* If we're not valid, there's nothing to maintain. */
+        if (!m_is_valid) {
+            return;
+        }
+
+        ContentMetaReader reader(meta, meta_size);
+
+        /* Remove the key from each of our tables. */
+        const auto application_id = reader.GetApplicationId(key);
+        m_type_table.Erase({ key, application_id.value_or(InvalidApplicationId), application_id.has_value() });
+        if (application_id) {
+            m_application_table.Erase({ *application_id, key });
+        }
+
+        for (size_t i = 0; i < reader.GetContentCount(); ++i) {
+            m_content_table.Erase({ reader.GetContentInfo(i)->GetId(), key });
+        }
+    }
+
+    ContentMetaDatabaseIndex::Range<ContentMetaDatabaseIndex::ApplicationEntry> ContentMetaDatabaseIndex::GetApplicationRange(ApplicationId application_id) const {
+        AMS_ASSERT(m_is_valid);
+
+        const auto first = std::lower_bound(m_application_table.begin(), m_application_table.end(), application_id, [](const ApplicationEntry &entry, const ApplicationId &id) { return entry.application_id.value < id.value; });
+        const auto last  = std::upper_bound(first, m_application_table.end(), application_id, [](const ApplicationId &id, const ApplicationEntry &entry) { return id.value < entry.application_id.value; });
+        return { first, last };
+    }
+
+    ContentMetaDatabaseIndex::Range<ContentMetaDatabaseIndex::TypeEntry> ContentMetaDatabaseIndex::GetTypeRange(ContentMetaType type) const {
+        AMS_ASSERT(m_is_valid);
+
+        const auto first = std::lower_bound(m_type_table.begin(), m_type_table.end(), type, [](const TypeEntry &entry, const ContentMetaType &t) { return entry.key.type < t; });
+        const auto last  = std::upper_bound(first, m_type_table.end(), type, [](const ContentMetaType &t, const TypeEntry &entry) { return t < entry.key.type; });
+        return { first, last };
+    }
+
+    bool ContentMetaDatabaseIndex::HasContent(const ContentId &content_id) const {
+        AMS_ASSERT(m_is_valid);
+
+        const auto it = std::lower_bound(m_content_table.begin(), m_content_table.end(), content_id, [](const ContentEntry &entry, const ContentId &id) { return std::memcmp(entry.content_id.uuid.data, id.uuid.data, sizeof(id.uuid.data)) < 0; });
+        return it != m_content_table.end() && it->content_id == content_id;
+    }
+
+}
@@ -0,0 +1,206 @@
+/*
+ * Copyright (c) Atmosphère-NX
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <stratosphere.hpp>
+
+namespace ams::ncm {
+
+    namespace impl {
+
+        /* An array from a memory resource, kept sorted by Compare. Allocation failures are reported rather than aborting. */
+        template<typename Entry, typename Compare>
+        class SortedIndexTable {
+            NON_COPYABLE(SortedIndexTable);
+            NON_MOVEABLE(SortedIndexTable);
+            static_assert(std::is_trivially_copyable<Entry>::value);
+            private:
+                static constexpr size_t CapacityMin = 0x10;
+            private:
+                MemoryResource *m_memory_resource;
+                Entry *m_entries;
+                size_t m_count;
+                size_t m_capacity;
+            public:
+                explicit SortedIndexTable(MemoryResource *mr) : m_memory_resource(mr), m_entries(nullptr), m_count(0), m_capacity(0) { /* ... */ }
+
+                ~SortedIndexTable() {
+                    this->Clear();
+                }
+
+                const Entry *begin() const { return m_entries; }
+                const Entry *end() const { return m_entries + m_count; }
+
+                size_t GetCount() const { return m_count; }
+
+                void Clear() {
+                    if (m_entries != nullptr) {
+                        m_memory_resource->Deallocate(m_entries, sizeof(Entry) * m_capacity, alignof(Entry));
+                    }
+
+                    m_entries  = nullptr;
+                    m_count    = 0;
+                    m_capacity = 0;
+                }
+
+                bool Reserve(size_t capacity) {
+                    /* If we already have enough space, there's nothing to do. */
+                    if (capacity <= m_capacity) {
+                        return true;
+                    }
+
+                    /* Allocate new entries. */
+                    Entry *entries = static_cast<Entry *>(m_memory_resource->Allocate(sizeof(Entry) * capacity, alignof(Entry)));
+                    if (entries == nullptr) {
+                        return false;
+                    }
+
+                    /* Move over our existing entries, and free the old ones. */
+                    const size_t count = m_count;
+                    if (count > 0) {
+                        std::memcpy(entries, m_entries, sizeof(Entry) * count);
+                    }
+                    this->Clear();
+
+                    m_entries  = entries;
+                    m_count    = count;
+                    m_capacity = capacity;
+                    return true;
+                }
+
+                /* NOTE: Entries added with PushBackUnsafe must be sorted with Sort before the table is used. */
+                void PushBackUnsafe(const Entry &entry) {
+                    AMS_ASSERT(m_count < m_capacity);
+                    m_entries[m_count++] = entry;
+                }
+
+                void Sort() {
+                    std::sort(m_entries, m_entries + m_count, Compare{});
+                }
+
+                bool Insert(const Entry &entry) {
+                    /* Ensure we have space for the entry. */
+                    if (m_count == m_capacity && !this->Reserve(std::max(CapacityMin, m_capacity * 2))) {
+                        return false;
+                    }
+
+                    /* Insert the entry at its sorted position. */
+                    Entry *it = std::upper_bound(m_entries, m_entries + m_count, entry, Compare{});
+                    std::memmove(it + 1, it, sizeof(Entry) * (m_entries + m_count - it));
+                    *it = entry;
+                    ++m_count;
+                    return true;
+                }
+
+                void Erase(const Entry &entry) {
+                    /* Find the entry. */
+                    Entry *it = std::lower_bound(m_entries, m_entries + m_count, entry, Compare{});
+                    if (it == m_entries + m_count || Compare{}(entry, *it)) {
+                        return;
+                    }
+
+                    /* Remove it. */
+                    std::memmove(it, it + 1, sizeof(Entry) * (m_entries + m_count - (it + 1)));
+                    --m_count;
+                }
+        };
+
+    }
+
+    /* Secondary indices over a content meta key-value store, so that queries need not parse every content meta. */
+    /* Indices are built on demand, and are maintained by the owner as content metas are set and removed. */
+    /* NOTE: The tables come from a bounded memory resource; when it is exhausted, the index is dropped and the owner scans the kvs instead. */
+    class ContentMetaDatabaseIndex {
+        NON_COPYABLE(ContentMetaDatabaseIndex);
+        NON_MOVEABLE(ContentMetaDatabaseIndex);
+        public:
+            using ContentMetaKeyValueStore = ams::kvdb::MemoryKeyValueStore<ContentMetaKey>;
+
+            struct ApplicationEntry {
+                ApplicationId application_id;
+                ContentMetaKey key;
+            };
+
+            struct TypeEntry {
+                ContentMetaKey key;
+                ApplicationId application_id;
+                bool has_application_id;
+            };
+
+            struct ContentEntry {
+                ContentId content_id;
+                ContentMetaKey key;
+            };
+
+            template<typename Entry>
+            struct Range {
+                const Entry *first;
+                const Entry *last;
+
+                const Entry *begin() const { return this->first; }
+                const Entry *end() const { return this->last; }
+            };
+        private:
+            struct ApplicationEntryCompare {
+                bool operator()(const ApplicationEntry &lhs, const ApplicationEntry &rhs) const {
+                    return lhs.application_id.value < rhs.application_id.value || (lhs.application_id.value == rhs.application_id.value && lhs.key < rhs.key);
+                }
+            };
+
+            struct TypeEntryCompare {
+                bool operator()(const TypeEntry &lhs, const TypeEntry &rhs) const {
+                    return lhs.key.type < rhs.key.type || (lhs.key.type == rhs.key.type && lhs.key < rhs.key);
+                }
+            };
+
+            struct ContentEntryCompare {
+                bool operator()(const ContentEntry &lhs, const ContentEntry &rhs) const {
+                    const auto cmp = std::memcmp(lhs.content_id.uuid.data, rhs.content_id.uuid.data, sizeof(lhs.content_id.uuid.data));
+                    return cmp < 0 || (cmp == 0 && lhs.key < rhs.key);
+                }
+            };
+        private:
+            impl::SortedIndexTable<ApplicationEntry, ApplicationEntryCompare> m_application_table;
+            impl::SortedIndexTable<TypeEntry, TypeEntryCompare> m_type_table;
+            impl::SortedIndexTable<ContentEntry, ContentEntryCompare> m_content_table;
+            bool m_is_valid;
+        public:
+            explicit ContentMetaDatabaseIndex(MemoryResource *mr) : m_application_table(mr), m_type_table(mr), m_content_table(mr), m_is_valid(false) { /* ... */ }
+
+            bool IsValid() const { return m_is_valid; }
+
+            bool Build(const ContentMetaKeyValueStore &kvs);
+            void Invalidate();
+
+            void Add(const ContentMetaKey &key, const void *meta, size_t meta_size);
+            void Remove(const ContentMetaKey &key, const void *meta, size_t meta_size);
+
+            /* Gets the number of content metas which don't belong to an application. */
+            size_t GetNonApplicationCount() const {
+                AMS_ASSERT(m_is_valid);
+                return m_type_table.GetCount() - m_application_table.GetCount();
+            }
+
+            /* Gets the content metas belonging to an application, sorted by key. */
+            Range<ApplicationEntry> GetApplicationRange(ApplicationId application_id) const;
+
+            /* Gets the content metas of a type, sorted by key. */
+            Range<TypeEntry> GetTypeRange(ContentMetaType type) const;
+
+            /* Gets whether any content meta references a content. */
+            bool HasContent(const ContentId &content_id) const;
+    };
+
+}
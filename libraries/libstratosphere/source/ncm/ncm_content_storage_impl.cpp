@@ -349,31 +349,29 @@ namespace ams::ncm {
     }
 
     void ContentStorageImpl::InvalidateFileCache() {
-        if (m_cached_content_id != InvalidContentId) {
-            fs::CloseFile(m_cached_file_handle);
-            m_cached_content_id = InvalidContentId;
-        }
+        m_content_file_cache.InvalidateAll();
         m_content_iterator = util::nullopt;
     }
 
-    Result ContentStorageImpl::OpenContentIdFile(ContentId content_id) {
-        /* If the file is the currently cached one, we've nothing to do. */
-        R_SUCCEED_IF(m_cached_content_id == content_id);
-
-        /* Close any cached file. */
-        this->InvalidateFileCache();
+    void ContentStorageImpl::InvalidateFileCache(ContentId content_id) {
+        m_content_file_cache.Invalidate(content_id);
+        m_content_iterator = util::nullopt;
+    }
 
-        /* Create the content path. */
-        PathString path;
-        MakeContentPath(std::addressof(path), content_id, m_make_content_path_func, m_root_path);
+    Result ContentStorageImpl::OpenContentIdFile(fs::FileHandle *out, ContentId content_id) {
+        /* Get the content file from the cache, opening it if it isn't there. */
+        R_RETURN(m_content_file_cache.Acquire(out, content_id, [&](fs::FileHandle *out_handle) -> Result {
+            /* Create the content path. */
+            PathString path;
+            MakeContentPath(std::addressof(path), content_id, m_make_content_path_func, m_root_path);
 
-        /* Open the content file and store to the cache. */
-        R_TRY_CATCH(fs::OpenFile(std::addressof(m_cached_file_handle), path, fs::OpenMode_Read)) {
-            R_CONVERT(ams::fs::ResultPathNotFound, ncm::ResultContentNotFound())
-        } R_END_TRY_CATCH;
+            /* Open the content file. */
+            R_TRY_CATCH(fs::OpenFile(out_handle, path, fs::OpenMode_Read)) {
+                R_CONVERT(ams::fs::ResultPathNotFound, ncm::ResultContentNotFound())
+            } R_END_TRY_CATCH;
 
-        m_cached_content_id = content_id;
-        R_SUCCEED();
+            R_SUCCEED();
+        }));
     }
 
     Result ContentStorageImpl::Initialize(const char *path, MakeContentPathFunction content_path_func, MakePlaceHolderPathFunction placeholder_path_func, bool delay_flush, RightsIdCache *rights_id_cache) {
@@ -429,7 +427,7 @@ namespace ams::ncm {
     }
 
     Result ContentStorageImpl::Register(PlaceHolderId placeholder_id, ContentId content_id) {
-        this->InvalidateFileCache();
+        this->InvalidateFileCache(content_id);
         R_TRY(this->EnsureEnabled());
 
         /* Create the placeholder path. */
@@ -451,7 +449,7 @@ namespace ams::ncm {
 
     Result ContentStorageImpl::Delete(ContentId content_id) {
         R_TRY(this->EnsureEnabled());
-        this->InvalidateFileCache();
+        this->InvalidateFileCache(content_id);
         R_RETURN(DeleteContentFile(content_id, m_make_content_path_func, m_root_path));
     }
 
@@ -665,7 +663,7 @@ namespace ams::ncm {
         R_TRY(this->EnsureEnabled());
 
         /* Close any cached file. */
-        this->InvalidateFileCache();
+        this->InvalidateFileCache(old_content_id);
 
         /* Ensure the future content directory exists. */
         R_TRY(EnsureContentDirectory(new_content_id, m_make_content_path_func, m_root_path));
@@ -700,15 +698,13 @@ namespace ams::ncm {
         R_UNLESS(offset >= 0, ncm::ResultInvalidOffset());
         R_TRY(this->EnsureEnabled());
 
-        /* Create the content path. */
-        PathString content_path;
-        MakeContentPath(std::addressof(content_path), content_id, m_make_content_path_func, m_root_path);
-
         /* Open the content file. */
-        R_TRY(this->OpenContentIdFile(content_id));
+        fs::FileHandle file;
+        R_TRY(this->OpenContentIdFile(std::addressof(file), content_id));
+        ON_SCOPE_EXIT { m_content_file_cache.Release(file); };
 
         /* Read from the requested offset up to the requested size. */
-        R_RETURN(fs::ReadFile(m_cached_file_handle, offset, buf.GetPointer(), buf.GetSize()));
+        R_RETURN(fs::ReadFile(file, offset, buf.GetPointer(), buf.GetSize()));
     }
 
     Result ContentStorageImpl::GetRightsIdFromPlaceHolderIdDeprecated(sf::Out<ams::fs::RightsId> out_rights_id, PlaceHolderId placeholder_id) {
@@ -782,7 +778,7 @@ namespace ams::ncm {
         AMS_ABORT_UNLESS(spl::IsDevelopment());
 
         /* Close any cached file. */
-        this->InvalidateFileCache();
+        this->InvalidateFileCache(content_id);
 
         /* Make the content path. */
         PathString path;
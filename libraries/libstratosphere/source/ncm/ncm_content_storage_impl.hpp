@@ -18,10 +18,13 @@
 
 #include "ncm_content_storage_impl_base.hpp"
 #include "ncm_placeholder_accessor.hpp"
+#include "ncm_file_handle_cache.hpp"
 
 namespace ams::ncm {
 
     class ContentStorageImpl : public ContentStorageImplBase {
+        public:
+            static constexpr size_t ContentFileCacheEntryCount = 0x4;
         private:
             class ContentIterator {
                 NON_COPYABLE(ContentIterator);
@@ -51,8 +54,7 @@ namespace ams::ncm {
             static_assert(std::is_constructible<ContentIterator>::value);
         protected:
             PlaceHolderAccessor m_placeholder_accessor;
-            ContentId m_cached_content_id;
-            fs::FileHandle m_cached_file_handle;
+            FileHandleCache<ContentId, ContentFileCacheEntryCount> m_content_file_cache;
             RightsIdCache *m_rights_id_cache;
             util::optional<ContentIterator> m_content_iterator;
             util::optional<s32> m_last_content_offset;
@@ -61,14 +63,20 @@ namespace ams::ncm {
             static Result CleanupBase(const char *root_path);
             static Result VerifyBase(const char *root_path);
         public:
-            ContentStorageImpl() : m_placeholder_accessor(), m_cached_content_id(InvalidContentId), m_cached_file_handle(), m_rights_id_cache(nullptr), m_content_iterator(util::nullopt), m_last_content_offset(util::nullopt) { /* ... */ }
+            ContentStorageImpl() : m_placeholder_accessor(), m_content_file_cache(false), m_rights_id_cache(nullptr), m_content_iterator(util::nullopt), m_last_content_offset(util::nullopt) { /* ... */ }
             ~ContentStorageImpl();
 
             Result Initialize(const char *root_path, MakeContentPathFunction content_path_func, MakePlaceHolderPathFunction placeholder_path_func, bool delay_flush, RightsIdCache *rights_id_cache);
         private:
             /* Helpers. */
-            Result OpenContentIdFile(ContentId content_id);
+            Result OpenContentIdFile(fs::FileHandle *out, ContentId content_id);
             void InvalidateFileCache();
+            void InvalidateFileCache(ContentId content_id);
+        public:
+            void GetFileCacheStatistics(FileHandleCacheStatistics *out_content, FileHandleCacheStatistics *out_placeholder) const {
+                m_content_file_cache.GetStatistics(out_content);
+                m_placeholder_accessor.GetFileCacheStatistics(out_placeholder);
+            }
         public:
             /* Actual commands. */
             virtual Result GeneratePlaceHolderId(sf::Out<PlaceHolderId> out) override;
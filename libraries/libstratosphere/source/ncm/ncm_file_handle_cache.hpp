@@ -0,0 +1,199 @@
+/*
+ * Copyright (c) Atmosphère-NX
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <stratosphere.hpp>
+
+namespace ams::ncm {
+
+    struct FileHandleCacheStatistics {
+        u64 hit_count;
+        u64 miss_count;
+        u64 eviction_count;
+    };
+
+    /* An LRU cache of open file handles, keyed by content or placeholder id. */
+    /* Handles are reference counted while in use, so only idle handles are ever evicted or closed. */
+    template<typename Id, size_t EntryCount>
+    class FileHandleCache {
+        NON_COPYABLE(FileHandleCache);
+        NON_MOVEABLE(FileHandleCache);
+        static_assert(EntryCount > 0);
+        private:
+            struct Entry {
+                Id id;
+                fs::FileHandle handle;
+                u64 last_used;
+                u32 reference_count;
+                bool is_cached;
+                bool is_open;
+            };
+        private:
+            std::array<Entry, EntryCount> m_entries;
+            u64 m_counter;
+            FileHandleCacheStatistics m_statistics;
+            bool m_flush_on_close;
+            mutable os::SdkMutex m_mutex;
+        public:
+            explicit FileHandleCache(bool flush_on_close) : m_entries(), m_counter(0), m_statistics(), m_flush_on_close(flush_on_close), m_mutex() { /* ... */ }
+
+            ~FileHandleCache() { this->InvalidateAll(); }
+
+            /* Gets a cached handle for a file, if there is one. Acquired handles must be released with Release. */
+            bool TryAcquire(fs::FileHandle *out, const Id &id) {
+                std::scoped_lock lk(m_mutex);
+
+                /* Find the entry for the id. */
+                Entry *entry = this->Find(id);
+                if (entry == nullptr) {
+                    ++m_statistics.miss_count;
+                    return false;
+                }
+
+                /* Reference the entry. */
+                ++m_statistics.hit_count;
+                ++entry->reference_count;
+                entry->last_used = ++m_counter;
+
+                *out = entry->handle;
+                return true;
+            }
+
+            /* Gets a handle for a file, opening it with open_func (Result(fs::FileHandle *)) if it isn't cached. */
+            template<typename F>
+            Result Acquire(fs::FileHandle *out, const Id &id, F open_func) {
+                /* If the file is cached, we've nothing to do. */
+                R_SUCCEED_IF(this->TryAcquire(out, id));
+
+                /* Open the file. */
+                fs::FileHandle handle;
+                R_TRY(open_func(std::addressof(handle)));
+
+                /* Store the handle. If every entry is in use, the handle is closed when it's released. */
+                {
+                    std::scoped_lock lk(m_mutex);
+
+                    if (Entry *entry = this->Find(id); entry != nullptr) {
+                        /* Someone else opened the file while we were; use their handle. */
+                        ++entry->reference_count;
+                        entry->last_used = ++m_counter;
+
+                        this->Close(handle);
+                        handle = entry->handle;
+                    } else if (Entry *entry = this->GetFreeEntry(); entry != nullptr) {
+                        *entry = { id, handle, ++m_counter, 1, true, true };
+                    }
+                }
+
+                *out = handle;
+                R_SUCCEED();
+            }
+
+            void Release(fs::FileHandle handle) {
+                std::scoped_lock lk(m_mutex);
+
+                /* Find the entry holding the handle. */
+                for (auto &entry : m_entries) {
+                    if (entry.is_open && entry.handle.handle == handle.handle) {
+                        AMS_ASSERT(entry.reference_count > 0);
+
+                        /* Close the handle if it was invalidated while in use. */
+                        if (--entry.reference_count == 0 && !entry.is_cached) {
+                            this->Close(std::addressof(entry));
+                        }
+                        return;
+                    }
+                }
+
+                /* The handle was never cached, so close it. */
+                this->Close(handle);
+            }
+
+            void Invalidate(const Id &id) {
+                std::scoped_lock lk(m_mutex);
+
+                if (Entry *entry = this->Find(id); entry != nullptr) {
+                    this->Invalidate(entry);
+                }
+            }
+
+            void InvalidateAll() {
+                std::scoped_lock lk(m_mutex);
+
+                for (auto &entry : m_entries) {
+                    if (entry.is_cached) {
+                        this->Invalidate(std::addressof(entry));
+                    }
+                }
+            }
+
+            void GetStatistics(FileHandleCacheStatistics *out) const {
+                std::scoped_lock lk(m_mutex);
+                *out = m_statistics;
+            }
+        private:
+            Entry *Find(const Id &id) {
+                for (auto &entry : m_entries) {
+                    if (entry.is_cached && entry.id == id) {
+                        return std::addressof(entry);
+                    }
+                }
+                return nullptr;
+            }
+
+            Entry *GetFreeEntry() {
+                /* Find an unused entry, or else the least recently used idle one. */
+                Entry *lru_entry = nullptr;
+                for (auto &entry : m_entries) {
+                    if (!entry.is_open) {
+                        return std::addressof(entry);
+                    }
+
+                    if (entry.reference_count == 0 && (lru_entry == nullptr || entry.last_used < lru_entry->last_used)) {
+                        lru_entry = std::addressof(entry);
+                    }
+                }
+
+                /* Evict the least recently used entry. */
+                if (lru_entry != nullptr) {
+                    ++m_statistics.eviction_count;
+                    this->Close(lru_entry);
+                }
+                return lru_entry;
+            }
+
+            void Invalidate(Entry *entry) {
+                /* Remove the entry from the cache, closing it now if it isn't in use. */
+                entry->is_cached = false;
+                if (entry->reference_count == 0) {
+                    this->Close(entry);
+                }
+            }
+
+            void Close(Entry *entry) {
+                this->Close(entry->handle);
+                entry->is_cached = false;
+                entry->is_open   = false;
+            }
+
+            void Close(fs::FileHandle handle) {
+                if (m_flush_on_close) {
+                    fs::FlushFile(handle);
+                }
+                fs::CloseFile(handle);
+            }
+    };
+
+}
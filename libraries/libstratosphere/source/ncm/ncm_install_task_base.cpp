@@ -50,6 +50,12 @@ namespace ams::ncm {
                    expected_key.type    == actual_key.type;
         }
 
+        /* Placeholder writes are done on worker threads while data is produced. Only one install task may use them at a time. */
+        constexpr size_t PlaceHolderWriteThreadStackSize = 16_KB;
+
+        constinit os::SdkMutex g_place_holder_write_thread_lock;
+        alignas(os::ThreadStackAlignment) constinit u8 g_place_holder_write_thread_stacks[InstallTaskBase::PlaceHolderWriteThreadCountMax][PlaceHolderWriteThreadStackSize];
+
     }
 
     void InstallTaskBase::Cancel() {
@@ -331,6 +337,10 @@ namespace ams::ncm {
     Result InstallTaskBase::ExecuteImpl() {
         this->StartThroughputMeasurement();
 
+        /* Write placeholders on worker threads while we produce their data, if we can. */
+        this->BeginPlaceHolderWrites();
+        ON_SCOPE_EXIT { this->EndPlaceHolderWrites(); };
+
         /* Count the number of content meta entries. */
         s32 count;
         R_TRY(m_data->Count(std::addressof(count)));
@@ -343,19 +353,32 @@ namespace ams::ncm {
 
             /* Write all prepared content infos. */
             {
-                /* If we fail while writing, update (but don't check the result). */
-                ON_RESULT_FAILURE { m_data->Update(content_meta, i); };
+                /* If we fail while writing, let outstanding writes finish and update (but don't check the result). */
+                ON_RESULT_FAILURE {
+                    this->WaitPlaceHolderWrites();
+                    m_data->Update(content_meta, i);
+                };
 
                 /* Create a writer. */
                 const auto writer = content_meta.GetWriter();
 
-                /* Iterate over content infos. */
+                /* Write the data for all prepared content infos. */
+                /* NOTE: We don't wait for each content's writes to finish, so that the writes for one can overlap producing and writing the next. */
                 for (size_t j = 0; j < writer.GetContentCount(); j++) {
                     auto *content_info = writer.GetWritableContentInfo(j);
+                    if (content_info->install_state == InstallState::Prepared) {
+                        R_TRY(this->WritePlaceHolderData(writer.GetKey(), content_info));
+                    }
+                }
 
-                    /* Write prepared content infos. */
+                /* Wait for the writes to finish. */
+                R_TRY(this->WaitPlaceHolderWrites());
+
+                /* Install tickets for the written placeholders, and mark them installed. */
+                for (size_t j = 0; j < writer.GetContentCount(); j++) {
+                    auto *content_info = writer.GetWritableContentInfo(j);
                     if (content_info->install_state == InstallState::Prepared) {
-                        R_TRY(this->WritePlaceHolder(writer.GetKey(), content_info));
+                        R_TRY(this->InstallTicketForPlaceHolder(content_info));
                         content_info->install_state = InstallState::Installed;
                     }
                 }
@@ -537,6 +560,11 @@ namespace ams::ncm {
     Result InstallTaskBase::WritePlaceHolderBuffer(InstallContentInfo *content_info, const void *data, size_t data_size) {
         R_UNLESS(!this->IsCancelRequested(), ncm::ResultWritePlaceHolderCancelled());
 
+        /* If we're writing on worker threads, hand the data off to them. */
+        if (m_is_write_pipeline_active) {
+            R_RETURN(this->SubmitPlaceHolderWrite(content_info, data, data_size));
+        }
+
         /* Open the content storage for the content info. */
         ContentStorage content_storage;
         R_TRY(OpenContentStorage(std::addressof(content_storage), content_info->storage_id));
@@ -544,6 +572,7 @@ namespace ams::ncm {
         /* Write data to the placeholder. */
         R_TRY(content_storage.WritePlaceHolder(content_info->placeholder_id, content_info->written, data, data_size));
         content_info->written += data_size;
+        m_write_offset        += data_size;
 
         /* Update progress/throughput if content info isn't temporary. */
         if (!content_info->is_temporary) {
@@ -556,7 +585,255 @@ namespace ams::ncm {
         R_SUCCEED();
     }
 
+    void InstallTaskBase::SetPlaceHolderWriteBuffer(void *buffer, size_t buffer_size, size_t slot_count) {
+        AMS_ASSERT(!m_is_write_pipeline_active);
+        AMS_ASSERT(slot_count <= PlaceHolderWriteSlotCountMax);
+
+        /* Split the buffer into slots. */
+        const size_t slot_size = slot_count > 0 ? buffer_size / slot_count : 0;
+        for (size_t i = 0; i < slot_count; i++) {
+            m_write_slots[i].buffer      = static_cast<u8 *>(buffer) + i * slot_size;
+            m_write_slots[i].buffer_size = slot_size;
+        }
+
+        /* We need at least two slots for writing to overlap producing data. */
+        m_write_slot_count = slot_size > 0 && slot_count >= 2 ? slot_count : 0;
+    }
+
+    void InstallTaskBase::BeginPlaceHolderWrites() {
+        AMS_ASSERT(!m_is_write_pipeline_active);
+
+        /* If we don't have buffers, or another task is using the write threads, we'll write synchronously. */
+        if (m_write_slot_count == 0 || !g_place_holder_write_thread_lock.TryLock()) {
+            return;
+        }
+
+        /* Reset our write state. */
+        for (size_t i = 0; i < m_write_slot_count; i++) {
+            m_write_slots[i].state = PlaceHolderWriteSlotState_Free;
+        }
+        m_write_slot_pending = 0;
+        m_write_sequence     = 0;
+        m_write_result       = ResultSuccess();
+        m_exit_write_thread  = false;
+
+        /* Create the write threads, leaving at least one slot beyond those being written so that producing data overlaps the writes. */
+        const size_t thread_count = std::min(PlaceHolderWriteThreadCountMax, m_write_slot_count - 1);
+        for (m_write_thread_count = 0; m_write_thread_count < thread_count; m_write_thread_count++) {
+            auto *stack = g_place_holder_write_thread_stacks[m_write_thread_count];
+            if (R_FAILED(os::CreateThread(std::addressof(m_write_threads[m_write_thread_count]), PlaceHolderWriteThreadFunction, this, stack, PlaceHolderWriteThreadStackSize, os::GetThreadPriority(os::GetCurrentThread())))) {
+                break;
+            }
+        }
+
+        /* If we couldn't create any write thread, we'll write synchronously. */
+        if (m_write_thread_count == 0) {
+            g_place_holder_write_thread_lock.Unlock();
+            return;
+        }
+
+        for (size_t i = 0; i < m_write_thread_count; i++) {
+            os::StartThread(std::addressof(m_write_threads[i]));
+        }
+        m_is_write_pipeline_active = true;
+    }
+
+    void InstallTaskBase::EndPlaceHolderWrites() {
+        if (!m_is_write_pipeline_active) {
+            return;
+        }
+
+        /* Signal the write threads to exit, once they have finished any outstanding writes. */
+        {
+            std::scoped_lock lk(m_write_mutex);
+            m_exit_write_thread = true;
+            m_write_cv.Broadcast();
+        }
+
+        for (size_t i = 0; i < m_write_thread_count; i++) {
+            os::WaitThread(std::addressof(m_write_threads[i]));
+            os::DestroyThread(std::addressof(m_write_threads[i]));
+        }
+        m_write_thread_count = 0;
+
+        m_is_write_pipeline_active = false;
+        g_place_holder_write_thread_lock.Unlock();
+    }
+
+    Result InstallTaskBase::WaitPlaceHolderWrites() {
+        R_SUCCEED_IF(!m_is_write_pipeline_active);
+
+        std::scoped_lock lk(m_write_mutex);
+        while (m_write_slot_pending > 0) {
+            m_write_cv.Wait(m_write_mutex);
+        }
+
+        R_RETURN(m_write_result);
+    }
+
+    Result InstallTaskBase::SubmitPlaceHolderWrite(InstallContentInfo *content_info, const void *data, size_t data_size) {
+        const u8 *src = static_cast<const u8 *>(data);
+        while (data_size > 0) {
+            /* Wait for a free slot. */
+            PlaceHolderWriteSlot *free_slot;
+            {
+                std::scoped_lock lk(m_write_mutex);
+                while (m_write_slot_pending == m_write_slot_count && R_SUCCEEDED(m_write_result)) {
+                    m_write_cv.Wait(m_write_mutex);
+                }
+
+                /* If a write failed, there's no point producing more data. */
+                R_TRY(m_write_result);
+
+                free_slot = this->FindFreePlaceHolderWriteSlot();
+                AMS_ASSERT(free_slot != nullptr);
+            }
+
+            /* Fill the slot, and hash its data while it's still in cache. */
+            /* The hash state is saved with the slot, so that the content info's hash always matches what was written. */
+            auto &slot = *free_slot;
+            const size_t cur_size = std::min(data_size, slot.buffer_size);
+            std::memcpy(slot.buffer, src, cur_size);
+            m_sha256_generator.Update(slot.buffer, cur_size);
+
+            slot.size               = cur_size;
+            slot.content_info       = content_info;
+            slot.offset             = m_write_offset;
+            slot.buffered_data_size = m_sha256_generator.GetBufferedDataSize();
+            m_sha256_generator.GetContext(std::addressof(slot.context));
+            m_sha256_generator.GetBufferedData(slot.buffered_data, slot.buffered_data_size);
+
+            /* Submit the slot. */
+            {
+                std::scoped_lock lk(m_write_mutex);
+                slot.state    = PlaceHolderWriteSlotState_Pending;
+                slot.sequence = m_write_sequence++;
+                ++m_write_slot_pending;
+                m_write_cv.Broadcast();
+            }
+
+            m_write_offset += cur_size;
+            src            += cur_size;
+            data_size      -= cur_size;
+        }
+
+        R_SUCCEED();
+    }
+
+    Result InstallTaskBase::WritePlaceHolderSlot(ContentStorage *storage, util::optional<StorageId> *storage_id, const PlaceHolderWriteSlot &slot) {
+        InstallContentInfo *content_info = slot.content_info;
+
+        /* Open the content storage for the content info, if we don't already have it open. */
+        if (!storage_id->has_value() || **storage_id != content_info->storage_id) {
+            *storage_id = util::nullopt;
+            R_TRY(OpenContentStorage(storage, content_info->storage_id));
+            *storage_id = content_info->storage_id;
+        }
+
+        /* Write data to the placeholder. */
+        R_TRY(storage->WritePlaceHolder(content_info->placeholder_id, slot.offset, slot.buffer, slot.size));
+
+        /* Update the content info to reflect the write. */
+        content_info->written            = slot.offset + slot.size;
+        content_info->context            = slot.context;
+        content_info->buffered_data_size = slot.buffered_data_size;
+        std::memcpy(content_info->buffered_data, slot.buffered_data, slot.buffered_data_size);
+        content_info->is_sha256_calculated = true;
+
+        /* Update progress/throughput if content info isn't temporary. */
+        if (!content_info->is_temporary) {
+            this->IncrementProgress(slot.size);
+            this->UpdateThroughputMeasurement(slot.size);
+        }
+
+        R_SUCCEED();
+    }
+
+    InstallTaskBase::PlaceHolderWriteSlot *InstallTaskBase::FindFreePlaceHolderWriteSlot() {
+        for (size_t i = 0; i < m_write_slot_count; i++) {
+            if (m_write_slots[i].state == PlaceHolderWriteSlotState_Free) {
+                return std::addressof(m_write_slots[i]);
+            }
+        }
+
+        return nullptr;
+    }
+
+    InstallTaskBase::PlaceHolderWriteSlot *InstallTaskBase::FindWritablePlaceHolderWriteSlot() {
+        /* Find the oldest pending slot whose placeholder isn't being written by another thread. */
+        /* NOTE: Each placeholder is thus written by one thread at a time and in order, so its content info only ever moves forward. */
+        PlaceHolderWriteSlot *found = nullptr;
+        for (size_t i = 0; i < m_write_slot_count; i++) {
+            auto &slot = m_write_slots[i];
+            if (slot.state != PlaceHolderWriteSlotState_Pending || (found != nullptr && found->sequence < slot.sequence)) {
+                continue;
+            }
+
+            bool is_busy = false;
+            for (size_t j = 0; j < m_write_slot_count; j++) {
+                if (m_write_slots[j].state == PlaceHolderWriteSlotState_Writing && m_write_slots[j].content_info == slot.content_info) {
+                    is_busy = true;
+                    break;
+                }
+            }
+
+            if (!is_busy) {
+                found = std::addressof(slot);
+            }
+        }
+
+        return found;
+    }
+
+    void InstallTaskBase::ProcessPlaceHolderWrites() {
+        ContentStorage storage;
+        util::optional<StorageId> storage_id = util::nullopt;
+
+        std::scoped_lock lk(m_write_mutex);
+        while (true) {
+            /* Wait for a slot we can write. */
+            PlaceHolderWriteSlot *slot;
+            while ((slot = this->FindWritablePlaceHolderWriteSlot()) == nullptr && !(m_exit_write_thread && m_write_slot_pending == 0)) {
+                m_write_cv.Wait(m_write_mutex);
+            }
+
+            if (slot == nullptr) {
+                break;
+            }
+
+            /* Write the slot, unless a previous write failed. */
+            if (R_SUCCEEDED(m_write_result)) {
+                slot->state = PlaceHolderWriteSlotState_Writing;
+
+                m_write_mutex.Unlock();
+                const Result result = this->WritePlaceHolderSlot(std::addressof(storage), std::addressof(storage_id), *slot);
+                m_write_mutex.Lock();
+
+                if (R_FAILED(result) && R_SUCCEEDED(m_write_result)) {
+                    m_write_result = result;
+                }
+            }
+
+            /* Free the slot. */
+            slot->state = PlaceHolderWriteSlotState_Free;
+            --m_write_slot_pending;
+            m_write_cv.Broadcast();
+        }
+    }
+
+    void InstallTaskBase::PlaceHolderWriteThreadFunction(void *arg) {
+        static_cast<InstallTaskBase *>(arg)->ProcessPlaceHolderWrites();
+    }
+
     Result InstallTaskBase::WritePlaceHolder(const ContentMetaKey &key, InstallContentInfo *content_info) {
+        /* Write the data, and wait for it to reach the placeholder. */
+        R_TRY(this->WritePlaceHolderData(key, content_info));
+        R_TRY(this->WaitPlaceHolderWrites());
+
+        R_RETURN(this->InstallTicketForPlaceHolder(content_info));
+    }
+
+    Result InstallTaskBase::WritePlaceHolderData(const ContentMetaKey &key, InstallContentInfo *content_info) {
         if (content_info->is_sha256_calculated) {
             /* Update the hash with the buffered data. */
             m_sha256_generator.InitializeWithContext(std::addressof(content_info->context));
@@ -566,13 +843,19 @@ namespace ams::ncm {
             m_sha256_generator.Initialize();
         }
 
+        /* Data is produced from where we last wrote. */
+        m_write_offset = content_info->written;
+
         {
             ON_SCOPE_EXIT {
                 /* Update this content info's sha256 data. */
-                m_sha256_generator.GetContext(std::addressof(content_info->context));
-                content_info->buffered_data_size = m_sha256_generator.GetBufferedDataSize();
-                m_sha256_generator.GetBufferedData(content_info->buffered_data, m_sha256_generator.GetBufferedDataSize());
-                content_info->is_sha256_calculated = true;
+                /* NOTE: When writing on worker threads, they do this as each write completes. */
+                if (!m_is_write_pipeline_active) {
+                    m_sha256_generator.GetContext(std::addressof(content_info->context));
+                    content_info->buffered_data_size = m_sha256_generator.GetBufferedDataSize();
+                    m_sha256_generator.GetBufferedData(content_info->buffered_data, m_sha256_generator.GetBufferedDataSize());
+                    content_info->is_sha256_calculated = true;
+                }
             };
 
             /* Perform the placeholder write. */
@@ -586,6 +869,10 @@ namespace ams::ncm {
             R_UNLESS(std::memcmp(hash, content_info->digest.data, crypto::Sha256Generator::HashSize) == 0, ncm::ResultInvalidContentHash());
         }
 
+        R_SUCCEED();
+    }
+
+    Result InstallTaskBase::InstallTicketForPlaceHolder(const InstallContentInfo *content_info) {
         if (hos::GetVersion() >= hos::Version_2_0_0 && !(m_config & InstallConfig_IgnoreTicket)) {
             ncm::RightsId rights_id;
             {
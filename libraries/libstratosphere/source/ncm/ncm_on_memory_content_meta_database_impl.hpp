@@ -21,7 +21,7 @@ namespace ams::ncm {
 
     class OnMemoryContentMetaDatabaseImpl : public ContentMetaDatabaseImpl {
         public:
-            OnMemoryContentMetaDatabaseImpl(ams::kvdb::MemoryKeyValueStore<ContentMetaKey> *kvs) : ContentMetaDatabaseImpl(kvs) { /* ... */ }
+            OnMemoryContentMetaDatabaseImpl(ams::kvdb::MemoryKeyValueStore<ContentMetaKey> *kvs, MemoryResource *index_mr) : ContentMetaDatabaseImpl(kvs, index_mr) { /* ... */ }
         public:
             /* Actual commands. */
             virtual Result List(sf::Out<s32> out_entries_total, sf::Out<s32> out_entries_written, const sf::OutArray<ContentMetaKey> &out_info, ContentMetaType meta_type, ApplicationId application_id, u64 min, u64 max, ContentInstallType install_type) override;
@@ -20,8 +20,18 @@ namespace ams::ncm {
     Result PackageInstallTaskBase::Initialize(const char *package_root_path, void *buffer, size_t buffer_size, StorageId storage_id, InstallTaskDataBase *data, u32 config) {
         R_TRY(InstallTaskBase::Initialize(storage_id, data, config));
         m_package_root.Assign(package_root_path);
-        m_buffer = buffer;
-        m_buffer_size = buffer_size;
+
+        /* If the buffer is large enough, read into a quarter of it, and use the rest to write placeholders while we read. */
+        const size_t read_buffer_size = util::AlignDown(buffer_size / (1 + PlaceHolderWriteSlotCount), os::MemoryPageSize);
+        if (read_buffer_size >= PlaceHolderWriteSlotSizeMin) {
+            m_buffer      = buffer;
+            m_buffer_size = read_buffer_size;
+            this->SetPlaceHolderWriteBuffer(static_cast<u8 *>(buffer) + read_buffer_size, buffer_size - read_buffer_size, PlaceHolderWriteSlotCount);
+        } else {
+            m_buffer      = buffer;
+            m_buffer_size = buffer_size;
+        }
+
         R_SUCCEED();
     }
 
@@ -45,7 +55,7 @@ namespace ams::ncm {
         while (true) {
             /* Read as much of the remainder of the file as possible. */
             size_t size_read;
-            R_TRY(fs::ReadFile(std::addressof(size_read), file, content_info->written, m_buffer, m_buffer_size));
+            R_TRY(fs::ReadFile(std::addressof(size_read), file, this->GetPlaceHolderWriteOffset(), m_buffer, m_buffer_size));
 
             /* There is nothing left to read. */
             if (size_read == 0) {
@@ -15,38 +15,22 @@
  */
 #pragma once
 #include <stratosphere.hpp>
+#include "ncm_file_handle_cache.hpp"
 
 namespace ams::ncm {
 
     class PlaceHolderAccessor {
+        public:
+            static constexpr size_t FileCacheEntryCount = 0x4;
         private:
-            struct CacheEntry {
-                PlaceHolderId id;
-                fs::FileHandle handle;
-                u64 counter;
-            };
-
-            static constexpr size_t MaxCacheEntries = 0x2;
-        private:
-            std::array<CacheEntry, MaxCacheEntries> m_caches;
+            FileHandleCache<PlaceHolderId, FileCacheEntryCount> m_file_cache;
             PathString *m_root_path;
-            u64 m_cur_counter;
-            os::SdkMutex m_cache_mutex;
             MakePlaceHolderPathFunction m_make_placeholder_path_func;
             bool m_delay_flush;
         private:
             Result Open(fs::FileHandle *out_handle, PlaceHolderId placeholder_id);
-            bool LoadFromCache(fs::FileHandle *out_handle, PlaceHolderId placeholder_id);
-            void StoreToCache(PlaceHolderId placeholder_id, fs::FileHandle handle);
-            void Invalidate(CacheEntry *entry);
-            CacheEntry *FindInCache(PlaceHolderId placeholder_id);
-            CacheEntry *GetFreeEntry();;
         public:
-            PlaceHolderAccessor() : m_root_path(nullptr), m_cur_counter(0), m_cache_mutex(), m_make_placeholder_path_func(nullptr), m_delay_flush(false) {
-                for (size_t i = 0; i < MaxCacheEntries; i++) {
-                    m_caches[i].id = InvalidPlaceHolderId;
-                }
-            }
+            PlaceHolderAccessor() : m_file_cache(true), m_root_path(nullptr), m_make_placeholder_path_func(nullptr), m_delay_flush(false) { /* ... */ }
 
             ~PlaceHolderAccessor() { this->InvalidateAll(); }
 
@@ -71,6 +55,8 @@ namespace ams::ncm {
 
             void InvalidateAll();
 
+            void GetFileCacheStatistics(FileHandleCacheStatistics *out) const { m_file_cache.GetStatistics(out); }
+
             Result EnsurePlaceHolderDirectory(PlaceHolderId placeholder_id);
             size_t GetHierarchicalDirectoryDepth() const { return GetHierarchicalPlaceHolderDirectoryDepth(m_make_placeholder_path_func); }
     };
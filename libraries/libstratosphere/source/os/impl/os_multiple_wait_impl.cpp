@@ -71,11 +71,11 @@ namespace ams::os::impl {
 
     template<bool AllowReply>
     Result MultiWaitImpl::InternalWaitAnyImpl(MultiWaitHolderBase **out, bool infinite, TimeSpan timeout, NativeHandle reply_target) {
-        /* Build the objects array. */
+        /* Build the objects array, unless our target impl waits on handles registered with it as holders are linked. */
         NativeHandle object_handles[MaximumHandleCount];
         MultiWaitHolderBase *objects[MaximumHandleCount];
 
-        const s32 count = this->ConstructObjectsArray(object_handles, objects, MaximumHandleCount);
+        const s32 count = m_target_impl.IsNativeHandleRegistrationEnabled() ? m_target_impl.GetRegisteredNativeHandleCount() : this->ConstructObjectsArray(object_handles, objects, MaximumHandleCount);
 
         /* Determine the appropriate end time for our wait. */
         const TimeSpan end_time = infinite ? TimeSpan::FromNanoSeconds(std::numeric_limits<s64>::max()) : os::impl::GetCurrentTick().ToTimeSpan() + timeout;
@@ -153,16 +153,18 @@ namespace ams::os::impl {
                         R_RETURN(wait_result);
                     }
                     break;
-                default: /* 0 - 0x3F, valid. */
+                default:
                     {
-                        /* Sanity check that the returned index is within the range of our objects array. */
+                        /* Sanity check that the returned index is within the range of our objects. */
                         AMS_ASSERT(0 <= index && index < count);
 
+                        MultiWaitHolderBase * const signaled_object = m_target_impl.GetSignaledHolder(objects, index);
+
                         std::scoped_lock lk(m_cs_wait);
 
                         /* Set our signaled holder (and the output) as the newly signaled object. */
-                        m_signaled_holder = objects[index];
-                        *out              = objects[index];
+                        m_signaled_holder = signaled_object;
+                        *out              = signaled_object;
                         R_RETURN(wait_result);
                     }
                     break;
@@ -208,13 +210,24 @@ namespace ams::os::impl {
         return count;
     }
 
+    MultiWaitImpl::MultiWaitList::iterator MultiWaitImpl::GetUserWaitObjectEnd() {
+        /* Holders with native handles are kept at the back of our list, so find the first of them. */
+        auto it = m_multi_wait_list.begin();
+        for (os::NativeHandle handle = os::InvalidNativeHandle; it != m_multi_wait_list.end() && !it->GetNativeHandle(std::addressof(handle)); ++it) {
+            /* ... */
+        }
+
+        return it;
+    }
+
     MultiWaitHolderBase *MultiWaitImpl::AddToEachObjectListAndCheckObjectState() {
         /* Add each holder to the current object list, checking for the first signaled object. */
+        /* NOTE: Holders with native handles have no object list, and are never signaled here. */
         MultiWaitHolderBase *signaled_holder = nullptr;
 
-        for (MultiWaitHolderBase &holder_base : m_multi_wait_list) {
-            if (const TriBool is_signaled = holder_base.AddToObjectList(); signaled_holder == nullptr && is_signaled == TriBool::True) {
-                signaled_holder = std::addressof(holder_base);
+        for (auto it = m_multi_wait_list.begin(), end = this->GetUserWaitObjectEnd(); it != end; ++it) {
+            if (const TriBool is_signaled = it->AddToObjectList(); signaled_holder == nullptr && is_signaled == TriBool::True) {
+                signaled_holder = std::addressof(*it);
             }
         }
 
@@ -223,8 +236,8 @@ namespace ams::os::impl {
 
     void MultiWaitImpl::RemoveFromEachObjectList() {
         /* Remove each holder from the current object list. */
-        for (MultiWaitHolderBase &holder_base : m_multi_wait_list) {
-            holder_base.RemoveFromObjectList();
+        for (auto it = m_multi_wait_list.begin(), end = this->GetUserWaitObjectEnd(); it != end; ++it) {
+            it->RemoveFromObjectList();
         }
     }
 
@@ -233,9 +246,10 @@ namespace ams::os::impl {
         MultiWaitHolderBase *min_timeout_holder = nullptr;
         TimeSpan min_time = end_time;
 
-        for (MultiWaitHolderBase &holder_base : m_multi_wait_list) {
-            if (const TimeSpan cur_time = holder_base.GetAbsoluteTimeToWakeup(); cur_time < min_time) {
-                min_timeout_holder = std::addressof(holder_base);
+        /* NOTE: Holders with native handles never have a wakeup time. */
+        for (auto it = m_multi_wait_list.begin(), end = this->GetUserWaitObjectEnd(); it != end; ++it) {
+            if (const TimeSpan cur_time = it->GetAbsoluteTimeToWakeup(); cur_time < min_time) {
+                min_timeout_holder = std::addressof(*it);
                 min_time           = cur_time;
             }
         }
@@ -52,6 +52,8 @@ namespace ams::os::impl {
 
             s32 ConstructObjectsArray(NativeHandle out_handles[], MultiWaitHolderBase *out_objects[], s32 num);
 
+            MultiWaitList::iterator GetUserWaitObjectEnd();
+
             MultiWaitHolderBase *AddToEachObjectListAndCheckObjectState();
             void                 RemoveFromEachObjectList();
 
@@ -84,27 +86,37 @@ namespace ams::os::impl {
             }
 
             void PushBackToList(MultiWaitHolderBase &holder_base) {
-                m_multi_wait_list.push_back(holder_base);
+                /* Holders without native handles are kept at the front of our list, as only they need processing for each wait. */
+                if (os::NativeHandle handle = os::InvalidNativeHandle; holder_base.GetNativeHandle(std::addressof(handle))) {
+                    m_multi_wait_list.push_back(holder_base);
+                } else {
+                    m_multi_wait_list.insert(this->GetUserWaitObjectEnd(), holder_base);
+                }
+
+                m_target_impl.OnHolderLinked(m_multi_wait_list, holder_base);
             }
 
             void EraseFromList(MultiWaitHolderBase &holder_base) {
                 m_multi_wait_list.erase(m_multi_wait_list.iterator_to(holder_base));
+                m_target_impl.OnHolderUnlinked(m_multi_wait_list, holder_base);
             }
 
             void EraseAllFromList() {
                 while (!m_multi_wait_list.empty()) {
-                    m_multi_wait_list.front().SetMultiWait(nullptr);
-                    m_multi_wait_list.pop_front();
+                    auto &holder_base = m_multi_wait_list.front();
+                    this->EraseFromList(holder_base);
+                    holder_base.SetMultiWait(nullptr);
                 }
             }
 
             void MoveAllFromOther(MultiWaitImpl &other) {
-                /* Set ourselves as multi wait for all of the other's holders. */
-                for (auto &w : other.m_multi_wait_list) {
-                    w.SetMultiWait(this);
+                /* Move each of the other's holders to us, so that both target impls see them unlinked/linked. */
+                while (!other.m_multi_wait_list.empty()) {
+                    auto &holder_base = other.m_multi_wait_list.front();
+                    other.EraseFromList(holder_base);
+                    this->PushBackToList(holder_base);
+                    holder_base.SetMultiWait(this);
                 }
-
-                m_multi_wait_list.splice(m_multi_wait_list.end(), other.m_multi_wait_list);
             }
 
             /* Other. */
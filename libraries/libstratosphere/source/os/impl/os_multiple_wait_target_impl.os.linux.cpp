@@ -18,19 +18,25 @@
 #include "os_multiple_wait_impl.hpp"
 #include "os_timeout_helper.hpp"
 #include "os_inter_process_event_impl.os.linux.hpp"
+#include "os_native_handle_impl.hpp"
 
 #include <poll.h>
+#include <sys/epoll.h>
 
 namespace ams::os::impl {
 
-    MultiWaitLinuxImpl::MultiWaitLinuxImpl() {
+    MultiWaitLinuxImpl::MultiWaitLinuxImpl() : m_epoll_handle(InvalidNativeHandle), m_native_handle_count(0), m_duplicate_native_handle_count(0), m_registered_signaled_holder(nullptr) {
         R_ABORT_UNLESS(InterProcessEventLinuxImpl::CreateSingle(std::addressof(m_cancel_event)));
     }
 
     MultiWaitLinuxImpl::~MultiWaitLinuxImpl() {
         InterProcessEventLinuxImpl::Close(m_cancel_event);
+        if (m_epoll_handle != InvalidNativeHandle) {
+            NativeHandleImpl::Close(m_epoll_handle);
+        }
 
         m_cancel_event = InvalidNativeHandle;
+        m_epoll_handle = InvalidNativeHandle;
     }
 
     void MultiWaitLinuxImpl::CancelWait() {
@@ -93,6 +99,93 @@ namespace ams::os::impl {
         }
     }
 
+    void MultiWaitLinuxImpl::EnableNativeHandleRegistration() {
+        AMS_ASSERT(!this->IsNativeHandleRegistrationEnabled());
+
+        /* Create our epoll instance. */
+        m_epoll_handle = ::epoll_create1(EPOLL_CLOEXEC);
+        AMS_ABORT_UNLESS(m_epoll_handle != InvalidNativeHandle);
+
+        /* Register our cancel event, without a holder. */
+        AMS_ABORT_UNLESS(this->RegisterNativeHandle(m_cancel_event, nullptr));
+    }
+
+    bool MultiWaitLinuxImpl::RegisterNativeHandle(NativeHandle handle, MultiWaitHolderBase *holder) {
+        AMS_ASSERT(this->IsNativeHandleRegistrationEnabled());
+
+        struct epoll_event ev = { .events = EPOLLIN, .data = { .ptr = holder } };
+        if (::epoll_ctl(m_epoll_handle, EPOLL_CTL_ADD, handle, std::addressof(ev)) != 0) {
+            /* epoll only allows a single registration per handle. */
+            AMS_ABORT_UNLESS(errno == EEXIST);
+            return false;
+        }
+
+        return true;
+    }
+
+    void MultiWaitLinuxImpl::UnregisterNativeHandle(NativeHandle handle) {
+        AMS_ASSERT(this->IsNativeHandleRegistrationEnabled());
+
+        /* NOTE: Holders must be unlinked before their handles are closed, as a closed handle's number may since have been reused and registered by another holder. */
+        AMS_ABORT_UNLESS(::epoll_ctl(m_epoll_handle, EPOLL_CTL_DEL, handle, nullptr) == 0);
+    }
+
+    Result MultiWaitLinuxImpl::WaitRegisteredNativeHandlesImpl(s32 *out_index, s64 ns) {
+        AMS_ASSERT(this->IsNativeHandleRegistrationEnabled());
+
+        /* epoll_wait only has millisecond granularity, so perform timed waits by polling our epoll instance itself. */
+        if (ns > 0) {
+            struct pollfd pfd = { .fd = m_epoll_handle, .events = POLLIN, .revents = 0 };
+
+            constexpr s64 NanoSecondsPerSecond = TimeSpan::FromSeconds(1).GetNanoSeconds();
+            struct timespec ts = { .tv_sec = (ns / NanoSecondsPerSecond), .tv_nsec = ns % NanoSecondsPerSecond };
+
+            const auto ret = ::ppoll(std::addressof(pfd), 1, std::addressof(ts), nullptr);
+            if (ret < 0) {
+                /* Treat EINTR like a cancellation event; this will lead to a re-poll if nothing is signaled. */
+                AMS_ABORT_UNLESS(errno == EINTR);
+
+                *out_index = MultiWaitImpl::WaitCancelled;
+                R_SUCCEED();
+            } else if (ret == 0) {
+                *out_index = MultiWaitImpl::WaitTimedOut;
+                R_SUCCEED();
+            }
+        }
+
+        /* Get the signaled handles. */
+        struct epoll_event events[EventCountMax];
+        const auto ret = ::epoll_wait(m_epoll_handle, events, EventCountMax, ns < 0 ? -1 : 0);
+        if (ret < 0) {
+            /* Treat EINTR like a cancellation event; this will lead to a re-poll if nothing is signaled. */
+            AMS_ABORT_UNLESS(errno == EINTR);
+
+            *out_index = MultiWaitImpl::WaitCancelled;
+            R_SUCCEED();
+        } else if (ret == 0) {
+            /* If we polled our epoll instance as signaled, something was unsignaled before we could get it; let our caller re-poll. */
+            *out_index = ns > 0 ? MultiWaitImpl::WaitCancelled : MultiWaitImpl::WaitTimedOut;
+            R_SUCCEED();
+        }
+
+        /* Check for cancellation first, as it may mean a non-native waitable was signaled. */
+        for (auto i = 0; i < ret; ++i) {
+            if (events[i].data.ptr == nullptr) {
+                *out_index = MultiWaitImpl::WaitCancelled;
+
+                /* Reset our cancel event. */
+                InterProcessEventLinuxImpl::Clear(m_cancel_event);
+
+                R_SUCCEED();
+            }
+        }
+
+        /* NOTE: epoll moves the handles it returns to the back of its ready list, so repeated waits are fair among signaled handles. */
+        *out_index                   = 0;
+        m_registered_signaled_holder = static_cast<MultiWaitHolderBase *>(events[0].data.ptr);
+        R_SUCCEED();
+    }
+
     Result MultiWaitLinuxImpl::ReplyAndReceiveImpl(s32 *out_index, s32 num, NativeHandle arr[], s32 array_size, s64 ns, NativeHandle reply_target) {
         AMS_UNUSED(out_index, num, arr, array_size, ns, reply_target);
         R_ABORT_UNLESS(os::ResultNotImplemented());
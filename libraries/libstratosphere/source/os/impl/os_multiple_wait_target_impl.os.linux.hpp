@@ -16,18 +16,44 @@
 #pragma once
 #include <stratosphere.hpp>
 #include "os_thread_manager.hpp"
+#include "os_multiple_wait_holder_base.hpp"
 
 namespace ams::os::impl {
 
     class MultiWaitLinuxImpl {
         public:
-            /* TODO: This can potentially be higher. */
             static constexpr size_t MaximumHandleCount = 64;
+        private:
+            static constexpr s32 EventCountMax = 8;
         private:
             NativeHandle m_cancel_event;
+            NativeHandle m_epoll_handle;
+            s32 m_native_handle_count;
+            s32 m_duplicate_native_handle_count;
+            MultiWaitHolderBase *m_registered_signaled_holder;
         private:
             Result PollNativeHandlesImpl(s32 *out_index, s32 num, NativeHandle arr[], s32 array_size, s64 ns);
+            Result WaitRegisteredNativeHandlesImpl(s32 *out_index, s64 ns);
             Result ReplyAndReceiveImpl(s32 *out_index, s32 num, NativeHandle arr[], s32 array_size, s64 ns, NativeHandle reply_target);
+
+            Result WaitNativeHandlesImpl(s32 *out_index, s32 num, NativeHandle arr[], s32 array_size, s64 ns) {
+                if (this->IsNativeHandleRegistrationEnabled()) {
+                    R_RETURN(this->WaitRegisteredNativeHandlesImpl(out_index, ns));
+                } else {
+                    R_RETURN(this->PollNativeHandlesImpl(out_index, num, arr, array_size, ns));
+                }
+            }
+
+            void EnableNativeHandleRegistration();
+            bool RegisterNativeHandle(NativeHandle handle, MultiWaitHolderBase *holder);
+            void UnregisterNativeHandle(NativeHandle handle);
+
+            void RegisterHolder(NativeHandle handle, MultiWaitHolderBase &holder_base) {
+                /* If another holder already registered the same handle, we'll register this one when that holder is unlinked. */
+                if (!this->RegisterNativeHandle(handle, std::addressof(holder_base))) {
+                    ++m_duplicate_native_handle_count;
+                }
+            }
         public:
             MultiWaitLinuxImpl();
             ~MultiWaitLinuxImpl();
@@ -35,15 +61,15 @@ namespace ams::os::impl {
             void CancelWait();
 
             Result WaitAny(s32 *out_index, NativeHandle arr[], s32 array_size, s32 num) {
-                R_RETURN(this->PollNativeHandlesImpl(out_index, num, arr, array_size, static_cast<s64>(-1)));
+                R_RETURN(this->WaitNativeHandlesImpl(out_index, num, arr, array_size, static_cast<s64>(-1)));
             }
 
             Result TryWaitAny(s32 *out_index, NativeHandle arr[], s32 array_size, s32 num) {
-                R_RETURN(this->PollNativeHandlesImpl(out_index, num, arr, array_size, 0));
+                R_RETURN(this->WaitNativeHandlesImpl(out_index, num, arr, array_size, 0));
             }
 
             Result TimedWaitAny(s32 *out_index, NativeHandle arr[], s32 array_size, s32 num, TimeSpan ts) {
-                R_RETURN(this->PollNativeHandlesImpl(out_index, num, arr, array_size, ts.GetNanoSeconds()));
+                R_RETURN(this->WaitNativeHandlesImpl(out_index, num, arr, array_size, ts.GetNanoSeconds()));
             }
 
             Result ReplyAndReceive(s32 *out_index, NativeHandle arr[], s32 array_size, s32 num, NativeHandle reply_target) {
@@ -61,6 +87,71 @@ namespace ams::os::impl {
             void ClearCurrentThreadHandleForCancelWait() {
                 /* ... */
             }
+
+            /* Lists with more native handles than fit in a wait's array wait on an epoll instance instead, with handles registered as holders are linked. */
+            /* NOTE: For smaller lists, ppoll over the array is faster than the epoll_ctl calls made as signaled holders are unlinked and relinked. */
+            bool IsNativeHandleRegistrationEnabled() const {
+                return m_epoll_handle != InvalidNativeHandle;
+            }
+
+            s32 GetRegisteredNativeHandleCount() const {
+                return m_native_handle_count;
+            }
+
+            MultiWaitHolderBase *GetSignaledHolder(MultiWaitHolderBase *objects[], s32 index) const {
+                return this->IsNativeHandleRegistrationEnabled() ? m_registered_signaled_holder : objects[index];
+            }
+
+            template<typename List>
+            void OnHolderLinked(List &list, MultiWaitHolderBase &holder_base) {
+                os::NativeHandle handle = os::InvalidNativeHandle;
+                if (!holder_base.GetNativeHandle(std::addressof(handle))) {
+                    return;
+                }
+
+                ++m_native_handle_count;
+
+                if (this->IsNativeHandleRegistrationEnabled()) {
+                    this->RegisterHolder(handle, holder_base);
+                } else if (m_native_handle_count > static_cast<s32>(MaximumHandleCount)) {
+                    /* We no longer fit in a wait's array, so register the handles of all of our holders (including this one). */
+                    this->EnableNativeHandleRegistration();
+
+                    for (auto &linked : list) {
+                        if (os::NativeHandle linked_handle = os::InvalidNativeHandle; linked.GetNativeHandle(std::addressof(linked_handle))) {
+                            this->RegisterHolder(linked_handle, linked);
+                        }
+                    }
+                }
+            }
+
+            template<typename List>
+            void OnHolderUnlinked(List &list, MultiWaitHolderBase &holder_base) {
+                /* NOTE: The holder must already have been removed from the list. */
+                os::NativeHandle handle = os::InvalidNativeHandle;
+                if (!holder_base.GetNativeHandle(std::addressof(handle))) {
+                    return;
+                }
+
+                --m_native_handle_count;
+
+                if (!this->IsNativeHandleRegistrationEnabled()) {
+                    return;
+                }
+
+                this->UnregisterNativeHandle(handle);
+
+                /* If another holder shares the handle, register it in place of whichever holder was registered. */
+                if (m_duplicate_native_handle_count > 0) {
+                    for (auto &linked : list) {
+                        if (os::NativeHandle linked_handle = os::InvalidNativeHandle; linked.GetNativeHandle(std::addressof(linked_handle)) && linked_handle == handle) {
+                            AMS_ABORT_UNLESS(this->RegisterNativeHandle(handle, std::addressof(linked)));
+                            --m_duplicate_native_handle_count;
+                            break;
+                        }
+                    }
+                }
+            }
     };
 
     using MultiWaitTargetImpl = MultiWaitLinuxImpl;
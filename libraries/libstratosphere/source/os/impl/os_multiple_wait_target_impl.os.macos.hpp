@@ -19,6 +19,8 @@
 
 namespace ams::os::impl {
 
+    class MultiWaitHolderBase;
+
     class MultiWaitMacosImpl {
         public:
             /* TODO: This can potentially be higher. */
@@ -62,6 +64,29 @@ namespace ams::os::impl {
             void ClearCurrentThreadHandleForCancelWait() {
                 /* ... */
             }
+
+            /* Native handles are only waited on from the array passed to each wait. */
+            constexpr bool IsNativeHandleRegistrationEnabled() const {
+                return false;
+            }
+
+            constexpr s32 GetRegisteredNativeHandleCount() const {
+                return 0;
+            }
+
+            MultiWaitHolderBase *GetSignaledHolder(MultiWaitHolderBase *objects[], s32 index) const {
+                return objects[index];
+            }
+
+            template<typename List>
+            void OnHolderLinked(List &, MultiWaitHolderBase &) {
+                /* ... */
+            }
+
+            template<typename List>
+            void OnHolderUnlinked(List &, MultiWaitHolderBase &) {
+                /* ... */
+            }
     };
 
     using MultiWaitTargetImpl = MultiWaitMacosImpl;
@@ -19,6 +19,8 @@
 
 namespace ams::os::impl {
 
+    class MultiWaitHolderBase;
+
     class MultiWaitWindowsImpl {
         public:
             static constexpr size_t MaximumHandleCount = static_cast<size_t>(MAXIMUM_WAIT_OBJECTS);
@@ -68,6 +70,29 @@ namespace ams::os::impl {
             void ClearCurrentThreadHandleForCancelWait() {
                 /* ... */
             }
+
+            /* Native handles are only waited on from the array passed to each wait. */
+            constexpr bool IsNativeHandleRegistrationEnabled() const {
+                return false;
+            }
+
+            constexpr s32 GetRegisteredNativeHandleCount() const {
+                return 0;
+            }
+
+            MultiWaitHolderBase *GetSignaledHolder(MultiWaitHolderBase *objects[], s32 index) const {
+                return objects[index];
+            }
+
+            template<typename List>
+            void OnHolderLinked(List &, MultiWaitHolderBase &) {
+                /* ... */
+            }
+
+            template<typename List>
+            void OnHolderUnlinked(List &, MultiWaitHolderBase &) {
+                /* ... */
+            }
     };
 
     using MultiWaitTargetImpl = MultiWaitWindowsImpl;
@@ -30,9 +30,13 @@ namespace ams::patcher {
         constexpr size_t IpsFileExtensionLength = util::Strlen(IpsFileExtension);
         constexpr size_t ModuleIpsPatchLength = 2 * sizeof(ro::ModuleId) + IpsFileExtensionLength;
 
+        constexpr size_t PatchReadBufferSize           = 4 * os::MemoryPageSize;
+        constexpr size_t PatchDirectoryEntryBatchCount = 4;
+
         /* Global data. */
         constinit os::SdkMutex g_apply_patch_lock;
-        constinit u8 g_patch_read_buffer[os::MemoryPageSize];
+        constinit u8 g_patch_read_buffer[PatchReadBufferSize];
+        constinit fs::DirectoryEntry g_patch_directory_entries[PatchDirectoryEntryBatchCount];
 
         /* Helpers. */
         inline u8 ConvertHexNybble(const char nybble) {
@@ -63,17 +67,7 @@ namespace ams::patcher {
             return true;
         }
 
-        bool MatchesModuleId(const char *name, size_t name_len, size_t extension_len, const ro::ModuleId *module_id) {
-            /* Get module id. */
-            ro::ModuleId module_id_from_name;
-            if (!ParseModuleIdFromPath(std::addressof(module_id_from_name), name, name_len, extension_len)) {
-                return false;
-            }
-
-            return std::memcmp(std::addressof(module_id_from_name), module_id, sizeof(*module_id)) == 0;
-        }
-
-        bool IsIpsFileForModule(const char *name, const ro::ModuleId *module_id) {
+        bool ParseIpsFileName(ro::ModuleId *out_module_id, const char *name) {
             const size_t name_len = std::strlen(name);
 
             /* The path must be correct size for a module id (with trailing zeroes optionally trimmed) + ".ips". */
@@ -91,11 +85,20 @@ namespace ams::patcher {
                 return false;
             }
 
-            /* The path needs to match the module id. */
-            return MatchesModuleId(name, name_len, IpsFileExtensionLength, module_id);
+            /* The path needs to be a module id. */
+            return ParseModuleIdFromPath(out_module_id, name, name_len, IpsFileExtensionLength);
+        }
+
+        bool IsIpsFileForModule(const char *name, const ro::ModuleId *module_id) {
+            ro::ModuleId module_id_from_name;
+            if (!ParseIpsFileName(std::addressof(module_id_from_name), name)) {
+                return false;
+            }
+
+            return std::memcmp(std::addressof(module_id_from_name), module_id, sizeof(*module_id)) == 0;
         }
 
-        inline bool IsIpsTail(bool is_ips32, u8 *buffer) {
+        inline bool IsIpsTail(bool is_ips32, const u8 *buffer) {
             if (is_ips32) {
                 return std::memcmp(buffer, Ips32TailMagic, sizeof(Ips32TailMagic)) == 0;
             } else {
@@ -103,7 +106,7 @@ namespace ams::patcher {
             }
         }
 
-        inline u32 GetIpsPatchOffset(bool is_ips32, u8 *buffer) {
+        inline u32 GetIpsPatchOffset(bool is_ips32, const u8 *buffer) {
             if (is_ips32) {
                 return (buffer[0] << 24) | (buffer[1] << 16) | (buffer[2] << 8) | (buffer[3]);
             } else {
@@ -111,24 +114,85 @@ namespace ams::patcher {
             }
         }
 
-        inline u32 GetIpsPatchSize(bool is_ips32, u8 *buffer) {
+        inline u32 GetIpsPatchSize(bool is_ips32, const u8 *buffer) {
             AMS_UNUSED(is_ips32);
             return (buffer[0] << 8) | (buffer[1]);
         }
 
+        /* Reads an ips file sequentially through the patch read buffer, so that small records don't each need a file read. */
+        class IpsFileReader {
+            NON_COPYABLE(IpsFileReader);
+            NON_MOVEABLE(IpsFileReader);
+            private:
+                fs::FileHandle m_file;
+                s64 m_buffer_file_offset;
+                size_t m_buffer_offset;
+                size_t m_buffer_size;
+            public:
+                IpsFileReader(fs::FileHandle file, s64 offset) : m_file(file), m_buffer_file_offset(offset), m_buffer_offset(0), m_buffer_size(0) { /* ... */ }
+
+                const u8 *Read(size_t size) {
+                    /* Ensure the data is buffered. */
+                    AMS_ASSERT(size <= sizeof(g_patch_read_buffer));
+                    if (m_buffer_size - m_buffer_offset < size) {
+                        this->Fill();
+                        AMS_ABORT_UNLESS(size <= m_buffer_size);
+                    }
+
+                    const u8 *data = g_patch_read_buffer + m_buffer_offset;
+                    m_buffer_offset += size;
+                    return data;
+                }
+
+                void Read(void *dst, size_t size) {
+                    u8 *dst_u8 = static_cast<u8 *>(dst);
+                    while (size > 0) {
+                        if (m_buffer_offset == m_buffer_size) {
+                            this->Fill();
+                            AMS_ABORT_UNLESS(m_buffer_size > 0);
+                        }
+
+                        const size_t cur_size = std::min(size, m_buffer_size - m_buffer_offset);
+                        std::memcpy(dst_u8, g_patch_read_buffer + m_buffer_offset, cur_size);
+
+                        m_buffer_offset += cur_size;
+                        dst_u8          += cur_size;
+                        size            -= cur_size;
+                    }
+                }
+
+                void Skip(size_t size) {
+                    if (size <= m_buffer_size - m_buffer_offset) {
+                        m_buffer_offset += size;
+                    } else {
+                        m_buffer_file_offset += m_buffer_offset + size;
+                        m_buffer_offset       = 0;
+                        m_buffer_size         = 0;
+                    }
+                }
+            private:
+                void Fill() {
+                    /* Move any unconsumed data to the start of the buffer. */
+                    const size_t remaining = m_buffer_size - m_buffer_offset;
+                    std::memmove(g_patch_read_buffer, g_patch_read_buffer + m_buffer_offset, remaining);
+                    m_buffer_file_offset += m_buffer_offset;
+
+                    /* Read as much as we can after it. */
+                    size_t read_size;
+                    R_ABORT_UNLESS(fs::ReadFile(std::addressof(read_size), m_file, m_buffer_file_offset + remaining, g_patch_read_buffer + remaining, sizeof(g_patch_read_buffer) - remaining));
+
+                    m_buffer_offset = 0;
+                    m_buffer_size   = remaining + read_size;
+                }
+        };
+
         void ApplyIpsPatch(u8 *mapped_module, size_t mapped_size, size_t protected_size, size_t offset, bool is_ips32, fs::FileHandle file) {
             /* Validate offset/protected size. */
             AMS_ABORT_UNLESS(offset <= protected_size);
 
-            s64 file_offset = sizeof(IpsHeadMagic);
-            auto ReadData = [&](void *dst, size_t size) ALWAYS_INLINE_LAMBDA {
-                R_ABORT_UNLESS(fs::ReadFile(file, file_offset, dst, size));
-                file_offset += size;
-            };
-
-            u8 buffer[sizeof(Ips32TailMagic)];
+            IpsFileReader reader(file, sizeof(IpsHeadMagic));
             while (true) {
-                ReadData(buffer, is_ips32 ? sizeof(Ips32TailMagic) : sizeof(IpsTailMagic));
+                const u8 *buffer = reader.Read(is_ips32 ? sizeof(Ips32TailMagic) : sizeof(IpsTailMagic));
 
                 if (IsIpsTail(is_ips32, buffer)) {
                     break;
@@ -138,18 +202,16 @@ namespace ams::patcher {
                 u32 patch_offset = GetIpsPatchOffset(is_ips32, buffer);
 
                 /* Size of patch. */
-                ReadData(buffer, 2);
+                buffer = reader.Read(2);
                 u32 patch_size = GetIpsPatchSize(is_ips32, buffer);
 
                 /* Check for RLE encoding. */
                 if (patch_size == 0) {
-                    /* Size of RLE. */
-                    ReadData(buffer, 2);
+                    /* Size and value of RLE. */
+                    buffer = reader.Read(3);
 
                     u32 rle_size = (buffer[0] << 8) | (buffer[1]);
-
-                    /* Value for RLE. */
-                    ReadData(buffer, 1);
+                    const u8 rle_value = buffer[2];
 
                     /* Ensure we don't write to protected region. */
                     if (patch_offset < protected_size) {
@@ -170,7 +232,7 @@ namespace ams::patcher {
                         AMS_ABORT_UNLESS(patch_offset <= mapped_size);
                         rle_size = mapped_size - patch_offset;
                     }
-                    std::memset(mapped_module + patch_offset, buffer[0], rle_size);
+                    std::memset(mapped_module + patch_offset, rle_value, rle_size);
                 } else {
                     /* Ensure we don't write to protected region. */
                     if (patch_offset < protected_size) {
@@ -178,9 +240,9 @@ namespace ams::patcher {
                             const u32 diff = protected_size - patch_offset;
                             patch_offset += diff;
                             patch_size -= diff;
-                            file_offset += diff;
+                            reader.Skip(diff);
                         } else {
-                            file_offset += patch_size;
+                            reader.Skip(patch_size);
                             continue;
                         }
                     }
@@ -194,94 +256,356 @@ namespace ams::patcher {
                         AMS_ABORT_UNLESS(patch_offset <= mapped_size);
                         read_size = mapped_size - patch_offset;
                     }
-                    {
-                        size_t remaining   = read_size;
-                        size_t copy_offset = patch_offset;
-                        while (remaining > 0) {
-                            const size_t cur_read = std::min(remaining, sizeof(g_patch_read_buffer));
-                            ReadData(g_patch_read_buffer, cur_read);
-                            std::memcpy(mapped_module + copy_offset, g_patch_read_buffer, cur_read);
-                            remaining   -= cur_read;
-                            copy_offset += cur_read;
-                        }
-                    }
+                    reader.Read(mapped_module + patch_offset, read_size);
                     if (patch_size > read_size) {
-                        file_offset += patch_size - read_size;
+                        reader.Skip(patch_size - read_size);
                     }
                 }
             }
         }
 
-    }
+        void ApplyIpsPatchFile(const char *path, size_t protected_size, size_t offset, u8 *mapped_module, size_t mapped_size) {
+            /* Open the file. */
+            fs::FileHandle file;
+            if (R_FAILED(fs::OpenFile(std::addressof(file), path, fs::OpenMode_Read))) {
+                return;
+            }
+            ON_SCOPE_EXIT { fs::CloseFile(file); };
+
+            /* Read the header. */
+            u8 header[sizeof(IpsHeadMagic)];
+            if (R_SUCCEEDED(fs::ReadFile(file, 0, header, sizeof(header)))) {
+                if (std::memcmp(header, IpsHeadMagic, sizeof(header)) == 0) {
+                    ApplyIpsPatch(mapped_module, mapped_size, protected_size, offset, false, file);
+                } else if (std::memcmp(header, Ips32HeadMagic, sizeof(header)) == 0) {
+                    ApplyIpsPatch(mapped_module, mapped_size, protected_size, offset, true, file);
+                }
+            }
+        }
 
-    void LocateAndApplyIpsPatchesToModule(const char *mount_name, const char *patch_dir_name, size_t protected_size, size_t offset, const ro::ModuleId *module_id, u8 *mapped_module, size_t mapped_size) {
-        /* Ensure only one thread tries to apply patches at a time. */
-        std::scoped_lock lk(g_apply_patch_lock);
+        /* Index of the ips patches in /<mount>:/atmosphere/<patch_dir>/<*>/<*>.ips, so that applying patches to a module */
+        /* doesn't read the patch directories again. Entries are kept in enumeration order, which is the order patches apply in. */
+        class IpsPatchIndex {
+            NON_COPYABLE(IpsPatchIndex);
+            NON_MOVEABLE(IpsPatchIndex);
+            public:
+                static constexpr size_t EntryCountMax     = 0x100;
+                static constexpr size_t DirectoryCountMax = 0x40;
+                static constexpr size_t PathBufferSize    = 8_KB;
+            private:
+                struct Entry {
+                    ro::ModuleId module_id{};
+                    u32 path_offset{};
+                };
+
+                /* NOTE: An entry count of -1 means the directory couldn't be opened. */
+                struct Directory {
+                    s64 entry_count{};
+                    u32 name_offset{};
+                };
+            private:
+                char m_mount_name[fs::MountNameLengthMax + 1];
+                char m_patch_dir_name[fs::EntryNameLengthMax + 1];
+                bool m_is_valid;
+                bool m_is_complete;
+                s64 m_patches_dir_entry_count;
+                size_t m_entry_count;
+                size_t m_directory_count;
+                size_t m_path_buffer_size;
+                Entry m_entries[EntryCountMax];
+                Directory m_directories[DirectoryCountMax];
+                char m_path_buffer[PathBufferSize];
+            public:
+                constexpr IpsPatchIndex() : m_mount_name(), m_patch_dir_name(), m_is_valid(false), m_is_complete(false), m_patches_dir_entry_count(-1), m_entry_count(0), m_directory_count(0), m_path_buffer_size(0), m_entries(), m_directories(), m_path_buffer() { /* ... */ }
+
+                /* NOTE: If the index couldn't hold every patch, callers must walk the patch directories themselves. */
+                bool IsComplete() const {
+                    return m_is_complete;
+                }
 
-        /* Inspect all patches from /atmosphere/<patch_dir>/<*>/<*>.ips */
-        char path[fs::EntryNameLengthMax + 1];
-        util::SNPrintf(path, sizeof(path), "%s:/atmosphere/%s", mount_name, patch_dir_name);
-        const size_t patches_dir_path_len = std::strlen(path);
+                /* Checks that the index was built for the patch directory, and that no patch directory has gained or lost entries since. */
+                /* NOTE: This can't see a patch replaced by one with a different name; that is picked up when the sd card changes. */
+                bool IsUpToDate(const char *mount_name, const char *patch_dir_name) const {
+                    if (!m_is_valid || std::strcmp(m_mount_name, mount_name) != 0 || std::strcmp(m_patch_dir_name, patch_dir_name) != 0) {
+                        return false;
+                    }
 
-        /* Open the patch directory. */
-        fs::DirectoryHandle patches_dir;
-        if (R_FAILED(fs::OpenDirectory(std::addressof(patches_dir), path, fs::OpenDirectoryMode_Directory))) {
-            return;
-        }
-        ON_SCOPE_EXIT { fs::CloseDirectory(patches_dir); };
-
-        /* Iterate over the patches directory to find patch subdirectories. */
-        while (true) {
-            /* Read the next entry. */
-            s64 count;
-            fs::DirectoryEntry entry;
-            if (R_FAILED(fs::ReadDirectory(std::addressof(count), std::addressof(entry), patches_dir, 1)) || count == 0) {
-                break;
+                    /* An incomplete index isn't used for lookups, so there's nothing to check. */
+                    if (!m_is_complete) {
+                        return true;
+                    }
+
+                    char path[fs::EntryNameLengthMax + 1];
+                    const size_t patches_dir_path_len = util::SNPrintf(path, sizeof(path), "%s:/atmosphere/%s", mount_name, patch_dir_name);
+
+                    /* Check the patch subdirectory count. */
+                    if (GetDirectoryEntryCount(path, fs::OpenDirectoryMode_Directory) != m_patches_dir_entry_count) {
+                        return false;
+                    }
+
+                    /* Check each patch subdirectory's file count. */
+                    for (size_t i = 0; i < m_directory_count; ++i) {
+                        util::SNPrintf(path + patches_dir_path_len, sizeof(path) - patches_dir_path_len, "/%s", m_path_buffer + m_directories[i].name_offset);
+                        if (GetDirectoryEntryCount(path, fs::OpenDirectoryMode_File) != m_directories[i].entry_count) {
+                            return false;
+                        }
+                    }
+
+                    return true;
+                }
+
+                void Build(const char *mount_name, const char *patch_dir_name) {
+                    /* Reset our state. */
+                    util::Strlcpy(m_mount_name, mount_name, sizeof(m_mount_name));
+                    util::Strlcpy(m_patch_dir_name, patch_dir_name, sizeof(m_patch_dir_name));
+                    m_is_valid                = true;
+                    m_is_complete             = true;
+                    m_patches_dir_entry_count = -1;
+                    m_entry_count             = 0;
+                    m_directory_count         = 0;
+                    m_path_buffer_size        = 0;
+
+                    /* Open the patch directory. */
+                    char path[fs::EntryNameLengthMax + 1];
+                    const size_t patches_dir_path_len = util::SNPrintf(path, sizeof(path), "%s:/atmosphere/%s", mount_name, patch_dir_name);
+
+                    fs::DirectoryHandle patches_dir;
+                    if (R_FAILED(fs::OpenDirectory(std::addressof(patches_dir), path, fs::OpenDirectoryMode_Directory))) {
+                        return;
+                    }
+                    ON_SCOPE_EXIT { fs::CloseDirectory(patches_dir); };
+
+                    if (R_FAILED(fs::GetDirectoryEntryCount(std::addressof(m_patches_dir_entry_count), patches_dir))) {
+                        m_is_complete = false;
+                        return;
+                    }
+
+                    /* Iterate over the patches directory to find patch subdirectories. */
+                    while (true) {
+                        /* Read the next entry. */
+                        s64 count;
+                        fs::DirectoryEntry entry;
+                        if (R_FAILED(fs::ReadDirectory(std::addressof(count), std::addressof(entry), patches_dir, 1)) || count == 0) {
+                            break;
+                        }
+
+                        /* Print the path for this directory. */
+                        util::SNPrintf(path + patches_dir_path_len, sizeof(path) - patches_dir_path_len, "/%s", entry.name);
+
+                        /* Add the patches in the directory. */
+                        if (!this->AddPatchDirectory(path, entry.name)) {
+                            m_is_complete = false;
+                            return;
+                        }
+                    }
+                }
+
+                template<typename F>
+                void ForEachPatch(const ro::ModuleId *module_id, F f) const {
+                    for (size_t i = 0; i < m_entry_count; ++i) {
+                        if (std::memcmp(std::addressof(m_entries[i].module_id), module_id, sizeof(*module_id)) == 0) {
+                            f(m_path_buffer + m_entries[i].path_offset);
+                        }
+                    }
+                }
+            private:
+                static s64 GetDirectoryEntryCount(const char *path, fs::OpenDirectoryMode mode) {
+                    fs::DirectoryHandle dir;
+                    if (R_FAILED(fs::OpenDirectory(std::addressof(dir), path, mode))) {
+                        return -1;
+                    }
+                    ON_SCOPE_EXIT { fs::CloseDirectory(dir); };
+
+                    s64 count;
+                    if (R_FAILED(fs::GetDirectoryEntryCount(std::addressof(count), dir))) {
+                        /* NOTE: -2 never matches a recorded count, so failures always read as a change. */
+                        return -2;
+                    }
+
+                    return count;
+                }
+
+                bool AddPathToBuffer(u32 *out_offset, const char *dir_name, const char *file_name) {
+                    /* Paths are stored relative to the patch directory, as <dir_name> or <dir_name>/<file_name>. */
+                    const size_t dir_name_len = std::strlen(dir_name);
+                    const size_t path_size    = dir_name_len + (file_name != nullptr ? 1 + std::strlen(file_name) : 0) + 1;
+                    if (path_size > PathBufferSize - m_path_buffer_size) {
+                        return false;
+                    }
+
+                    char *dst = m_path_buffer + m_path_buffer_size;
+                    if (file_name != nullptr) {
+                        util::SNPrintf(dst, path_size, "%s/%s", dir_name, file_name);
+                    } else {
+                        util::Strlcpy(dst, dir_name, path_size);
+                    }
+
+                    *out_offset = static_cast<u32>(m_path_buffer_size);
+                    m_path_buffer_size += path_size;
+                    return true;
+                }
+
+                bool AddPatchDirectory(const char *path, const char *dir_name) {
+                    /* Record the directory, so that we can tell when it changes. */
+                    if (m_directory_count >= DirectoryCountMax) {
+                        return false;
+                    }
+
+                    Directory &directory = m_directories[m_directory_count];
+                    if (!this->AddPathToBuffer(std::addressof(directory.name_offset), dir_name, nullptr)) {
+                        return false;
+                    }
+                    ++m_directory_count;
+
+                    /* Open the patch directory. */
+                    directory.entry_count = -1;
+
+                    fs::DirectoryHandle patch_dir;
+                    if (R_FAILED(fs::OpenDirectory(std::addressof(patch_dir), path, fs::OpenDirectoryMode_File))) {
+                        return true;
+                    }
+                    ON_SCOPE_EXIT { fs::CloseDirectory(patch_dir); };
+
+                    if (R_FAILED(fs::GetDirectoryEntryCount(std::addressof(directory.entry_count), patch_dir))) {
+                        return false;
+                    }
+
+                    /* Iterate over files in the patch directory, a batch at a time. */
+                    while (true) {
+                        s64 count;
+                        if (R_FAILED(fs::ReadDirectory(std::addressof(count), g_patch_directory_entries, patch_dir, util::size(g_patch_directory_entries))) || count == 0) {
+                            break;
+                        }
+
+                        for (s64 i = 0; i < count; ++i) {
+                            const char *name = g_patch_directory_entries[i].name;
+
+                            /* Check if this file is an ips patch. */
+                            ro::ModuleId module_id;
+                            if (!ParseIpsFileName(std::addressof(module_id), name)) {
+                                continue;
+                            }
+
+                            /* Add the entry, if we have space. */
+                            if (m_entry_count >= EntryCountMax) {
+                                return false;
+                            }
+
+                            Entry &index_entry = m_entries[m_entry_count];
+                            if (!this->AddPathToBuffer(std::addressof(index_entry.path_offset), dir_name, name)) {
+                                return false;
+                            }
+                            index_entry.module_id = module_id;
+                            ++m_entry_count;
+                        }
+                    }
+
+                    return true;
+                }
+        };
+
+        constinit IpsPatchIndex g_patch_index;
+
+        /* Patches are read from the sd card, so the index is also rebuilt whenever the sd card changes. */
+        constinit bool g_checked_sd_card_detection_event;
+        constinit std::unique_ptr<fs::IEventNotifier> g_sd_card_detection_event_notifier;
+        constinit os::SystemEventType g_sd_card_detection_event;
+
+        bool IsSdCardChanged() {
+            if (!g_checked_sd_card_detection_event) {
+                g_checked_sd_card_detection_event = true;
+                if (R_SUCCEEDED(fs::OpenSdCardDetectionEventNotifier(std::addressof(g_sd_card_detection_event_notifier)))) {
+                    if (R_FAILED(g_sd_card_detection_event_notifier->BindEvent(std::addressof(g_sd_card_detection_event), os::EventClearMode_AutoClear))) {
+                        g_sd_card_detection_event_notifier.reset();
+                    }
+                }
+            }
+
+            /* If we can't tell when the sd card changes, we rely on the index's own checks. */
+            if (g_sd_card_detection_event_notifier == nullptr) {
+                return false;
             }
 
-            /* Print the path for this directory. */
-            util::SNPrintf(path + patches_dir_path_len, sizeof(path) - patches_dir_path_len, "/%s", entry.name);
-            const size_t patch_dir_path_len = patches_dir_path_len + 1 + std::strlen(entry.name);
+            return os::TryWaitSystemEvent(std::addressof(g_sd_card_detection_event));
+        }
+
+        void LocateAndApplyIpsPatchesToModuleUncached(const char *mount_name, const char *patch_dir_name, size_t protected_size, size_t offset, const ro::ModuleId *module_id, u8 *mapped_module, size_t mapped_size) {
+            /* Inspect all patches from /atmosphere/<patch_dir>/<*>/<*>.ips */
+            char path[fs::EntryNameLengthMax + 1];
+            util::SNPrintf(path, sizeof(path), "%s:/atmosphere/%s", mount_name, patch_dir_name);
+            const size_t patches_dir_path_len = std::strlen(path);
 
             /* Open the patch directory. */
-            fs::DirectoryHandle patch_dir;
-            if (R_FAILED(fs::OpenDirectory(std::addressof(patch_dir), path, fs::OpenDirectoryMode_File))) {
-                continue;
+            fs::DirectoryHandle patches_dir;
+            if (R_FAILED(fs::OpenDirectory(std::addressof(patches_dir), path, fs::OpenDirectoryMode_Directory))) {
+                return;
             }
-            ON_SCOPE_EXIT { fs::CloseDirectory(patch_dir); };
+            ON_SCOPE_EXIT { fs::CloseDirectory(patches_dir); };
 
-            /* Iterate over files in the patch directory. */
+            /* Iterate over the patches directory to find patch subdirectories. */
             while (true) {
-                if (R_FAILED(fs::ReadDirectory(std::addressof(count), std::addressof(entry), patch_dir, 1)) || count == 0) {
+                /* Read the next entry. */
+                s64 count;
+                fs::DirectoryEntry entry;
+                if (R_FAILED(fs::ReadDirectory(std::addressof(count), std::addressof(entry), patches_dir, 1)) || count == 0) {
                     break;
                 }
 
-                /* Check if this file is an ips. */
-                if (!IsIpsFileForModule(entry.name, module_id)) {
+                /* Print the path for this directory. */
+                util::SNPrintf(path + patches_dir_path_len, sizeof(path) - patches_dir_path_len, "/%s", entry.name);
+                const size_t patch_dir_path_len = patches_dir_path_len + 1 + std::strlen(entry.name);
+
+                /* Open the patch directory. */
+                fs::DirectoryHandle patch_dir;
+                if (R_FAILED(fs::OpenDirectory(std::addressof(patch_dir), path, fs::OpenDirectoryMode_File))) {
                     continue;
                 }
+                ON_SCOPE_EXIT { fs::CloseDirectory(patch_dir); };
 
-                /* Print the path for this file. */
-                util::SNPrintf(path + patch_dir_path_len, sizeof(path) - patch_dir_path_len, "/%s", entry.name);
+                /* Iterate over files in the patch directory, a batch at a time. */
+                while (true) {
+                    if (R_FAILED(fs::ReadDirectory(std::addressof(count), g_patch_directory_entries, patch_dir, util::size(g_patch_directory_entries))) || count == 0) {
+                        break;
+                    }
 
-                /* Open the file. */
-                fs::FileHandle file;
-                if (R_FAILED(fs::OpenFile(std::addressof(file), path, fs::OpenMode_Read))) {
-                    continue;
-                }
-                ON_SCOPE_EXIT { fs::CloseFile(file); };
-
-                /* Read the header. */
-                u8 header[sizeof(IpsHeadMagic)];
-                if (R_SUCCEEDED(fs::ReadFile(file, 0, header, sizeof(header)))) {
-                    if (std::memcmp(header, IpsHeadMagic, sizeof(header)) == 0) {
-                        ApplyIpsPatch(mapped_module, mapped_size, protected_size, offset, false, file);
-                    } else if (std::memcmp(header, Ips32HeadMagic, sizeof(header)) == 0) {
-                        ApplyIpsPatch(mapped_module, mapped_size, protected_size, offset, true, file);
+                    for (s64 i = 0; i < count; ++i) {
+                        /* Check if this file is an ips. */
+                        const char *name = g_patch_directory_entries[i].name;
+                        if (!IsIpsFileForModule(name, module_id)) {
+                            continue;
+                        }
+
+                        /* Print the path for this file, and apply it. */
+                        util::SNPrintf(path + patch_dir_path_len, sizeof(path) - patch_dir_path_len, "/%s", name);
+                        ApplyIpsPatchFile(path, protected_size, offset, mapped_module, mapped_size);
                     }
                 }
             }
         }
+
+    }
+
+    void LocateAndApplyIpsPatchesToModule(const char *mount_name, const char *patch_dir_name, size_t protected_size, size_t offset, const ro::ModuleId *module_id, u8 *mapped_module, size_t mapped_size) {
+        /* Ensure only one thread tries to apply patches at a time. */
+        std::scoped_lock lk(g_apply_patch_lock);
+
+        /* Ensure our patch index is up to date. */
+        if (IsSdCardChanged() || !g_patch_index.IsUpToDate(mount_name, patch_dir_name)) {
+            g_patch_index.Build(mount_name, patch_dir_name);
+        }
+
+        /* If the index doesn't hold every patch, fall back to walking the patch directories. */
+        if (!g_patch_index.IsComplete()) {
+            return LocateAndApplyIpsPatchesToModuleUncached(mount_name, patch_dir_name, protected_size, offset, module_id, mapped_module, mapped_size);
+        }
+
+        /* Apply each indexed patch for the module. */
+        char path[fs::EntryNameLengthMax + 1];
+        const size_t patches_dir_path_len = util::SNPrintf(path, sizeof(path), "%s:/atmosphere/%s/", mount_name, patch_dir_name);
+        g_patch_index.ForEachPatch(module_id, [&](const char *patch_path) {
+            util::SNPrintf(path + patches_dir_path_len, sizeof(path) - patches_dir_path_len, "%s", patch_path);
+            ApplyIpsPatchFile(path, protected_size, offset, mapped_module, mapped_size);
+        });
     }
 
 }
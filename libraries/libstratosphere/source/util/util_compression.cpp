@@ -38,4 +38,194 @@ namespace ams::util {
         return LZ4_decompress_safe(reinterpret_cast<const char *>(src), reinterpret_cast<char *>(dst), static_cast<int>(src_size), static_cast<int>(dst_size));
     }
 
+    int DecompressLZ4(void *dst, size_t dst_size, const void *src, size_t src_size, size_t unit_size, DecompressLZ4Callback callback, void *arg) {
+        /* Size checks. */
+        AMS_ABORT_UNLESS(dst_size <= std::numeric_limits<int>::max());
+        AMS_ABORT_UNLESS(src_size <= std::numeric_limits<int>::max());
+        AMS_ABORT_UNLESS(unit_size > 0);
+
+        /* NOTE: LZ4's decoder has no way to observe its progress, so we decode the block format ourselves. */
+        /* Output is never modified once written, so everything behind the output pointer is final. */
+        const u8 *ip         = static_cast<const u8 *>(src);
+        const u8 * const ie  = ip + src_size;
+        u8 * const os        = static_cast<u8 *>(dst);
+        u8 *op               = os;
+        u8 * const oe        = os + dst_size;
+        u8 *unit             = os;
+
+        /* The source may overlap the end of the destination (in-place decompression), in which case output must never reach unconsumed input. */
+        const bool is_in_place = ip < oe && os < ie;
+        auto GetOutputLimit = [&]() ALWAYS_INLINE_LAMBDA -> size_t {
+            if (is_in_place) {
+                return op < ip ? static_cast<size_t>(ip - op) : 0;
+            } else {
+                return static_cast<size_t>(oe - op);
+            }
+        };
+
+        /* The last bytes of a block are always literals, and the last match must begin well before the end. */
+        constexpr size_t LastLiteralSize = 5;
+        constexpr size_t MatchFindLimit  = 12;
+
+        /* When there's slack past the end of a copy, copy in fixed size chunks. This may write past the end of the copy, */
+        /* which is fine as the excess is either overwritten by later output or lies in slack we've checked for. */
+        constexpr size_t WildCopySize = 16;
+        auto CopyWild = [](u8 *dst, const u8 *src, size_t size) ALWAYS_INLINE_LAMBDA {
+            u8 * const dst_end = dst + size;
+            do {
+                u8 chunk[WildCopySize];
+                std::memcpy(chunk, src, WildCopySize);
+                std::memcpy(dst, chunk, WildCopySize);
+                dst += WildCopySize;
+                src += WildCopySize;
+            } while (dst < dst_end);
+        };
+
+        auto ReadLength = [&](size_t *out, size_t length) ALWAYS_INLINE_LAMBDA -> bool {
+            if (length == 0xF) {
+                u8 cur;
+                do {
+                    if (ip >= ie) {
+                        return false;
+                    }
+                    cur = *(ip++);
+                    length += cur;
+                } while (cur == 0xFF);
+            }
+
+            *out = length;
+            return true;
+        };
+
+        auto ReportUnits = [&]() ALWAYS_INLINE_LAMBDA -> bool {
+            while (static_cast<size_t>(op - unit) >= unit_size) {
+                if (!callback(unit, unit_size, arg)) {
+                    return false;
+                }
+                unit += unit_size;
+            }
+            return true;
+        };
+
+        while (true) {
+            /* Read the token. */
+            if (ip >= ie) {
+                return -1;
+            }
+            const u8 token = *(ip++);
+
+            /* Most sequences are short; when they are and there's enough slack, decode them with fixed size copies. */
+            constexpr size_t ShortcutInputSlack  = 2 * WildCopySize;
+            constexpr size_t ShortcutOutputSlack = 4 * WildCopySize;
+            if ((token >> 4) != 0xF && (token & 0xF) != 0xF && static_cast<size_t>(ie - ip) >= ShortcutInputSlack && GetOutputLimit() >= ShortcutOutputSlack) {
+                /* Copy the literals. */
+                const size_t literal_size = token >> 4;
+                CopyWild(op, ip, literal_size);
+                ip += literal_size;
+                op += literal_size;
+
+                /* Read the match offset. */
+                const size_t match_offset = static_cast<size_t>(ip[0]) | (static_cast<size_t>(ip[1]) << 8);
+                ip += 2;
+                if (match_offset == 0 || match_offset > static_cast<size_t>(op - os)) {
+                    return -1;
+                }
+
+                /* Copy the match. */
+                const size_t match_size = (token & 0xF) + 4;
+                const u8 *match = op - match_offset;
+                if (match_offset >= WildCopySize) {
+                    CopyWild(op, match, match_size);
+                } else {
+                    for (size_t i = 0; i < match_size; ++i) {
+                        op[i] = match[i];
+                    }
+                }
+                op += match_size;
+
+                if (AMS_UNLIKELY(!ReportUnits())) {
+                    return -1;
+                }
+                continue;
+            }
+
+            /* Copy the literals. */
+            size_t literal_size;
+            if (!ReadLength(std::addressof(literal_size), token >> 4)) {
+                return -1;
+            }
+            if (literal_size > static_cast<size_t>(ie - ip) || literal_size > static_cast<size_t>(oe - op)) {
+                return -1;
+            }
+            if (literal_size + WildCopySize <= static_cast<size_t>(ie - ip) && literal_size + WildCopySize <= GetOutputLimit()) {
+                CopyWild(op, ip, literal_size);
+            } else {
+                std::memmove(op, ip, literal_size);
+            }
+            ip += literal_size;
+            op += literal_size;
+
+            /* The last sequence has only literals. */
+            if (ip == ie) {
+                break;
+            }
+
+            /* As in the reference decoder, a sequence with a match must leave room for the final literals, */
+            /* and must not begin within MatchFindLimit bytes of the end of the output. */
+            if (static_cast<size_t>(ie - ip) < 2 + 1 + LastLiteralSize || static_cast<size_t>(oe - op) < MatchFindLimit) {
+                return -1;
+            }
+
+            /* Read the match offset. */
+            const size_t match_offset = static_cast<size_t>(ip[0]) | (static_cast<size_t>(ip[1]) << 8);
+            ip += 2;
+            if (match_offset == 0 || match_offset > static_cast<size_t>(op - os)) {
+                return -1;
+            }
+
+            /* Copy the match. */
+            size_t match_size;
+            if (!ReadLength(std::addressof(match_size), token & 0xF)) {
+                return -1;
+            }
+            match_size += 4;
+            if (static_cast<size_t>(ie - ip) < LastLiteralSize || match_size + LastLiteralSize > static_cast<size_t>(oe - op)) {
+                return -1;
+            }
+
+            const u8 *match = op - match_offset;
+            if (match_offset >= WildCopySize && match_size + WildCopySize <= GetOutputLimit()) {
+                CopyWild(op, match, match_size);
+                op += match_size;
+            } else if (match_offset >= match_size) {
+                std::memcpy(op, match, match_size);
+                op += match_size;
+            } else {
+                /* Overlapping matches repeat the pattern; copy it in chunks that double in size. */
+                u8 * const match_end = op + match_size;
+                while (op < match_end) {
+                    const size_t cur_size = std::min<size_t>(op - match, match_end - op);
+                    std::memcpy(op, match, cur_size);
+                    op += cur_size;
+                }
+            }
+
+            /* Report any output units which are now final. */
+            if (AMS_UNLIKELY(!ReportUnits())) {
+                return -1;
+            }
+        }
+
+        /* Report the remaining output. */
+        while (unit < op) {
+            const size_t cur_size = std::min<size_t>(unit_size, op - unit);
+            if (!callback(unit, cur_size, arg)) {
+                return -1;
+            }
+            unit += cur_size;
+        }
+
+        return static_cast<int>(op - os);
+    }
+
 }
\ No newline at end of file
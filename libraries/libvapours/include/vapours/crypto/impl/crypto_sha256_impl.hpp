@@ -66,6 +66,9 @@ namespace ams::crypto::impl {
 
                 std::memcpy(dst, m_buffer, m_buffered_bytes);
             }
+
+            /* Hashes each of the (src_size / block_size) equally-sized blocks in src, writing the hashes contiguously to dst. */
+            static void GenerateHashes(void *dst, size_t dst_size, const void *src, size_t src_size, size_t block_size);
         private:
             void ProcessBlock(const void *data);
             void ProcessBlocks(const u8 *data, size_t block_count);
@@ -45,6 +45,11 @@ namespace ams::dmnt {
         R_DEFINE_ABSTRACT_ERROR_RANGE_NS(cheat, VirtualMachineError, 6700, 6799);
             R_DEFINE_ERROR_RESULT_NS(cheat, VirtualMachineInvalidConditionDepth, 6700);
 
+        R_DEFINE_ABSTRACT_ERROR_RANGE_NS(cheat, MemorySearchError, 6800, 6899);
+            R_DEFINE_ERROR_RESULT_NS(cheat, MemorySearchInvalidCondition, 6800);
+            R_DEFINE_ERROR_RESULT_NS(cheat, MemorySearchNotStarted,       6801);
+            R_DEFINE_ERROR_RESULT_NS(cheat, MemorySearchOutOfResource,    6802);
+
     // }
 
 }
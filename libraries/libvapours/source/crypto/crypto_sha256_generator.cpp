@@ -25,4 +25,8 @@ namespace ams::crypto {
         gen.GetHash(dst, dst_size);
     }
 
+    void GenerateSha256Hashes(void *dst, size_t dst_size, const void *src, size_t src_size, size_t block_size) {
+        return impl::Sha256Impl::GenerateHashes(dst, dst_size, src, src_size, block_size);
+    }
+
 }
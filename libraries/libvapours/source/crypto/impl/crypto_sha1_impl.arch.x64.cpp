@@ -0,0 +1,310 @@
+/*
+ * Copyright (c) Atmosphère-NX
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <vapours.hpp>
+#include "crypto_sha_impl.arch.x64.hpp"
+
+namespace ams::crypto::impl {
+
+    namespace {
+
+        constexpr const u32 RoundConstants[4] = {
+            0x5A827999, 0x6ED9EBA1, 0x8F1BBCDC, 0xCA62C1D6
+        };
+
+        constexpr ALWAYS_INLINE u32 Choose(u32 x, u32 y, u32 z) {
+            return (x & y) ^ ((~x) & z);
+        }
+
+        constexpr ALWAYS_INLINE u32 Majority(u32 x, u32 y, u32 z) {
+            return (x & y) ^ (x & z) ^ (y & z);
+        }
+
+        constexpr ALWAYS_INLINE u32 Parity(u32 x, u32 y, u32 z) {
+            return x ^ y ^ z;
+        }
+
+
+        void ProcessBlockGeneric(u32 *intermediate_hash, const void *data) {
+            /* Load work variables. */
+            u32 a = intermediate_hash[0];
+            u32 b = intermediate_hash[1];
+            u32 c = intermediate_hash[2];
+            u32 d = intermediate_hash[3];
+            u32 e = intermediate_hash[4];
+            u32 tmp;
+            size_t i;
+
+            /* Copy the input. */
+            u32 w[80];
+            if constexpr (util::IsLittleEndian()) {
+                static_assert(Sha1Impl::BlockSize % sizeof(u32) == 0);
+
+                const u32 *src_32 = static_cast<const u32 *>(data);
+                for (size_t i = 0; i < Sha1Impl::BlockSize / sizeof(u32); ++i) {
+                    w[i] = util::LoadBigEndian<u32>(src_32 + i);
+                }
+            } else {
+                std::memcpy(w, data, Sha1Impl::BlockSize);
+            }
+
+            /* Initialize the rest of w. */
+            for (i = Sha1Impl::BlockSize / sizeof(u32); i < util::size(w); ++i) {
+                const u32 *prev = w + (i - Sha1Impl::BlockSize / sizeof(u32));
+                w[i] = util::RotateLeft<u32>(prev[0] ^ prev[2] ^ prev[8] ^ prev[13], 1);
+            }
+
+            /* Perform rounds. */
+            for (i = 0; i < 20; ++i) {
+                tmp = util::RotateLeft<u32>(a, 5) + Choose(b, c, d) + e + w[i] + RoundConstants[0];
+                e = d;
+                d = c;
+                c = util::RotateLeft<u32>(b, 30);
+                b = a;
+                a = tmp;
+            }
+
+            for (/* ... */; i < 40; ++i) {
+                tmp = util::RotateLeft<u32>(a, 5) + Parity(b, c, d) + e + w[i] + RoundConstants[1];
+                e = d;
+                d = c;
+                c = util::RotateLeft<u32>(b, 30);
+                b = a;
+                a = tmp;
+            }
+
+            for (/* ... */; i < 60; ++i) {
+                tmp = util::RotateLeft<u32>(a, 5) + Majority(b, c, d) + e + w[i] + RoundConstants[2];
+                e = d;
+                d = c;
+                c = util::RotateLeft<u32>(b, 30);
+                b = a;
+                a = tmp;
+            }
+
+            for (/* ... */; i < 80; ++i) {
+                tmp = util::RotateLeft<u32>(a, 5) + Parity(b, c, d) + e + w[i] + RoundConstants[3];
+                e = d;
+                d = c;
+                c = util::RotateLeft<u32>(b, 30);
+                b = a;
+                a = tmp;
+            }
+
+            /* Update intermediate hash. */
+            intermediate_hash[0] += a;
+            intermediate_hash[1] += b;
+            intermediate_hash[2] += c;
+            intermediate_hash[3] += d;
+            intermediate_hash[4] += e;
+        }
+
+        __attribute__((target("sha,sse4.1")))
+        void ProcessBlocksShaNi(u32 *intermediate_hash, const u8 *data, size_t block_count) {
+            /* Declare mask for byte-swapping message words into the order used by the sha instructions. */
+            const __m128i ByteSwapMask = _mm_set_epi64x(0x0001020304050607ull, 0x08090A0B0C0D0E0Full);
+
+            /* Load the intermediate hash. */
+            __m128i abcd = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(intermediate_hash)), 0x1B);
+            __m128i e0   = _mm_set_epi32(intermediate_hash[4], 0, 0, 0);
+            __m128i e1;
+
+            while ((block_count--) > 0) {
+                /* Save the current state. */
+                const __m128i prev_abcd = abcd;
+                const __m128i prev_e0   = e0;
+
+                /* Load the message. */
+                __m128i msgs[4];
+                for (size_t i = 0; i < util::size(msgs); ++i) {
+                    msgs[i] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data + sizeof(__m128i) * i)), ByteSwapMask);
+                }
+
+                /* Perform rounds, four at a time, extending the message schedule as we go. */
+                [&]<size_t... Ix>(std::index_sequence<Ix...>) __attribute__((target("sha,sse4.1"))) ALWAYS_INLINE_LAMBDA {
+                    const auto DoRounds = [&]<size_t I>() __attribute__((target("sha,sse4.1"))) ALWAYS_INLINE_LAMBDA {
+                        /* Alternate which register holds e for the current rounds. */
+                        __m128i &e_cur  = (I % 2) == 0 ? e0 : e1;
+                        __m128i &e_next = (I % 2) == 0 ? e1 : e0;
+
+                        if constexpr (I == 0) {
+                            e_cur = _mm_add_epi32(e_cur, msgs[0]);
+                        } else {
+                            e_cur = _mm_sha1nexte_epu32(e_cur, msgs[I % 4]);
+                        }
+                        e_next = abcd;
+
+                        if constexpr (3 <= I && I <= 18) {
+                            msgs[(I + 1) % 4] = _mm_sha1msg2_epu32(msgs[(I + 1) % 4], msgs[I % 4]);
+                        }
+
+                        abcd = _mm_sha1rnds4_epu32(abcd, e_cur, I / 5);
+
+                        if constexpr (1 <= I && I <= 16) {
+                            msgs[(I + 3) % 4] = _mm_sha1msg1_epu32(msgs[(I + 3) % 4], msgs[I % 4]);
+                        }
+                        if constexpr (2 <= I && I <= 17) {
+                            msgs[(I + 2) % 4] = _mm_xor_si128(msgs[(I + 2) % 4], msgs[I % 4]);
+                        }
+                    };
+
+                    (DoRounds.template operator()<Ix>(), ...);
+                }(std::make_index_sequence<80 / 4>());
+
+                /* Update the state. */
+                e0   = _mm_sha1nexte_epu32(e0, prev_e0);
+                abcd = _mm_add_epi32(abcd, prev_abcd);
+
+                data += Sha1Impl::BlockSize;
+            }
+
+            /* Store the intermediate hash. */
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(intermediate_hash), _mm_shuffle_epi32(abcd, 0x1B));
+            intermediate_hash[4] = _mm_extract_epi32(e0, 3);
+        }
+
+    }
+
+    void Sha1Impl::Initialize() {
+        /* Reset buffered bytes/bits. */
+        m_buffered_bytes = 0;
+        m_bits_consumed  = 0;
+
+        /* Set intermediate hash. */
+        m_intermediate_hash[0] = 0x67452301;
+        m_intermediate_hash[1] = 0xEFCDAB89;
+        m_intermediate_hash[2] = 0x98BADCFE;
+        m_intermediate_hash[3] = 0x10325476;
+        m_intermediate_hash[4] = 0xC3D2E1F0;
+
+        /* Set state. */
+        m_state = State_Initialized;
+    }
+
+    void Sha1Impl::Update(const void *data, size_t size) {
+        /* Verify we're in a state to update. */
+        AMS_ASSERT(m_state == State_Initialized);
+
+        /* Advance our input bit count. */
+        m_bits_consumed += BITSIZEOF(u8) * (((m_buffered_bytes + size) / BlockSize) * BlockSize);
+
+        /* Process anything we have buffered. */
+        const u8 *data8 = static_cast<const u8 *>(data);
+        size_t remaining = size;
+
+        if (m_buffered_bytes > 0) {
+            const size_t copy_size = std::min(BlockSize - m_buffered_bytes, remaining);
+            std::memcpy(m_buffer + m_buffered_bytes, data8, copy_size);
+
+            data8            += copy_size;
+            remaining        -= copy_size;
+            m_buffered_bytes += copy_size;
+
+            /* Process a block, if we filled one. */
+            if (m_buffered_bytes == BlockSize) {
+                this->ProcessBlock(m_buffer);
+                m_buffered_bytes = 0;
+            }
+        }
+
+        /* Process blocks, if we have any. */
+        if (remaining >= BlockSize) {
+            const size_t blocks = remaining / BlockSize;
+
+            this->ProcessBlocks(data8, blocks);
+            data8     += BlockSize * blocks;
+            remaining -= BlockSize * blocks;
+        }
+
+        /* Copy any leftover data to our buffer. */
+        if (remaining > 0) {
+            m_buffered_bytes = remaining;
+            std::memcpy(m_buffer, data8, remaining);
+        }
+    }
+
+    void Sha1Impl::GetHash(void *dst, size_t size) {
+        /* Verify we're in a state to get hash. */
+        AMS_ASSERT(m_state == State_Initialized || m_state == State_Done);
+        AMS_ASSERT(size >= HashSize);
+        AMS_UNUSED(size);
+
+        /* If we need to, process the last block. */
+        if (m_state == State_Initialized) {
+            this->ProcessLastBlock();
+            m_state = State_Done;
+        }
+
+        /* Copy the output hash. */
+        if constexpr (util::IsLittleEndian()) {
+            static_assert(HashSize % sizeof(u32) == 0);
+
+            u32 *dst_32 = static_cast<u32 *>(dst);
+            for (size_t i = 0; i < HashSize / sizeof(u32); ++i) {
+                dst_32[i] = util::LoadBigEndian<u32>(m_intermediate_hash + i);
+            }
+        } else {
+            std::memcpy(dst, m_intermediate_hash, HashSize);
+        }
+    }
+
+    ALWAYS_INLINE void Sha1Impl::ProcessBlock(const void *data) {
+        return this->ProcessBlocks(static_cast<const u8 *>(data), 1);
+    }
+
+    void Sha1Impl::ProcessBlocks(const u8 *data, size_t block_count) {
+        /* If we have sha-ni, use an optimized impl. */
+        if (IsShaNiAvailable()) {
+            return ProcessBlocksShaNi(m_intermediate_hash, data, block_count);
+        }
+
+        /* Otherwise, process blocks one at a time. */
+        while ((block_count--) > 0) {
+            ProcessBlockGeneric(m_intermediate_hash, data);
+            data += BlockSize;
+        }
+    }
+
+    void Sha1Impl::ProcessLastBlock() {
+        /* Setup the final block. */
+        constexpr const auto BlockSizeWithoutSizeField = BlockSize - sizeof(u64);
+
+        /* Increment our bits consumed. */
+        m_bits_consumed += BITSIZEOF(u8) * m_buffered_bytes;
+
+        /* Add 0x80 terminator. */
+        m_buffer[m_buffered_bytes++] = 0x80;
+
+        /* If we can process the size field directly, do so, otherwise set up to process it. */
+        if (m_buffered_bytes <= BlockSizeWithoutSizeField) {
+            /* Clear up to size field. */
+            std::memset(m_buffer + m_buffered_bytes, 0, BlockSizeWithoutSizeField - m_buffered_bytes);
+        } else {
+            /* Consume full block */
+            std::memset(m_buffer + m_buffered_bytes, 0, BlockSize - m_buffered_bytes);
+            this->ProcessBlock(m_buffer);
+
+            /* Clear up to size field. */
+            std::memset(m_buffer, 0, BlockSizeWithoutSizeField);
+        }
+
+        /* Store the size field. */
+        util::StoreBigEndian<u64>(reinterpret_cast<u64 *>(m_buffer + BlockSizeWithoutSizeField), m_bits_consumed);
+
+        /* Process the final block. */
+        this->ProcessBlock(m_buffer);
+    }
+
+}
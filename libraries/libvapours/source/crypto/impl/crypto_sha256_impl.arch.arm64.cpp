@@ -41,6 +41,126 @@ namespace ams::crypto::impl {
             0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2,
         };
 
+        constexpr inline size_t HashWordCount = Sha256Impl::HashSize / sizeof(u32);
+        constexpr inline size_t InterleavedLaneCount = 2;
+
+        /* NOTE: The interleaved path has not yet been checked on hardware, so we hash one block at a time by default. */
+        /* It should only be enabled once TestSha256GenerateHashes passes on an arm64 target. */
+        constexpr inline bool EnableInterleavedHashes = false;
+
+        constexpr const u32 InitialHash[HashWordCount] = {
+            0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A, 0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19,
+        };
+
+        template<size_t Lanes>
+        void ProcessBlocksInterleaved(u32 * const *intermediate_hashes, const u8 * const *datas, size_t block_count) {
+            /* Independent messages are interleaved, so that each can make progress while the others wait on the sha units. */
+            [&]<size_t... Lx>(std::index_sequence<Lx...>) ALWAYS_INLINE_LAMBDA {
+                /* Load the intermediate hashes. */
+                uint32x4_t abcd[Lanes];
+                uint32x4_t efgh[Lanes];
+                ((abcd[Lx] = vld1q_u32(intermediate_hashes[Lx] + 0)), ...);
+                ((efgh[Lx] = vld1q_u32(intermediate_hashes[Lx] + 4)), ...);
+
+                for (size_t block = 0; block < block_count; ++block) {
+                    /* Save the current state. */
+                    uint32x4_t prev_abcd[Lanes];
+                    uint32x4_t prev_efgh[Lanes];
+                    ((prev_abcd[Lx] = abcd[Lx]), ...);
+                    ((prev_efgh[Lx] = efgh[Lx]), ...);
+
+                    /* Load the messages. */
+                    uint32x4_t msgs[Lanes][4];
+                    for (size_t i = 0; i < 4; ++i) {
+                        ((msgs[Lx][i] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(datas[Lx] + block * Sha256Impl::BlockSize + sizeof(uint32x4_t) * i)))), ...);
+                    }
+
+                    /* Perform rounds, four at a time, extending the message schedules as we go. */
+                    [&]<size_t... Ix>(std::index_sequence<Ix...>) ALWAYS_INLINE_LAMBDA {
+                        const auto DoRounds = [&]<size_t I>() ALWAYS_INLINE_LAMBDA {
+                            const uint32x4_t round_constants = vld1q_u32(RoundConstants + 4 * I);
+
+                            uint32x4_t msg[Lanes];
+                            ((msg[Lx] = vaddq_u32(msgs[Lx][I % 4], round_constants)), ...);
+
+                            if constexpr (I < 12) {
+                                ((msgs[Lx][I % 4] = vsha256su1q_u32(vsha256su0q_u32(msgs[Lx][I % 4], msgs[Lx][(I + 1) % 4]), msgs[Lx][(I + 2) % 4], msgs[Lx][(I + 3) % 4])), ...);
+                            }
+
+                            uint32x4_t tmp[Lanes];
+                            ((tmp[Lx] = abcd[Lx]), ...);
+                            ((abcd[Lx] = vsha256hq_u32(abcd[Lx], efgh[Lx], msg[Lx])), ...);
+                            ((efgh[Lx] = vsha256h2q_u32(efgh[Lx], tmp[Lx], msg[Lx])), ...);
+                        };
+
+                        (DoRounds.template operator()<Ix>(), ...);
+                    }(std::make_index_sequence<0x40 / 4>());
+
+                    /* Update the state. */
+                    ((abcd[Lx] = vaddq_u32(abcd[Lx], prev_abcd[Lx])), ...);
+                    ((efgh[Lx] = vaddq_u32(efgh[Lx], prev_efgh[Lx])), ...);
+                }
+
+                /* Store the intermediate hashes. */
+                (vst1q_u32(intermediate_hashes[Lx] + 0, abcd[Lx]), ...);
+                (vst1q_u32(intermediate_hashes[Lx] + 4, efgh[Lx]), ...);
+            }(std::make_index_sequence<Lanes>());
+        }
+
+        template<size_t Lanes>
+        void GenerateHashesInterleaved(u8 *dst, const u8 *src, size_t block_size) {
+            constexpr size_t BlockSize                 = Sha256Impl::BlockSize;
+            constexpr size_t BlockSizeWithoutSizeField = BlockSize - sizeof(u64);
+
+            /* Set the initial hash for each lane. */
+            u32 intermediate_hashes[Lanes][HashWordCount];
+            u32 *hash_ptrs[Lanes];
+            for (size_t i = 0; i < Lanes; ++i) {
+                std::memcpy(intermediate_hashes[i], InitialHash, sizeof(InitialHash));
+                hash_ptrs[i] = intermediate_hashes[i];
+            }
+
+            /* Process all complete blocks. */
+            const size_t full_block_count = block_size / BlockSize;
+            if (full_block_count > 0) {
+                const u8 *data_ptrs[Lanes];
+                for (size_t i = 0; i < Lanes; ++i) {
+                    data_ptrs[i] = src + i * block_size;
+                }
+
+                ProcessBlocksInterleaved<Lanes>(hash_ptrs, data_ptrs, full_block_count);
+            }
+
+            /* Process the final block(s), which hold any leftover data followed by the padding. */
+            {
+                const size_t leftover_size    = block_size % BlockSize;
+                const size_t last_block_count = (leftover_size < BlockSizeWithoutSizeField) ? 1 : 2;
+
+                u8 last_blocks[Lanes][2 * BlockSize];
+                const u8 *data_ptrs[Lanes];
+                for (size_t i = 0; i < Lanes; ++i) {
+                    u8 *last = last_blocks[i];
+
+                    std::memcpy(last, src + i * block_size + full_block_count * BlockSize, leftover_size);
+                    last[leftover_size] = 0x80;
+                    std::memset(last + leftover_size + 1, 0, last_block_count * BlockSize - (leftover_size + 1));
+                    util::StoreBigEndian<u64>(reinterpret_cast<u64 *>(last + last_block_count * BlockSize - sizeof(u64)), static_cast<u64>(block_size) * BITSIZEOF(u8));
+
+                    data_ptrs[i] = last;
+                }
+
+                ProcessBlocksInterleaved<Lanes>(hash_ptrs, data_ptrs, last_block_count);
+            }
+
+            /* Copy out the hashes. */
+            for (size_t i = 0; i < Lanes; ++i) {
+                u32 *dst_32 = reinterpret_cast<u32 *>(dst + i * Sha256Impl::HashSize);
+                for (size_t j = 0; j < HashWordCount; ++j) {
+                    util::StoreBigEndian<u32>(dst_32 + j, intermediate_hashes[i][j]);
+                }
+            }
+        }
+
     }
 
     void Sha256Impl::Initialize() {
@@ -323,5 +443,38 @@ namespace ams::crypto::impl {
         this->ProcessBlock(m_buffer);
     }
 
+    void Sha256Impl::GenerateHashes(void *dst, size_t dst_size, const void *src, size_t src_size, size_t block_size) {
+        /* Check pre-conditions. */
+        AMS_ASSERT(block_size > 0);
+        AMS_ASSERT(src_size % block_size == 0);
+        AMS_ASSERT(dst_size >= (src_size / block_size) * HashSize);
+        AMS_UNUSED(dst_size);
+
+        u8 *dst8       = static_cast<u8 *>(dst);
+        const u8 *src8 = static_cast<const u8 *>(src);
+        size_t count   = src_size / block_size;
+
+        /* Hash as many blocks in parallel as we can. */
+        while (EnableInterleavedHashes && count >= InterleavedLaneCount) {
+            GenerateHashesInterleaved<InterleavedLaneCount>(dst8, src8, block_size);
+
+            dst8  += InterleavedLaneCount * HashSize;
+            src8  += InterleavedLaneCount * block_size;
+            count -= InterleavedLaneCount;
+        }
+
+        /* Hash any remaining blocks one at a time. */
+        while (count > 0) {
+            Sha256Impl impl;
+            impl.Initialize();
+            impl.Update(src8, block_size);
+            impl.GetHash(dst8, HashSize);
+
+            dst8  += HashSize;
+            src8  += block_size;
+            count -= 1;
+        }
+    }
+
 }
 #endif
\ No newline at end of file
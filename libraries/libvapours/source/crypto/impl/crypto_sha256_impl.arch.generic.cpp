@@ -257,4 +257,23 @@ namespace ams::crypto::impl {
         this->ProcessBlock(m_buffer);
     }
 
+    void Sha256Impl::GenerateHashes(void *dst, size_t dst_size, const void *src, size_t src_size, size_t block_size) {
+        /* Check pre-conditions. */
+        AMS_ASSERT(block_size > 0);
+        AMS_ASSERT(src_size % block_size == 0);
+        AMS_ASSERT(dst_size >= (src_size / block_size) * HashSize);
+        AMS_UNUSED(dst_size);
+
+        u8 *dst8       = static_cast<u8 *>(dst);
+        const u8 *src8 = static_cast<const u8 *>(src);
+
+        /* Hash each block. */
+        for (size_t i = 0; i < src_size / block_size; ++i) {
+            Sha256Impl impl;
+            impl.Initialize();
+            impl.Update(src8 + i * block_size, block_size);
+            impl.GetHash(dst8 + i * HashSize, HashSize);
+        }
+    }
+
 }
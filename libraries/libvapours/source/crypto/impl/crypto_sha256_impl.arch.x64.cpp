@@ -0,0 +1,640 @@
+/*
+ * Copyright (c) Atmosphère-NX
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <vapours.hpp>
+#include "crypto_sha_impl.arch.x64.hpp"
+
+namespace ams::crypto::impl {
+
+    namespace {
+
+        alignas(Sha256Impl::BlockSize) constexpr const u32 RoundConstants[0x40] = {
+            0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5,
+            0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
+            0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3,
+            0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174,
+            0xE49B69C1, 0xEFBE4786, 0x0FC19DC6, 0x240CA1CC,
+            0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA,
+            0x983E5152, 0xA831C66D, 0xB00327C8, 0xBF597FC7,
+            0xC6E00BF3, 0xD5A79147, 0x06CA6351, 0x14292967,
+            0x27B70A85, 0x2E1B2138, 0x4D2C6DFC, 0x53380D13,
+            0x650A7354, 0x766A0ABB, 0x81C2C92E, 0x92722C85,
+            0xA2BFE8A1, 0xA81A664B, 0xC24B8B70, 0xC76C51A3,
+            0xD192E819, 0xD6990624, 0xF40E3585, 0x106AA070,
+            0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5,
+            0x391C0CB3, 0x4ED8AA4A, 0x5B9CCA4F, 0x682E6FF3,
+            0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208,
+            0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2,
+        };
+
+        constexpr ALWAYS_INLINE u32 Choose(u32 x, u32 y, u32 z) {
+            return (x & y) ^ ((~x) & z);
+        }
+
+        constexpr ALWAYS_INLINE u32 Majority(u32 x, u32 y, u32 z) {
+            return (x & y) ^ (x & z) ^ (y & z);
+        }
+
+        constexpr ALWAYS_INLINE u32 LargeSigma0(u32 x) {
+            return util::RotateRight<u32>(x, 2) ^ util::RotateRight<u32>(x, 13) ^ util::RotateRight<u32>(x, 22);
+        }
+
+        constexpr ALWAYS_INLINE u32 LargeSigma1(u32 x) {
+            return util::RotateRight<u32>(x, 6) ^ util::RotateRight<u32>(x, 11) ^ util::RotateRight<u32>(x, 25);
+        }
+
+        constexpr ALWAYS_INLINE u32 SmallSigma0(u32 x) {
+            return util::RotateRight<u32>(x, 7) ^ util::RotateRight<u32>(x, 18) ^ (x >> 3);
+        }
+
+        constexpr ALWAYS_INLINE u32 SmallSigma1(u32 x) {
+            return util::RotateRight<u32>(x, 17) ^ util::RotateRight<u32>(x, 19) ^ (x >> 10);
+        }
+
+
+        void ProcessBlockGeneric(u32 *intermediate_hash, const void *data) {
+            /* Load work variables. */
+            u32 a = intermediate_hash[0];
+            u32 b = intermediate_hash[1];
+            u32 c = intermediate_hash[2];
+            u32 d = intermediate_hash[3];
+            u32 e = intermediate_hash[4];
+            u32 f = intermediate_hash[5];
+            u32 g = intermediate_hash[6];
+            u32 h = intermediate_hash[7];
+            u32 tmp[2];
+            size_t i;
+
+            /* Copy the input. */
+            u32 w[64];
+            if constexpr (util::IsLittleEndian()) {
+                static_assert(Sha256Impl::BlockSize % sizeof(u32) == 0);
+
+                const u32 *src_32 = static_cast<const u32 *>(data);
+                for (size_t i = 0; i < Sha256Impl::BlockSize / sizeof(u32); ++i) {
+                    w[i] = util::LoadBigEndian<u32>(src_32 + i);
+                }
+            } else {
+                std::memcpy(w, data, Sha256Impl::BlockSize);
+            }
+
+            /* Initialize the rest of w. */
+            for (i = Sha256Impl::BlockSize / sizeof(u32); i < util::size(w); ++i) {
+                const u32 *prev = w + (i - Sha256Impl::BlockSize / sizeof(u32));
+                w[i] = prev[0] + SmallSigma0(prev[1]) + prev[9] + SmallSigma1(prev[14]);
+            }
+
+            /* Perform rounds. */
+            for (i = 0; i < 64; ++i) {
+                tmp[0] = h + LargeSigma1(e) + Choose(e, f, g) + RoundConstants[i] + w[i];
+                tmp[1] = LargeSigma0(a) + Majority(a, b, c);
+
+                h = g;
+                g = f;
+                f = e;
+                e = d + tmp[0];
+                d = c;
+                c = b;
+                b = a;
+                a = tmp[0] + tmp[1];
+            }
+
+            /* Update intermediate hash. */
+            intermediate_hash[0] += a;
+            intermediate_hash[1] += b;
+            intermediate_hash[2] += c;
+            intermediate_hash[3] += d;
+            intermediate_hash[4] += e;
+            intermediate_hash[5] += f;
+            intermediate_hash[6] += g;
+            intermediate_hash[7] += h;
+        }
+
+        bool GetShaNiAvailabilityImpl() {
+            /* Check that we can query the extended feature flags. */
+            int a = 0, b = 0, c = 0, d = 0;
+            __asm__ __volatile__("cpuid" : "=a"(a), "=b"(b), "=c"(c), "=d"(d) : "0"(0), "2"(0) : "memory");
+            if (a < 7) {
+                return false;
+            }
+
+            /* Check for SSSE3 and SSE4.1. */
+            __asm__ __volatile__("cpuid" : "=a"(a), "=b"(b), "=c"(c), "=d"(d) : "0"(1), "2"(0) : "memory");
+            if (!((c & (1 << 9)) && (c & (1 << 19)))) {
+                return false;
+            }
+
+            /* Check for SHA-NI. */
+            __asm__ __volatile__("cpuid" : "=a"(a), "=b"(b), "=c"(c), "=d"(d) : "0"(7), "2"(0) : "memory");
+            return (b & (1 << 29));
+        }
+
+        bool GetAvx2AvailabilityImpl() {
+            /* Check that we can query the extended feature flags. */
+            int a = 0, b = 0, c = 0, d = 0;
+            __asm__ __volatile__("cpuid" : "=a"(a), "=b"(b), "=c"(c), "=d"(d) : "0"(0), "2"(0) : "memory");
+            if (a < 7) {
+                return false;
+            }
+
+            /* Check that the os uses xsave, so that we can check what register state it preserves. */
+            __asm__ __volatile__("cpuid" : "=a"(a), "=b"(b), "=c"(c), "=d"(d) : "0"(1), "2"(0) : "memory");
+            if (!(c & (1 << 27))) {
+                return false;
+            }
+
+            /* Check that the os preserves sse and avx register state. */
+            u32 xcr0_lo = 0, xcr0_hi = 0;
+            __asm__ __volatile__("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+            AMS_UNUSED(xcr0_hi);
+
+            constexpr u32 Xcr0AvxStateMask = (1u << 1) | (1u << 2);
+            if ((xcr0_lo & Xcr0AvxStateMask) != Xcr0AvxStateMask) {
+                return false;
+            }
+
+            /* Check for AVX2. */
+            __asm__ __volatile__("cpuid" : "=a"(a), "=b"(b), "=c"(c), "=d"(d) : "0"(7), "2"(0) : "memory");
+            return (b & (1 << 5));
+        }
+
+        const bool g_is_avx2_available = GetAvx2AvailabilityImpl();
+
+        ALWAYS_INLINE bool IsAvx2Available() {
+            return g_is_avx2_available;
+        }
+
+        constexpr inline size_t HashWordCount = Sha256Impl::HashSize / sizeof(u32);
+
+        constexpr const u32 InitialHash[HashWordCount] = {
+            0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A, 0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19,
+        };
+
+        template<size_t Lanes>
+        __attribute__((target("sha,sse4.1")))
+        void ProcessBlocksShaNi(u32 * const *intermediate_hashes, const u8 * const *datas, size_t block_count) {
+            /* Declare mask for byte-swapping message words. */
+            const __m128i ByteSwapMask = _mm_set_epi64x(0x0C0D0E0F08090A0Bull, 0x0405060700010203ull);
+
+            /* Independent messages are interleaved, so that each can make progress while the others wait on the sha units. */
+            [&]<size_t... Lx>(std::index_sequence<Lx...>) __attribute__((target("sha,sse4.1"))) ALWAYS_INLINE_LAMBDA {
+                /* Load the intermediate hashes, rearranging them into the ABEF/CDGH form used by the sha instructions. */
+                __m128i state0[Lanes];
+                __m128i state1[Lanes];
+                {
+                    __m128i abcd[Lanes];
+                    __m128i efgh[Lanes];
+                    ((abcd[Lx] = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(intermediate_hashes[Lx] + 0)), 0xB1)), ...);
+                    ((efgh[Lx] = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(intermediate_hashes[Lx] + 4)), 0x1B)), ...);
+
+                    ((state0[Lx] = _mm_alignr_epi8(abcd[Lx], efgh[Lx], 8)), ...);
+                    ((state1[Lx] = _mm_blend_epi16(efgh[Lx], abcd[Lx], 0xF0)), ...);
+                }
+
+                for (size_t block = 0; block < block_count; ++block) {
+                    /* Save the current state. */
+                    __m128i prev_state0[Lanes];
+                    __m128i prev_state1[Lanes];
+                    ((prev_state0[Lx] = state0[Lx]), ...);
+                    ((prev_state1[Lx] = state1[Lx]), ...);
+
+                    /* Load the messages. */
+                    __m128i msgs[Lanes][4];
+                    for (size_t i = 0; i < 4; ++i) {
+                        ((msgs[Lx][i] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(datas[Lx] + block * Sha256Impl::BlockSize + sizeof(__m128i) * i)), ByteSwapMask)), ...);
+                    }
+
+                    /* Perform rounds, four at a time, extending the message schedules as we go. */
+                    [&]<size_t... Ix>(std::index_sequence<Ix...>) __attribute__((target("sha,sse4.1"))) ALWAYS_INLINE_LAMBDA {
+                        const auto DoRounds = [&]<size_t I>() __attribute__((target("sha,sse4.1"))) ALWAYS_INLINE_LAMBDA {
+                            const __m128i round_constants = _mm_load_si128(reinterpret_cast<const __m128i *>(RoundConstants + 4 * I));
+
+                            __m128i msg[Lanes];
+                            ((msg[Lx] = _mm_add_epi32(msgs[Lx][I % 4], round_constants)), ...);
+                            ((state1[Lx] = _mm_sha256rnds2_epu32(state1[Lx], state0[Lx], msg[Lx])), ...);
+
+                            if constexpr (I < 12) {
+                                ((msgs[Lx][I % 4] = _mm_sha256msg2_epu32(_mm_add_epi32(_mm_sha256msg1_epu32(msgs[Lx][I % 4], msgs[Lx][(I + 1) % 4]), _mm_alignr_epi8(msgs[Lx][(I + 3) % 4], msgs[Lx][(I + 2) % 4], 4)), msgs[Lx][(I + 3) % 4])), ...);
+                            }
+
+                            ((msg[Lx] = _mm_shuffle_epi32(msg[Lx], 0x0E)), ...);
+                            ((state0[Lx] = _mm_sha256rnds2_epu32(state0[Lx], state1[Lx], msg[Lx])), ...);
+                        };
+
+                        (DoRounds.template operator()<Ix>(), ...);
+                    }(std::make_index_sequence<0x40 / 4>());
+
+                    /* Update the state. */
+                    ((state0[Lx] = _mm_add_epi32(state0[Lx], prev_state0[Lx])), ...);
+                    ((state1[Lx] = _mm_add_epi32(state1[Lx], prev_state1[Lx])), ...);
+                }
+
+                /* Rearrange the states back into ABCD/EFGH form, and store them. */
+                {
+                    __m128i feba[Lanes];
+                    __m128i dchg[Lanes];
+                    ((feba[Lx] = _mm_shuffle_epi32(state0[Lx], 0x1B)), ...);
+                    ((dchg[Lx] = _mm_shuffle_epi32(state1[Lx], 0xB1)), ...);
+
+                    ((_mm_storeu_si128(reinterpret_cast<__m128i *>(intermediate_hashes[Lx] + 0), _mm_blend_epi16(feba[Lx], dchg[Lx], 0xF0))), ...);
+                    ((_mm_storeu_si128(reinterpret_cast<__m128i *>(intermediate_hashes[Lx] + 4), _mm_alignr_epi8(dchg[Lx], feba[Lx], 8))), ...);
+                }
+            }(std::make_index_sequence<Lanes>());
+        }
+
+        constexpr inline size_t Avx2LaneCount = sizeof(__m256i) / sizeof(u32);
+
+        __attribute__((target("avx2")))
+        ALWAYS_INLINE void Transpose8x8(__m256i (&v)[8]) {
+            /* Interleave words. */
+            const __m256i t0 = _mm256_unpacklo_epi32(v[0], v[1]);
+            const __m256i t1 = _mm256_unpackhi_epi32(v[0], v[1]);
+            const __m256i t2 = _mm256_unpacklo_epi32(v[2], v[3]);
+            const __m256i t3 = _mm256_unpackhi_epi32(v[2], v[3]);
+            const __m256i t4 = _mm256_unpacklo_epi32(v[4], v[5]);
+            const __m256i t5 = _mm256_unpackhi_epi32(v[4], v[5]);
+            const __m256i t6 = _mm256_unpacklo_epi32(v[6], v[7]);
+            const __m256i t7 = _mm256_unpackhi_epi32(v[6], v[7]);
+
+            /* Interleave double-words. */
+            const __m256i u0 = _mm256_unpacklo_epi64(t0, t2);
+            const __m256i u1 = _mm256_unpackhi_epi64(t0, t2);
+            const __m256i u2 = _mm256_unpacklo_epi64(t1, t3);
+            const __m256i u3 = _mm256_unpackhi_epi64(t1, t3);
+            const __m256i u4 = _mm256_unpacklo_epi64(t4, t6);
+            const __m256i u5 = _mm256_unpackhi_epi64(t4, t6);
+            const __m256i u6 = _mm256_unpacklo_epi64(t5, t7);
+            const __m256i u7 = _mm256_unpackhi_epi64(t5, t7);
+
+            /* Interleave halves. */
+            v[0] = _mm256_permute2x128_si256(u0, u4, 0x20);
+            v[1] = _mm256_permute2x128_si256(u1, u5, 0x20);
+            v[2] = _mm256_permute2x128_si256(u2, u6, 0x20);
+            v[3] = _mm256_permute2x128_si256(u3, u7, 0x20);
+            v[4] = _mm256_permute2x128_si256(u0, u4, 0x31);
+            v[5] = _mm256_permute2x128_si256(u1, u5, 0x31);
+            v[6] = _mm256_permute2x128_si256(u2, u6, 0x31);
+            v[7] = _mm256_permute2x128_si256(u3, u7, 0x31);
+        }
+
+        template<int N>
+        __attribute__((target("avx2")))
+        ALWAYS_INLINE __m256i RotateRight(__m256i v) {
+            return _mm256_or_si256(_mm256_srli_epi32(v, N), _mm256_slli_epi32(v, BITSIZEOF(u32) - N));
+        }
+
+        template<size_t Lanes>
+        __attribute__((target("avx2")))
+        void ProcessBlocksAvx2(u32 * const *intermediate_hashes, const u8 * const *datas, size_t block_count) {
+            static_assert(Lanes == Avx2LaneCount);
+
+            /* Declare mask for byte-swapping message words. */
+            const __m256i ByteSwapMask = _mm256_set_epi64x(0x0C0D0E0F08090A0Bull, 0x0405060700010203ull, 0x0C0D0E0F08090A0Bull, 0x0405060700010203ull);
+
+            /* Load the intermediate hashes, so that each vector holds one word of every lane's hash. */
+            __m256i state[HashWordCount];
+            for (size_t i = 0; i < Lanes; ++i) {
+                state[i] = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(intermediate_hashes[i]));
+            }
+            Transpose8x8(state);
+
+            for (size_t block = 0; block < block_count; ++block) {
+                /* Load the messages, so that each vector holds one word of every lane's message. */
+                __m256i w[0x10];
+                for (size_t half = 0; half < 2; ++half) {
+                    __m256i rows[Lanes];
+                    for (size_t i = 0; i < Lanes; ++i) {
+                        rows[i] = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(datas[i] + block * Sha256Impl::BlockSize + half * sizeof(__m256i)));
+                    }
+                    Transpose8x8(rows);
+
+                    for (size_t i = 0; i < Lanes; ++i) {
+                        w[half * Lanes + i] = _mm256_shuffle_epi8(rows[i], ByteSwapMask);
+                    }
+                }
+
+                /* Load work variables. */
+                __m256i a = state[0];
+                __m256i b = state[1];
+                __m256i c = state[2];
+                __m256i d = state[3];
+                __m256i e = state[4];
+                __m256i f = state[5];
+                __m256i g = state[6];
+                __m256i h = state[7];
+
+                /* Perform rounds, extending the message schedule as we go. */
+                for (size_t i = 0; i < 0x40; ++i) {
+                    if (i >= 0x10) {
+                        const __m256i w1  = w[(i +  1) % 0x10];
+                        const __m256i w14 = w[(i + 14) % 0x10];
+
+                        const __m256i small_sigma0 = _mm256_xor_si256(_mm256_xor_si256(RotateRight<7>(w1), RotateRight<18>(w1)), _mm256_srli_epi32(w1, 3));
+                        const __m256i small_sigma1 = _mm256_xor_si256(_mm256_xor_si256(RotateRight<17>(w14), RotateRight<19>(w14)), _mm256_srli_epi32(w14, 10));
+
+                        w[i % 0x10] = _mm256_add_epi32(_mm256_add_epi32(w[i % 0x10], small_sigma0), _mm256_add_epi32(w[(i + 9) % 0x10], small_sigma1));
+                    }
+
+                    const __m256i large_sigma1 = _mm256_xor_si256(_mm256_xor_si256(RotateRight<6>(e), RotateRight<11>(e)), RotateRight<25>(e));
+                    const __m256i choose       = _mm256_xor_si256(_mm256_and_si256(e, f), _mm256_andnot_si256(e, g));
+                    const __m256i tmp0         = _mm256_add_epi32(_mm256_add_epi32(_mm256_add_epi32(h, large_sigma1), _mm256_add_epi32(choose, _mm256_set1_epi32(RoundConstants[i]))), w[i % 0x10]);
+
+                    const __m256i large_sigma0 = _mm256_xor_si256(_mm256_xor_si256(RotateRight<2>(a), RotateRight<13>(a)), RotateRight<22>(a));
+                    const __m256i majority     = _mm256_or_si256(_mm256_and_si256(a, b), _mm256_and_si256(c, _mm256_or_si256(a, b)));
+                    const __m256i tmp1         = _mm256_add_epi32(large_sigma0, majority);
+
+                    h = g;
+                    g = f;
+                    f = e;
+                    e = _mm256_add_epi32(d, tmp0);
+                    d = c;
+                    c = b;
+                    b = a;
+                    a = _mm256_add_epi32(tmp0, tmp1);
+                }
+
+                /* Update intermediate hashes. */
+                state[0] = _mm256_add_epi32(state[0], a);
+                state[1] = _mm256_add_epi32(state[1], b);
+                state[2] = _mm256_add_epi32(state[2], c);
+                state[3] = _mm256_add_epi32(state[3], d);
+                state[4] = _mm256_add_epi32(state[4], e);
+                state[5] = _mm256_add_epi32(state[5], f);
+                state[6] = _mm256_add_epi32(state[6], g);
+                state[7] = _mm256_add_epi32(state[7], h);
+            }
+
+            /* Store the intermediate hashes. */
+            Transpose8x8(state);
+            for (size_t i = 0; i < Lanes; ++i) {
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(intermediate_hashes[i]), state[i]);
+            }
+        }
+
+        template<size_t Lanes, auto ProcessBlocksImpl>
+        void GenerateHashesMultiLane(u8 *dst, const u8 *src, size_t block_size) {
+            constexpr size_t BlockSize                 = Sha256Impl::BlockSize;
+            constexpr size_t BlockSizeWithoutSizeField = BlockSize - sizeof(u64);
+
+            /* Set the initial hash for each lane. */
+            u32 intermediate_hashes[Lanes][HashWordCount];
+            u32 *hash_ptrs[Lanes];
+            for (size_t i = 0; i < Lanes; ++i) {
+                std::memcpy(intermediate_hashes[i], InitialHash, sizeof(InitialHash));
+                hash_ptrs[i] = intermediate_hashes[i];
+            }
+
+            /* Process all complete blocks. */
+            const size_t full_block_count = block_size / BlockSize;
+            if (full_block_count > 0) {
+                const u8 *data_ptrs[Lanes];
+                for (size_t i = 0; i < Lanes; ++i) {
+                    data_ptrs[i] = src + i * block_size;
+                }
+
+                ProcessBlocksImpl(hash_ptrs, data_ptrs, full_block_count);
+            }
+
+            /* Process the final block(s), which hold any leftover data followed by the padding. */
+            {
+                const size_t leftover_size   = block_size % BlockSize;
+                const size_t last_block_count = (leftover_size < BlockSizeWithoutSizeField) ? 1 : 2;
+
+                u8 last_blocks[Lanes][2 * BlockSize];
+                const u8 *data_ptrs[Lanes];
+                for (size_t i = 0; i < Lanes; ++i) {
+                    u8 *last = last_blocks[i];
+
+                    std::memcpy(last, src + i * block_size + full_block_count * BlockSize, leftover_size);
+                    last[leftover_size] = 0x80;
+                    std::memset(last + leftover_size + 1, 0, last_block_count * BlockSize - (leftover_size + 1));
+                    util::StoreBigEndian<u64>(reinterpret_cast<u64 *>(last + last_block_count * BlockSize - sizeof(u64)), static_cast<u64>(block_size) * BITSIZEOF(u8));
+
+                    data_ptrs[i] = last;
+                }
+
+                ProcessBlocksImpl(hash_ptrs, data_ptrs, last_block_count);
+            }
+
+            /* Copy out the hashes. */
+            for (size_t i = 0; i < Lanes; ++i) {
+                u32 *dst_32 = reinterpret_cast<u32 *>(dst + i * Sha256Impl::HashSize);
+                for (size_t j = 0; j < HashWordCount; ++j) {
+                    util::StoreBigEndian<u32>(dst_32 + j, intermediate_hashes[i][j]);
+                }
+            }
+        }
+
+    }
+
+    bool g_is_sha_ni_available = GetShaNiAvailabilityImpl();
+
+    void Sha256Impl::Initialize() {
+        /* Reset buffered bytes/bits. */
+        m_buffered_bytes = 0;
+        m_bits_consumed  = 0;
+
+        /* Set intermediate hash. */
+        m_intermediate_hash[0] = 0x6A09E667;
+        m_intermediate_hash[1] = 0xBB67AE85;
+        m_intermediate_hash[2] = 0x3C6EF372;
+        m_intermediate_hash[3] = 0xA54FF53A;
+        m_intermediate_hash[4] = 0x510E527F;
+        m_intermediate_hash[5] = 0x9B05688C;
+        m_intermediate_hash[6] = 0x1F83D9AB;
+        m_intermediate_hash[7] = 0x5BE0CD19;
+
+        /* Set state. */
+        m_state = State_Initialized;
+    }
+
+    void Sha256Impl::Update(const void *data, size_t size) {
+        /* Verify we're in a state to update. */
+        AMS_ASSERT(m_state == State_Initialized);
+
+        /* Advance our input bit count. */
+        m_bits_consumed += BITSIZEOF(u8) * (((m_buffered_bytes + size) / BlockSize) * BlockSize);
+
+        /* Process anything we have buffered. */
+        const u8 *data8 = static_cast<const u8 *>(data);
+        size_t remaining = size;
+
+        if (m_buffered_bytes > 0) {
+            const size_t copy_size = std::min(BlockSize - m_buffered_bytes, remaining);
+            std::memcpy(m_buffer + m_buffered_bytes, data8, copy_size);
+
+            data8            += copy_size;
+            remaining        -= copy_size;
+            m_buffered_bytes += copy_size;
+
+            /* Process a block, if we filled one. */
+            if (m_buffered_bytes == BlockSize) {
+                this->ProcessBlock(m_buffer);
+                m_buffered_bytes = 0;
+            }
+        }
+
+        /* Process blocks, if we have any. */
+        if (remaining >= BlockSize) {
+            const size_t blocks = remaining / BlockSize;
+
+            this->ProcessBlocks(data8, blocks);
+            data8     += BlockSize * blocks;
+            remaining -= BlockSize * blocks;
+        }
+
+        /* Copy any leftover data to our buffer. */
+        if (remaining > 0) {
+            m_buffered_bytes = remaining;
+            std::memcpy(m_buffer, data8, remaining);
+        }
+    }
+
+    void Sha256Impl::GetHash(void *dst, size_t size) {
+        /* Verify we're in a state to get hash. */
+        AMS_ASSERT(m_state == State_Initialized || m_state == State_Done);
+        AMS_ASSERT(size >= HashSize);
+        AMS_UNUSED(size);
+
+        /* If we need to, process the last block. */
+        if (m_state == State_Initialized) {
+            this->ProcessLastBlock();
+            m_state = State_Done;
+        }
+
+        /* Copy the output hash. */
+        if constexpr (util::IsLittleEndian()) {
+            static_assert(HashSize % sizeof(u32) == 0);
+
+            u32 *dst_32 = static_cast<u32 *>(dst);
+            for (size_t i = 0; i < HashSize / sizeof(u32); ++i) {
+                dst_32[i] = util::LoadBigEndian<u32>(m_intermediate_hash + i);
+            }
+        } else {
+            std::memcpy(dst, m_intermediate_hash, HashSize);
+        }
+    }
+
+    void Sha256Impl::InitializeWithContext(const Sha256Context *context) {
+        /* Copy state in from the context. */
+        std::memcpy(m_intermediate_hash, context->intermediate_hash, sizeof(m_intermediate_hash));
+        m_bits_consumed = context->bits_consumed;
+
+        /* Reset other fields. */
+        m_buffered_bytes = 0;
+        m_state = State_Initialized;
+    }
+
+    size_t Sha256Impl::GetContext(Sha256Context *context) const {
+        /* Check our state. */
+        AMS_ASSERT(m_state == State_Initialized);
+
+        /* Copy out the context. */
+        std::memcpy(context->intermediate_hash, m_intermediate_hash, sizeof(context->intermediate_hash));
+        context->bits_consumed = m_bits_consumed;
+
+        return m_buffered_bytes;
+    }
+
+    ALWAYS_INLINE void Sha256Impl::ProcessBlock(const void *data) {
+        return this->ProcessBlocks(static_cast<const u8 *>(data), 1);
+    }
+
+    void Sha256Impl::ProcessBlocks(const u8 *data, size_t block_count) {
+        /* If we have sha-ni, use an optimized impl. */
+        if (IsShaNiAvailable()) {
+            u32 * const hashes[1]    = { m_intermediate_hash };
+            const u8 * const datas[1] = { data };
+            return ProcessBlocksShaNi<1>(hashes, datas, block_count);
+        }
+
+        /* Otherwise, process blocks one at a time. */
+        while ((block_count--) > 0) {
+            ProcessBlockGeneric(m_intermediate_hash, data);
+            data += BlockSize;
+        }
+    }
+
+    void Sha256Impl::ProcessLastBlock() {
+        /* Setup the final block. */
+        constexpr const auto BlockSizeWithoutSizeField = BlockSize - sizeof(u64);
+
+        /* Increment our bits consumed. */
+        m_bits_consumed += BITSIZEOF(u8) * m_buffered_bytes;
+
+        /* Add 0x80 terminator. */
+        m_buffer[m_buffered_bytes++] = 0x80;
+
+        /* If we can process the size field directly, do so, otherwise set up to process it. */
+        if (m_buffered_bytes <= BlockSizeWithoutSizeField) {
+            /* Clear up to size field. */
+            std::memset(m_buffer + m_buffered_bytes, 0, BlockSizeWithoutSizeField - m_buffered_bytes);
+        } else {
+            /* Consume full block */
+            std::memset(m_buffer + m_buffered_bytes, 0, BlockSize - m_buffered_bytes);
+            this->ProcessBlock(m_buffer);
+
+            /* Clear up to size field. */
+            std::memset(m_buffer, 0, BlockSizeWithoutSizeField);
+        }
+
+        /* Store the size field. */
+        util::StoreBigEndian<u64>(reinterpret_cast<u64 *>(m_buffer + BlockSizeWithoutSizeField), m_bits_consumed);
+
+        /* Process the final block. */
+        this->ProcessBlock(m_buffer);
+    }
+
+    void Sha256Impl::GenerateHashes(void *dst, size_t dst_size, const void *src, size_t src_size, size_t block_size) {
+        /* Check pre-conditions. */
+        AMS_ASSERT(block_size > 0);
+        AMS_ASSERT(src_size % block_size == 0);
+        AMS_ASSERT(dst_size >= (src_size / block_size) * HashSize);
+        AMS_UNUSED(dst_size);
+
+        u8 *dst8       = static_cast<u8 *>(dst);
+        const u8 *src8 = static_cast<const u8 *>(src);
+        size_t count   = src_size / block_size;
+
+        /* Hash as many blocks in parallel as we can. */
+        const auto GenerateLanes = [&]<size_t Lanes, auto ProcessBlocksImpl>() ALWAYS_INLINE_LAMBDA {
+            while (count >= Lanes) {
+                GenerateHashesMultiLane<Lanes, ProcessBlocksImpl>(dst8, src8, block_size);
+                dst8  += Lanes * HashSize;
+                src8  += Lanes * block_size;
+                count -= Lanes;
+            }
+        };
+
+        if (IsShaNiAvailable()) {
+            GenerateLanes.template operator()<2, ProcessBlocksShaNi<2>>();
+        } else if (IsAvx2Available()) {
+            GenerateLanes.template operator()<Avx2LaneCount, ProcessBlocksAvx2<Avx2LaneCount>>();
+        }
+
+        /* Hash any remaining blocks one at a time. */
+        while (count > 0) {
+            Sha256Impl impl;
+            impl.Initialize();
+            impl.Update(src8, block_size);
+            impl.GetHash(dst8, HashSize);
+
+            dst8  += HashSize;
+            src8  += block_size;
+            count -= 1;
+        }
+    }
+
+}
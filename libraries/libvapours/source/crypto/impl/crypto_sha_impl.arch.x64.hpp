@@ -0,0 +1,33 @@
+/*
+ * Copyright (c) Atmosphère-NX
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <vapours.hpp>
+#include <x86intrin.h>
+
+namespace ams::crypto::impl {
+
+    extern bool g_is_sha_ni_available;
+
+    ALWAYS_INLINE bool IsShaNiAvailable() {
+        return g_is_sha_ni_available;
+    }
+
+    /* NOTE: This lets tests exercise the generic implementations on hosts with SHA-NI; it must not be used to enable SHA-NI. */
+    ALWAYS_INLINE void SetShaNiAvailableForTest(bool available) {
+        g_is_sha_ni_available = available;
+    }
+
+}
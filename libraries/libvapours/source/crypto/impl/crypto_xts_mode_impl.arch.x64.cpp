@@ -0,0 +1,315 @@
+/*
+ * Copyright (c) Atmosphère-NX
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <vapours.hpp>
+#include "crypto_update_impl.hpp"
+#include "crypto_aes_impl.arch.x64.hpp"
+
+namespace ams::crypto::impl {
+
+    namespace {
+
+        constexpr inline size_t AesNiUnrolledBlockCount = 8;
+        constexpr inline size_t VaesUnrolledBlockCount  = 16;
+
+        constexpr inline size_t VaesBlocksPerRegister   = sizeof(__m512i) / sizeof(__m128i);
+        constexpr inline size_t VaesRegisterCount       = VaesUnrolledBlockCount / VaesBlocksPerRegister;
+
+        bool GetVaesAvailabilityImpl() {
+            /* Check that we can query the extended feature flags. */
+            int a = 0, b = 0, c = 0, d = 0;
+            __asm__ __volatile__("cpuid" : "=a"(a), "=b"(b), "=c"(c), "=d"(d) : "0"(0), "2"(0) : "memory");
+            if (a < 7) {
+                return false;
+            }
+
+            /* Check that the os uses xsave, so that we can check what register state it preserves. */
+            __asm__ __volatile__("cpuid" : "=a"(a), "=b"(b), "=c"(c), "=d"(d) : "0"(1), "2"(0) : "memory");
+            if (!(c & (1 << 27))) {
+                return false;
+            }
+
+            /* Check that the os preserves sse, avx, and avx-512 register state. */
+            u32 xcr0_lo = 0, xcr0_hi = 0;
+            __asm__ __volatile__("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+            AMS_UNUSED(xcr0_hi);
+
+            constexpr u32 Xcr0Avx512StateMask = (1u << 1) | (1u << 2) | (1u << 5) | (1u << 6) | (1u << 7);
+            if ((xcr0_lo & Xcr0Avx512StateMask) != Xcr0Avx512StateMask) {
+                return false;
+            }
+
+            /* Check for AVX-512F, AVX-512BW, VAES, and VPCLMULQDQ. */
+            __asm__ __volatile__("cpuid" : "=a"(a), "=b"(b), "=c"(c), "=d"(d) : "0"(7), "2"(0) : "memory");
+            return (b & (1 << 16)) && (b & (1 << 30)) && (c & (1 << 9)) && (c & (1 << 10));
+        }
+
+        const bool g_is_vaes_available = GetVaesAvailabilityImpl();
+
+        ALWAYS_INLINE bool IsVaesAvailable() {
+            return g_is_vaes_available;
+        }
+
+        template<typename BlockCipher>
+        constexpr inline bool IsAesEncryptor = std::same_as<BlockCipher, AesEncryptor<BlockCipher::KeySize>>;
+
+        template<typename BlockCipher>
+        constexpr inline s32 AesRoundCount = AesImpl<BlockCipher::KeySize>::RoundCount;
+
+        ALWAYS_INLINE __m128i MultiplyTweak(const __m128i tweak) {
+            /* Determine the carry out of each word, rotating the carry out of the top word around to be reduced by the xts polynomial. */
+            const __m128i carry = _mm_and_si128(_mm_shuffle_epi32(_mm_srai_epi32(tweak, 31), 0x93), _mm_set_epi32(1, 1, 1, 0x87));
+
+            /* Shift each word left by one, and apply the carries. */
+            return _mm_xor_si128(_mm_add_epi32(tweak, tweak), carry);
+        }
+
+        template<typename BlockCipher, size_t N>
+        ALWAYS_INLINE __m128i ProcessBlocksAesNi(u8 *dst, const u8 *src, __m128i tweak, const __m128i (&round_keys)[AesRoundCount<BlockCipher> + 1]) {
+            constexpr s32 RoundCount = AesRoundCount<BlockCipher>;
+
+            __m128i tweaks[N];
+            __m128i blocks[N];
+
+            [&]<size_t... Ix>(std::index_sequence<Ix...>) ALWAYS_INLINE_LAMBDA {
+                /* Load the blocks, and xor them with their tweaks. */
+                ((tweaks[Ix] = tweak, tweak = MultiplyTweak(tweak), blocks[Ix] = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src) + Ix), tweaks[Ix])), ...);
+
+                /* Crypt the blocks, interleaving so that the aes units stay busy. */
+                if constexpr (IsAesEncryptor<BlockCipher>) {
+                    ((blocks[Ix] = _mm_xor_si128(blocks[Ix], round_keys[0])), ...);
+                    for (s32 i = 1; i < RoundCount; ++i) {
+                        ((blocks[Ix] = _mm_aesenc_si128(blocks[Ix], round_keys[i])), ...);
+                    }
+                    ((blocks[Ix] = _mm_aesenclast_si128(blocks[Ix], round_keys[RoundCount])), ...);
+                } else {
+                    ((blocks[Ix] = _mm_xor_si128(blocks[Ix], round_keys[RoundCount])), ...);
+                    for (s32 i = RoundCount - 1; i > 0; --i) {
+                        ((blocks[Ix] = _mm_aesdec_si128(blocks[Ix], round_keys[i])), ...);
+                    }
+                    ((blocks[Ix] = _mm_aesdeclast_si128(blocks[Ix], round_keys[0])), ...);
+                }
+
+                /* Xor the blocks with their tweaks, and store them. */
+                ((_mm_storeu_si128(reinterpret_cast<__m128i *>(dst) + Ix, _mm_xor_si128(blocks[Ix], tweaks[Ix]))), ...);
+            }(std::make_index_sequence<N>());
+
+            return tweak;
+        }
+
+        __attribute__((target("avx512f,avx512bw,vpclmulqdq")))
+        ALWAYS_INLINE __m512i MultiplyTweaksByX16(const __m512i tweaks) {
+            /* Multiplying by x^16 shifts out the top two bytes of each tweak. */
+            const __m512i high = _mm512_bsrli_epi128(tweaks, 14);
+
+            /* Reduce the shifted out bytes by the xts polynomial, x^7 + x^2 + x + 1. */
+            const __m512i reduced = _mm512_clmulepi64_epi128(high, _mm512_set_epi64(0, 0x87, 0, 0x87, 0, 0x87, 0, 0x87), 0x00);
+
+            return _mm512_xor_si512(_mm512_bslli_epi128(tweaks, 2), reduced);
+        }
+
+        template<typename BlockCipher>
+        __attribute__((target("avx512f,avx512bw,vaes,vpclmulqdq")))
+        size_t ProcessBlocksVaes(u8 *dst, const u8 *src, size_t num_blocks, __m128i &tweak, const __m128i (&round_keys)[AesRoundCount<BlockCipher> + 1]) {
+            constexpr s32 RoundCount = AesRoundCount<BlockCipher>;
+
+            /* Check that we have enough blocks to make it worth setting up. */
+            if (num_blocks < VaesUnrolledBlockCount) {
+                return 0;
+            }
+
+            /* Broadcast the round keys to all lanes. */
+            /* NOTE: We go through memory rather than using _mm512_broadcast_i32x4, which spuriously trips -Wuninitialized on some gcc versions. */
+            __m512i wide_round_keys[RoundCount + 1];
+            for (s32 i = 0; i <= RoundCount; ++i) {
+                alignas(sizeof(__m512i)) const __m128i lanes[VaesBlocksPerRegister] = { round_keys[i], round_keys[i], round_keys[i], round_keys[i] };
+                wide_round_keys[i] = _mm512_load_si512(lanes);
+            }
+
+            /* Calculate the initial tweaks. Each lane is then advanced by x^16 per iteration. */
+            __m512i tweaks[VaesRegisterCount];
+            {
+                alignas(sizeof(__m512i)) __m128i initial_tweaks[VaesUnrolledBlockCount];
+                for (size_t i = 0; i < VaesUnrolledBlockCount; ++i) {
+                    initial_tweaks[i] = tweak;
+                    tweak = MultiplyTweak(tweak);
+                }
+                for (size_t i = 0; i < VaesRegisterCount; ++i) {
+                    tweaks[i] = _mm512_load_si512(initial_tweaks + i * VaesBlocksPerRegister);
+                }
+            }
+
+            size_t processed;
+            for (processed = 0; processed + VaesUnrolledBlockCount <= num_blocks; processed += VaesUnrolledBlockCount) {
+                const __m512i *src512 = reinterpret_cast<const __m512i *>(src + processed * BlockCipher::BlockSize);
+                      __m512i *dst512 = reinterpret_cast<      __m512i *>(dst + processed * BlockCipher::BlockSize);
+
+                [&]<size_t... Ix>(std::index_sequence<Ix...>) __attribute__((target("avx512f,avx512bw,vaes,vpclmulqdq"))) ALWAYS_INLINE_LAMBDA {
+                    __m512i blocks[VaesRegisterCount];
+
+                    /* Load the blocks, and xor them with their tweaks. */
+                    ((blocks[Ix] = _mm512_xor_si512(_mm512_loadu_si512(src512 + Ix), tweaks[Ix])), ...);
+
+                    /* Crypt the blocks. */
+                    if constexpr (IsAesEncryptor<BlockCipher>) {
+                        ((blocks[Ix] = _mm512_xor_si512(blocks[Ix], wide_round_keys[0])), ...);
+                        for (s32 i = 1; i < RoundCount; ++i) {
+                            ((blocks[Ix] = _mm512_aesenc_epi128(blocks[Ix], wide_round_keys[i])), ...);
+                        }
+                        ((blocks[Ix] = _mm512_aesenclast_epi128(blocks[Ix], wide_round_keys[RoundCount])), ...);
+                    } else {
+                        ((blocks[Ix] = _mm512_xor_si512(blocks[Ix], wide_round_keys[RoundCount])), ...);
+                        for (s32 i = RoundCount - 1; i > 0; --i) {
+                            ((blocks[Ix] = _mm512_aesdec_epi128(blocks[Ix], wide_round_keys[i])), ...);
+                        }
+                        ((blocks[Ix] = _mm512_aesdeclast_epi128(blocks[Ix], wide_round_keys[0])), ...);
+                    }
+
+                    /* Xor the blocks with their tweaks, store them, and advance the tweaks. */
+                    ((_mm512_storeu_si512(dst512 + Ix, _mm512_xor_si512(blocks[Ix], tweaks[Ix]))), ...);
+                    ((tweaks[Ix] = MultiplyTweaksByX16(tweaks[Ix])), ...);
+                }(std::make_index_sequence<VaesRegisterCount>());
+            }
+
+            /* The first lane now holds the tweak for the next block. */
+            {
+                alignas(sizeof(__m512i)) __m128i lanes[VaesBlocksPerRegister];
+                _mm512_store_si512(lanes, tweaks[0]);
+                tweak = lanes[0];
+            }
+
+            /* Clear the upper register state, to avoid penalties in subsequent sse code. */
+            _mm256_zeroupper();
+
+            return processed;
+        }
+
+        template<typename BlockCipher>
+        void ProcessBlocksAccelerated(u8 *dst, const u8 *src, size_t num_blocks, const BlockCipher *cipher, u8 *raw_tweak) {
+            constexpr s32 RoundCount = AesRoundCount<BlockCipher>;
+            constexpr size_t BlockSize = BlockCipher::BlockSize;
+
+            /* Load all keys into sse2 registers. */
+            const u8 *raw_round_keys = cipher->GetRoundKey();
+            __m128i round_keys[RoundCount + 1];
+            for (s32 i = 0; i <= RoundCount; ++i) {
+                round_keys[i] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(raw_round_keys + BlockSize * i));
+            }
+
+            /* Load the tweak. */
+            __m128i tweak = _mm_loadu_si128(reinterpret_cast<const __m128i *>(raw_tweak));
+
+            /* If we have vaes, process sixteen blocks at a time, while we can. */
+            if (IsVaesAvailable()) {
+                const size_t processed = ProcessBlocksVaes<BlockCipher>(dst, src, num_blocks, tweak, round_keys);
+                dst        += processed * BlockSize;
+                src        += processed * BlockSize;
+                num_blocks -= processed;
+            }
+
+            /* Process eight blocks at a time, while we can. */
+            while (num_blocks >= AesNiUnrolledBlockCount) {
+                tweak = ProcessBlocksAesNi<BlockCipher, AesNiUnrolledBlockCount>(dst, src, tweak, round_keys);
+                dst        += AesNiUnrolledBlockCount * BlockSize;
+                src        += AesNiUnrolledBlockCount * BlockSize;
+                num_blocks -= AesNiUnrolledBlockCount;
+            }
+
+            /* Process any remaining blocks. */
+            while (num_blocks > 0) {
+                tweak = ProcessBlocksAesNi<BlockCipher, 1>(dst, src, tweak, round_keys);
+                dst        += BlockSize;
+                src        += BlockSize;
+                num_blocks -= 1;
+            }
+
+            /* Store the updated tweak. */
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(raw_tweak), tweak);
+        }
+
+    }
+
+    size_t XtsModeImpl::UpdateGeneric(void *dst, size_t dst_size, const void *src, size_t src_size) {
+        AMS_ASSERT(m_state == State_Initialized || m_state == State_Processing);
+
+        return UpdateImpl<void>(this, dst, dst_size, src, src_size);
+    }
+
+    size_t XtsModeImpl::ProcessBlocksGeneric(u8 *dst, const u8 *src, size_t num_blocks) {
+        size_t processed = BlockSize * (num_blocks - 1);
+
+        if (m_state == State_Processing) {
+            this->ProcessBlock(dst, m_last_block);
+            dst       += BlockSize;
+            processed += BlockSize;
+        }
+
+        while ((--num_blocks) > 0) {
+            this->ProcessBlock(dst, src);
+            dst += BlockSize;
+            src += BlockSize;
+        }
+
+        std::memcpy(m_last_block, src, BlockSize);
+
+        m_state = State_Processing;
+
+        return processed;
+    }
+
+    template<> size_t XtsModeImpl::Update<AesEncryptor128>(void *dst, size_t dst_size, const void *src, size_t src_size) { return UpdateImpl<AesEncryptor128>(this, dst, dst_size, src, src_size); }
+    template<> size_t XtsModeImpl::Update<AesEncryptor192>(void *dst, size_t dst_size, const void *src, size_t src_size) { return UpdateImpl<AesEncryptor192>(this, dst, dst_size, src, src_size); }
+    template<> size_t XtsModeImpl::Update<AesEncryptor256>(void *dst, size_t dst_size, const void *src, size_t src_size) { return UpdateImpl<AesEncryptor256>(this, dst, dst_size, src, src_size); }
+
+    template<> size_t XtsModeImpl::Update<AesDecryptor128>(void *dst, size_t dst_size, const void *src, size_t src_size) { return UpdateImpl<AesDecryptor128>(this, dst, dst_size, src, src_size); }
+    template<> size_t XtsModeImpl::Update<AesDecryptor192>(void *dst, size_t dst_size, const void *src, size_t src_size) { return UpdateImpl<AesDecryptor192>(this, dst, dst_size, src, src_size); }
+    template<> size_t XtsModeImpl::Update<AesDecryptor256>(void *dst, size_t dst_size, const void *src, size_t src_size) { return UpdateImpl<AesDecryptor256>(this, dst, dst_size, src, src_size); }
+
+    #define AMS_CRYPTO_DEFINE_XTS_AES_PROCESS_BLOCKS(_CIPHER_)                                                                   \
+    template<> size_t XtsModeImpl::ProcessBlocks<_CIPHER_>(u8 *dst, const u8 *src, size_t num_blocks) {                         \
+        /* If we don't have aes-ni, use the generic impl. */                                                                    \
+        if (!IsAesNiAvailable()) {                                                                                              \
+            return this->ProcessBlocksGeneric(dst, src, num_blocks);                                                            \
+        }                                                                                                                       \
+                                                                                                                                \
+        size_t processed = BlockSize * (num_blocks - 1);                                                                        \
+                                                                                                                                \
+        if (m_state == State_Processing) {                                                                                      \
+            this->ProcessBlock(dst, m_last_block);                                                                              \
+            dst       += BlockSize;                                                                                             \
+            processed += BlockSize;                                                                                             \
+        }                                                                                                                       \
+                                                                                                                                \
+        ProcessBlocksAccelerated<_CIPHER_>(dst, src, num_blocks - 1, static_cast<const _CIPHER_ *>(m_cipher_ctx), m_tweak);     \
+        src += BlockSize * (num_blocks - 1);                                                                                    \
+                                                                                                                                \
+        std::memcpy(m_last_block, src, BlockSize);                                                                              \
+                                                                                                                                \
+        m_state = State_Processing;                                                                                             \
+                                                                                                                                \
+        return processed;                                                                                                       \
+    }
+
+    AMS_CRYPTO_DEFINE_XTS_AES_PROCESS_BLOCKS(AesEncryptor128)
+    AMS_CRYPTO_DEFINE_XTS_AES_PROCESS_BLOCKS(AesEncryptor192)
+    AMS_CRYPTO_DEFINE_XTS_AES_PROCESS_BLOCKS(AesEncryptor256)
+
+    AMS_CRYPTO_DEFINE_XTS_AES_PROCESS_BLOCKS(AesDecryptor128)
+    AMS_CRYPTO_DEFINE_XTS_AES_PROCESS_BLOCKS(AesDecryptor192)
+    AMS_CRYPTO_DEFINE_XTS_AES_PROCESS_BLOCKS(AesDecryptor256)
+
+    #undef AMS_CRYPTO_DEFINE_XTS_AES_PROCESS_BLOCKS
+
+}
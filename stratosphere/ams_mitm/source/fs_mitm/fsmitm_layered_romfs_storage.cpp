@@ -17,16 +17,25 @@
 #include "../amsmitm_initialization.hpp"
 #include "../amsmitm_fs_utils.hpp"
 #include "fsmitm_layered_romfs_storage.hpp"
+#include "fsmitm_romfs_metadata_cache.hpp"
 
 namespace ams::mitm::fs {
 
     namespace {
 
-        constinit os::SdkMutex g_mq_lock;
-        constinit bool g_started_req_thread;
-        constinit uintptr_t g_mq_storage[2];
-        os::MessageQueue g_req_mq(g_mq_storage + 0, 1);
-        os::MessageQueue g_ack_mq(g_mq_storage + 1, 1);
+        constexpr s32 RomfsBuildThreadCountMax     = 4;
+        constexpr s32 RomfsBuildThreadCountDefault = 2;
+
+        using BuildRequestList = util::IntrusiveListBaseTraits<LayeredRomfsStorageImpl>::ListType;
+
+        constinit os::SdkMutex g_build_lock;
+        constinit os::SdkConditionVariable g_build_request_cv;
+        constinit os::SdkConditionVariable g_build_finished_cv;
+        constinit bool g_started_build_threads;
+        constinit s32 g_romfs_build_thread_count;
+        constinit BuildRequestList g_process_romfs_build_requests;
+        constinit BuildRequestList g_data_romfs_build_requests;
+        constinit ncm::ProgramId g_building_program_ids[RomfsBuildThreadCountMax];
 
         class LayeredRomfsStorageHolder : public util::IntrusiveRedBlackTreeBaseNode<LayeredRomfsStorageHolder> {
             public:
@@ -78,7 +87,6 @@ namespace ams::mitm::fs {
 
         constinit os::SdkRecursiveMutex g_storage_set_mutex;
         constinit LayeredRomfsStorageSet g_storage_set;
-        constinit os::SdkMutex g_initialization_mutex;
 
         void OpenReference(LayeredRomfsStorageImpl *impl) {
             std::scoped_lock lk(g_storage_set_mutex);
@@ -99,20 +107,97 @@ namespace ams::mitm::fs {
             it->CloseReferenceImpl();
         }
 
-        void RomfsInitializerThreadFunction(void *) {
+        s32 GetRomfsBuildThreadCount() {
+            u8 count = RomfsBuildThreadCountDefault;
+            if (settings::fwdbg::GetSettingsItemValue(std::addressof(count), sizeof(count), "atmosphere", "fsmitm_romfs_build_thread_count") != sizeof(count)) {
+                count = RomfsBuildThreadCountDefault;
+            }
+
+            return std::min<s32>(std::max<s32>(count, 1), RomfsBuildThreadCountMax);
+        }
+
+        bool IsBuildingRomfs(ncm::ProgramId program_id) {
+            AMS_ASSERT(g_build_lock.IsLockedByCurrentThread());
+
+            for (const auto &id : g_building_program_ids) {
+                if (id == program_id) {
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        bool IsPendingRomfsBuild(ncm::ProgramId program_id) {
+            AMS_ASSERT(g_build_lock.IsLockedByCurrentThread());
+
+            if (IsBuildingRomfs(program_id)) {
+                return true;
+            }
+
+            for (const auto *list : { std::addressof(g_process_romfs_build_requests), std::addressof(g_data_romfs_build_requests) }) {
+                for (const auto &impl : *list) {
+                    if (impl.GetProgramId() == program_id) {
+                        return true;
+                    }
+                }
+            }
+
+            return false;
+        }
+
+        LayeredRomfsStorageImpl *TakeRomfsBuildRequest(BuildRequestList &list) {
+            AMS_ASSERT(g_build_lock.IsLockedByCurrentThread());
+
+            /* Take the oldest request whose program isn't already being built by another thread. */
+            for (auto it = list.begin(); it != list.end(); ++it) {
+                if (!IsBuildingRomfs(it->GetProgramId())) {
+                    auto *impl = std::addressof(*it);
+                    list.erase(it);
+                    return impl;
+                }
+            }
+
+            return nullptr;
+        }
+
+        void RomfsBuildThreadFunction(void *arg) {
+            /* NOTE: The first build thread only builds process romfs, so that a launching program is never stuck behind data archives. */
+            const s32 thread_index    = static_cast<s32>(reinterpret_cast<uintptr_t>(arg));
+            const bool can_build_data = thread_index != 0 || g_romfs_build_thread_count == 1;
+
+            std::scoped_lock lk(g_build_lock);
+
             while (true) {
-                uintptr_t storage_uptr = 0;
+                /* Wait for a request we can service, preferring process romfs. */
+                LayeredRomfsStorageImpl *impl = nullptr;
+                while (true) {
+                    if ((impl = TakeRomfsBuildRequest(g_process_romfs_build_requests)) != nullptr) {
+                        break;
+                    }
+                    if (can_build_data && (impl = TakeRomfsBuildRequest(g_data_romfs_build_requests)) != nullptr) {
+                        break;
+                    }
+
+                    g_build_request_cv.Wait(g_build_lock);
+                }
 
-                g_req_mq.Receive(std::addressof(storage_uptr));
-                auto *impl = reinterpret_cast<LayeredRomfsStorageImpl *>(storage_uptr);
-                g_ack_mq.Send(storage_uptr);
+                /* Build the romfs, without holding our lock. */
+                g_building_program_ids[thread_index] = impl->GetProgramId();
+                {
+                    g_build_lock.Unlock();
+                    ON_SCOPE_EXIT { g_build_lock.Lock(); };
 
-                std::scoped_lock lk(g_initialization_mutex);
+                    impl->InitializeImpl();
 
-                impl->InitializeImpl();
+                    /* Close the initial reference. */
+                    CloseReference(impl);
+                }
+                g_building_program_ids[thread_index] = ncm::InvalidProgramId;
 
-                /* Close the initial reference. */
-                CloseReference(impl);
+                /* Let anyone waiting on the build know that it's done, including threads which skipped requests for the program. */
+                g_build_finished_cv.Broadcast();
+                g_build_request_cv.Broadcast();
             }
         }
 
@@ -141,31 +226,39 @@ namespace ams::mitm::fs {
             }
         }
 
-        constexpr size_t RomfsInitializerThreadStackSize = 0x8000;
-        os::ThreadType g_romfs_initializer_thread;
+        constexpr size_t RomfsBuildThreadStackSize = 0x8000;
+        os::ThreadType g_romfs_build_threads[RomfsBuildThreadCountMax];
         os::ThreadType g_romfs_finalizer_thread;
-        alignas(os::ThreadStackAlignment) u8 g_romfs_initializer_thread_stack[RomfsInitializerThreadStackSize];
+        alignas(os::ThreadStackAlignment) u8 g_romfs_build_thread_stacks[RomfsBuildThreadCountMax][RomfsBuildThreadStackSize];
         alignas(os::ThreadStackAlignment) u8 g_romfs_finalizer_thread_stack[os::MemoryPageSize];
 
-        void RequestInitializeStorage(uintptr_t storage_uptr) {
-            std::scoped_lock lk(g_mq_lock);
+        void RequestInitializeStorage(LayeredRomfsStorageImpl *impl) {
+            std::scoped_lock lk(g_build_lock);
 
-            if (AMS_UNLIKELY(!g_started_req_thread)) {
-                R_ABORT_UNLESS(os::CreateThread(std::addressof(g_romfs_initializer_thread), RomfsInitializerThreadFunction, nullptr, g_romfs_initializer_thread_stack, sizeof(g_romfs_initializer_thread_stack), AMS_GET_SYSTEM_THREAD_PRIORITY(mitm_fs, RomFileSystemInitializeThread)));
-                os::SetThreadNamePointer(std::addressof(g_romfs_initializer_thread), AMS_GET_SYSTEM_THREAD_NAME(mitm_fs, RomFileSystemInitializeThread));
-                os::StartThread(std::addressof(g_romfs_initializer_thread));
+            if (AMS_UNLIKELY(!g_started_build_threads)) {
+                g_romfs_build_thread_count = GetRomfsBuildThreadCount();
+                for (s32 i = 0; i < g_romfs_build_thread_count; ++i) {
+                    R_ABORT_UNLESS(os::CreateThread(std::addressof(g_romfs_build_threads[i]), RomfsBuildThreadFunction, reinterpret_cast<void *>(static_cast<uintptr_t>(i)), g_romfs_build_thread_stacks[i], sizeof(g_romfs_build_thread_stacks[i]), AMS_GET_SYSTEM_THREAD_PRIORITY(mitm_fs, RomFileSystemInitializeThread)));
+                    os::SetThreadNamePointer(std::addressof(g_romfs_build_threads[i]), AMS_GET_SYSTEM_THREAD_NAME(mitm_fs, RomFileSystemInitializeThread));
+                    os::StartThread(std::addressof(g_romfs_build_threads[i]));
+                }
 
                 R_ABORT_UNLESS(os::CreateThread(std::addressof(g_romfs_finalizer_thread), RomfsFinalizerThreadFunction, nullptr, g_romfs_finalizer_thread_stack, sizeof(g_romfs_finalizer_thread_stack), AMS_GET_SYSTEM_THREAD_PRIORITY(mitm_fs, RomFileSystemInitializeThread)));
                 os::SetThreadNamePointer(std::addressof(g_romfs_finalizer_thread), AMS_GET_SYSTEM_THREAD_NAME(mitm_fs, RomFileSystemFinalizeThread));
                 os::StartThread(std::addressof(g_romfs_finalizer_thread));
 
-                g_started_req_thread = true;
+                g_started_build_threads = true;
+            }
+
+            /* Enqueue the request. */
+            if (impl->IsProcessRomfs()) {
+                g_process_romfs_build_requests.push_back(*impl);
+            } else {
+                g_data_romfs_build_requests.push_back(*impl);
             }
 
-            g_req_mq.Send(storage_uptr);
-            uintptr_t ack = 0;
-            g_ack_mq.Receive(std::addressof(ack));
-            AMS_ABORT_UNLESS(ack == storage_uptr);
+            /* NOTE: Not every thread can service every request, so we must wake all of them. */
+            g_build_request_cv.Broadcast();
         }
 
         class LayeredRomfsStorage : public ams::fs::IStorage {
@@ -242,9 +335,9 @@ namespace ams::mitm::fs {
         {
             ::FsFile data_file;
             if (R_SUCCEEDED(OpenAtmosphereSdFile(std::addressof(data_file), program_id, "romfs.bin", OpenMode_Read))) {
-                impl = new LayeredRomfsStorageImpl(std::make_unique<ReadOnlyStorageAdapter>(new RemoteStorage(data_storage)), std::make_unique<ReadOnlyStorageAdapter>(new FileStorage(new RemoteFile(data_file))), program_id);
+                impl = new LayeredRomfsStorageImpl(std::make_unique<ReadOnlyStorageAdapter>(new RemoteStorage(data_storage)), std::make_unique<ReadOnlyStorageAdapter>(new FileStorage(new RemoteFile(data_file))), program_id, is_process_romfs);
             } else {
-                impl = new LayeredRomfsStorageImpl(std::make_unique<ReadOnlyStorageAdapter>(new RemoteStorage(data_storage)), nullptr, program_id);
+                impl = new LayeredRomfsStorageImpl(std::make_unique<ReadOnlyStorageAdapter>(new RemoteStorage(data_storage)), nullptr, program_id, is_process_romfs);
             }
         }
 
@@ -259,8 +352,16 @@ namespace ams::mitm::fs {
     }
 
     void FinalizeLayeredRomfsStorage(ncm::ProgramId program_id) {
-        std::scoped_lock lk(g_initialization_mutex);
-        std::scoped_lock lk2(g_storage_set_mutex);
+        /* Wait for any build of the program's romfs to finish. */
+        {
+            std::scoped_lock lk(g_build_lock);
+
+            while (IsPendingRomfsBuild(program_id)) {
+                g_build_finished_cv.Wait(g_build_lock);
+            }
+        }
+
+        std::scoped_lock lk(g_storage_set_mutex);
 
         /* Find an existing storage. */
         if (auto it = g_storage_set.find_key(program_id.value); it != g_storage_set.end()) {
@@ -273,11 +374,13 @@ namespace ams::mitm::fs {
         }
     }
 
-    LayeredRomfsStorageImpl::LayeredRomfsStorageImpl(std::unique_ptr<IStorage> s_r, std::unique_ptr<IStorage> f_r, ncm::ProgramId pr_id) : m_storage_romfs(std::move(s_r)), m_file_romfs(std::move(f_r)), m_initialize_event(os::EventClearMode_ManualClear), m_program_id(std::move(pr_id)), m_is_initialized(false), m_started_initialize(false) {
+    LayeredRomfsStorageImpl::LayeredRomfsStorageImpl(std::unique_ptr<IStorage> s_r, std::unique_ptr<IStorage> f_r, ncm::ProgramId pr_id, bool process_rom) : m_storage_romfs(std::move(s_r)), m_file_romfs(std::move(f_r)), m_initialize_event(os::EventClearMode_ManualClear), m_program_id(std::move(pr_id)), m_is_process_romfs(process_rom), m_is_initialized(false), m_started_initialize(false), m_loose_file_cache_mutex(), m_loose_file_cache(), m_loose_file_cache_tick(0), m_loose_file_cache_hit_count(0), m_loose_file_cache_miss_count(0) {
         /* ... */
     }
 
     LayeredRomfsStorageImpl::~LayeredRomfsStorageImpl() {
+        this->FinalizeLooseFileCache();
+
         for (size_t i = 0; i < m_source_infos.size(); i++) {
             m_source_infos[i].Cleanup();
         }
@@ -285,25 +388,45 @@ namespace ams::mitm::fs {
 
     void LayeredRomfsStorageImpl::BeginInitialize() {
         AMS_ABORT_UNLESS(!m_started_initialize);
-        RequestInitializeStorage(reinterpret_cast<uintptr_t>(this));
         m_started_initialize = true;
+        RequestInitializeStorage(this);
     }
 
     void LayeredRomfsStorageImpl::InitializeImpl() {
-        /* Build new virtual romfs. */
-        romfs::Builder builder(m_program_id);
+        /* Allocate out of our program's dynamic heap, if it has one. */
+        romfs::BuildHeapScope heap_scope(m_program_id);
 
-        if (mitm::IsInitialized()) {
-            builder.AddSdFiles();
-        }
-        if (m_file_romfs) {
-            builder.AddStorageFiles(m_file_romfs.get(), romfs::DataSourceType::File);
-        }
-        if (m_storage_romfs) {
-            builder.AddStorageFiles(m_storage_romfs.get(), romfs::DataSourceType::Storage);
-        }
+        /* Determine the key for our sources, so we can check whether a previous build is still valid. */
+        const bool has_sd_files = mitm::IsInitialized();
 
-        builder.Build(std::addressof(m_source_infos));
+        romfs::MetadataCacheKey cache_key;
+        const bool is_cacheable = romfs::CalculateMetadataCacheKey(std::addressof(cache_key), m_program_id, has_sd_files, m_file_romfs.get(), m_storage_romfs.get());
+
+        /* If we can't use a cached build, build from scratch. */
+        if (!is_cacheable || !romfs::LoadMetadataCache(std::addressof(m_source_infos), m_program_id, cache_key)) {
+            /* Building overwrites the metadata the cache refers to, so invalidate it first. */
+            romfs::InvalidateMetadataCache(m_program_id);
+
+            /* Prepare to build new virtual romfs. */
+            romfs::Builder builder(m_program_id, m_is_process_romfs);
+
+            if (has_sd_files) {
+                builder.AddSdFiles();
+            }
+            if (m_file_romfs) {
+                builder.AddStorageFiles(m_file_romfs.get(), romfs::DataSourceType::File);
+            }
+            if (m_storage_romfs) {
+                builder.AddStorageFiles(m_storage_romfs.get(), romfs::DataSourceType::Storage);
+            }
+
+            builder.Build(std::addressof(m_source_infos));
+
+            /* Save the build, so that we can skip it next time. */
+            if (is_cacheable) {
+                romfs::SaveMetadataCache(m_program_id, cache_key, m_source_infos);
+            }
+        }
 
         m_is_initialized = true;
         m_initialize_event.Signal();
@@ -349,15 +472,7 @@ namespace ams::mitm::fs {
                         R_ABORT_UNLESS(m_file_romfs->Read(cur_source.file_source_info.offset + offset_within_source, cur_dst, cur_read_size));
                         break;
                     case romfs::DataSourceType::LooseSdFile:
-                        {
-                            FsFile file;
-                            R_ABORT_UNLESS(mitm::fs::OpenAtmosphereSdRomfsFile(std::addressof(file), m_program_id, cur_source.loose_source_info.path, OpenMode_Read));
-                            ON_SCOPE_EXIT { fsFileClose(std::addressof(file)); };
-
-                            u64 out_read = 0;
-                            R_ABORT_UNLESS(fsFileRead(std::addressof(file), offset_within_source, cur_dst, cur_read_size, FsReadOption_None, std::addressof(out_read)));
-                            AMS_ABORT_UNLESS(out_read == cur_read_size);
-                        }
+                        R_ABORT_UNLESS(this->ReadLooseFile(static_cast<size_t>(it - m_source_infos.begin()), offset_within_source, cur_dst, cur_read_size));
                         break;
                     case romfs::DataSourceType::Memory:
                         std::memcpy(cur_dst, cur_source.memory_source_info.data + offset_within_source, cur_read_size);
@@ -425,4 +540,120 @@ namespace ams::mitm::fs {
     }
 
 
+    void LayeredRomfsStorageImpl::GetLooseFileCacheCounters(u64 *out_hit_count, u64 *out_miss_count) const {
+        *out_hit_count  = m_loose_file_cache_hit_count;
+        *out_miss_count = m_loose_file_cache_miss_count;
+    }
+
+    Result LayeredRomfsStorageImpl::ReadLooseFile(size_t source_index, s64 offset, void *buffer, size_t size) {
+        /* Get the file from our cache. */
+        ::FsFile uncached_file;
+        LooseFileCacheEntry *entry = this->AcquireLooseFile(source_index);
+        if (entry == nullptr) {
+            /* Open the file outside of our cache's lock, so that reads of cached files don't wait on the sd card. */
+            R_TRY(mitm::fs::OpenAtmosphereSdRomfsFile(std::addressof(uncached_file), m_program_id, m_source_infos[source_index].loose_source_info.path, OpenMode_Read));
+
+            /* Try to cache the file, closing whatever it evicts. */
+            ::FsFile evicted_file;
+            bool evicted = false;
+            entry = this->InsertLooseFile(source_index, uncached_file, std::addressof(evicted_file), std::addressof(evicted));
+            if (evicted) {
+                fsFileClose(std::addressof(evicted_file));
+            }
+        }
+        ON_SCOPE_EXIT {
+            if (entry != nullptr) {
+                this->ReleaseLooseFile(entry);
+            } else {
+                fsFileClose(std::addressof(uncached_file));
+            }
+        };
+
+        /* Read the file. */
+        u64 out_read = 0;
+        R_TRY(fsFileRead(entry != nullptr ? std::addressof(entry->file) : std::addressof(uncached_file), offset, buffer, size, FsReadOption_None, std::addressof(out_read)));
+        AMS_ABORT_UNLESS(out_read == size);
+
+        R_SUCCEED();
+    }
+
+    LayeredRomfsStorageImpl::LooseFileCacheEntry *LayeredRomfsStorageImpl::AcquireLooseFile(size_t source_index) {
+        std::scoped_lock lk(m_loose_file_cache_mutex);
+
+        /* Check if we already have the file open. */
+        for (auto &entry : m_loose_file_cache) {
+            if (entry.is_valid && entry.source_index == source_index) {
+                ++m_loose_file_cache_hit_count;
+
+                ++entry.reference_count;
+                entry.last_used = ++m_loose_file_cache_tick;
+                return std::addressof(entry);
+            }
+        }
+
+        ++m_loose_file_cache_miss_count;
+        return nullptr;
+    }
+
+    LayeredRomfsStorageImpl::LooseFileCacheEntry *LayeredRomfsStorageImpl::InsertLooseFile(size_t source_index, const ::FsFile &file, ::FsFile *out_evicted_file, bool *out_evicted) {
+        std::scoped_lock lk(m_loose_file_cache_mutex);
+
+        /* NOTE: Another thread may have cached the same file while we were opening it. */
+        /* That's harmless; lookups use the first entry, and the other ages out. */
+        *out_evicted = false;
+
+        /* Find an entry to use, preferring unused entries and otherwise evicting the least recently used unreferenced one. */
+        LooseFileCacheEntry *victim = nullptr;
+        for (auto &entry : m_loose_file_cache) {
+            if (!entry.is_valid) {
+                victim = std::addressof(entry);
+                break;
+            }
+
+            if (entry.reference_count == 0 && (victim == nullptr || entry.last_used < victim->last_used)) {
+                victim = std::addressof(entry);
+            }
+        }
+
+        /* If every entry is in use, the caller will have to use the file on its own. */
+        if (victim == nullptr) {
+            return nullptr;
+        }
+
+        /* Give the victim's file to the caller to close, if it has one. */
+        if (victim->is_valid) {
+            *out_evicted_file = victim->file;
+            *out_evicted      = true;
+        }
+
+        /* Set up the entry. */
+        victim->file            = file;
+        victim->source_index    = source_index;
+        victim->last_used       = ++m_loose_file_cache_tick;
+        victim->reference_count = 1;
+        victim->is_valid        = true;
+
+        return victim;
+    }
+
+    void LayeredRomfsStorageImpl::ReleaseLooseFile(LooseFileCacheEntry *entry) {
+        std::scoped_lock lk(m_loose_file_cache_mutex);
+
+        AMS_ABORT_UNLESS(entry->reference_count > 0);
+        --entry->reference_count;
+    }
+
+    void LayeredRomfsStorageImpl::FinalizeLooseFileCache() {
+        std::scoped_lock lk(m_loose_file_cache_mutex);
+
+        for (auto &entry : m_loose_file_cache) {
+            if (entry.is_valid) {
+                AMS_ABORT_UNLESS(entry.reference_count == 0);
+
+                fsFileClose(std::addressof(entry.file));
+                entry.is_valid = false;
+            }
+        }
+    }
+
 }
@@ -20,33 +20,59 @@
 
 namespace ams::mitm::fs {
 
-    class LayeredRomfsStorageImpl {
+    class LayeredRomfsStorageImpl : public util::IntrusiveListBaseNode<LayeredRomfsStorageImpl> {
+        private:
+            static constexpr size_t LooseFileCacheEntryCount = 8;
+
+            struct LooseFileCacheEntry {
+                ::FsFile file;
+                size_t source_index;
+                u64 last_used;
+                u32 reference_count;
+                bool is_valid;
+            };
         private:
             romfs::Builder::SourceInfoVector m_source_infos;
             std::unique_ptr<ams::fs::IStorage> m_storage_romfs;
             std::unique_ptr<ams::fs::IStorage> m_file_romfs;
             os::Event m_initialize_event;
             ncm::ProgramId m_program_id;
+            bool m_is_process_romfs;
             bool m_is_initialized;
             bool m_started_initialize;
+            os::SdkMutex m_loose_file_cache_mutex;
+            LooseFileCacheEntry m_loose_file_cache[LooseFileCacheEntryCount];
+            u64 m_loose_file_cache_tick;
+            std::atomic<u64> m_loose_file_cache_hit_count;
+            std::atomic<u64> m_loose_file_cache_miss_count;
         protected:
             inline s64 GetSize() const {
                 const auto &back = m_source_infos.back();
                 return back.virtual_offset + back.size;
             }
         public:
-            LayeredRomfsStorageImpl(std::unique_ptr<ams::fs::IStorage> s_r, std::unique_ptr<ams::fs::IStorage> f_r, ncm::ProgramId pr_id);
+            LayeredRomfsStorageImpl(std::unique_ptr<ams::fs::IStorage> s_r, std::unique_ptr<ams::fs::IStorage> f_r, ncm::ProgramId pr_id, bool process_rom);
             ~LayeredRomfsStorageImpl();
 
             void BeginInitialize();
             void InitializeImpl();
 
             constexpr ncm::ProgramId GetProgramId() const { return m_program_id; }
+            constexpr bool IsProcessRomfs() const { return m_is_process_romfs; }
 
             Result Read(s64 offset, void *buffer, size_t size);
             Result GetSize(s64 *out_size);
             Result Flush();
             Result OperateRange(void *dst, size_t dst_size, ams::fs::OperationId op_id, s64 offset, s64 size, const void *src, size_t src_size);
+
+            void GetLooseFileCacheCounters(u64 *out_hit_count, u64 *out_miss_count) const;
+        private:
+            Result ReadLooseFile(size_t source_index, s64 offset, void *buffer, size_t size);
+
+            LooseFileCacheEntry *AcquireLooseFile(size_t source_index);
+            LooseFileCacheEntry *InsertLooseFile(size_t source_index, const ::FsFile &file, ::FsFile *out_evicted_file, bool *out_evicted);
+            void ReleaseLooseFile(LooseFileCacheEntry *entry);
+            void FinalizeLooseFileCache();
     };
 
     std::shared_ptr<ams::fs::IStorage> GetLayeredRomfsStorage(ncm::ProgramId program_id, ::FsStorage &data_storage, bool is_process_romfs);
@@ -17,6 +17,7 @@
 #include "../amsmitm_fs_utils.hpp"
 #include "fsmitm_romfs.hpp"
 #include "fsmitm_layered_romfs_storage.hpp"
+#include "fsmitm_romfs_directory_scanner.hpp"
 
 namespace ams::mitm::fs {
 
@@ -70,25 +71,30 @@ namespace ams::mitm::fs {
                 return 0;
             }
 
+            /* NOTE: Memory from a dynamic heap may be freed by any thread, including while another romfs is being built. */
             template<auto MapImpl, auto UnmapImpl>
             struct DynamicHeap {
-                uintptr_t heap_address{};
+                std::atomic<uintptr_t> heap_address{};
                 size_t heap_size{};
-                size_t outstanding_allocations{};
+                std::atomic<size_t> outstanding_allocations{};
                 util::TypedStorage<mem::StandardAllocator> heap{};
                 os::SdkMutex release_heap_lock{};
 
                 constexpr DynamicHeap() = default;
 
                 void Map() {
-                    if (this->heap_address == 0) {
-                        /* NOTE: Lock not necessary, because this is the only location which do 0 -> non-zero. */
+                    std::scoped_lock lk(this->release_heap_lock);
 
-                        R_ABORT_UNLESS(MapImpl(std::addressof(this->heap_address), this->heap_size));
-                        AMS_ABORT_UNLESS(this->heap_address != 0);
+                    if (this->heap_address == 0) {
+                        uintptr_t address = 0;
+                        R_ABORT_UNLESS(MapImpl(std::addressof(address), this->heap_size));
+                        AMS_ABORT_UNLESS(address != 0);
 
                         /* Create heap. */
-                        util::ConstructAt(this->heap, reinterpret_cast<void *>(this->heap_address), this->heap_size);
+                        util::ConstructAt(this->heap, reinterpret_cast<void *>(address), this->heap_size);
+
+                        /* Publish the heap only once it has been created, so that frees from other threads never see it half-made. */
+                        this->heap_address = address;
                     }
                 }
 
@@ -96,13 +102,14 @@ namespace ams::mitm::fs {
                     if (this->outstanding_allocations == 0) {
                         std::scoped_lock lk(this->release_heap_lock);
 
-                        if (this->heap_address != 0) {
+                        if (const uintptr_t address = this->heap_address; address != 0) {
+                            /* Unpublish the heap before destroying it. */
+                            this->heap_address = 0;
+
                             util::DestroyAt(this->heap);
                             this->heap = {};
 
-                            R_ABORT_UNLESS(UnmapImpl(this->heap_address, this->heap_size));
-
-                            this->heap_address = 0;
+                            R_ABORT_UNLESS(UnmapImpl(address, this->heap_size));
                         }
                     }
                 }
@@ -117,10 +124,11 @@ namespace ams::mitm::fs {
 
                 bool TryFree(void *p) {
                     if (this->IsAllocated(p)) {
-                        --this->outstanding_allocations;
-
+                        /* Free before decrementing, so that the heap can't be released out from under us. */
                         util::GetReference(this->heap).Free(p);
 
+                        --this->outstanding_allocations;
+
                         return true;
                     } else {
                         return false;
@@ -128,9 +136,10 @@ namespace ams::mitm::fs {
                 }
 
                 bool IsAllocated(void *p) const {
-                    const uintptr_t address = reinterpret_cast<uintptr_t>(p);
+                    const uintptr_t address      = reinterpret_cast<uintptr_t>(p);
+                    const uintptr_t heap_address = this->heap_address;
 
-                    return this->heap_address != 0 && (this->heap_address <= address && address < this->heap_address + this->heap_size);
+                    return heap_address != 0 && (heap_address <= address && address < heap_address + this->heap_size);
                 }
 
                 void Reset() {
@@ -156,11 +165,49 @@ namespace ams::mitm::fs {
                 R_RETURN(os::SetMemoryHeapSize(0));
             }
 
+            /* Build slot globals. */
+            /* NOTE: Builds allocate heavily, and abort on allocation failure, so we bound how many may run at once. */
+            constexpr s32 RomfsConcurrentBuildCountMax = 2;
+
+            constinit os::SdkMutex g_romfs_build_slot_lock;
+            constinit os::SdkConditionVariable g_romfs_build_slot_cv;
+            constinit s32 g_romfs_build_slot_count = 0;
+            constinit s32 g_process_romfs_build_slot_waiter_count = 0;
+
+            void AcquireRomfsBuildSlot(bool is_process_romfs) {
+                std::scoped_lock lk(g_romfs_build_slot_lock);
+
+                if (is_process_romfs) {
+                    ++g_process_romfs_build_slot_waiter_count;
+                    while (g_romfs_build_slot_count >= RomfsConcurrentBuildCountMax) {
+                        g_romfs_build_slot_cv.Wait(g_romfs_build_slot_lock);
+                    }
+                    --g_process_romfs_build_slot_waiter_count;
+                } else {
+                    /* Data archives yield to any waiting process romfs, so that a launching program is never stuck behind them. */
+                    while (g_romfs_build_slot_count >= RomfsConcurrentBuildCountMax || g_process_romfs_build_slot_waiter_count > 0) {
+                        g_romfs_build_slot_cv.Wait(g_romfs_build_slot_lock);
+                    }
+                }
+
+                ++g_romfs_build_slot_count;
+            }
+
+            void ReleaseRomfsBuildSlot() {
+                std::scoped_lock lk(g_romfs_build_slot_lock);
+
+                AMS_ABORT_UNLESS(g_romfs_build_slot_count > 0);
+                --g_romfs_build_slot_count;
+
+                /* NOTE: Waiters have differing conditions, so we must wake all of them. */
+                g_romfs_build_slot_cv.Broadcast();
+            }
+
             /* Dynamic allocation globals. */
-            constinit os::SdkMutex g_romfs_build_lock;
             constinit ncm::ProgramId g_dynamic_heap_program_id{};
 
-            constinit bool g_building_from_dynamic_heap = false;
+            /* NOTE: Only the build for the dynamic heap program may allocate from dynamic heap. */
+            constinit std::atomic<os::ThreadType *> g_dynamic_heap_build_thread = nullptr;
 
             constinit DynamicHeap<os::AllocateUnsafeMemory, os::FreeUnsafeMemory> g_dynamic_app_heap;
             constinit DynamicHeap<MapByHeap, UnmapByHeap> g_dynamic_sys_heap;
@@ -168,7 +215,8 @@ namespace ams::mitm::fs {
             void InitializeDynamicHeapForBuildRomfs(ncm::ProgramId program_id) {
                 if (program_id == g_dynamic_heap_program_id && g_dynamic_app_heap.heap_size > 0) {
                     /* This romfs will build out of dynamic heap. */
-                    g_building_from_dynamic_heap = true;
+                    AMS_ABORT_UNLESS(g_dynamic_heap_build_thread == nullptr);
+                    g_dynamic_heap_build_thread = os::GetCurrentThread();
 
                     g_dynamic_app_heap.Map();
 
@@ -178,11 +226,21 @@ namespace ams::mitm::fs {
                 }
             }
 
+            ALWAYS_INLINE bool IsBuildingFromDynamicHeap() {
+                return g_dynamic_heap_build_thread == os::GetCurrentThread();
+            }
+
+            ALWAYS_INLINE bool IsAnyBuildingFromDynamicHeap() {
+                return g_dynamic_heap_build_thread != nullptr;
+            }
+
             void FinalizeDynamicHeapForBuildRomfs() {
-                /* We are definitely no longer building out of dynamic heap. */
-                g_building_from_dynamic_heap = false;
+                /* If we were building out of dynamic heap, we no longer are. */
+                if (IsBuildingFromDynamicHeap()) {
+                    g_dynamic_heap_build_thread = nullptr;
 
-                g_dynamic_app_heap.TryRelease();
+                    g_dynamic_app_heap.TryRelease();
+                }
             }
 
         }
@@ -190,7 +248,7 @@ namespace ams::mitm::fs {
         void *AllocateTracked(AllocationType type, size_t size) {
             AMS_UNUSED(type);
 
-            if (g_building_from_dynamic_heap) {
+            if (IsBuildingFromDynamicHeap()) {
                 void *ret = g_dynamic_app_heap.Allocate(size);
 
                 if (ret == nullptr && g_dynamic_sys_heap.heap_address != 0) {
@@ -212,11 +270,11 @@ namespace ams::mitm::fs {
             AMS_UNUSED(size);
 
             if (g_dynamic_app_heap.TryFree(p)) {
-                if (!g_building_from_dynamic_heap) {
+                if (!IsAnyBuildingFromDynamicHeap()) {
                     g_dynamic_app_heap.TryRelease();
                 }
             } else if (g_dynamic_sys_heap.TryFree(p)) {
-                if (!g_building_from_dynamic_heap) {
+                if (!IsAnyBuildingFromDynamicHeap()) {
                     g_dynamic_sys_heap.TryRelease();
                 }
             } else {
@@ -229,20 +287,6 @@ namespace ams::mitm::fs {
             constexpr u32 EmptyEntry = 0xFFFFFFFF;
             constexpr size_t FilePartitionOffset = 0x200;
 
-            struct Header {
-                s64 header_size;
-                s64 dir_hash_table_ofs;
-                s64 dir_hash_table_size;
-                s64 dir_table_ofs;
-                s64 dir_table_size;
-                s64 file_hash_table_ofs;
-                s64 file_hash_table_size;
-                s64 file_table_ofs;
-                s64 file_table_size;
-                s64 file_partition_ofs;
-            };
-            static_assert(util::is_pod<Header>::value && sizeof(Header) == 0x50);
-
             struct DirectoryEntry {
                 u32 parent;
                 u32 sibling;
@@ -511,12 +555,19 @@ namespace ams::mitm::fs {
 
         }
 
-        Builder::Builder(ncm::ProgramId pr_id) : m_program_id(pr_id), m_num_dirs(0), m_num_files(0), m_dir_table_size(0), m_file_table_size(0), m_dir_hash_table_size(0), m_file_hash_table_size(0), m_file_partition_size(0) {
-            /* Ensure only one romfs is built at any time. */
-            g_romfs_build_lock.Lock();
-
+        BuildHeapScope::BuildHeapScope(ncm::ProgramId program_id) {
             /* If we should be using dynamic heap, turn it on. */
-            InitializeDynamicHeapForBuildRomfs(m_program_id);
+            InitializeDynamicHeapForBuildRomfs(program_id);
+        }
+
+        BuildHeapScope::~BuildHeapScope() {
+            /* If we have nothing remaining in dynamic heap, release it. */
+            FinalizeDynamicHeapForBuildRomfs();
+        }
+
+        Builder::Builder(ncm::ProgramId pr_id, bool process_rom) : m_program_id(pr_id), m_num_dirs(0), m_num_files(0), m_dir_table_size(0), m_file_table_size(0), m_dir_hash_table_size(0), m_file_hash_table_size(0), m_file_partition_size(0) {
+            /* Wait until we may build. */
+            AcquireRomfsBuildSlot(process_rom);
 
             auto res = m_directories.emplace(std::unique_ptr<BuildDirectoryContext>(AllocateTyped<BuildDirectoryContext>(AllocationType_BuildDirContext, BuildDirectoryContext::RootTag{})));
             AMS_ABORT_UNLESS(res.second);
@@ -526,11 +577,11 @@ namespace ams::mitm::fs {
         }
 
         Builder::~Builder() {
-            /* If we have nothing remaining in dynamic heap, release it. */
-            FinalizeDynamicHeapForBuildRomfs();
+            /* Free our contexts before giving up our build slot, so that the slot bounds our memory use. */
+            m_files.clear();
+            m_directories.clear();
 
-            /* Release the romfs build lock. */
-            g_romfs_build_lock.Unlock();
+            ReleaseRomfsBuildSlot();
         }
 
 
@@ -672,7 +723,72 @@ namespace ams::mitm::fs {
         }
 
 
-        void Builder::AddSdFiles() {
+        class Builder::SdDirectoryVisitor {
+            NON_COPYABLE(SdDirectoryVisitor);
+            NON_MOVEABLE(SdDirectoryVisitor);
+            public:
+                using DirectoryType = BuildDirectoryContext;
+            private:
+                static constexpr size_t ReadEntryCount = 8;
+            private:
+                Builder *m_builder;
+                FsFileSystem *m_fs;
+            public:
+                SdDirectoryVisitor(Builder *builder, FsFileSystem *fs) : m_builder(builder), m_fs(fs) { /* ... */ }
+
+                Result ReadDirectory(DirectoryEntryList *out, BuildDirectoryContext *directory) {
+                    /* NOTE: We may be called on a scan thread, so we must use our own path buffer. */
+                    char path[fs::EntryNameLengthMax + 1];
+                    directory->GetPath(path);
+
+                    FsDir dir;
+                    R_TRY(mitm::fs::OpenAtmosphereRomfsDirectory(std::addressof(dir), m_builder->m_program_id, path, OpenDirectoryMode_All, m_fs));
+                    ON_SCOPE_EXIT { fsDirClose(std::addressof(dir)); };
+
+                    ::FsDirectoryEntry entries[ReadEntryCount];
+                    while (true) {
+                        s64 read_entries = 0;
+                        R_TRY(fsDirRead(std::addressof(dir), std::addressof(read_entries), ReadEntryCount, entries));
+                        if (read_entries == 0) {
+                            break;
+                        }
+
+                        for (s64 i = 0; i < read_entries; ++i) {
+                            const auto &entry = entries[i];
+
+                            AMS_ABORT_UNLESS(entry.type == FsDirEntryType_Dir || entry.type == FsDirEntryType_File);
+                            if (entry.type == FsDirEntryType_Dir) {
+                                R_UNLESS(out->AddDirectory(entry.name, strlen(entry.name)), fs::ResultAllocationMemoryFailedNew());
+                            } else /* if (entry.type == FsDirEntryType_File) */ {
+                                R_UNLESS(out->AddFile(entry.name, strlen(entry.name), entry.file_size), fs::ResultAllocationMemoryFailedNew());
+                            }
+                        }
+                    }
+
+                    R_SUCCEED();
+                }
+
+                BuildDirectoryContext *AddDirectory(BuildDirectoryContext *parent, const char *name, size_t name_len) {
+                    BuildDirectoryContext *real_child = nullptr;
+                    m_builder->AddDirectory(std::addressof(real_child), parent, std::unique_ptr<BuildDirectoryContext>(AllocateTyped<BuildDirectoryContext>(AllocationType_BuildDirContext, name, name_len)));
+                    AMS_ABORT_UNLESS(real_child != nullptr);
+                    return real_child;
+                }
+
+                void AddFile(BuildDirectoryContext *parent, const char *name, size_t name_len, s64 size) {
+                    m_builder->AddFile(parent, std::unique_ptr<BuildFileContext>(AllocateTyped<BuildFileContext>(AllocationType_BuildFileContext, name, name_len, size, 0, m_builder->m_cur_source_type)));
+                }
+
+                static void *Allocate(size_t size) {
+                    return AllocateTracked(AllocationType_DirScan, size);
+                }
+
+                static void Free(void *p, size_t size) {
+                    FreeTracked(AllocationType_DirScan, p, size);
+                }
+        };
+
+        void Builder::AddSdFiles(s32 scan_thread_count) {
             /* Open Sd Card filesystem. */
             FsFileSystem sd_filesystem;
             R_ABORT_UNLESS(fsOpenSdCardFileSystem(std::addressof(sd_filesystem)));
@@ -688,6 +804,19 @@ namespace ams::mitm::fs {
             }
 
             m_cur_source_type = DataSourceType::LooseSdFile;
+
+            /* Visit the tree, reading directories in parallel if we can. */
+            /* NOTE: The scanner merges entries in a fixed order, so the resulting romfs is identical either way. */
+            if (scan_thread_count > 0) {
+                SdDirectoryVisitor visitor(this, std::addressof(sd_filesystem));
+                ParallelDirectoryScanner<SdDirectoryVisitor> scanner(visitor);
+
+                if (R_SUCCEEDED(scanner.Scan(m_root, std::min(scan_thread_count, ParallelDirectoryScanner<SdDirectoryVisitor>::ThreadCountMax), AMS_GET_SYSTEM_THREAD_PRIORITY(mitm_fs, RomFileSystemScanThread)))) {
+                    return;
+                }
+            }
+
+            /* NOTE: If the scan failed part way, re-walking is safe, as entries we already have are merged rather than duplicated. */
             this->VisitDirectory(std::addressof(sd_filesystem), m_root);
         }
 
@@ -39,10 +39,25 @@ namespace ams::mitm::fs::romfs {
         AllocationType_DirContextSet,
         AllocationType_FileContextSet,
         AllocationType_Memory,
+        AllocationType_DirScan,
 
         AllocationType_Count,
     };
 
+    struct Header {
+        s64 header_size;
+        s64 dir_hash_table_ofs;
+        s64 dir_hash_table_size;
+        s64 dir_table_ofs;
+        s64 dir_table_size;
+        s64 file_hash_table_ofs;
+        s64 file_hash_table_size;
+        s64 file_table_ofs;
+        s64 file_table_size;
+        s64 file_partition_ofs;
+    };
+    static_assert(util::is_pod<Header>::value && sizeof(Header) == 0x50);
+
     void *AllocateTracked(AllocationType type, size_t size);
     void FreeTracked(AllocationType type, void *p, size_t size);
 
@@ -314,12 +329,25 @@ namespace ams::mitm::fs::romfs {
     class DirectoryTableReader;
     class FileTableReader;
 
+    /* NOTE: While this is alive, romfs allocations made by the current thread come from the program's dynamic heap, if it has one. */
+    class BuildHeapScope {
+        NON_COPYABLE(BuildHeapScope);
+        NON_MOVEABLE(BuildHeapScope);
+        public:
+            explicit BuildHeapScope(ncm::ProgramId program_id);
+            ~BuildHeapScope();
+    };
+
     class Builder {
         NON_COPYABLE(Builder);
         NON_MOVEABLE(Builder);
         public:
             using SourceInfoVector = std::vector<SourceInfo, TrackedAllocator<AllocationType_SourceInfo, SourceInfo>>;
+
+            static constexpr s32 DefaultSdScanThreadCount = 3;
         private:
+            class SdDirectoryVisitor;
+
             template<typename T>
             struct Comparator {
                 static constexpr inline int Compare(const char *a, const char *b) {
@@ -365,10 +393,10 @@ namespace ams::mitm::fs::romfs {
             void AddDirectory(BuildDirectoryContext **out, BuildDirectoryContext *parent_ctx, std::unique_ptr<BuildDirectoryContext> file_ctx);
             void AddFile(BuildDirectoryContext *parent_ctx, std::unique_ptr<BuildFileContext> file_ctx);
         public:
-            Builder(ncm::ProgramId pr_id);
+            Builder(ncm::ProgramId pr_id, bool process_rom);
             ~Builder();
 
-            void AddSdFiles();
+            void AddSdFiles(s32 scan_thread_count = DefaultSdScanThreadCount);
             void AddStorageFiles(ams::fs::IStorage *storage, DataSourceType source_type);
 
             void Build(SourceInfoVector *out_infos);
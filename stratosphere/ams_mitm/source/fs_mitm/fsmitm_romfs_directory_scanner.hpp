@@ -0,0 +1,396 @@
+/*
+ * Copyright (c) Atmosphère-NX
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include <stratosphere.hpp>
+
+namespace ams::mitm::fs::romfs {
+
+    /* Holds the entries read from a single directory, packed to keep memory use low for large directories. */
+    class DirectoryEntryList {
+        NON_COPYABLE(DirectoryEntryList);
+        NON_MOVEABLE(DirectoryEntryList);
+        public:
+            using AllocateFunction = void *(*)(size_t size);
+            using FreeFunction     = void (*)(void *p, size_t size);
+        private:
+            static constexpr size_t InitialCapacity = 4_KB;
+
+            struct EntryHeader {
+                s64 size;
+                u16 name_len;
+                bool is_directory;
+            };
+            static_assert(ams::fs::EntryNameLengthMax <= std::numeric_limits<u16>::max());
+        private:
+            AllocateFunction m_allocate;
+            FreeFunction m_free;
+            u8 *m_buffer;
+            size_t m_size;
+            size_t m_capacity;
+        public:
+            constexpr DirectoryEntryList(AllocateFunction allocate, FreeFunction free) : m_allocate(allocate), m_free(free), m_buffer(nullptr), m_size(0), m_capacity(0) { /* ... */ }
+
+            ~DirectoryEntryList() {
+                if (m_buffer != nullptr) {
+                    m_free(m_buffer, m_capacity);
+                }
+            }
+
+            /* NOTE: These return false if we fail to allocate space for the entry. */
+            bool AddDirectory(const char *name, size_t name_len) {
+                return this->AddEntry(name, name_len, 0, true);
+            }
+
+            bool AddFile(const char *name, size_t name_len, s64 size) {
+                return this->AddEntry(name, name_len, size, false);
+            }
+
+            /* NOTE: Iteration stops early if f returns false. */
+            template<typename F>
+            bool ForEach(F f) const {
+                size_t offset = 0;
+                while (offset < m_size) {
+                    const EntryHeader *header = reinterpret_cast<const EntryHeader *>(m_buffer + offset);
+                    const char *name          = reinterpret_cast<const char *>(header + 1);
+
+                    if (!f(header->is_directory, name, static_cast<size_t>(header->name_len), header->size)) {
+                        return false;
+                    }
+
+                    offset += GetEntrySize(header->name_len);
+                }
+
+                return true;
+            }
+        private:
+            static constexpr size_t GetEntrySize(size_t name_len) {
+                return util::AlignUp(sizeof(EntryHeader) + name_len, alignof(EntryHeader));
+            }
+
+            bool AddEntry(const char *name, size_t name_len, s64 size, bool is_directory) {
+                AMS_ABORT_UNLESS(name_len <= ams::fs::EntryNameLengthMax);
+
+                /* Ensure we have space for the entry. */
+                const size_t entry_size = GetEntrySize(name_len);
+                if (m_size + entry_size > m_capacity) {
+                    const size_t new_capacity = std::max(std::max(m_capacity * 2, InitialCapacity), m_size + entry_size);
+
+                    u8 *new_buffer = static_cast<u8 *>(m_allocate(new_capacity));
+                    if (new_buffer == nullptr) {
+                        return false;
+                    }
+
+                    if (m_buffer != nullptr) {
+                        std::memcpy(new_buffer, m_buffer, m_size);
+                        m_free(m_buffer, m_capacity);
+                    }
+
+                    m_buffer   = new_buffer;
+                    m_capacity = new_capacity;
+                }
+
+                /* Write the entry. */
+                EntryHeader *header  = reinterpret_cast<EntryHeader *>(m_buffer + m_size);
+                header->size         = size;
+                header->name_len     = static_cast<u16>(name_len);
+                header->is_directory = is_directory;
+                std::memcpy(header + 1, name, name_len);
+
+                m_size += entry_size;
+                return true;
+            }
+    };
+
+    /* Walks a directory tree, reading directories on worker threads while the calling thread merges their entries. */
+    /* Visitor must provide the following, where only ReadDirectory, Allocate and Free may be called from worker threads: */
+    /*   Result ReadDirectory(DirectoryEntryList *out, DirectoryType *directory);                            */
+    /*   DirectoryType *AddDirectory(DirectoryType *parent, const char *name, size_t name_len);              */
+    /*   void AddFile(DirectoryType *parent, const char *name, size_t name_len, s64 size);                   */
+    /*   static void *Allocate(size_t size);                                                                 */
+    /*   static void Free(void *p, size_t size);                                                             */
+    /* Entries are merged in breadth-first order regardless of which thread read them, so the result is deterministic. */
+    /* If memory for worker threads can't be allocated or they can't be created, directories are read on the calling thread. */
+    /* Any other allocation failure fails the scan, leaving whatever was merged so far in place. */
+    template<typename Visitor>
+    class ParallelDirectoryScanner {
+        NON_COPYABLE(ParallelDirectoryScanner);
+        NON_MOVEABLE(ParallelDirectoryScanner);
+        public:
+            using DirectoryType = typename Visitor::DirectoryType;
+
+            static constexpr s32 ThreadCountMax     = 8;
+            static constexpr size_t ThreadStackSize = 32_KB;
+
+            /* Directories are read at most this far ahead of the merge, to bound memory use on wide trees. */
+            static constexpr s32 ReadAheadCountMax = 64;
+        private:
+            enum class JobState : u8 {
+                Pending,
+                Reading,
+                Done,
+            };
+
+            struct Job : public util::IntrusiveListBaseNode<Job> {
+                DirectoryType *directory;
+                DirectoryEntryList entries;
+                Result result;
+                JobState state;
+
+                explicit Job(DirectoryType *d) : directory(d), entries(Visitor::Allocate, Visitor::Free), result(ResultSuccess()), state(JobState::Pending) { /* ... */ }
+            };
+
+            using JobList = typename util::IntrusiveListBaseTraits<Job>::ListType;
+        private:
+            Visitor &m_visitor;
+            os::ThreadType m_threads[ThreadCountMax];
+            void *m_thread_stacks;
+            size_t m_thread_stacks_size;
+            JobList m_jobs;
+            os::SdkMutex m_mutex;
+            os::SdkConditionVariable m_job_cv;
+            os::SdkConditionVariable m_done_cv;
+            s32 m_thread_count;
+            bool m_is_exiting;
+        public:
+            ParallelDirectoryScanner(Visitor &visitor) : m_visitor(visitor), m_thread_stacks(nullptr), m_thread_stacks_size(0), m_jobs(), m_mutex(), m_job_cv(), m_done_cv(), m_thread_count(0), m_is_exiting(false) { /* ... */ }
+
+            ~ParallelDirectoryScanner() {
+                this->StopThreads();
+                this->ClearJobs();
+            }
+
+            /* NOTE: With a thread count of zero, every directory is read on the calling thread. */
+            Result Scan(DirectoryType *root, s32 thread_count, s32 priority) {
+                AMS_ASSERT(0 <= thread_count && thread_count <= ThreadCountMax);
+
+                /* Start our workers, and ensure we stop them when we're done. */
+                this->StartThreads(thread_count, priority);
+                ON_SCOPE_EXIT {
+                    this->StopThreads();
+                    this->ClearJobs();
+                };
+
+                /* Begin with the root directory. */
+                {
+                    Job *root_job = CreateJob(root);
+                    R_UNLESS(root_job != nullptr, ams::fs::ResultAllocationMemoryFailedNew());
+
+                    m_jobs.push_back(*root_job);
+                }
+
+                JobList children;
+                ON_SCOPE_EXIT { DestroyJobs(children); };
+                while (!m_jobs.empty()) {
+                    /* Get the oldest job, reading it ourselves if no worker has. */
+                    Job *job = std::addressof(m_jobs.front());
+                    {
+                        std::scoped_lock lk(m_mutex);
+
+                        if (job->state == JobState::Pending) {
+                            this->ReadJob(job);
+                        }
+
+                        while (job->state != JobState::Done) {
+                            m_done_cv.Wait(m_mutex);
+                        }
+
+                        /* Removing the job moves the read-ahead window, so let our workers know. */
+                        m_jobs.pop_front();
+                        m_job_cv.Broadcast();
+                    }
+                    ON_SCOPE_EXIT { DestroyJob(job); };
+
+                    R_TRY(job->result);
+
+                    /* Merge the job's entries. */
+                    const bool merged = job->entries.ForEach([&](bool is_directory, const char *name, size_t name_len, s64 size) {
+                        if (is_directory) {
+                            Job *child = CreateJob(m_visitor.AddDirectory(job->directory, name, name_len));
+                            if (child == nullptr) {
+                                return false;
+                            }
+
+                            children.push_back(*child);
+                        } else {
+                            m_visitor.AddFile(job->directory, name, name_len, size);
+                        }
+
+                        return true;
+                    });
+                    R_UNLESS(merged, ams::fs::ResultAllocationMemoryFailedNew());
+
+                    /* Queue the job's children. */
+                    if (!children.empty()) {
+                        std::scoped_lock lk(m_mutex);
+
+                        m_jobs.splice(m_jobs.end(), children);
+                        m_job_cv.Broadcast();
+                    }
+                }
+
+                R_SUCCEED();
+            }
+        private:
+            static void ThreadEntry(void *arg) {
+                static_cast<ParallelDirectoryScanner *>(arg)->WorkerThread();
+            }
+
+            static Job *CreateJob(DirectoryType *directory) {
+                void *mem = Visitor::Allocate(sizeof(Job));
+                if (mem == nullptr) {
+                    return nullptr;
+                }
+
+                return std::construct_at(static_cast<Job *>(mem), directory);
+            }
+
+            static void DestroyJob(Job *job) {
+                std::destroy_at(job);
+                Visitor::Free(job, sizeof(Job));
+            }
+
+            static void DestroyJobs(JobList &jobs) {
+                while (!jobs.empty()) {
+                    Job *job = std::addressof(jobs.front());
+                    jobs.pop_front();
+                    DestroyJob(job);
+                }
+            }
+
+            void StartThreads(s32 thread_count, s32 priority) {
+                AMS_ABORT_UNLESS(m_thread_count == 0);
+
+                if (thread_count == 0) {
+                    return;
+                }
+
+                /* Allocate our stacks, reading on the calling thread if we can't. */
+                /* NOTE: The visitor's allocator makes no alignment guarantee, so we over-allocate and align ourselves. */
+                m_thread_stacks_size = ThreadStackSize * thread_count + os::ThreadStackAlignment;
+                m_thread_stacks      = Visitor::Allocate(m_thread_stacks_size);
+                if (m_thread_stacks == nullptr) {
+                    m_thread_stacks_size = 0;
+                    return;
+                }
+
+                u8 *stacks = reinterpret_cast<u8 *>(util::AlignUp(reinterpret_cast<uintptr_t>(m_thread_stacks), os::ThreadStackAlignment));
+
+                /* Start as many workers as we can; any we fail to create just leave more reads to the others. */
+                m_is_exiting = false;
+                for (s32 i = 0; i < thread_count; ++i) {
+                    if (R_FAILED(os::CreateThread(std::addressof(m_threads[m_thread_count]), ThreadEntry, this, stacks + ThreadStackSize * i, ThreadStackSize, priority))) {
+                        break;
+                    }
+
+                    os::SetThreadNamePointer(std::addressof(m_threads[m_thread_count]), AMS_GET_SYSTEM_THREAD_NAME(mitm_fs, RomFileSystemScanThread));
+                    os::StartThread(std::addressof(m_threads[m_thread_count]));
+                    ++m_thread_count;
+                }
+
+                if (m_thread_count == 0) {
+                    this->FreeThreadStacks();
+                }
+            }
+
+            void FreeThreadStacks() {
+                Visitor::Free(m_thread_stacks, m_thread_stacks_size);
+                m_thread_stacks      = nullptr;
+                m_thread_stacks_size = 0;
+            }
+
+            void StopThreads() {
+                if (m_thread_count == 0) {
+                    return;
+                }
+
+                /* Tell our workers to exit. */
+                {
+                    std::scoped_lock lk(m_mutex);
+
+                    m_is_exiting = true;
+                    m_job_cv.Broadcast();
+                }
+
+                /* Wait for our workers to exit. */
+                for (s32 i = 0; i < m_thread_count; ++i) {
+                    os::WaitThread(std::addressof(m_threads[i]));
+                    os::DestroyThread(std::addressof(m_threads[i]));
+                }
+                m_thread_count = 0;
+
+                this->FreeThreadStacks();
+            }
+
+            void ClearJobs() {
+                DestroyJobs(m_jobs);
+            }
+
+            Job *FindPendingJob() {
+                AMS_ASSERT(m_mutex.IsLockedByCurrentThread());
+
+                s32 position = 0;
+                for (auto &job : m_jobs) {
+                    if (position++ >= ReadAheadCountMax) {
+                        break;
+                    }
+
+                    if (job.state == JobState::Pending) {
+                        return std::addressof(job);
+                    }
+                }
+
+                return nullptr;
+            }
+
+            void ReadJob(Job *job) {
+                AMS_ASSERT(m_mutex.IsLockedByCurrentThread());
+                AMS_ASSERT(job->state == JobState::Pending);
+
+                /* Read the directory without holding our lock. */
+                job->state = JobState::Reading;
+                {
+                    m_mutex.Unlock();
+                    ON_SCOPE_EXIT { m_mutex.Lock(); };
+
+                    job->result = m_visitor.ReadDirectory(std::addressof(job->entries), job->directory);
+                }
+                job->state = JobState::Done;
+
+                m_done_cv.Broadcast();
+            }
+
+            void WorkerThread() {
+                std::scoped_lock lk(m_mutex);
+
+                while (true) {
+                    /* Wait for a job to become available. */
+                    Job *job = nullptr;
+                    while (!m_is_exiting && (job = this->FindPendingJob()) == nullptr) {
+                        m_job_cv.Wait(m_mutex);
+                    }
+
+                    /* If we're exiting, we're done. */
+                    if (job == nullptr) {
+                        break;
+                    }
+
+                    this->ReadJob(job);
+                }
+            }
+    };
+
+}
@@ -0,0 +1,542 @@
+/*
+ * Copyright (c) Atmosphère-NX
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stratosphere.hpp>
+#include "../amsmitm_fs_utils.hpp"
+#include "fsmitm_romfs_metadata_cache.hpp"
+
+namespace ams::mitm::fs::romfs {
+
+    using namespace ams::fs;
+
+    namespace {
+
+        constexpr const char CacheFileName[]    = "romfs_metadata_cache.bin";
+        constexpr const char MetadataFileName[] = "romfs_metadata.bin";
+
+        constexpr u32 CacheMagic   = util::FourCC<'R','F','M','C'>::Code;
+        constexpr u32 CacheVersion = 0;
+
+        struct CacheHeader {
+            u32 magic;
+            u32 version;
+            MetadataCacheKey key;
+            s64 metadata_size;
+            u32 source_info_count;
+            u32 data_size;
+            u8 reserved[8];
+        };
+        static_assert(util::is_pod<CacheHeader>::value && sizeof(CacheHeader) == 0x40);
+
+        struct CacheSourceInfo {
+            s64 virtual_offset;
+            s64 size;
+            s64 argument;
+            DataSourceType source_type;
+            u8 reserved[7];
+        };
+        static_assert(util::is_pod<CacheSourceInfo>::value && sizeof(CacheSourceInfo) == 0x20);
+
+        /* Sanity limits, to avoid trusting a corrupted cache with huge allocations. */
+        constexpr u32 SourceInfoCountMax = 0x100000;
+        constexpr u32 DataSizeMax        = 64_MB;
+
+        class MetadataCacheKeyCalculator {
+            NON_COPYABLE(MetadataCacheKeyCalculator);
+            NON_MOVEABLE(MetadataCacheKeyCalculator);
+            private:
+                static constexpr size_t DirectoryEntryBufferCount = 0x10;
+                static constexpr size_t StorageBufferSize         = 16_KB;
+            private:
+                crypto::Sha256Generator m_generator;
+                ncm::ProgramId m_program_id;
+                char m_path[EntryNameLengthMax + 1];
+            public:
+                MetadataCacheKeyCalculator(ncm::ProgramId program_id) : m_program_id(program_id) {
+                    m_generator.Initialize();
+                    this->Update(CacheVersion);
+                    this->Update(m_program_id.value);
+                }
+
+                void GetKey(MetadataCacheKey *out) {
+                    m_generator.GetHash(out->hash, sizeof(out->hash));
+                }
+
+                template<typename T> requires std::is_trivially_copyable<T>::value
+                void Update(const T &value) {
+                    m_generator.Update(std::addressof(value), sizeof(value));
+                }
+
+                bool UpdateWithSdFiles() {
+                    /* Open the sd card filesystem. */
+                    FsFileSystem sd_filesystem;
+                    if (R_FAILED(fsOpenSdCardFileSystem(std::addressof(sd_filesystem)))) {
+                        return false;
+                    }
+                    ON_SCOPE_EXIT { fsFsClose(std::addressof(sd_filesystem)); };
+
+                    /* Allocate a buffer for reading directory entries. */
+                    FsDirectoryEntry *entries = static_cast<FsDirectoryEntry *>(AllocateTracked(AllocationType_DirPointerArray, sizeof(FsDirectoryEntry) * DirectoryEntryBufferCount));
+                    if (entries == nullptr) {
+                        return false;
+                    }
+                    ON_SCOPE_EXIT { FreeTracked(AllocationType_DirPointerArray, entries, sizeof(FsDirectoryEntry) * DirectoryEntryBufferCount); };
+
+                    /* If there's no romfs folder, there's nothing to visit. */
+                    m_path[0] = '\x00';
+
+                    FsDir dir;
+                    if (R_FAILED(mitm::fs::OpenAtmosphereRomfsDirectory(std::addressof(dir), m_program_id, m_path, OpenDirectoryMode_All, std::addressof(sd_filesystem)))) {
+                        this->Update(false);
+                        return true;
+                    }
+
+                    this->Update(true);
+                    return this->VisitDirectory(std::addressof(sd_filesystem), std::addressof(dir), entries, 0);
+                }
+
+                bool UpdateWithStorage(ams::fs::IStorage *storage) {
+                    /* Note whether we have the storage. */
+                    this->Update(storage != nullptr);
+                    if (storage == nullptr) {
+                        return true;
+                    }
+
+                    /* Hash the header. */
+                    Header header;
+                    if (R_FAILED(storage->Read(0, std::addressof(header), sizeof(header)))) {
+                        return false;
+                    }
+                    this->Update(header);
+
+                    /* Allocate a buffer for reading the tables. */
+                    void *buffer = AllocateTracked(AllocationType_TableCache, StorageBufferSize);
+                    if (buffer == nullptr) {
+                        return false;
+                    }
+                    ON_SCOPE_EXIT { FreeTracked(AllocationType_TableCache, buffer, StorageBufferSize); };
+
+                    /* Hash the directory and file tables, which describe every file in the storage. */
+                    return this->UpdateWithStorageRange(storage, buffer, header.dir_table_ofs, header.dir_table_size) && this->UpdateWithStorageRange(storage, buffer, header.file_table_ofs, header.file_table_size);
+                }
+            private:
+                bool UpdateWithStorageRange(ams::fs::IStorage *storage, void *buffer, s64 offset, s64 size) {
+                    if (offset < 0 || size < 0) {
+                        return false;
+                    }
+
+                    while (size > 0) {
+                        const size_t cur_size = static_cast<size_t>(std::min<s64>(size, StorageBufferSize));
+                        if (R_FAILED(storage->Read(offset, buffer, cur_size))) {
+                            return false;
+                        }
+                        m_generator.Update(buffer, cur_size);
+
+                        offset += cur_size;
+                        size   -= cur_size;
+                    }
+
+                    return true;
+                }
+
+                bool UpdateWithFile(size_t path_len, const FsDirectoryEntry &entry) {
+                    /* Hash the file's path and size. */
+                    /* NOTE: Loose files are read by path when the romfs is read, so their contents don't affect the built metadata. */
+                    const size_t name_len = strnlen(entry.name, sizeof(entry.name));
+                    if (path_len + 1 + name_len > EntryNameLengthMax) {
+                        return false;
+                    }
+
+                    m_path[path_len] = '/';
+                    std::memcpy(m_path + path_len + 1, entry.name, name_len);
+                    m_path[path_len + 1 + name_len] = '\x00';
+                    ON_SCOPE_EXIT { m_path[path_len] = '\x00'; };
+
+                    m_generator.Update(m_path, path_len + 1 + name_len + 1);
+                    this->Update(entry.file_size);
+
+                    return true;
+                }
+
+                bool VisitDirectory(FsFileSystem *fs, FsDirectoryEntry *entries, size_t path_len) {
+                    FsDir dir;
+                    if (R_FAILED(mitm::fs::OpenAtmosphereRomfsDirectory(std::addressof(dir), m_program_id, m_path, OpenDirectoryMode_All, fs))) {
+                        return false;
+                    }
+
+                    return this->VisitDirectory(fs, std::addressof(dir), entries, path_len);
+                }
+
+                bool VisitDirectory(FsFileSystem *fs, FsDir *dir, FsDirectoryEntry *entries, size_t path_len) {
+                    /* Hash all files in the directory, and gather the names of its child directories, in a single pass. */
+                    /* NOTE: We can't hold our directory open while visiting children, so we close it before doing so. */
+                    char *child_names = nullptr;
+                    size_t child_names_size = 0;
+                    size_t child_names_capacity = 0;
+                    ON_SCOPE_EXIT { if (child_names != nullptr) { FreeTracked(AllocationType_DirName, child_names, child_names_capacity); } };
+                    {
+                        ON_SCOPE_EXIT { fsDirClose(dir); };
+
+                        while (true) {
+                            s64 read_entries = 0;
+                            if (R_FAILED(fsDirRead(dir, std::addressof(read_entries), DirectoryEntryBufferCount, entries))) {
+                                return false;
+                            }
+                            if (read_entries == 0) {
+                                break;
+                            }
+
+                            for (s64 i = 0; i < read_entries; ++i) {
+                                if (entries[i].type == FsDirEntryType_File) {
+                                    if (!this->UpdateWithFile(path_len, entries[i])) {
+                                        return false;
+                                    }
+                                    continue;
+                                }
+
+                                /* Append the child's name, growing our buffer as needed. */
+                                const size_t name_size = strnlen(entries[i].name, sizeof(entries[i].name)) + 1;
+                                if (child_names_size + name_size > child_names_capacity) {
+                                    const size_t new_capacity = std::max(child_names_capacity * 2, child_names_size + std::max<size_t>(name_size, DirectoryEntryBufferCount * (EntryNameLengthMax + 1)));
+
+                                    char *new_names = static_cast<char *>(AllocateTracked(AllocationType_DirName, new_capacity));
+                                    if (new_names == nullptr) {
+                                        return false;
+                                    }
+
+                                    if (child_names != nullptr) {
+                                        std::memcpy(new_names, child_names, child_names_size);
+                                        FreeTracked(AllocationType_DirName, child_names, child_names_capacity);
+                                    }
+
+                                    child_names          = new_names;
+                                    child_names_capacity = new_capacity;
+                                }
+
+                                std::memcpy(child_names + child_names_size, entries[i].name, name_size - 1);
+                                child_names[child_names_size + name_size - 1] = '\x00';
+                                child_names_size += name_size;
+                            }
+                        }
+                    }
+
+                    /* Visit all child directories. */
+                    for (size_t offset = 0; offset < child_names_size; /* ... */) {
+                        const char *name = child_names + offset;
+                        const size_t name_len = std::strlen(name);
+                        offset += name_len + 1;
+
+                        if (path_len + 1 + name_len > EntryNameLengthMax) {
+                            return false;
+                        }
+
+                        m_path[path_len] = '/';
+                        std::memcpy(m_path + path_len + 1, name, name_len);
+                        m_path[path_len + 1 + name_len] = '\x00';
+                        ON_SCOPE_EXIT { m_path[path_len] = '\x00'; };
+
+                        /* Hash the directory's path, so that empty directories are accounted for. */
+                        m_generator.Update(m_path, path_len + 1 + name_len + 1);
+
+                        if (!this->VisitDirectory(fs, entries, path_len + 1 + name_len)) {
+                            return false;
+                        }
+                    }
+
+                    return true;
+                }
+        };
+
+        void CleanupSourceInfos(Builder::SourceInfoVector *infos) {
+            for (auto &info : *infos) {
+                info.Cleanup();
+            }
+            infos->clear();
+        }
+
+        bool LoadMetadataCacheImpl(Builder::SourceInfoVector *out_infos, ::FsFile *cache_file, ncm::ProgramId program_id, const MetadataCacheKey &key) {
+            /* Read and validate the header. */
+            CacheHeader header;
+            {
+                u64 read_size = 0;
+                if (R_FAILED(fsFileRead(cache_file, 0, std::addressof(header), sizeof(header), FsReadOption_None, std::addressof(read_size))) || read_size != sizeof(header)) {
+                    return false;
+                }
+            }
+
+            if (header.magic != CacheMagic || header.version != CacheVersion) {
+                return false;
+            }
+            if (!crypto::IsSameBytes(header.key.hash, key.hash, sizeof(key.hash))) {
+                return false;
+            }
+            if (header.source_info_count == 0 || header.source_info_count > SourceInfoCountMax || header.data_size > DataSizeMax) {
+                return false;
+            }
+
+            /* Check that the metadata we refer to is still present, and the right size. */
+            ::FsFile metadata_file;
+            if (R_FAILED(mitm::fs::OpenAtmosphereSdFile(std::addressof(metadata_file), program_id, MetadataFileName, OpenMode_Read))) {
+                return false;
+            }
+            auto metadata_guard = SCOPE_GUARD { fsFileClose(std::addressof(metadata_file)); };
+            {
+                s64 metadata_size = 0;
+                if (R_FAILED(fsFileGetSize(std::addressof(metadata_file), std::addressof(metadata_size))) || metadata_size != header.metadata_size) {
+                    return false;
+                }
+            }
+
+            /* Read the source infos and their data. */
+            const size_t body_size = header.source_info_count * sizeof(CacheSourceInfo) + header.data_size;
+            u8 *body = static_cast<u8 *>(AllocateTracked(AllocationType_TableCache, body_size));
+            if (body == nullptr) {
+                return false;
+            }
+            ON_SCOPE_EXIT { FreeTracked(AllocationType_TableCache, body, body_size); };
+            {
+                u64 read_size = 0;
+                if (R_FAILED(fsFileRead(cache_file, sizeof(header), body, body_size, FsReadOption_None, std::addressof(read_size))) || read_size != body_size) {
+                    return false;
+                }
+            }
+
+            const CacheSourceInfo *cache_infos = reinterpret_cast<const CacheSourceInfo *>(body);
+            const u8 *data = body + header.source_info_count * sizeof(CacheSourceInfo);
+
+            /* Reconstruct the source infos. */
+            out_infos->clear();
+            out_infos->reserve(header.source_info_count);
+
+            auto info_guard = SCOPE_GUARD { CleanupSourceInfos(out_infos); };
+            for (u32 i = 0; i < header.source_info_count; ++i) {
+                const auto &cache_info = cache_infos[i];
+
+                /* Validate the extents. */
+                if (cache_info.virtual_offset < 0 || cache_info.size < 0) {
+                    return false;
+                }
+                if (!out_infos->empty() && cache_info.virtual_offset < out_infos->back().virtual_offset + out_infos->back().size) {
+                    return false;
+                }
+
+                switch (cache_info.source_type) {
+                    case DataSourceType::Storage:
+                    case DataSourceType::File:
+                        out_infos->emplace_back(cache_info.virtual_offset, cache_info.size, cache_info.source_type, cache_info.argument);
+                        break;
+                    case DataSourceType::LooseSdFile:
+                        {
+                            /* Validate the path. */
+                            if (cache_info.argument < 0 || static_cast<u64>(cache_info.argument) >= header.data_size) {
+                                return false;
+                            }
+
+                            const char *src_path = reinterpret_cast<const char *>(data + cache_info.argument);
+                            const size_t path_len = strnlen(src_path, header.data_size - cache_info.argument);
+                            if (path_len == header.data_size - cache_info.argument || path_len > EntryNameLengthMax) {
+                                return false;
+                            }
+
+                            char *path = static_cast<char *>(AllocateTracked(AllocationType_FullPath, path_len + 1));
+                            if (path == nullptr) {
+                                return false;
+                            }
+                            std::memcpy(path, src_path, path_len + 1);
+
+                            out_infos->emplace_back(cache_info.virtual_offset, cache_info.size, cache_info.source_type, path);
+                        }
+                        break;
+                    case DataSourceType::Memory:
+                        {
+                            /* Validate the data. */
+                            if (cache_info.argument < 0 || static_cast<u64>(cache_info.argument) > header.data_size || static_cast<u64>(cache_info.size) > header.data_size - cache_info.argument) {
+                                return false;
+                            }
+
+                            u8 *mem = static_cast<u8 *>(AllocateTracked(AllocationType_Memory, cache_info.size));
+                            if (mem == nullptr) {
+                                return false;
+                            }
+                            std::memcpy(mem, data + cache_info.argument, cache_info.size);
+
+                            out_infos->emplace_back(cache_info.virtual_offset, cache_info.size, cache_info.source_type, mem);
+                        }
+                        break;
+                    case DataSourceType::Metadata:
+                        {
+                            /* The metadata file must be the last source, and match the file we opened. */
+                            if (i != header.source_info_count - 1 || cache_info.size != header.metadata_size) {
+                                return false;
+                            }
+
+                            metadata_guard.Cancel();
+                            out_infos->emplace_back(cache_info.virtual_offset, cache_info.size, cache_info.source_type, new RemoteFile(metadata_file));
+                        }
+                        break;
+                    default:
+                        return false;
+                }
+            }
+
+            /* We must have ended with the metadata. */
+            if (out_infos->back().source_type != DataSourceType::Metadata) {
+                return false;
+            }
+
+            info_guard.Cancel();
+            return true;
+        }
+
+    }
+
+    bool CalculateMetadataCacheKey(MetadataCacheKey *out, ncm::ProgramId program_id, bool has_sd_files, ams::fs::IStorage *file_romfs, ams::fs::IStorage *storage_romfs) {
+        MetadataCacheKeyCalculator calculator(program_id);
+
+        /* Hash the layered sources, in the order the builder adds them. */
+        calculator.Update(has_sd_files);
+        if (has_sd_files && !calculator.UpdateWithSdFiles()) {
+            return false;
+        }
+        if (!calculator.UpdateWithStorage(file_romfs)) {
+            return false;
+        }
+        if (!calculator.UpdateWithStorage(storage_romfs)) {
+            return false;
+        }
+
+        calculator.GetKey(out);
+        return true;
+    }
+
+    bool LoadMetadataCache(Builder::SourceInfoVector *out_infos, ncm::ProgramId program_id, const MetadataCacheKey &key) {
+        /* Open the cache file. */
+        ::FsFile cache_file;
+        if (R_FAILED(mitm::fs::OpenAtmosphereSdFile(std::addressof(cache_file), program_id, CacheFileName, OpenMode_Read))) {
+            return false;
+        }
+        ON_SCOPE_EXIT { fsFileClose(std::addressof(cache_file)); };
+
+        return LoadMetadataCacheImpl(out_infos, std::addressof(cache_file), program_id, key);
+    }
+
+    void SaveMetadataCache(ncm::ProgramId program_id, const MetadataCacheKey &key, const Builder::SourceInfoVector &infos) {
+        /* We expect the builder's output to end with the metadata file. */
+        if (infos.empty() || infos.back().source_type != DataSourceType::Metadata) {
+            return;
+        }
+
+        /* Determine the size of the data following the source infos. */
+        size_t data_size = 0;
+        for (const auto &info : infos) {
+            switch (info.source_type) {
+                case DataSourceType::LooseSdFile:
+                    data_size += std::strlen(info.loose_source_info.path) + 1;
+                    break;
+                case DataSourceType::Memory:
+                    data_size += info.size;
+                    break;
+                default:
+                    break;
+            }
+        }
+
+        if (infos.size() > SourceInfoCountMax || data_size > DataSizeMax) {
+            return;
+        }
+
+        /* Allocate a buffer for the source infos and their data. */
+        const size_t body_size = infos.size() * sizeof(CacheSourceInfo) + data_size;
+        u8 *body = static_cast<u8 *>(AllocateTracked(AllocationType_TableCache, body_size));
+        if (body == nullptr) {
+            return;
+        }
+        ON_SCOPE_EXIT { FreeTracked(AllocationType_TableCache, body, body_size); };
+
+        /* Serialize the source infos. */
+        CacheSourceInfo *cache_infos = reinterpret_cast<CacheSourceInfo *>(body);
+        u8 *data = body + infos.size() * sizeof(CacheSourceInfo);
+        size_t data_offset = 0;
+        for (size_t i = 0; i < infos.size(); ++i) {
+            const auto &info = infos[i];
+            auto &cache_info = cache_infos[i];
+
+            std::memset(std::addressof(cache_info), 0, sizeof(cache_info));
+            cache_info.virtual_offset = info.virtual_offset;
+            cache_info.size           = info.size;
+            cache_info.source_type    = info.source_type;
+
+            switch (info.source_type) {
+                case DataSourceType::Storage:
+                    cache_info.argument = info.storage_source_info.offset;
+                    break;
+                case DataSourceType::File:
+                    cache_info.argument = info.file_source_info.offset;
+                    break;
+                case DataSourceType::LooseSdFile:
+                    {
+                        const size_t path_size = std::strlen(info.loose_source_info.path) + 1;
+                        std::memcpy(data + data_offset, info.loose_source_info.path, path_size);
+
+                        cache_info.argument = data_offset;
+                        data_offset += path_size;
+                    }
+                    break;
+                case DataSourceType::Memory:
+                    std::memcpy(data + data_offset, info.memory_source_info.data, info.size);
+
+                    cache_info.argument = data_offset;
+                    data_offset += info.size;
+                    break;
+                case DataSourceType::Metadata:
+                    break;
+                AMS_UNREACHABLE_DEFAULT_CASE();
+            }
+        }
+        AMS_ABORT_UNLESS(data_offset == data_size);
+
+        /* Set up the header. */
+        const CacheHeader header = {
+            .magic             = CacheMagic,
+            .version           = CacheVersion,
+            .key               = key,
+            .metadata_size     = infos.back().size,
+            .source_info_count = static_cast<u32>(infos.size()),
+            .data_size         = static_cast<u32>(data_size),
+        };
+
+        /* Write the cache file, writing the header last so that an interrupted write leaves an invalid cache. */
+        ::FsFile cache_file;
+        if (R_FAILED(mitm::fs::CreateAndOpenAtmosphereSdFile(std::addressof(cache_file), program_id, CacheFileName, sizeof(header) + body_size))) {
+            return;
+        }
+        ON_SCOPE_EXIT { fsFileClose(std::addressof(cache_file)); };
+
+        if (R_FAILED(fsFileWrite(std::addressof(cache_file), sizeof(header), body, body_size, FsWriteOption_Flush))) {
+            return;
+        }
+        fsFileWrite(std::addressof(cache_file), 0, std::addressof(header), sizeof(header), FsWriteOption_Flush);
+    }
+
+    void InvalidateMetadataCache(ncm::ProgramId program_id) {
+        /* Truncate the cache file, if there is one. */
+        ::FsFile cache_file;
+        if (R_SUCCEEDED(mitm::fs::OpenAtmosphereSdFile(std::addressof(cache_file), program_id, CacheFileName, OpenMode_Write))) {
+            fsFileSetSize(std::addressof(cache_file), 0);
+            fsFileClose(std::addressof(cache_file));
+        }
+    }
+
+}
@@ -0,0 +1,33 @@
+/*
+ * Copyright (c) Atmosphère-NX
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <stratosphere.hpp>
+#include "fsmitm_romfs.hpp"
+
+namespace ams::mitm::fs::romfs {
+
+    struct MetadataCacheKey {
+        u8 hash[crypto::Sha256Generator::HashSize];
+    };
+
+    /* NOTE: These must only be called while a BuildHeapScope is alive, so that allocations come from the build heap. */
+    bool CalculateMetadataCacheKey(MetadataCacheKey *out, ncm::ProgramId program_id, bool has_sd_files, ams::fs::IStorage *file_romfs, ams::fs::IStorage *storage_romfs);
+
+    bool LoadMetadataCache(Builder::SourceInfoVector *out_infos, ncm::ProgramId program_id, const MetadataCacheKey &key);
+    void SaveMetadataCache(ncm::ProgramId program_id, const MetadataCacheKey &key, const Builder::SourceInfoVector &infos);
+    void InvalidateMetadataCache(ncm::ProgramId program_id);
+
+}
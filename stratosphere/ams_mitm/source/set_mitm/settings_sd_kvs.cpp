@@ -325,6 +325,10 @@ namespace ams::settings::fwdbg {
             /* Note that this setting does nothing when log manager is not enabled/sd card logging is not enabled. */
             R_ABORT_UNLESS(ParseSettingsItemValue("lm", "sd_card_log_output_directory", "str!atmosphere/binlogs"));
 
+            /* Control whether SD card logs are written as LZ4-compressed blocks. */
+            /* Note that this setting does nothing when log manager is not enabled/sd card logging is not enabled. */
+            R_ABORT_UNLESS(ParseSettingsItemValue("lm", "enable_sd_card_log_compression", "u8!0x0"));
+
             /* Control whether erpt reports should always be preserved, instead of automatically cleaning periodically. */
             /* 0 = Disabled, 1 = Enabled */
             R_ABORT_UNLESS(ParseSettingsItemValue("erpt", "disable_automatic_report_cleanup", "u8!0x0"));
@@ -359,6 +363,11 @@ namespace ams::settings::fwdbg {
             /* If you do not know what you are doing, do not touch this yet. */
             R_ABORT_UNLESS(ParseSettingsItemValue("atmosphere", "fsmitm_redirect_saves_to_sd", "u8!0x0"));
 
+            /* Controls how many threads fs.mitm uses to build layeredfs romfs. */
+            /* Romfs for launching programs is always built before data archives. */
+            /* 1 = Build one romfs at a time, up to 4. */
+            R_ABORT_UNLESS(ParseSettingsItemValue("atmosphere", "fsmitm_romfs_build_thread_count", "u8!0x2"));
+
             /* Controls whether am sees system settings "DebugModeFlag" as */
             /* enabled or disabled. */
             /* 0 = Disabled (not debug mode), 1 = Enabled (debug mode) */
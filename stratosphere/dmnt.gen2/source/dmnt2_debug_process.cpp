@@ -64,6 +64,8 @@ namespace ams::dmnt {
             m_debug_handle = svc::InvalidHandle;
         }
 
+        this->InvalidateMemoryCache();
+
         m_is_valid = false;
     }
 
@@ -289,13 +291,82 @@ namespace ams::dmnt {
     }
 
     Result DebugProcess::ReadMemory(void *dst, uintptr_t address, size_t size) {
-        R_RETURN(svc::ReadDebugProcessMemory(reinterpret_cast<uintptr_t>(dst), m_debug_handle, address, size));
+        /* Memory may change while the process runs, so we only use our cache while it's broken. */
+        if (m_status != ProcessStatus_DebugBreak) {
+            R_RETURN(svc::ReadDebugProcessMemory(reinterpret_cast<uintptr_t>(dst), m_debug_handle, address, size));
+        }
+
+        std::scoped_lock lk(m_memory_cache_mutex);
+
+        u8 *dst_u8 = static_cast<u8 *>(dst);
+        while (size > 0) {
+            const uintptr_t page_address = util::AlignDown(address, os::MemoryPageSize);
+            const size_t offset          = address - page_address;
+            const size_t cur_size        = std::min(size, os::MemoryPageSize - offset);
+
+            if (const auto *page = this->GetMemoryCachePage(page_address); page != nullptr) {
+                std::memcpy(dst_u8, page->data + offset, cur_size);
+            } else {
+                /* If we can't read the whole page, read exactly what we were asked for. */
+                R_TRY(svc::ReadDebugProcessMemory(reinterpret_cast<uintptr_t>(dst_u8), m_debug_handle, address, cur_size));
+            }
+
+            address += cur_size;
+            dst_u8  += cur_size;
+            size    -= cur_size;
+        }
+
+        R_SUCCEED();
     }
 
     Result DebugProcess::WriteMemory(const void *src, uintptr_t address, size_t size) {
+        this->InvalidateMemoryCache(address, size);
+
         R_RETURN(svc::WriteDebugProcessMemory(m_debug_handle, reinterpret_cast<uintptr_t>(src), address, size));
     }
 
+    const DebugProcess::MemoryCachePage *DebugProcess::GetMemoryCachePage(uintptr_t page_address) {
+        /* Check if we already have the page. */
+        for (const auto &page : m_memory_cache) {
+            if (page.is_valid && page.address == page_address) {
+                return std::addressof(page);
+            }
+        }
+
+        /* Read the page, so that a failed read doesn't evict anything. */
+        if (R_FAILED(svc::ReadDebugProcessMemory(reinterpret_cast<uintptr_t>(m_memory_cache_read_buffer), m_debug_handle, page_address, sizeof(m_memory_cache_read_buffer)))) {
+            return nullptr;
+        }
+
+        /* Replace our oldest page. */
+        auto &page = m_memory_cache[m_memory_cache_next_index];
+        m_memory_cache_next_index = (m_memory_cache_next_index + 1) % MemoryCachePageCount;
+
+        std::memcpy(page.data, m_memory_cache_read_buffer, sizeof(page.data));
+        page.address  = page_address;
+        page.is_valid = true;
+
+        return std::addressof(page);
+    }
+
+    void DebugProcess::InvalidateMemoryCache() {
+        std::scoped_lock lk(m_memory_cache_mutex);
+
+        for (auto &page : m_memory_cache) {
+            page.is_valid = false;
+        }
+    }
+
+    void DebugProcess::InvalidateMemoryCache(uintptr_t address, size_t size) {
+        std::scoped_lock lk(m_memory_cache_mutex);
+
+        for (auto &page : m_memory_cache) {
+            if (page.is_valid && page.address < address + size && address < page.address + os::MemoryPageSize) {
+                page.is_valid = false;
+            }
+        }
+    }
+
     Result DebugProcess::QueryMemory(svc::MemoryInfo *out, uintptr_t address) {
         svc::PageInfo dummy;
         R_RETURN(svc::QueryDebugProcessMemory(out, std::addressof(dummy), m_debug_handle, address));
@@ -304,6 +375,8 @@ namespace ams::dmnt {
     Result DebugProcess::Continue() {
         AMS_DMNT2_GDB_LOG_DEBUG("DebugProcess::Continue() all\n");
 
+        this->InvalidateMemoryCache();
+
         u64 thread_ids[] = { 0 };
         R_TRY(svc::ContinueDebugEvent(m_debug_handle, svc::ContinueFlag_ExceptionHandled | svc::ContinueFlag_EnableExceptionEvent | svc::ContinueFlag_ContinueAll, thread_ids, util::size(thread_ids)));
 
@@ -319,6 +392,8 @@ namespace ams::dmnt {
     Result DebugProcess::Continue(u64 thread_id) {
         AMS_DMNT2_GDB_LOG_DEBUG("DebugProcess::Continue() thread_id=%lx\n", thread_id);
 
+        this->InvalidateMemoryCache();
+
         u64 thread_ids[] = { thread_id };
         R_TRY(svc::ContinueDebugEvent(m_debug_handle, svc::ContinueFlag_ExceptionHandled | svc::ContinueFlag_EnableExceptionEvent, thread_ids, util::size(thread_ids)));
 
@@ -339,6 +414,8 @@ namespace ams::dmnt {
     Result DebugProcess::Step(u64 thread_id) {
         AMS_DMNT2_GDB_LOG_DEBUG("DebugProcess::Step() thread_id=%lx\n", thread_id);
 
+        this->InvalidateMemoryCache();
+
         /* Get the thread context. */
         svc::ThreadContext ctx;
         R_TRY(this->GetThreadContext(std::addressof(ctx), thread_id, svc::ThreadContextFlag_Control));
@@ -27,6 +27,8 @@ namespace ams::dmnt {
         public:
             static constexpr size_t ThreadCountMax = 0x100;
             static constexpr size_t ModuleCountMax = 0x60;
+            /* NOTE: Together with the buffer pages are read into, the cache takes 32KB of DebugProcess (and thus GdbServerImpl). */
+            static constexpr size_t MemoryCachePageCount = 7;
 
             enum ProcessStatus {
                 ProcessStatus_DebugBreak,
@@ -39,6 +41,12 @@ namespace ams::dmnt {
                 ContinueMode_Continue,
                 ContinueMode_Step,
             };
+        private:
+            struct MemoryCachePage {
+                uintptr_t address;
+                bool is_valid;
+                alignas(0x10) u8 data[os::MemoryPageSize];
+            };
         private:
             os::NativeHandle m_debug_handle{os::InvalidNativeHandle};
             s32 m_thread_count{0};
@@ -76,6 +84,10 @@ namespace ams::dmnt {
             ncm::ProgramLocation m_program_location{};
             cfg::OverrideStatus m_process_override_status{};
             bool m_is_application{false};
+            os::SdkMutex m_memory_cache_mutex{};
+            size_t m_memory_cache_next_index{};
+            MemoryCachePage m_memory_cache[MemoryCachePageCount]{};
+            alignas(0x10) u8 m_memory_cache_read_buffer[os::MemoryPageSize]{};
         public:
             DebugProcess() : m_software_breakpoints(this), m_hardware_breakpoints(this), m_hardware_watchpoints(this), m_step_breakpoints(m_software_breakpoints) {
                 if (svc::IsKernelMesosphere()) {
@@ -187,6 +199,10 @@ namespace ams::dmnt {
 
             s32 ThreadCreate(u64 thread_id);
             void ThreadExit(u64 thread_id);
+
+            const MemoryCachePage *GetMemoryCachePage(uintptr_t page_address);
+            void InvalidateMemoryCache();
+            void InvalidateMemoryCache(uintptr_t address, size_t size);
     };
 
 }
\ No newline at end of file
@@ -23,6 +23,13 @@ namespace ams::dmnt {
 
         constexpr char BreakCharacter = '\x03'; /* ctrl-c */
 
+        constexpr char EscapeCharacter = '}';
+        constexpr char EscapeXorValue  = 0x20;
+
+        constexpr bool IsEscapeRequired(char c) {
+            return c == '$' || c == '#' || c == EscapeCharacter || c == '*';
+        }
+
         constexpr int DecodeHex(char c) {
             if ('a' <= c && c <= 'f') {
                 return 10 + (c - 'a');
@@ -41,7 +48,39 @@ namespace ams::dmnt {
 
     }
 
+    size_t GdbPacketIo::EscapeBinaryData(size_t *out_src_size, char *dst, size_t dst_size, const void *src, size_t src_size) {
+        const char *src_chars = static_cast<const char *>(src);
+
+        size_t src_ofs = 0, dst_ofs = 0;
+        while (src_ofs < src_size) {
+            const char c = src_chars[src_ofs];
+            if (IsEscapeRequired(c)) {
+                if (dst_ofs + 2 > dst_size) {
+                    break;
+                }
+
+                dst[dst_ofs++] = EscapeCharacter;
+                dst[dst_ofs++] = c ^ EscapeXorValue;
+            } else {
+                if (dst_ofs + 1 > dst_size) {
+                    break;
+                }
+
+                dst[dst_ofs++] = c;
+            }
+
+            ++src_ofs;
+        }
+
+        *out_src_size = src_ofs;
+        return dst_ofs;
+    }
+
     void GdbPacketIo::SendPacket(bool *out_break, const char *src, TransportSession *session) {
+        return this->SendPacket(out_break, src, std::strlen(src), session);
+    }
+
+    void GdbPacketIo::SendPacket(bool *out_break, const char *src, size_t src_size, TransportSession *session) {
         /* Default to not breaked. */
         *out_break = false;
 
@@ -49,11 +88,12 @@ namespace ams::dmnt {
         while (true) {
             std::scoped_lock lk(m_mutex);
 
-            size_t len = 0;
+            /* NOTE: Binary packets may contain null characters, so we can't rely on null termination. */
+            const size_t len = std::min(src_size, GdbPacketBufferSize);
             u8 checksum = 0;
 
-            while (src[len] != 0) {
-                checksum += static_cast<u8>(src[len++]);
+            for (size_t i = 0; i < len; ++i) {
+                checksum += static_cast<u8>(src[i]);
             }
 
             char buffer[1 + GdbPacketBufferSize + 4];
@@ -64,7 +104,7 @@ namespace ams::dmnt {
             buffer[3 + len] = EncodeHex(checksum >> 0);
             buffer[4 + len] = 0;
 
-            if (session->PutString(buffer) < 0) {
+            if (session->PutData(buffer, 4 + len) < 0) {
                 /* Log (truncated) copy of packet. */
                 AMS_DMNT2_GDB_LOG_ERROR("Failed to send packet %s\n", buffer);
                 return;
@@ -99,7 +139,7 @@ namespace ams::dmnt {
         }
     }
 
-    char *GdbPacketIo::ReceivePacket(bool *out_break, char *dst, size_t size, TransportSession *session) {
+    char *GdbPacketIo::ReceivePacket(bool *out_break, size_t *out_size, char *dst, size_t size, TransportSession *session) {
         /* Default to not breaked. */
         *out_break = false;
 
@@ -130,6 +170,7 @@ namespace ams::dmnt {
             u8 checksum = 0;
             int csum_high = -1, csum_low = -1;
             size_t count = 0;
+            bool escaped = false;
 
             /* Read characters. */
             while (true) {
@@ -146,10 +187,18 @@ namespace ams::dmnt {
                             }
                             break;
                         case State::PacketData:
-                            /* TODO: Escaped characters. */
-                            if (c == '#') {
+                            /* NOTE: The checksum covers the escaped characters, not the data they stand for. */
+                            if (escaped) {
+                                AMS_ABORT_UNLESS(count < size - 1);
+                                checksum += static_cast<u8>(c);
+                                dst[count++] = c ^ EscapeXorValue;
+                                escaped = false;
+                            } else if (c == '#') {
                                 dst[count] = 0;
                                 state = State::ChecksumHigh;
+                            } else if (c == EscapeCharacter) {
+                                checksum += static_cast<u8>(c);
+                                escaped = true;
                             } else {
                                 AMS_ABORT_UNLESS(count < size - 1);
                                 checksum += static_cast<u8>(c);
@@ -164,6 +213,7 @@ namespace ams::dmnt {
                             csum_low = DecodeHex(c);
 
                             if (m_no_ack) {
+                                *out_size = count;
                                 return dst;
                             } else {
                                 const u8 expectsum = (static_cast<u8>(csum_high) << 4) | (static_cast<u8>(csum_low) << 0);
@@ -175,9 +225,11 @@ namespace ams::dmnt {
                                     csum_high = -1;
                                     csum_low  = -1;
                                     count     = 0;
+                                    escaped   = false;
                                     session->PutChar('-');
                                 } else {
                                     session->PutChar('+');
+                                    *out_size = count;
                                     return dst;
                                 }
                             }
@@ -31,7 +31,11 @@ namespace ams::dmnt {
             void SetNoAck() { m_no_ack = true; }
 
             void SendPacket(bool *out_break, const char *src, TransportSession *session);
-            char *ReceivePacket(bool *out_break, char *dst, size_t size, TransportSession *session);
+            void SendPacket(bool *out_break, const char *src, size_t src_size, TransportSession *session);
+            char *ReceivePacket(bool *out_break, size_t *out_size, char *dst, size_t size, TransportSession *session);
+
+            /* Escapes binary data for a packet, stopping early if dst fills. Returns the number of characters written. */
+            static size_t EscapeBinaryData(size_t *out_src_size, char *dst, size_t dst_size, const void *src, size_t src_size);
     };
 
 }
\ No newline at end of file
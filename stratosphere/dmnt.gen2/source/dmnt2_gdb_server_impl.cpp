@@ -1291,16 +1291,21 @@ namespace ams::dmnt {
         while (m_session.IsValid()) {
             /* Receive a packet. */
             bool do_break = false;
+            size_t packet_size = 0;
             char recv_buf[GdbPacketBufferSize];
-            char *packet = this->ReceivePacket(std::addressof(do_break), recv_buf, sizeof(recv_buf));
+            char *packet = this->ReceivePacket(std::addressof(do_break), std::addressof(packet_size), recv_buf, sizeof(recv_buf));
 
             if (!do_break && packet != nullptr) {
                 /* Process the packet. */
                 char reply_buffer[GdbPacketBufferSize];
-                this->ProcessPacket(packet, reply_buffer);
+                this->ProcessPacket(packet, packet_size, reply_buffer);
 
                 /* Send packet. */
-                this->SendPacket(std::addressof(do_break), reply_buffer);
+                if (m_is_binary_reply) {
+                    this->SendPacket(std::addressof(do_break), reply_buffer, m_reply_cur - reply_buffer);
+                } else {
+                    this->SendPacket(std::addressof(do_break), reply_buffer);
+                }
             }
 
             /* If we should, break the process. */
@@ -1310,11 +1315,13 @@ namespace ams::dmnt {
         }
     }
 
-    void GdbServerImpl::ProcessPacket(char *receive, char *reply) {
+    void GdbServerImpl::ProcessPacket(char *receive, size_t receive_size, char *reply) {
         /* Set our fields. */
-        m_receive_packet = receive;
-        m_reply_cur      = reply;
-        m_reply_end      = reply + GdbPacketBufferSize;
+        m_receive_packet     = receive;
+        m_receive_packet_end = receive + receive_size;
+        m_reply_cur          = reply;
+        m_reply_end          = reply + GdbPacketBufferSize;
+        m_is_binary_reply    = false;
 
         /* Log the packet we're processing. */
         AMS_DMNT2_GDB_LOG_DEBUG("Receive: %s\n", m_receive_packet);
@@ -1345,6 +1352,9 @@ namespace ams::dmnt {
             case 'T':
                 this->T();
                 break;
+            case 'X':
+                this->X();
+                break;
             case 'Z':
                 this->Z();
                 break;
@@ -1368,6 +1378,9 @@ namespace ams::dmnt {
             case 'v':
                 this->v();
                 break;
+            case 'x':
+                this->x();
+                break;
             case 'q':
                 this->q();
                 break;
@@ -1565,6 +1578,49 @@ namespace ams::dmnt {
         }
     }
 
+    void GdbServerImpl::X() {
+        ++m_receive_packet;
+
+        /* Validate format. */
+        char *comma = std::strchr(m_receive_packet, ',');
+        if (comma == nullptr) {
+            AppendReplyError(m_reply_cur, m_reply_end, "E01");
+            return;
+        }
+        *comma = 0;
+
+        char *colon = std::strchr(comma + 1, ':');
+        if (colon == nullptr) {
+            AppendReplyError(m_reply_cur, m_reply_end, "E01");
+            return;
+        }
+        *colon = 0;
+
+        /* Parse address/length. */
+        const u64 address = DecodeHex(m_receive_packet);
+        const u64 length  = DecodeHex(comma + 1);
+
+        /* The data is binary, and may contain nulls, so check its length against the packet's. */
+        const char *data = colon + 1;
+        if (length != static_cast<u64>(m_receive_packet_end - data)) {
+            AppendReplyError(m_reply_cur, m_reply_end, "E01");
+            return;
+        }
+
+        /* NOTE: gdb probes for binary write support with an empty write. */
+        if (length == 0) {
+            AppendReplyOk(m_reply_cur, m_reply_end);
+            return;
+        }
+
+        /* Write the memory. */
+        if (R_SUCCEEDED(m_debug_process.WriteMemory(data, address, length))) {
+            AppendReplyOk(m_reply_cur, m_reply_end);
+        } else {
+            AppendReplyError(m_reply_cur, m_reply_end, "E01");
+        }
+    }
+
     void GdbServerImpl::Z() {
         /* Increment past the 'Z'. */
         ++m_receive_packet;
@@ -1924,6 +1980,37 @@ namespace ams::dmnt {
         R_SUCCEED();
     }
 
+    void GdbServerImpl::x() {
+        ++m_receive_packet;
+
+        /* Validate format. */
+        const char *comma = std::strchr(m_receive_packet, ',');
+        if (comma == nullptr) {
+            AppendReplyError(m_reply_cur, m_reply_end, "E01");
+            return;
+        }
+
+        /* Parse address/length. */
+        /* NOTE: Binary replies may be shorter than requested, and gdb will ask for the rest in another packet. */
+        const u64 address = DecodeHex(m_receive_packet);
+        const u64 length  = std::min<u64>(DecodeHex(comma + 1), sizeof(m_buffer));
+
+        /* Read the memory. */
+        if (R_FAILED(m_debug_process.ReadMemory(m_buffer, address, length))) {
+            AppendReplyError(m_reply_cur, m_reply_end, "E01");
+            return;
+        }
+
+        /* Encode the memory, after the 'b' marking a binary reply. */
+        *(m_reply_cur++) = 'b';
+
+        size_t encoded_size;
+        m_reply_cur += GdbPacketIo::EscapeBinaryData(std::addressof(encoded_size), m_reply_cur, m_reply_end - m_reply_cur - 1, m_buffer, length);
+        *m_reply_cur = 0;
+
+        m_is_binary_reply = true;
+    }
+
 
     void GdbServerImpl::q() {
         if (ParsePrefix(m_receive_packet, "qAttached:")) {
@@ -2152,6 +2239,7 @@ namespace ams::dmnt {
         AppendReplyFormat(m_reply_cur, m_reply_end, ";hwbreak+");
         AppendReplyFormat(m_reply_cur, m_reply_end, ";vContSupported+");
         AppendReplyFormat(m_reply_cur, m_reply_end, ";QStartNoAckMode+");
+        AppendReplyFormat(m_reply_cur, m_reply_end, ";binary-upload+");
     }
 
     void GdbServerImpl::qXfer() {
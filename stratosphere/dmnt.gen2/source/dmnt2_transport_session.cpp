@@ -81,22 +81,26 @@ namespace ams::dmnt {
     }
 
     ssize_t TransportSession::PutString(const char *str) {
+        return this->PutData(str, std::strlen(str));
+    }
+
+    ssize_t TransportSession::PutData(const void *data, size_t size) {
         /* Repeatedly send until all is sent. */
-        const size_t len = std::strlen(str);
+        const u8 *cur = static_cast<const u8 *>(data);
 
-        size_t remaining = len;
+        size_t remaining = size;
         while (remaining > 0) {
-            const auto sent = transport::Send(m_socket, str, remaining, 0);
+            const auto sent = transport::Send(m_socket, cur, remaining, 0);
             if (sent >= 0) {
                 remaining -= sent;
-                str += sent;
+                cur += sent;
             } else {
                 m_valid = false;
                 return sent;
             }
         }
 
-        return len;
+        return size;
     }
 
     void TransportSession::ReceiveThreadFunction() {
@@ -38,6 +38,7 @@ namespace ams::dmnt {
             util::optional<char> GetChar();
             ssize_t PutChar(char c);
             ssize_t PutString(const char *str);
+            ssize_t PutData(const void *data, size_t size);
 
         private:
             static void ReceiveThreadEntry(void *arg) {
@@ -153,4 +153,33 @@ namespace ams::dmnt::cheat {
         R_RETURN(dmnt::cheat::impl::DisableFrozenAddress(address));
     }
 
+    /* ========================================================================================= */
+    /* =================================  Statistics Commands  ================================= */
+    /* ========================================================================================= */
+
+    Result CheatService::GetMemoryAccessStatistics(sf::Out<CheatProcessMemoryAccessStatistics> out_statistics) {
+        R_RETURN(dmnt::cheat::impl::GetMemoryAccessStatistics(out_statistics.GetPointer()));
+    }
+
+    /* ========================================================================================= */
+    /* ===================================  Search Commands  =================================== */
+    /* ========================================================================================= */
+
+    Result CheatService::StartMemorySearch(const MemorySearchCondition &condition, const MemorySearchRegionFilter &filter, sf::Out<u64> out_count) {
+        R_RETURN(dmnt::cheat::impl::StartMemorySearch(out_count.GetPointer(), condition, filter));
+    }
+
+    Result CheatService::NarrowMemorySearch(const MemorySearchCondition &condition, sf::Out<u64> out_count) {
+        R_RETURN(dmnt::cheat::impl::NarrowMemorySearch(out_count.GetPointer(), condition));
+    }
+
+    Result CheatService::GetMemorySearchResults(const sf::OutArray<MemorySearchResult> &results, sf::Out<u64> out_count, u64 offset) {
+        R_UNLESS(results.GetPointer() != nullptr, dmnt::cheat::ResultCheatNullBuffer());
+        R_RETURN(dmnt::cheat::impl::GetMemorySearchResults(results.GetPointer(), results.GetSize(), out_count.GetPointer(), offset));
+    }
+
+    Result CheatService::ClearMemorySearch() {
+        R_RETURN(dmnt::cheat::impl::ClearMemorySearch());
+    }
+
 }
@@ -44,7 +44,12 @@
     AMS_SF_METHOD_INFO(C, H, 65301, Result, GetFrozenAddresses,          (const sf::OutArray<dmnt::cheat::FrozenAddressEntry> &addresses, sf::Out<u64> out_count, u64 offset), (addresses, out_count, offset)) \
     AMS_SF_METHOD_INFO(C, H, 65302, Result, GetFrozenAddress,            (sf::Out<dmnt::cheat::FrozenAddressEntry> entry, u64 address),                                        (entry, address))               \
     AMS_SF_METHOD_INFO(C, H, 65303, Result, EnableFrozenAddress,         (sf::Out<u64> out_value, u64 address, u64 width),                                                     (out_value, address, width))    \
-    AMS_SF_METHOD_INFO(C, H, 65304, Result, DisableFrozenAddress,        (u64 address),                                                                                        (address))
+    AMS_SF_METHOD_INFO(C, H, 65304, Result, DisableFrozenAddress,        (u64 address),                                                                                        (address))                      \
+    AMS_SF_METHOD_INFO(C, H, 65400, Result, GetMemoryAccessStatistics,   (sf::Out<dmnt::cheat::CheatProcessMemoryAccessStatistics> out_statistics),                            (out_statistics))               \
+    AMS_SF_METHOD_INFO(C, H, 65500, Result, StartMemorySearch,           (const dmnt::cheat::MemorySearchCondition &condition, const dmnt::cheat::MemorySearchRegionFilter &filter, sf::Out<u64> out_count), (condition, filter, out_count)) \
+    AMS_SF_METHOD_INFO(C, H, 65501, Result, NarrowMemorySearch,          (const dmnt::cheat::MemorySearchCondition &condition, sf::Out<u64> out_count),                        (condition, out_count))         \
+    AMS_SF_METHOD_INFO(C, H, 65502, Result, GetMemorySearchResults,      (const sf::OutArray<dmnt::cheat::MemorySearchResult> &results, sf::Out<u64> out_count, u64 offset),   (results, out_count, offset))   \
+    AMS_SF_METHOD_INFO(C, H, 65503, Result, ClearMemorySearch,           (),                                                                                                   ())
 
 AMS_SF_DEFINE_INTERFACE(ams::dmnt::cheat::impl, ICheatInterface, AMS_DMNT_I_CHEAT_INTERFACE_INTERFACE_INFO, 0x00000000)
 
@@ -82,6 +87,13 @@ namespace ams::dmnt::cheat {
             Result GetFrozenAddress(sf::Out<FrozenAddressEntry> entry, u64 address);
             Result EnableFrozenAddress(sf::Out<u64> out_value, u64 address, u64 width);
             Result DisableFrozenAddress(u64 address);
+
+            Result GetMemoryAccessStatistics(sf::Out<CheatProcessMemoryAccessStatistics> out_statistics);
+
+            Result StartMemorySearch(const MemorySearchCondition &condition, const MemorySearchRegionFilter &filter, sf::Out<u64> out_count);
+            Result NarrowMemorySearch(const MemorySearchCondition &condition, sf::Out<u64> out_count);
+            Result GetMemorySearchResults(const sf::OutArray<MemorySearchResult> &results, sf::Out<u64> out_count, u64 offset);
+            Result ClearMemorySearch();
     };
     static_assert(impl::IsICheatInterface<CheatService>);
 
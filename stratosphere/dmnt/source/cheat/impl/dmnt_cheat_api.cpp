@@ -16,6 +16,8 @@
 #include <stratosphere.hpp>
 #include "dmnt_cheat_api.hpp"
 #include "dmnt_cheat_vm.hpp"
+#include "dmnt_cheat_memory_batcher.hpp"
+#include "dmnt_cheat_memory_search.hpp"
 #include "dmnt_cheat_debug_events_manager.hpp"
 
 namespace ams::dmnt::cheat::impl {
@@ -25,6 +27,9 @@ namespace ams::dmnt::cheat::impl {
         /* Helper definitions. */
         constexpr size_t MaxCheatCount = 0x80;
         constexpr size_t MaxFrozenAddressCount = 0x80;
+        /* NOTE: Each match takes two bytes plus its width, and each 64KB chunk with matches sixteen more, so this holds */
+        /* around 87000 four-byte matches. Searches finding more fail with ResultMemorySearchOutOfResource. */
+        constexpr size_t MemorySearchStorageSize = 512_KB;
 
         class FrozenAddressMapEntry : public util::IntrusiveRedBlackTreeBaseNode<FrozenAddressMapEntry> {
             public:
@@ -78,12 +83,71 @@ namespace ams::dmnt::cheat::impl {
 
         using FrozenAddressMap = typename util::IntrusiveRedBlackTreeBaseTraits<FrozenAddressMapEntry>::TreeType<FrozenAddressMapEntry>;
 
+        alignas(alignof(u64)) constinit u8 g_memory_search_storage[MemorySearchStorageSize];
+        alignas(os::MemoryPageSize) constinit u8 g_memory_search_chunk_buffer[MemorySearcher::ChunkSize];
+
+        /* Accesses the cheat process through its debug handle. */
+        class DebugProcessMemoryAccessor : public CheatProcessMemoryAccessor {
+            private:
+                os::NativeHandle m_handle;
+            public:
+                explicit DebugProcessMemoryAccessor(os::NativeHandle handle) : m_handle(handle) { /* ... */ }
+
+                virtual Result ReadMemory(u64 address, void *dst, size_t size) override {
+                    R_RETURN(svc::ReadDebugProcessMemory(reinterpret_cast<uintptr_t>(dst), m_handle, address, size));
+                }
+
+                virtual Result WriteMemory(u64 address, const void *src, size_t size) override {
+                    R_RETURN(svc::WriteDebugProcessMemory(m_handle, reinterpret_cast<uintptr_t>(src), address, size));
+                }
+        };
+
         /* Manager class. */
         class CheatProcessManager {
             private:
                 static constexpr size_t ThreadStackSize = 0x4000;
+            private:
+                /* Searches the cheat process, taking the cheat lock for each query or read rather than for the whole scan. */
+                class MemorySearchProviderImpl : public MemorySearchProvider {
+                    private:
+                        CheatProcessManager *m_manager;
+                        os::ProcessId m_process_id;
+                        bool m_is_detached;
+                    public:
+                        MemorySearchProviderImpl(CheatProcessManager *manager, os::ProcessId process_id) : m_manager(manager), m_process_id(process_id), m_is_detached(false) { /* ... */ }
+
+                        bool IsDetached() const { return m_is_detached; }
+
+                        virtual Result QueryMemory(MemorySearchRegion *out, u64 address) override {
+                            std::scoped_lock lk(m_manager->m_cheat_lock);
+                            R_TRY(this->EnsureProcess());
+
+                            svc::MemoryInfo mem_info;
+                            svc::PageInfo page_info;
+                            R_TRY(svc::QueryDebugProcessMemory(std::addressof(mem_info), std::addressof(page_info), m_manager->GetCheatProcessHandle(), address));
+
+                            *out = { mem_info.base_address, mem_info.size, static_cast<u32>(mem_info.state), static_cast<u32>(mem_info.permission) };
+                            R_SUCCEED();
+                        }
+
+                        virtual Result ReadMemory(u64 address, void *dst, size_t size) override {
+                            std::scoped_lock lk(m_manager->m_cheat_lock);
+                            R_TRY(this->EnsureProcess());
+
+                            R_RETURN(svc::ReadDebugProcessMemory(reinterpret_cast<uintptr_t>(dst), m_manager->GetCheatProcessHandle(), address, size));
+                        }
+                    private:
+                        Result EnsureProcess() {
+                            /* If the process we're searching has gone, fail every access until the scan ends. */
+                            /* NOTE: This doesn't ask pm whether the process is still alive; the scan is checked in full when it ends. */
+                            m_is_detached |= m_manager->m_cheat_process_debug_handle == os::InvalidNativeHandle || m_manager->m_cheat_process_metadata.process_id != m_process_id;
+                            R_UNLESS(!m_is_detached, dmnt::cheat::ResultCheatNotAttached());
+                            R_SUCCEED();
+                        }
+                };
             private:
                 os::SdkMutex m_cheat_lock;
+                os::SdkMutex m_memory_search_lock;
                 os::Event m_unsafe_break_event;
                 os::Event m_debug_events_event; /* Autoclear. */
                 os::ThreadType m_detect_thread, m_debug_events_thread;
@@ -95,6 +159,9 @@ namespace ams::dmnt::cheat::impl {
                 bool m_broken_unsafe = false;
                 bool m_needs_reload_vm = false;
                 CheatVirtualMachine m_cheat_vm;
+                CheatProcessMemoryBatcher m_memory_batcher;
+                MemorySearcher m_memory_searcher;
+                os::ProcessId m_memory_search_process_id = os::InvalidProcessId;
 
                 bool m_enable_cheats_by_default = true;
                 bool m_always_save_cheat_toggles = false;
@@ -214,6 +281,11 @@ namespace ams::dmnt::cheat::impl {
                             }
                         }
 
+                        /* Clear memory access statistics. */
+                        m_memory_batcher.ResetStatistics();
+
+                        /* NOTE: Any memory search is cleared when next used, as a scan may hold the memory search lock. */
+
                         /* Signal to our fans. */
                         m_cheat_process_event.Signal();
                     }
@@ -243,6 +315,34 @@ namespace ams::dmnt::cheat::impl {
                     return m_cheat_process_debug_handle;
                 }
 
+                Result EnsureMemorySearchProcess() {
+                    /* Note: This function *MUST* be called only with the memory search lock held. */
+                    std::scoped_lock lk(m_cheat_lock);
+
+                    R_TRY(this->EnsureCheatProcess());
+
+                    /* Discard any search of a process which has since closed. */
+                    if (m_memory_search_process_id != m_cheat_process_metadata.process_id) {
+                        m_memory_searcher.Clear();
+                        m_memory_search_process_id = m_cheat_process_metadata.process_id;
+                    }
+
+                    R_SUCCEED();
+                }
+
+                Result EnsureMemorySearchScanComplete(const MemorySearchProviderImpl &provider) {
+                    /* Note: This function *MUST* be called only with the memory search lock held. */
+                    std::scoped_lock lk(m_cheat_lock);
+
+                    /* If the process closed mid-scan, the results are meaningless. */
+                    if (provider.IsDetached() || !this->HasActiveCheatProcess() || m_cheat_process_metadata.process_id != m_memory_search_process_id) {
+                        m_memory_searcher.Clear();
+                        R_THROW(dmnt::cheat::ResultCheatNotAttached());
+                    }
+
+                    R_SUCCEED();
+                }
+
                 os::NativeHandle HookToCreateApplicationProcess() const {
                     os::NativeHandle h;
                     R_ABORT_UNLESS(pm::dmnt::HookToCreateApplicationProcess(std::addressof(h)));
@@ -253,7 +353,7 @@ namespace ams::dmnt::cheat::impl {
                     R_ABORT_UNLESS(pm::dmnt::StartProcess(process_id));
                 }
             public:
-                CheatProcessManager() : m_cheat_lock(), m_unsafe_break_event(os::EventClearMode_ManualClear), m_debug_events_event(os::EventClearMode_AutoClear), m_cheat_process_event(os::EventClearMode_AutoClear, true) {
+                CheatProcessManager() : m_cheat_lock(), m_memory_search_lock(), m_unsafe_break_event(os::EventClearMode_ManualClear), m_debug_events_event(os::EventClearMode_AutoClear), m_cheat_process_event(os::EventClearMode_AutoClear, true), m_memory_searcher(g_memory_search_storage, sizeof(g_memory_search_storage), g_memory_search_chunk_buffer) {
                     /* Learn whether we should enable cheats by default. */
                     {
                         u8 en = 0;
@@ -310,11 +410,21 @@ namespace ams::dmnt::cheat::impl {
                 }
 
                 Result ReadCheatProcessMemoryUnsafe(u64 proc_addr, void *out_data, size_t size) {
+                    /* While the virtual machine is executing, go through the batcher. */
+                    if (m_memory_batcher.IsActive()) {
+                        R_RETURN(m_memory_batcher.Read(proc_addr, out_data, size));
+                    }
+
                     R_RETURN(svc::ReadDebugProcessMemory(reinterpret_cast<uintptr_t>(out_data), this->GetCheatProcessHandle(), proc_addr, size));
                 }
 
                 Result WriteCheatProcessMemoryUnsafe(u64 proc_addr, const void *data, size_t size) {
-                    R_TRY(svc::WriteDebugProcessMemory(this->GetCheatProcessHandle(), reinterpret_cast<uintptr_t>(data), proc_addr, size));
+                    /* While the virtual machine is executing, go through the batcher. */
+                    if (m_memory_batcher.IsActive()) {
+                        R_TRY(m_memory_batcher.Write(proc_addr, data, size));
+                    } else {
+                        R_TRY(svc::WriteDebugProcessMemory(this->GetCheatProcessHandle(), reinterpret_cast<uintptr_t>(data), proc_addr, size));
+                    }
 
                     for (auto &entry : m_frozen_addresses_map) {
                         /* Get address/value. */
@@ -338,16 +448,33 @@ namespace ams::dmnt::cheat::impl {
                 }
 
                 Result PauseCheatProcessUnsafe() {
+                    /* Ensure everything written so far lands before the process is broken. */
+                    Result flush_result = ResultSuccess();
+                    if (m_memory_batcher.IsActive()) {
+                        flush_result = m_memory_batcher.Invalidate();
+                    }
+
                     m_broken_unsafe = true;
                     m_unsafe_break_event.Clear();
-                    R_RETURN(svc::BreakDebugProcess(this->GetCheatProcessHandle()));
+                    R_TRY(svc::BreakDebugProcess(this->GetCheatProcessHandle()));
+
+                    /* Report any staged write which failed. */
+                    R_RETURN(flush_result);
                 }
 
                 Result ResumeCheatProcessUnsafe() {
+                    /* Ensure everything written so far lands before the process continues. */
+                    Result flush_result = ResultSuccess();
+                    if (m_memory_batcher.IsActive()) {
+                        flush_result = m_memory_batcher.Invalidate();
+                    }
+
                     m_broken_unsafe = false;
                     m_unsafe_break_event.Signal();
                     dmnt::cheat::impl::ContinueCheatProcess(this->GetCheatProcessHandle());
-                    R_SUCCEED();
+
+                    /* Report any staged write which failed. */
+                    R_RETURN(flush_result);
                 }
 
                 Result GetCheatProcessMappingCount(u64 *out_count) {
@@ -674,6 +801,59 @@ namespace ams::dmnt::cheat::impl {
                     R_SUCCEED();
                 }
 
+                Result GetMemoryAccessStatistics(CheatProcessMemoryAccessStatistics *out) {
+                    std::scoped_lock lk(m_cheat_lock);
+
+                    R_TRY(this->EnsureCheatProcess());
+
+                    *out = m_memory_batcher.GetLastStatistics();
+                    R_SUCCEED();
+                }
+
+                Result StartMemorySearch(u64 *out_count, const MemorySearchCondition &condition, const MemorySearchRegionFilter &filter) {
+                    /* NOTE: Scans don't hold the cheat lock, so that cheats keep running while we search. */
+                    std::scoped_lock lk(m_memory_search_lock);
+
+                    R_TRY(this->EnsureMemorySearchProcess());
+
+                    MemorySearchProviderImpl provider(this, m_memory_search_process_id);
+                    R_TRY(m_memory_searcher.Start(std::addressof(provider), condition, filter));
+                    R_TRY(this->EnsureMemorySearchScanComplete(provider));
+
+                    *out_count = m_memory_searcher.GetCount();
+                    R_SUCCEED();
+                }
+
+                Result NarrowMemorySearch(u64 *out_count, const MemorySearchCondition &condition) {
+                    std::scoped_lock lk(m_memory_search_lock);
+
+                    R_TRY(this->EnsureMemorySearchProcess());
+
+                    MemorySearchProviderImpl provider(this, m_memory_search_process_id);
+                    R_TRY(m_memory_searcher.Narrow(std::addressof(provider), condition));
+                    R_TRY(this->EnsureMemorySearchScanComplete(provider));
+
+                    *out_count = m_memory_searcher.GetCount();
+                    R_SUCCEED();
+                }
+
+                Result GetMemorySearchResults(MemorySearchResult *results, size_t max_count, u64 *out_count, u64 offset) {
+                    std::scoped_lock lk(m_memory_search_lock);
+
+                    R_TRY(this->EnsureMemorySearchProcess());
+
+                    R_RETURN(m_memory_searcher.GetResults(results, max_count, out_count, offset));
+                }
+
+                Result ClearMemorySearch() {
+                    std::scoped_lock lk(m_memory_search_lock);
+
+                    R_TRY(this->EnsureMemorySearchProcess());
+
+                    m_memory_searcher.Clear();
+                    R_SUCCEED();
+                }
+
         };
 
         void CheatProcessManager::DetectLaunchThread(void *_this) {
@@ -744,6 +924,11 @@ namespace ams::dmnt::cheat::impl {
                     std::scoped_lock lk(manager->m_cheat_lock);
 
                     if (manager->HasActiveCheatProcess()) {
+                        /* Batch all memory accesses made during this tick. */
+                        DebugProcessMemoryAccessor accessor(manager->GetCheatProcessHandle());
+                        manager->m_memory_batcher.Begin(std::addressof(accessor));
+                        ON_SCOPE_EXIT { manager->m_memory_batcher.End(); };
+
                         /* Execute VM. */
                         if (!manager->GetNeedsReloadVm() || manager->m_cheat_vm.LoadProgram(manager->m_cheat_entries, util::size(manager->m_cheat_entries))) {
                             manager->SetNeedsReloadVm(false);
@@ -755,12 +940,13 @@ namespace ams::dmnt::cheat::impl {
                         }
 
                         /* Apply frozen addresses. */
+                        /* The map is ordered, so adjacent addresses are staged contiguously and written as one run per page. */
                         for (const auto &entry : manager->m_frozen_addresses_map) {
                             const auto address = entry.GetAddress();
                             const auto &value  = entry.GetValue();
 
-                            /* Use Write SVC directly, to avoid the usual frozen address update logic. */
-                            svc::WriteDebugProcessMemory(manager->GetCheatProcessHandle(), reinterpret_cast<uintptr_t>(std::addressof(value.value)), address, value.width);
+                            /* Use the batcher directly, to avoid the usual frozen address update logic. */
+                            manager->m_memory_batcher.Write(address, std::addressof(value.value), value.width);
                         }
                     }
                 }
@@ -1316,4 +1502,24 @@ namespace ams::dmnt::cheat::impl {
         R_RETURN(GetReference(g_cheat_process_manager).DisableFrozenAddress(address));
     }
 
+    Result GetMemoryAccessStatistics(CheatProcessMemoryAccessStatistics *out) {
+        R_RETURN(GetReference(g_cheat_process_manager).GetMemoryAccessStatistics(out));
+    }
+
+    Result StartMemorySearch(u64 *out_count, const MemorySearchCondition &condition, const MemorySearchRegionFilter &filter) {
+        R_RETURN(GetReference(g_cheat_process_manager).StartMemorySearch(out_count, condition, filter));
+    }
+
+    Result NarrowMemorySearch(u64 *out_count, const MemorySearchCondition &condition) {
+        R_RETURN(GetReference(g_cheat_process_manager).NarrowMemorySearch(out_count, condition));
+    }
+
+    Result GetMemorySearchResults(MemorySearchResult *results, size_t max_count, u64 *out_count, u64 offset) {
+        R_RETURN(GetReference(g_cheat_process_manager).GetMemorySearchResults(results, max_count, out_count, offset));
+    }
+
+    Result ClearMemorySearch() {
+        R_RETURN(GetReference(g_cheat_process_manager).ClearMemorySearch());
+    }
+
 }
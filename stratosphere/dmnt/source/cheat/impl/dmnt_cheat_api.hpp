@@ -57,4 +57,11 @@ namespace ams::dmnt::cheat::impl {
     Result EnableFrozenAddress(u64 *out_value, u64 address, u64 width);
     Result DisableFrozenAddress(u64 address);
 
+    Result GetMemoryAccessStatistics(CheatProcessMemoryAccessStatistics *out);
+
+    Result StartMemorySearch(u64 *out_count, const MemorySearchCondition &condition, const MemorySearchRegionFilter &filter);
+    Result NarrowMemorySearch(u64 *out_count, const MemorySearchCondition &condition);
+    Result GetMemorySearchResults(MemorySearchResult *results, size_t max_count, u64 *out_count, u64 offset);
+    Result ClearMemorySearch();
+
 }
@@ -0,0 +1,245 @@
+/*
+ * Copyright (c) Atmosphère-NX
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stratosphere.hpp>
+#include "dmnt_cheat_memory_batcher.hpp"
+
+namespace ams::dmnt::cheat::impl {
+
+    namespace {
+
+        constexpr size_t BitsPerWord = BITSIZEOF(u64);
+
+        /* Finds the first bit at or after start which is set (or clear, when find_set is false). */
+        template<size_t BitCount>
+        size_t FindBit(const u64 (&bitmap)[BitCount / BitsPerWord], size_t start, bool find_set) {
+            size_t index = start / BitsPerWord;
+            if (index >= util::size(bitmap)) {
+                return BitCount;
+            }
+
+            /* Mask off the bits before our start. */
+            u64 word = find_set ? bitmap[index] : ~bitmap[index];
+            word &= ~((static_cast<u64>(1) << (start % BitsPerWord)) - 1);
+
+            while (word == 0) {
+                if (++index >= util::size(bitmap)) {
+                    return BitCount;
+                }
+                word = find_set ? bitmap[index] : ~bitmap[index];
+            }
+
+            return index * BitsPerWord + util::CountTrailingZeros(word);
+        }
+
+        template<size_t BitCount>
+        void SetBits(u64 (&bitmap)[BitCount / BitsPerWord], size_t start, size_t count) {
+            for (size_t i = start; i < start + count; ++i) {
+                bitmap[i / BitsPerWord] |= static_cast<u64>(1) << (i % BitsPerWord);
+            }
+        }
+
+    }
+
+    void CheatProcessMemoryBatcher::Begin(CheatProcessMemoryAccessor *accessor) {
+        AMS_ASSERT(!this->IsActive());
+
+        m_accessor   = accessor;
+        m_statistics = {};
+    }
+
+    void CheatProcessMemoryBatcher::End() {
+        AMS_ASSERT(this->IsActive());
+
+        /* Write everything we've staged. Any failures are counted in our statistics. */
+        this->Invalidate();
+
+        /* Update our statistics. */
+        const u32 svc_count = m_statistics.read_svc_count + m_statistics.write_svc_count;
+        m_statistics.max_svc_count = std::max(m_last_statistics.max_svc_count, svc_count);
+        m_statistics.tick_count    = m_last_statistics.tick_count + 1;
+        m_last_statistics          = m_statistics;
+
+        m_accessor = nullptr;
+    }
+
+    Result CheatProcessMemoryBatcher::Invalidate() {
+        Result result = ResultSuccess();
+
+        for (auto &page : m_pages) {
+            if (page.in_use) {
+                if (const Result flush_result = this->FlushPage(std::addressof(page)); R_FAILED(flush_result) && R_SUCCEEDED(result)) {
+                    result = flush_result;
+                }
+                page.in_use = false;
+            }
+        }
+
+        R_RETURN(result);
+    }
+
+    void CheatProcessMemoryBatcher::ResetStatistics() {
+        m_statistics      = {};
+        m_last_statistics = {};
+    }
+
+    Result CheatProcessMemoryBatcher::Read(u64 address, void *out, size_t size) {
+        AMS_ASSERT(this->IsActive());
+
+        m_statistics.read_count++;
+
+        u8 *dst = static_cast<u8 *>(out);
+        while (size > 0) {
+            const u64 page_address = util::AlignDown(address, PageSize);
+            const size_t offset    = address - page_address;
+            const size_t cur_size  = std::min(size, PageSize - offset);
+
+            /* Get the page, reading it if we haven't already. */
+            Page *page = this->GetPage(page_address);
+            if (this->EnsurePageLoaded(page)) {
+                std::memcpy(dst, page->data + offset, cur_size);
+            } else {
+                /* If we can't read the whole page, fall back to reading exactly what we were asked for. */
+                R_TRY(this->ReadDirect(address, dst, cur_size));
+            }
+
+            address += cur_size;
+            dst     += cur_size;
+            size    -= cur_size;
+        }
+
+        R_SUCCEED();
+    }
+
+    Result CheatProcessMemoryBatcher::Write(u64 address, const void *data, size_t size) {
+        AMS_ASSERT(this->IsActive());
+        AMS_ASSERT(size <= PageSize);
+
+        m_statistics.write_count++;
+
+        /* If any page we'd write can't be read, it's likely unmapped, so write directly to learn whether the write fails. */
+        for (u64 page_address = util::AlignDown(address, PageSize); page_address < address + size; page_address += PageSize) {
+            if (!this->EnsurePageLoaded(this->GetPage(page_address))) {
+                R_TRY(this->WriteDirect(address, data, size));
+
+                /* Keep our copies of the pages we could read up to date. */
+                this->ForEachPagePart(address, size, [&](Page *page, size_t offset, size_t part_offset, size_t part_size) {
+                    if (page->is_loaded) {
+                        std::memcpy(page->data + offset, static_cast<const u8 *>(data) + part_offset, part_size);
+                    }
+                });
+                R_SUCCEED();
+            }
+        }
+
+        /* Stage the data, which also keeps our copy of each page up to date. */
+        this->ForEachPagePart(address, size, [&](Page *page, size_t offset, size_t part_offset, size_t part_size) {
+            std::memcpy(page->data + offset, static_cast<const u8 *>(data) + part_offset, part_size);
+            SetBits<PageSize>(page->dirty_bitmap, offset, part_size);
+            page->is_dirty = true;
+        });
+
+        R_SUCCEED();
+    }
+
+    CheatProcessMemoryBatcher::Page *CheatProcessMemoryBatcher::GetPage(u64 page_address) {
+        const u64 use = ++m_use_counter;
+
+        /* Find the page, or else a free page or the least recently used one to replace. */
+        Page *victim = nullptr;
+        for (auto &page : m_pages) {
+            if (page.in_use) {
+                if (page.address == page_address) {
+                    page.last_use = use;
+                    return std::addressof(page);
+                }
+
+                if (victim == nullptr || (victim->in_use && page.last_use < victim->last_use)) {
+                    victim = std::addressof(page);
+                }
+            } else if (victim == nullptr || victim->in_use) {
+                victim = std::addressof(page);
+            }
+        }
+
+        /* Write anything staged to the page we're replacing. Any failures are counted in our statistics. */
+        if (victim->in_use) {
+            this->FlushPage(victim);
+        }
+
+        victim->address        = page_address;
+        victim->last_use       = use;
+        victim->in_use         = true;
+        victim->is_loaded      = false;
+        victim->is_load_failed = false;
+        victim->is_dirty       = false;
+        std::memset(victim->dirty_bitmap, 0, sizeof(victim->dirty_bitmap));
+
+        return victim;
+    }
+
+    bool CheatProcessMemoryBatcher::EnsurePageLoaded(Page *page) {
+        /* NOTE: Writes are only staged to loaded pages, so there's never anything staged to a page we load. */
+        if (!page->is_loaded && !page->is_load_failed) {
+            AMS_ASSERT(!page->is_dirty);
+
+            if (R_SUCCEEDED(this->ReadDirect(page->address, page->data, PageSize))) {
+                page->is_loaded = true;
+            } else {
+                page->is_load_failed = true;
+            }
+        }
+
+        return page->is_loaded;
+    }
+
+    Result CheatProcessMemoryBatcher::FlushPage(Page *page) {
+        if (!page->is_dirty) {
+            R_SUCCEED();
+        }
+
+        /* Write each contiguous run of staged bytes, counting any failures. */
+        Result result = ResultSuccess();
+        size_t start = FindBit<PageSize>(page->dirty_bitmap, 0, true);
+        while (start < PageSize) {
+            const size_t end = FindBit<PageSize>(page->dirty_bitmap, start, false);
+
+            if (const Result write_result = this->WriteDirect(page->address + start, page->data + start, end - start); R_FAILED(write_result)) {
+                m_statistics.write_failure_count++;
+                if (R_SUCCEEDED(result)) {
+                    result = write_result;
+                }
+            }
+
+            start = FindBit<PageSize>(page->dirty_bitmap, end, true);
+        }
+
+        page->is_dirty = false;
+        std::memset(page->dirty_bitmap, 0, sizeof(page->dirty_bitmap));
+
+        R_RETURN(result);
+    }
+
+    Result CheatProcessMemoryBatcher::ReadDirect(u64 address, void *out, size_t size) {
+        m_statistics.read_svc_count++;
+        R_RETURN(m_accessor->ReadMemory(address, out, size));
+    }
+
+    Result CheatProcessMemoryBatcher::WriteDirect(u64 address, const void *data, size_t size) {
+        m_statistics.write_svc_count++;
+        R_RETURN(m_accessor->WriteMemory(address, data, size));
+    }
+
+}
@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) Atmosphère-NX
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <stratosphere.hpp>
+
+namespace ams::dmnt::cheat::impl {
+
+    /* Accesses the memory of the cheat process, so that batching doesn't depend on the debug svcs. */
+    class CheatProcessMemoryAccessor {
+        public:
+            virtual ~CheatProcessMemoryAccessor() { /* ... */ }
+
+            virtual Result ReadMemory(u64 address, void *dst, size_t size) = 0;
+            virtual Result WriteMemory(u64 address, const void *src, size_t size) = 0;
+    };
+
+    /* Batches the cheat process memory accesses made during a single virtual machine tick. */
+    /* Reads are served from whole pages read once per tick, and writes are staged per page and */
+    /* flushed as one transfer per contiguous run of written bytes, so unwritten bytes are never touched. */
+    class CheatProcessMemoryBatcher {
+        NON_COPYABLE(CheatProcessMemoryBatcher);
+        NON_MOVEABLE(CheatProcessMemoryBatcher);
+        public:
+            static constexpr size_t PageSize  = os::MemoryPageSize;
+            static constexpr size_t PageCount = 8;
+        private:
+            struct Page {
+                u64 address;
+                u64 last_use;
+                bool in_use;
+                bool is_loaded;
+                bool is_load_failed;
+                bool is_dirty;
+                u64 dirty_bitmap[PageSize / BITSIZEOF(u64)];
+                alignas(0x10) u8 data[PageSize];
+            };
+        private:
+            CheatProcessMemoryAccessor *m_accessor;
+            u64 m_use_counter;
+            CheatProcessMemoryAccessStatistics m_statistics;
+            CheatProcessMemoryAccessStatistics m_last_statistics;
+            Page m_pages[PageCount];
+        public:
+            constexpr CheatProcessMemoryBatcher() : m_accessor(nullptr), m_use_counter(0), m_statistics(), m_last_statistics(), m_pages() { /* ... */ }
+
+            bool IsActive() const { return m_accessor != nullptr; }
+
+            void Begin(CheatProcessMemoryAccessor *accessor);
+            void End();
+
+            /* Writes any staged data, and forgets everything read so far. */
+            Result Invalidate();
+
+            Result Read(u64 address, void *out, size_t size);
+
+            /* NOTE: Writes to memory which can't be read are made immediately, so that their failure is returned. */
+            /* Writes may be at most a page, so that the pages they span can't evict one another. */
+            /* Staged writes which fail when flushed are counted in the statistics, and returned by Invalidate. */
+            Result Write(u64 address, const void *data, size_t size);
+
+            const CheatProcessMemoryAccessStatistics &GetLastStatistics() const { return m_last_statistics; }
+            void ResetStatistics();
+        private:
+            Page *GetPage(u64 page_address);
+            bool EnsurePageLoaded(Page *page);
+
+            template<typename F>
+            void ForEachPagePart(u64 address, size_t size, F f) {
+                for (size_t part_offset = 0; part_offset < size; /* ... */) {
+                    const u64 page_address = util::AlignDown(address + part_offset, PageSize);
+                    const size_t offset    = address + part_offset - page_address;
+                    const size_t part_size = std::min(size - part_offset, PageSize - offset);
+
+                    f(this->GetPage(page_address), offset, part_offset, part_size);
+                    part_offset += part_size;
+                }
+            }
+            Result FlushPage(Page *page);
+
+            Result ReadDirect(u64 address, void *out, size_t size);
+            Result WriteDirect(u64 address, const void *data, size_t size);
+    };
+
+}
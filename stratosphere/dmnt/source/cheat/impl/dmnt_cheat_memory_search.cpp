@@ -0,0 +1,357 @@
+/*
+ * Copyright (c) Atmosphère-NX
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stratosphere.hpp>
+#include "dmnt_cheat_memory_search.hpp"
+
+namespace ams::dmnt::cheat::impl {
+
+    namespace {
+
+        /* NOTE: Generic vectors let the compiler pick the native simd instructions (neon on arm64, sse on x64). */
+        constexpr size_t VectorSize = 0x10;
+
+        template<typename T> struct VectorTraits;
+        template<> struct VectorTraits<u8>  { typedef u8  Type __attribute__((vector_size(VectorSize))); };
+        template<> struct VectorTraits<u16> { typedef u16 Type __attribute__((vector_size(VectorSize))); };
+        template<> struct VectorTraits<u32> { typedef u32 Type __attribute__((vector_size(VectorSize))); };
+        template<> struct VectorTraits<u64> { typedef u64 Type __attribute__((vector_size(VectorSize))); };
+
+        template<typename T>
+        using Vector = typename VectorTraits<T>::Type;
+
+        constexpr bool IsValidWidth(size_t width) {
+            return width == sizeof(u8) || width == sizeof(u16) || width == sizeof(u32) || width == sizeof(u64);
+        }
+
+        constexpr u64 GetWidthMax(size_t width) {
+            return width == sizeof(u64) ? std::numeric_limits<u64>::max() : ((static_cast<u64>(1) << (BITSIZEOF(u8) * width)) - 1);
+        }
+
+        Result GetValueRange(u64 *out_min, u64 *out_max, const MemorySearchCondition &condition) {
+            const u64 width_max = GetWidthMax(condition.width);
+
+            switch (condition.comparison) {
+                case MemorySearchComparison_Equal:
+                    R_UNLESS(condition.value <= width_max, dmnt::cheat::ResultMemorySearchInvalidCondition());
+
+                    *out_min = condition.value;
+                    *out_max = condition.value;
+                    break;
+                case MemorySearchComparison_InRange:
+                    R_UNLESS(condition.value <= condition.value_max, dmnt::cheat::ResultMemorySearchInvalidCondition());
+                    R_UNLESS(condition.value <= width_max,           dmnt::cheat::ResultMemorySearchInvalidCondition());
+
+                    *out_min = condition.value;
+                    *out_max = std::min(condition.value_max, width_max);
+                    break;
+                default:
+                    R_THROW(dmnt::cheat::ResultMemorySearchInvalidCondition());
+            }
+
+            R_SUCCEED();
+        }
+
+        bool IsMatch(const MemorySearchCondition &condition, u64 value, u64 previous_value, u64 min, u64 max) {
+            switch (condition.comparison) {
+                case MemorySearchComparison_Changed:
+                    return value != previous_value;
+                case MemorySearchComparison_Increased:
+                    return value > previous_value;
+                default:
+                    return min <= value && value <= max;
+            }
+        }
+
+        /* Finds the offsets of every aligned value in [min, max], returning false if there are more than max_count. */
+        template<typename T>
+        bool ScanChunk(size_t *out_count, u16 *out_offsets, size_t max_count, const u8 *data, size_t size, size_t base_offset, u64 min, u64 max) {
+            using VectorType = Vector<T>;
+            constexpr size_t LaneCount = VectorSize / sizeof(T);
+
+            const VectorType min_vector = VectorType{} + static_cast<T>(min);
+            const VectorType max_vector = VectorType{} + static_cast<T>(max);
+
+            size_t count = 0;
+            size_t offset = 0;
+            for (/* ... */; offset + VectorSize <= size; offset += VectorSize) {
+                VectorType values;
+                std::memcpy(std::addressof(values), data + offset, VectorSize);
+
+                const auto mask = (values >= min_vector) & (values <= max_vector);
+
+                /* Most vectors won't match at all, so check for that first. */
+                u64 mask_words[VectorSize / sizeof(u64)];
+                std::memcpy(mask_words, std::addressof(mask), sizeof(mask_words));
+                if ((mask_words[0] | mask_words[1]) == 0) {
+                    continue;
+                }
+
+                for (size_t i = 0; i < LaneCount; ++i) {
+                    if (mask[i]) {
+                        if (count >= max_count) {
+                            return false;
+                        }
+                        out_offsets[count++] = static_cast<u16>(base_offset + offset + i * sizeof(T));
+                    }
+                }
+            }
+
+            /* Check any values past the last full vector. */
+            for (/* ... */; offset + sizeof(T) <= size; offset += sizeof(T)) {
+                T value;
+                std::memcpy(std::addressof(value), data + offset, sizeof(value));
+
+                if (min <= value && value <= max) {
+                    if (count >= max_count) {
+                        return false;
+                    }
+                    out_offsets[count++] = static_cast<u16>(base_offset + offset);
+                }
+            }
+
+            *out_count = count;
+            return true;
+        }
+
+    }
+
+    MemorySearcher::MemorySearcher(void *storage, size_t storage_size, void *chunk_buffer)
+        : m_storage(static_cast<u8 *>(storage)), m_storage_size(util::AlignDown(storage_size, alignof(BlockHeader))), m_chunk_buffer(static_cast<u8 *>(chunk_buffer))
+    {
+        AMS_ASSERT(util::IsAligned(reinterpret_cast<uintptr_t>(storage), alignof(BlockHeader)));
+        this->Clear();
+    }
+
+    void MemorySearcher::Clear() {
+        m_used_size  = 0;
+        m_count      = 0;
+        m_width      = 0;
+        m_is_started = false;
+        this->ResetIterator();
+    }
+
+    void MemorySearcher::ResetIterator() {
+        m_iterator_block_offset = 0;
+        m_iterator_index        = 0;
+    }
+
+    Result MemorySearcher::Start(MemorySearchProvider *provider, const MemorySearchCondition &condition, const MemorySearchRegionFilter &filter) {
+        /* Discard any previous search. */
+        this->Clear();
+
+        /* Validate the condition. */
+        R_UNLESS(IsValidWidth(condition.width), dmnt::cheat::ResultMemorySearchInvalidCondition());
+
+        u64 min, max;
+        R_TRY(GetValueRange(std::addressof(min), std::addressof(max), condition));
+
+        /* If we fail, don't leave a partial search behind. */
+        m_width = condition.width;
+        ON_RESULT_FAILURE { this->Clear(); };
+
+        /* Scan every region the filter selects. */
+        const u64 address_max = filter.address_max != 0 ? filter.address_max : std::numeric_limits<u64>::max();
+
+        u64 address = filter.address_min;
+        while (address < address_max) {
+            MemorySearchRegion region;
+            if (R_FAILED(provider->QueryMemory(std::addressof(region), address))) {
+                break;
+            }
+
+            const bool is_selected = region.permission != 0 &&
+                                     (region.permission & filter.permission) == filter.permission &&
+                                     (filter.state_mask == 0 || (region.state < BITSIZEOF(filter.state_mask) && (filter.state_mask & (1u << region.state)) != 0));
+
+            const u64 region_end = region.address + region.size;
+            if (is_selected) {
+                R_TRY(this->ScanRange(provider, min, max, std::max(address, region.address), std::min(region_end, address_max)));
+            }
+
+            /* Stop when we reach the end of the address space. */
+            if (region_end <= address) {
+                break;
+            }
+            address = region_end;
+        }
+
+        m_is_started = true;
+        R_SUCCEED();
+    }
+
+    Result MemorySearcher::ScanRange(MemorySearchProvider *provider, u64 min, u64 max, u64 address, u64 end) {
+        address = util::AlignUp(address, m_width);
+        while (address + m_width <= end) {
+            /* Read up to the end of the chunk containing the address. */
+            const u64 chunk_address = util::AlignDown(address, ChunkSize);
+            const u64 read_end      = std::min(end, chunk_address + ChunkSize);
+            const size_t read_size  = read_end - address;
+            ON_SCOPE_EXIT { address = read_end; };
+
+            /* Skip anything we can't read. */
+            if (R_FAILED(provider->ReadMemory(address, m_chunk_buffer, read_size))) {
+                continue;
+            }
+
+            /* Find the matches, placing their offsets directly into a new block. */
+            R_UNLESS(m_used_size + sizeof(BlockHeader) <= m_storage_size, dmnt::cheat::ResultMemorySearchOutOfResource());
+
+            BlockHeader *header = reinterpret_cast<BlockHeader *>(m_storage + m_used_size);
+            u16 *offsets        = reinterpret_cast<u16 *>(header + 1);
+
+            const size_t max_count = (m_storage_size - m_used_size - sizeof(BlockHeader)) / (sizeof(u16) + m_width);
+            const size_t base      = address - chunk_address;
+
+            size_t count = 0;
+            bool fit = false;
+            switch (m_width) {
+                case sizeof(u8):  fit = ScanChunk<u8>(std::addressof(count), offsets, max_count, m_chunk_buffer, read_size, base, min, max);  break;
+                case sizeof(u16): fit = ScanChunk<u16>(std::addressof(count), offsets, max_count, m_chunk_buffer, read_size, base, min, max); break;
+                case sizeof(u32): fit = ScanChunk<u32>(std::addressof(count), offsets, max_count, m_chunk_buffer, read_size, base, min, max); break;
+                case sizeof(u64): fit = ScanChunk<u64>(std::addressof(count), offsets, max_count, m_chunk_buffer, read_size, base, min, max); break;
+                AMS_UNREACHABLE_DEFAULT_CASE();
+            }
+            R_UNLESS(fit, dmnt::cheat::ResultMemorySearchOutOfResource());
+
+            if (count == 0) {
+                continue;
+            }
+
+            /* Store the values after the offsets. */
+            u8 *values = reinterpret_cast<u8 *>(offsets + count);
+            for (size_t i = 0; i < count; ++i) {
+                std::memcpy(values + i * m_width, m_chunk_buffer + (offsets[i] - base), m_width);
+            }
+
+            header->address  = chunk_address;
+            header->count    = count;
+            header->reserved = 0;
+
+            m_used_size += GetBlockSize(count, m_width);
+            m_count     += count;
+        }
+
+        R_SUCCEED();
+    }
+
+    Result MemorySearcher::Narrow(MemorySearchProvider *provider, const MemorySearchCondition &condition) {
+        /* Validate the condition. */
+        R_UNLESS(m_is_started,                dmnt::cheat::ResultMemorySearchNotStarted());
+        R_UNLESS(condition.width == m_width,  dmnt::cheat::ResultMemorySearchInvalidCondition());
+
+        u64 min = 0, max = 0;
+        if (condition.comparison != MemorySearchComparison_Changed && condition.comparison != MemorySearchComparison_Increased) {
+            R_TRY(GetValueRange(std::addressof(min), std::addressof(max), condition));
+        }
+
+        /* Rewrite each block in place, keeping only the matches. */
+        this->ResetIterator();
+
+        size_t read_offset = 0, write_offset = 0;
+        u64 total_count = 0;
+        while (read_offset < m_used_size) {
+            BlockHeader *header = reinterpret_cast<BlockHeader *>(m_storage + read_offset);
+            u16 *offsets        = reinterpret_cast<u16 *>(header + 1);
+            u8 *values          = reinterpret_cast<u8 *>(offsets + header->count);
+
+            const u32 count = header->count;
+            read_offset += GetBlockSize(count, m_width);
+
+            /* Read everything from the first match to the last in one go. If we can't, the memory is gone. */
+            const size_t first = offsets[0];
+            if (R_FAILED(provider->ReadMemory(header->address + first, m_chunk_buffer, offsets[count - 1] + m_width - first))) {
+                continue;
+            }
+
+            u32 new_count = 0;
+            for (u32 i = 0; i < count; ++i) {
+                u64 value = 0, previous_value = 0;
+                std::memcpy(std::addressof(value), m_chunk_buffer + (offsets[i] - first), m_width);
+                std::memcpy(std::addressof(previous_value), values + i * m_width, m_width);
+
+                if (IsMatch(condition, value, previous_value, min, max)) {
+                    offsets[new_count] = offsets[i];
+                    std::memcpy(values + new_count * m_width, std::addressof(value), m_width);
+                    ++new_count;
+                }
+            }
+
+            if (new_count == 0) {
+                continue;
+            }
+
+            /* Move the values to follow the remaining offsets, then move the block into place. */
+            std::memmove(offsets + new_count, values, new_count * m_width);
+            header->count = new_count;
+
+            const size_t new_size = GetBlockSize(new_count, m_width);
+            if (m_storage + write_offset != reinterpret_cast<u8 *>(header)) {
+                std::memmove(m_storage + write_offset, header, new_size);
+            }
+
+            write_offset += new_size;
+            total_count  += new_count;
+        }
+
+        m_used_size = write_offset;
+        m_count     = total_count;
+        R_SUCCEED();
+    }
+
+    Result MemorySearcher::GetResults(MemorySearchResult *out, size_t max_count, u64 *out_count, u64 offset) {
+        R_UNLESS(m_is_started, dmnt::cheat::ResultMemorySearchNotStarted());
+
+        /* Resume from where the last call left off, which makes iterating in order linear. */
+        if (offset < m_iterator_index) {
+            this->ResetIterator();
+        }
+
+        /* Find the block containing the first result we want. */
+        while (m_iterator_block_offset < m_used_size) {
+            const BlockHeader *header = reinterpret_cast<const BlockHeader *>(m_storage + m_iterator_block_offset);
+            if (offset < m_iterator_index + header->count) {
+                break;
+            }
+
+            m_iterator_index        += header->count;
+            m_iterator_block_offset += GetBlockSize(header->count, m_width);
+        }
+
+        /* Write out results. */
+        size_t count        = 0;
+        size_t block_offset = m_iterator_block_offset;
+        u64 block_index     = m_iterator_index;
+        while (count < max_count && block_offset < m_used_size) {
+            const BlockHeader *header = reinterpret_cast<const BlockHeader *>(m_storage + block_offset);
+            const u16 *offsets        = reinterpret_cast<const u16 *>(header + 1);
+            const u8 *values          = reinterpret_cast<const u8 *>(offsets + header->count);
+
+            for (u32 i = offset + count - block_index; i < header->count && count < max_count; ++i) {
+                u64 value = 0;
+                std::memcpy(std::addressof(value), values + i * m_width, m_width);
+
+                out[count++] = { .address = header->address + offsets[i], .value = value };
+            }
+
+            block_index  += header->count;
+            block_offset += GetBlockSize(header->count, m_width);
+        }
+
+        *out_count = count;
+        R_SUCCEED();
+    }
+
+}
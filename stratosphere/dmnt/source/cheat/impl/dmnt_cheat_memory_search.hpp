@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) Atmosphère-NX
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <stratosphere.hpp>
+
+namespace ams::dmnt::cheat::impl {
+
+    struct MemorySearchRegion {
+        u64 address;
+        u64 size;
+        u32 state;
+        u32 permission;
+    };
+
+    /* Provides the memory a search scans, so that searching doesn't depend on the debug svcs. */
+    class MemorySearchProvider {
+        public:
+            virtual ~MemorySearchProvider() { /* ... */ }
+
+            /* Gets the region containing an address. Regions must be page-aligned, and cover the whole address space. */
+            virtual Result QueryMemory(MemorySearchRegion *out, u64 address) = 0;
+            virtual Result ReadMemory(u64 address, void *dst, size_t size) = 0;
+    };
+
+    /* Searches memory for values, keeping the matches in caller-provided storage. */
+    /* Matches are stored in blocks, one per chunk of address space, which hold a 16-bit offset and the */
+    /* value for each match. Narrowing passes rewrite the blocks in place, so they never need more storage. */
+    class MemorySearcher {
+        NON_COPYABLE(MemorySearcher);
+        NON_MOVEABLE(MemorySearcher);
+        public:
+            static constexpr size_t ChunkSize = 64_KB;
+        private:
+            struct BlockHeader {
+                u64 address;
+                u32 count;
+                u32 reserved;
+            };
+            static_assert(ChunkSize - 1 <= std::numeric_limits<u16>::max());
+        private:
+            u8 *m_storage;
+            size_t m_storage_size;
+            u8 *m_chunk_buffer;
+            size_t m_used_size;
+            u64 m_count;
+            u8 m_width;
+            bool m_is_started;
+            size_t m_iterator_block_offset;
+            u64 m_iterator_index;
+        public:
+            /* NOTE: The chunk buffer must be ChunkSize bytes, aligned to the largest width. */
+            MemorySearcher(void *storage, size_t storage_size, void *chunk_buffer);
+
+            Result Start(MemorySearchProvider *provider, const MemorySearchCondition &condition, const MemorySearchRegionFilter &filter);
+            Result Narrow(MemorySearchProvider *provider, const MemorySearchCondition &condition);
+            void Clear();
+
+            bool IsStarted() const { return m_is_started; }
+            u64 GetCount() const { return m_count; }
+
+            Result GetResults(MemorySearchResult *out, size_t max_count, u64 *out_count, u64 offset);
+        private:
+            static size_t GetBlockSize(u32 count, size_t width) {
+                return util::AlignUp(sizeof(BlockHeader) + count * (sizeof(u16) + width), alignof(BlockHeader));
+            }
+
+            Result ScanRange(MemorySearchProvider *provider, u64 min, u64 max, u64 address, u64 end);
+            void ResetIterator();
+    };
+
+}
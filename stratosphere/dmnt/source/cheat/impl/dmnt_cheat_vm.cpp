@@ -310,11 +310,11 @@ namespace ams::dmnt::cheat::impl {
 
         /* Helper function for getting instruction dwords. */
         auto GetNextDword = [&]() {
-            if (m_instruction_ptr >= m_num_opcodes) {
+            if (m_decode_ptr >= m_num_opcodes) {
                 valid = false;
                 return static_cast<u32>(0);
             }
-            return m_program[m_instruction_ptr++];
+            return m_program[m_decode_ptr++];
         };
 
         /* Helper function for parsing a VmInt. */
@@ -674,31 +674,78 @@ namespace ams::dmnt::cheat::impl {
         return valid;
     }
 
-    void CheatVirtualMachine::SkipConditionalBlock(bool is_if) {
-        if (m_condition_depth > 0) {
-            /* We want to continue until we're out of the current block. */
-            const size_t desired_depth = m_condition_depth - 1;
-
-            CheatVmOpcode skip_opcode;
-            while (m_condition_depth > desired_depth && this->DecodeNextOpcode(std::addressof(skip_opcode))) {
-                /* Decode instructions until we see end of the current conditional block. */
-                /* NOTE: This is broken in gateway's implementation. */
-                /* Gateway currently checks for "0x2" instead of "0x20000000" */
-                /* In addition, they do a linear scan instead of correctly decoding opcodes. */
-                /* This causes issues if "0x2" appears as an immediate in the conditional block... */
-
-                /* We also support nesting of conditional blocks, and Gateway does not. */
-                if (skip_opcode.begin_conditional_block) {
-                    m_condition_depth++;
-                } else if (skip_opcode.opcode == CheatVmOpcodeType_EndConditionalBlock) {
-                    if (!skip_opcode.end_cond.is_else) {
-                        m_condition_depth--;
-                    } else if (is_if && m_condition_depth - 1 == desired_depth) {
-                        /* An if will continue to an else at the same depth. */
-                        break;
-                    }
+    void CheatVirtualMachine::CompileProgram() {
+        /* Decode every opcode up front, stopping at the first one which fails to decode. */
+        m_decode_ptr = 0;
+        m_decode_success = true;
+        m_num_compiled_opcodes = 0;
+        while (true) {
+            CheatVmOpcode opcode;
+            if (!this->DecodeNextOpcode(std::addressof(opcode))) {
+                break;
+            }
+
+            if (opcode.begin_conditional_block) {
+                opcode.block_type = CheatVmBlockType_Begin;
+            } else if (opcode.opcode == CheatVmOpcodeType_EndConditionalBlock) {
+                opcode.block_type = opcode.end_cond.is_else ? CheatVmBlockType_Else : CheatVmBlockType_End;
+            } else {
+                opcode.block_type = CheatVmBlockType_None;
+            }
+
+            m_compiled_program[m_num_compiled_opcodes++] = opcode;
+        }
+
+        /* Resolve where each conditional skip lands, walking backwards so that nested blocks are already resolved. */
+        /* NOTE: This is broken in gateway's implementation. */
+        /* Gateway currently checks for "0x2" instead of "0x20000000" */
+        /* In addition, they do a linear scan instead of correctly decoding opcodes. */
+        /* This causes issues if "0x2" appears as an immediate in the conditional block... */
+        /* We also support nesting of conditional blocks, and Gateway does not. */
+        /* An index of m_num_compiled_opcodes means the skip runs off the end of the program. */
+        static_assert(MaximumProgramOpcodeCount <= std::numeric_limits<u16>::max());
+        const u16 program_end = static_cast<u16>(m_num_compiled_opcodes);
+
+        u16 else_or_end_index = program_end;
+        u16 end_index         = program_end;
+        for (size_t i = m_num_compiled_opcodes; i > 0; i--) {
+            CheatVmOpcode &opcode = m_compiled_program[i - 1];
+
+            /* Each opcode holds the skip targets for the opcodes following it. */
+            opcode.else_or_end_index = else_or_end_index;
+            opcode.end_index         = end_index;
+
+            /* Update the skip targets to include this opcode. */
+            if (opcode.block_type == CheatVmBlockType_Begin) {
+                /* Skips pass over nested blocks entirely, continuing after their end. */
+                if (end_index != program_end) {
+                    else_or_end_index = m_compiled_program[end_index].else_or_end_index;
+                    end_index         = m_compiled_program[end_index].end_index;
+                } else {
+                    else_or_end_index = program_end;
+                }
+            } else if (opcode.block_type != CheatVmBlockType_None) {
+                else_or_end_index = static_cast<u16>(i - 1);
+                if (opcode.block_type == CheatVmBlockType_End) {
+                    end_index = static_cast<u16>(i - 1);
                 }
             }
+        }
+    }
+
+    void CheatVirtualMachine::SkipConditionalBlock(const CheatVmOpcode &opcode, bool is_if) {
+        if (m_condition_depth > 0) {
+            /* Jump past the end of the current block. An if will continue to an else at the same depth. */
+            const size_t target = is_if ? opcode.else_or_end_index : opcode.end_index;
+            if (target >= m_num_compiled_opcodes) {
+                m_instruction_ptr = m_num_compiled_opcodes;
+                return;
+            }
+
+            if (m_compiled_program[target].block_type != CheatVmBlockType_Else) {
+                m_condition_depth--;
+            }
+            m_instruction_ptr = target + 1;
         } else {
             /* Skipping, but m_condition_depth = 0. */
             /* This is an error condition. */
@@ -745,12 +792,12 @@ namespace ams::dmnt::cheat::impl {
         }
         m_instruction_ptr = 0;
         m_condition_depth = 0;
-        m_decode_success = true;
     }
 
     bool CheatVirtualMachine::LoadProgram(const CheatEntry *cheats, size_t num_cheats) {
         /* Reset opcode count. */
         m_num_opcodes = 0;
+        m_num_compiled_opcodes = 0;
 
         for (size_t i = 0; i < num_cheats; i++) {
             if (cheats[i].enabled) {
@@ -766,11 +813,13 @@ namespace ams::dmnt::cheat::impl {
             }
         }
 
+        /* Compile the program, so that executing it doesn't need to decode anything. */
+        this->CompileProgram();
+
         return true;
     }
 
     void CheatVirtualMachine::Execute(const CheatProcessMetadata *metadata) {
-        CheatVmOpcode cur_opcode;
         u64 kHeld = 0;
 
         /* Get Keys held. */
@@ -788,7 +837,9 @@ namespace ams::dmnt::cheat::impl {
         this->ResetState();
 
         /* Loop until program finishes. */
-        while (this->DecodeNextOpcode(std::addressof(cur_opcode))) {
+        while (m_instruction_ptr < m_num_compiled_opcodes) {
+            const CheatVmOpcode &cur_opcode = m_compiled_program[m_instruction_ptr++];
+
             this->LogToDebugFile("Instruction Ptr: %04x\n", (u32)m_instruction_ptr);
 
             for (size_t i = 0; i < NumRegisters; i++) {
@@ -859,14 +910,14 @@ namespace ams::dmnt::cheat::impl {
                         }
                         /* Skip conditional block if condition not met. */
                         if (!cond_met) {
-                            this->SkipConditionalBlock(true);
+                            this->SkipConditionalBlock(cur_opcode, true);
                         }
                     }
                     break;
                 case CheatVmOpcodeType_EndConditionalBlock:
                     if (cur_opcode.end_cond.is_else) {
                         /* Skip to the end of the conditional block. */
-                        this->SkipConditionalBlock(false);
+                        this->SkipConditionalBlock(cur_opcode, false);
                     } else {
                         /* Decrement the condition depth. */
                         /* We will assume, graciously, that mismatched conditional block ends are a nop. */
@@ -979,7 +1030,7 @@ namespace ams::dmnt::cheat::impl {
                     /* Check for keypress. */
                     if ((cur_opcode.begin_keypress_cond.key_mask & kHeld) != cur_opcode.begin_keypress_cond.key_mask) {
                         /* Keys not pressed. Skip conditional block. */
-                        this->SkipConditionalBlock(true);
+                        this->SkipConditionalBlock(cur_opcode, true);
                     }
                     break;
                 case CheatVmOpcodeType_PerformArithmeticRegister:
@@ -1178,7 +1229,7 @@ namespace ams::dmnt::cheat::impl {
 
                         /* Skip conditional block if condition not met. */
                         if (!cond_met) {
-                            this->SkipConditionalBlock(true);
+                            this->SkipConditionalBlock(cur_opcode, true);
                         }
                     }
                     break;
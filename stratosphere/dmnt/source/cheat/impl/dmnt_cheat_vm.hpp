@@ -18,7 +18,7 @@
 
 namespace ams::dmnt::cheat::impl {
 
-    enum CheatVmOpcodeType : u32 {
+    enum CheatVmOpcodeType : u16 {
         CheatVmOpcodeType_StoreStatic = 0,
         CheatVmOpcodeType_BeginConditionalBlock = 1,
         CheatVmOpcodeType_EndConditionalBlock = 2,
@@ -54,14 +54,14 @@ namespace ams::dmnt::cheat::impl {
         CheatVmOpcodeType_DebugLog = 0xFFF,
     };
 
-    enum MemoryAccessType : u32 {
+    enum MemoryAccessType : u8 {
         MemoryAccessType_MainNso = 0,
         MemoryAccessType_Heap    = 1,
         MemoryAccessType_Alias   = 2,
         MemoryAccessType_Aslr    = 3,
     };
 
-    enum ConditionalComparisonType : u32 {
+    enum ConditionalComparisonType : u8 {
         ConditionalComparisonType_GT = 1,
         ConditionalComparisonType_GE = 2,
         ConditionalComparisonType_LT = 3,
@@ -70,7 +70,7 @@ namespace ams::dmnt::cheat::impl {
         ConditionalComparisonType_NE = 6,
     };
 
-    enum RegisterArithmeticType : u32 {
+    enum RegisterArithmeticType : u8 {
         RegisterArithmeticType_Addition = 0,
         RegisterArithmeticType_Subtraction = 1,
         RegisterArithmeticType_Multiplication = 2,
@@ -86,7 +86,7 @@ namespace ams::dmnt::cheat::impl {
         RegisterArithmeticType_None = 9,
     };
 
-    enum StoreRegisterOffsetType : u32 {
+    enum StoreRegisterOffsetType : u8 {
         StoreRegisterOffsetType_None = 0,
         StoreRegisterOffsetType_Reg = 1,
         StoreRegisterOffsetType_Imm = 2,
@@ -95,7 +95,7 @@ namespace ams::dmnt::cheat::impl {
         StoreRegisterOffsetType_MemImmReg = 5,
     };
 
-    enum CompareRegisterValueType : u32 {
+    enum CompareRegisterValueType : u8 {
         CompareRegisterValueType_MemoryRelAddr = 0,
         CompareRegisterValueType_MemoryOfsReg = 1,
         CompareRegisterValueType_RegisterRelAddr = 2,
@@ -104,14 +104,14 @@ namespace ams::dmnt::cheat::impl {
         CompareRegisterValueType_OtherRegister = 5,
     };
 
-    enum SaveRestoreRegisterOpType : u32 {
+    enum SaveRestoreRegisterOpType : u8 {
         SaveRestoreRegisterOpType_Restore = 0,
         SaveRestoreRegisterOpType_Save = 1,
         SaveRestoreRegisterOpType_ClearSaved = 2,
         SaveRestoreRegisterOpType_ClearRegs = 3,
     };
 
-    enum DebugLogValueType : u32 {
+    enum DebugLogValueType : u8 {
         DebugLogValueType_MemoryRelAddr = 0,
         DebugLogValueType_MemoryOfsReg = 1,
         DebugLogValueType_RegisterRelAddr = 2,
@@ -127,15 +127,15 @@ namespace ams::dmnt::cheat::impl {
     };
 
     struct StoreStaticOpcode {
-        u32 bit_width;
+        u8 bit_width;
         MemoryAccessType mem_type;
-        u32 offset_register;
+        u8 offset_register;
         u64 rel_address;
         VmInt value;
     };
 
     struct BeginConditionalOpcode {
-        u32 bit_width;
+        u8 bit_width;
         MemoryAccessType mem_type;
         ConditionalComparisonType cond_type;
         u64 rel_address;
@@ -148,35 +148,35 @@ namespace ams::dmnt::cheat::impl {
 
     struct ControlLoopOpcode {
         bool start_loop;
-        u32 reg_index;
+        u8 reg_index;
         u32 num_iters;
     };
 
     struct LoadRegisterStaticOpcode {
-        u32 reg_index;
+        u8 reg_index;
         u64 value;
     };
 
     struct LoadRegisterMemoryOpcode {
-        u32 bit_width;
+        u8 bit_width;
         MemoryAccessType mem_type;
-        u32 reg_index;
+        u8 reg_index;
         bool load_from_reg;
         u64 rel_address;
     };
 
     struct StoreStaticToAddressOpcode {
-        u32 bit_width;
-        u32 reg_index;
+        u8 bit_width;
+        u8 reg_index;
         bool increment_reg;
         bool add_offset_reg;
-        u32 offset_reg_index;
+        u8 offset_reg_index;
         u64 value;
     };
 
     struct PerformArithmeticStaticOpcode {
-        u32 bit_width;
-        u32 reg_index;
+        u8 bit_width;
+        u8 reg_index;
         RegisterArithmeticType math_type;
         u32 value;
     };
@@ -186,42 +186,42 @@ namespace ams::dmnt::cheat::impl {
     };
 
     struct PerformArithmeticRegisterOpcode {
-        u32 bit_width;
+        u8 bit_width;
         RegisterArithmeticType math_type;
-        u32 dst_reg_index;
-        u32 src_reg_1_index;
-        u32 src_reg_2_index;
+        u8 dst_reg_index;
+        u8 src_reg_1_index;
+        u8 src_reg_2_index;
         bool has_immediate;
         VmInt value;
     };
 
     struct StoreRegisterToAddressOpcode {
-        u32 bit_width;
-        u32 str_reg_index;
-        u32 addr_reg_index;
+        u8 bit_width;
+        u8 str_reg_index;
+        u8 addr_reg_index;
         bool increment_reg;
         StoreRegisterOffsetType ofs_type;
         MemoryAccessType mem_type;
-        u32 ofs_reg_index;
+        u8 ofs_reg_index;
         u64 rel_address;
     };
 
     struct BeginRegisterConditionalOpcode {
-        u32 bit_width;
+        u8 bit_width;
         ConditionalComparisonType cond_type;
-        u32 val_reg_index;
+        u8 val_reg_index;
         CompareRegisterValueType comp_type;
         MemoryAccessType mem_type;
-        u32 addr_reg_index;
-        u32 other_reg_index;
-        u32 ofs_reg_index;
+        u8 addr_reg_index;
+        u8 other_reg_index;
+        u8 ofs_reg_index;
         u64 rel_address;
         VmInt value;
     };
 
     struct SaveRestoreRegisterOpcode {
-        u32 dst_index;
-        u32 src_index;
+        u8 dst_index;
+        u8 src_index;
         SaveRestoreRegisterOpType op_type;
     };
 
@@ -231,24 +231,37 @@ namespace ams::dmnt::cheat::impl {
     };
 
     struct ReadWriteStaticRegisterOpcode {
-        u32 static_idx;
-        u32 idx;
+        u8 static_idx;
+        u8 idx;
     };
 
     struct DebugLogOpcode {
-        u32 bit_width;
-        u32 log_id;
+        u8 bit_width;
+        u8 log_id;
         DebugLogValueType val_type;
         MemoryAccessType mem_type;
-        u32 addr_reg_index;
-        u32 val_reg_index;
-        u32 ofs_reg_index;
+        u8 addr_reg_index;
+        u8 val_reg_index;
+        u8 ofs_reg_index;
         u64 rel_address;
     };
 
+    enum CheatVmBlockType : u8 {
+        CheatVmBlockType_None  = 0,
+        CheatVmBlockType_Begin = 1,
+        CheatVmBlockType_Else  = 2,
+        CheatVmBlockType_End   = 3,
+    };
+
     struct CheatVmOpcode {
         CheatVmOpcodeType opcode;
         bool begin_conditional_block;
+
+        /* These are resolved when the program is compiled, so that conditional skips never need to decode. */
+        CheatVmBlockType block_type;
+        u16 else_or_end_index;
+        u16 end_index;
+
         union {
             StoreStaticOpcode store_static;
             BeginConditionalOpcode begin_cond;
@@ -269,6 +282,9 @@ namespace ams::dmnt::cheat::impl {
         };
     };
 
+    /* NOTE: Operands are packed into narrow fields, as a compiled program holds up to 0x400 decoded opcodes. */
+    static_assert(sizeof(CheatVmOpcode) == 0x20);
+
     class CheatVirtualMachine {
         public:
             constexpr static size_t MaximumProgramOpcodeCount = 0x400;
@@ -278,17 +294,21 @@ namespace ams::dmnt::cheat::impl {
             constexpr static size_t NumStaticRegisters = NumReadableStaticRegisters + NumWritableStaticRegisters;
         private:
             size_t m_num_opcodes = 0;
+            size_t m_num_compiled_opcodes = 0;
             size_t m_instruction_ptr = 0;
+            size_t m_decode_ptr = 0;
             size_t m_condition_depth = 0;
             bool m_decode_success = false;
             u32 m_program[MaximumProgramOpcodeCount] = {0};
+            CheatVmOpcode m_compiled_program[MaximumProgramOpcodeCount] = {};
             u64 m_registers[NumRegisters] = {0};
             u64 m_saved_values[NumRegisters] = {0};
             u64 m_static_registers[NumStaticRegisters] = {0};
             size_t m_loop_tops[NumRegisters] = {0};
         private:
             bool DecodeNextOpcode(CheatVmOpcode *out);
-            void SkipConditionalBlock(bool is_if);
+            void CompileProgram();
+            void SkipConditionalBlock(const CheatVmOpcode &opcode, bool is_if);
             void ResetState();
 
             /* For implementing the DebugLog opcode. */
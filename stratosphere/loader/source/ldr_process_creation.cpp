@@ -77,10 +77,33 @@ namespace ams::ldr {
             size_t    nso_size[Nso_Count];
         };
 
+        struct LoadSegmentsTask {
+            fs::FileHandle file;
+            const NsoHeader *nso_header;
+            uintptr_t map_address;
+            uintptr_t staging_end;
+            size_t segment_index;
+            size_t segment_count;
+            Result result;
+        };
+
+        constexpr size_t LoadWorkerThreadCount     = 3;
+        constexpr size_t LoadWorkerThreadStackSize = 16_KB;
+
+        constexpr size_t SegmentHashUnitSize = 16_KB;
+
         /* Global NSO header cache. */
         bool g_has_nso[Nso_Count];
         NsoHeader g_nso_headers[Nso_Count];
 
+        /* Global segment loading state. */
+        LoadSegmentsTask g_load_segments_tasks[static_cast<size_t>(Nso_Count) * NsoHeader::Segment_Count];
+        size_t g_load_segments_task_count;
+        constinit std::atomic<size_t> g_load_segments_task_index;
+
+        os::ThreadType g_load_worker_threads[LoadWorkerThreadCount];
+        alignas(os::ThreadStackAlignment) constinit u8 g_load_worker_thread_stacks[LoadWorkerThreadCount][LoadWorkerThreadStackSize];
+
         Result ValidateProgramVersion(ncm::ProgramId program_id, u32 version) {
             /* No version verification is done before 8.1.0. */
             R_SUCCEED_IF(hos::GetVersion() < hos::Version_8_1_0);
@@ -497,6 +520,11 @@ namespace ams::ldr {
             R_SUCCEED();
         }
 
+        bool UpdateSegmentHash(const void *data, size_t size, void *arg) {
+            static_cast<crypto::Sha256Generator *>(arg)->Update(data, size);
+            return true;
+        }
+
         Result LoadAutoLoadModuleSegment(fs::FileHandle file, const NsoHeader::SegmentInfo *segment, size_t file_size, const u8 *file_hash, bool is_compressed, bool check_hash, uintptr_t map_base, uintptr_t map_end) {
             /* Select read size based on compression. */
             if (!is_compressed) {
@@ -513,16 +541,21 @@ namespace ams::ldr {
             R_TRY(fs::ReadFile(std::addressof(read_size), file, segment->file_offset, reinterpret_cast<void *>(load_address), file_size));
             R_UNLESS(read_size == file_size, ldr::ResultInvalidNso());
 
-            /* Uncompress if necessary. */
+            /* Uncompress if necessary, hashing the output while it's still in cache. */
+            crypto::Sha256Generator generator;
+            generator.Initialize();
             if (is_compressed) {
-                bool decompressed = (util::DecompressLZ4(reinterpret_cast<void *>(map_base), segment->size, reinterpret_cast<const void *>(load_address), file_size) == static_cast<int>(segment->size));
-                R_UNLESS(decompressed, ldr::ResultInvalidNso());
+                const int decompressed_size = check_hash ? util::DecompressLZ4(reinterpret_cast<void *>(map_base), segment->size, reinterpret_cast<const void *>(load_address), file_size, SegmentHashUnitSize, UpdateSegmentHash, std::addressof(generator))
+                                                         : util::DecompressLZ4(reinterpret_cast<void *>(map_base), segment->size, reinterpret_cast<const void *>(load_address), file_size);
+                R_UNLESS(decompressed_size == static_cast<int>(segment->size), ldr::ResultInvalidNso());
+            } else if (check_hash) {
+                generator.Update(reinterpret_cast<void *>(map_base), segment->size);
             }
 
             /* Check hash if necessary. */
             if (check_hash) {
                 u8 hash[crypto::Sha256Generator::HashSize];
-                crypto::GenerateSha256(hash, sizeof(hash), reinterpret_cast<void *>(map_base), segment->size);
+                generator.GetHash(hash, sizeof(hash));
 
                 R_UNLESS(std::memcmp(hash, file_hash, sizeof(hash)) == 0, ldr::ResultInvalidNso());
             }
@@ -530,40 +563,113 @@ namespace ams::ldr {
             R_SUCCEED();
         }
 
-        Result LoadAutoLoadModule(os::NativeHandle process_handle, fs::FileHandle file, const NsoHeader *nso_header, uintptr_t nso_address, size_t nso_size) {
-            /* Map and read data from file. */
-            {
-                /* Map the process memory. */
-                void *mapped_memory = nullptr;
-                R_TRY(os::MapProcessMemory(std::addressof(mapped_memory), process_handle, nso_address, nso_size, GenerateSecureRandom));
-                ON_SCOPE_EXIT { os::UnmapProcessMemory(mapped_memory, process_handle, nso_address, nso_size); };
+        Result LoadAutoLoadModuleSegments(const LoadSegmentsTask &task) {
+            const NsoHeader *nso_header = task.nso_header;
+            for (size_t i = task.segment_index; i < task.segment_index + task.segment_count; ++i) {
+                const bool is_compressed = (nso_header->flags & (NsoHeader::Flag_CompressedText << i)) != 0;
+                const bool check_hash    = (nso_header->flags & (NsoHeader::Flag_CheckHashText  << i)) != 0;
+                R_TRY(LoadAutoLoadModuleSegment(task.file, std::addressof(nso_header->segments[i]), nso_header->compressed_sizes[i], nso_header->segment_hashes[i], is_compressed, check_hash, task.map_address + nso_header->segments[i].dst_offset, task.staging_end));
+            }
+
+            R_SUCCEED();
+        }
+
+        size_t AddLoadSegmentsTasks(LoadSegmentsTask *tasks, fs::FileHandle file, const NsoHeader *nso_header, uintptr_t map_address, size_t nso_size) {
+            /* Compressed segments are staged at the end of the mapping and decompressed towards the start. */
+            /* If the staged data for every segment fits after all of the segments' output, the segments are independent. */
+            u64 output_end = 0, staged_size = 0;
+            for (size_t i = 0; i < NsoHeader::Segment_Count; ++i) {
+                output_end = std::max<u64>(output_end, static_cast<u64>(nso_header->segments[i].dst_offset) + nso_header->segments[i].size);
+                if ((nso_header->flags & (NsoHeader::Flag_CompressedText << i)) != 0) {
+                    staged_size += nso_header->compressed_sizes[i];
+                }
+            }
+
+            /* Otherwise, the segments must be loaded in order, sharing the staging area. */
+            if (output_end > nso_size || staged_size > nso_size - output_end) {
+                tasks[0] = { file, nso_header, map_address, map_address + nso_size, 0, NsoHeader::Segment_Count, ResultSuccess() };
+                return 1;
+            }
+
+            uintptr_t staging_end = map_address + nso_size;
+            for (size_t i = 0; i < NsoHeader::Segment_Count; ++i) {
+                tasks[i] = { file, nso_header, map_address, staging_end, i, 1, ResultSuccess() };
+                if ((nso_header->flags & (NsoHeader::Flag_CompressedText << i)) != 0) {
+                    staging_end -= nso_header->compressed_sizes[i];
+                }
+            }
+            return NsoHeader::Segment_Count;
+        }
+
+        void RunLoadSegmentsTasks() {
+            while (true) {
+                const size_t index = g_load_segments_task_index.fetch_add(1);
+                if (index >= g_load_segments_task_count) {
+                    break;
+                }
+
+                auto &task = g_load_segments_tasks[index];
+                task.result = LoadAutoLoadModuleSegments(task);
+            }
+        }
 
-                const uintptr_t map_address = reinterpret_cast<uintptr_t>(mapped_memory);
+        void LoadWorkerThreadFunction(void *) {
+            RunLoadSegmentsTasks();
+        }
 
-                /* Load NSO segments. */
-                R_TRY(LoadAutoLoadModuleSegment(file, std::addressof(nso_header->segments[NsoHeader::Segment_Text]), nso_header->text_compressed_size, nso_header->text_hash, (nso_header->flags & NsoHeader::Flag_CompressedText) != 0,
-                                                      (nso_header->flags & NsoHeader::Flag_CheckHashText) != 0, map_address + nso_header->text_dst_offset, map_address + nso_size));
-                R_TRY(LoadAutoLoadModuleSegment(file, std::addressof(nso_header->segments[NsoHeader::Segment_Ro]), nso_header->ro_compressed_size, nso_header->ro_hash, (nso_header->flags & NsoHeader::Flag_CompressedRo) != 0,
-                                                      (nso_header->flags & NsoHeader::Flag_CheckHashRo) != 0, map_address + nso_header->ro_dst_offset, map_address + nso_size));
-                R_TRY(LoadAutoLoadModuleSegment(file, std::addressof(nso_header->segments[NsoHeader::Segment_Rw]), nso_header->rw_compressed_size, nso_header->rw_hash, (nso_header->flags & NsoHeader::Flag_CompressedRw) != 0,
-                                                      (nso_header->flags & NsoHeader::Flag_CheckHashRw) != 0, map_address + nso_header->rw_dst_offset, map_address + nso_size));
+        Result RunLoadSegmentsTasksInParallel(size_t task_count) {
+            /* Setup the tasks. */
+            g_load_segments_task_count = task_count;
+            g_load_segments_task_index = 0;
+
+            /* Start workers to help with the tasks. If we can't create a worker, we'll just do more of the tasks ourselves. */
+            /* NOTE: Our main thread runs on core 3, so we run workers on the other cores. */
+            const size_t max_worker_count = task_count > 1 ? std::min(LoadWorkerThreadCount, task_count - 1) : 0;
+            size_t worker_count = 0;
+            while (worker_count < max_worker_count) {
+                auto &thread = g_load_worker_threads[worker_count];
+                if (R_FAILED(os::CreateThread(std::addressof(thread), LoadWorkerThreadFunction, nullptr, g_load_worker_thread_stacks[worker_count], LoadWorkerThreadStackSize, AMS_GET_SYSTEM_THREAD_PRIORITY(ldr, LoadWorker), static_cast<s32>(worker_count)))) {
+                    break;
+                }
 
-                /* Clear unused space to zero. */
-                const size_t text_end = nso_header->text_dst_offset + nso_header->text_size;
-                const size_t ro_end   = nso_header->ro_dst_offset   + nso_header->ro_size;
-                const size_t rw_end   = nso_header->rw_dst_offset   + nso_header->rw_size;
-                std::memset(reinterpret_cast<void *>(map_address + 0),        0, nso_header->text_dst_offset);
-                std::memset(reinterpret_cast<void *>(map_address + text_end), 0, nso_header->ro_dst_offset - text_end);
-                std::memset(reinterpret_cast<void *>(map_address + ro_end),   0, nso_header->rw_dst_offset - ro_end);
-                std::memset(reinterpret_cast<void *>(map_address + rw_end),   0, nso_header->bss_size);
+                os::SetThreadNamePointer(std::addressof(thread), AMS_GET_SYSTEM_THREAD_NAME(ldr, LoadWorker));
+                os::StartThread(std::addressof(thread));
+                ++worker_count;
+            }
 
-                /* Apply embedded patches. */
-                ApplyEmbeddedPatchesToModule(nso_header->module_id, map_address, nso_size);
+            /* Run tasks until there are none left, and wait for the workers to finish theirs. */
+            RunLoadSegmentsTasks();
+            for (size_t i = 0; i < worker_count; ++i) {
+                os::WaitThread(std::addressof(g_load_worker_threads[i]));
+                os::DestroyThread(std::addressof(g_load_worker_threads[i]));
+            }
 
-                /* Apply IPS patches. */
-                LocateAndApplyIpsPatchesToModule(nso_header->module_id, map_address, nso_size);
+            /* Check the result of each task. */
+            for (size_t i = 0; i < task_count; ++i) {
+                R_TRY(g_load_segments_tasks[i].result);
             }
 
+            R_SUCCEED();
+        }
+
+        void FinishAutoLoadModule(const NsoHeader *nso_header, uintptr_t map_address, size_t nso_size) {
+            /* Clear unused space to zero. */
+            const size_t text_end = nso_header->text_dst_offset + nso_header->text_size;
+            const size_t ro_end   = nso_header->ro_dst_offset   + nso_header->ro_size;
+            const size_t rw_end   = nso_header->rw_dst_offset   + nso_header->rw_size;
+            std::memset(reinterpret_cast<void *>(map_address + 0),        0, nso_header->text_dst_offset);
+            std::memset(reinterpret_cast<void *>(map_address + text_end), 0, nso_header->ro_dst_offset - text_end);
+            std::memset(reinterpret_cast<void *>(map_address + ro_end),   0, nso_header->rw_dst_offset - ro_end);
+            std::memset(reinterpret_cast<void *>(map_address + rw_end),   0, nso_header->bss_size);
+
+            /* Apply embedded patches. */
+            ApplyEmbeddedPatchesToModule(nso_header->module_id, map_address, nso_size);
+
+            /* Apply IPS patches. */
+            LocateAndApplyIpsPatchesToModule(nso_header->module_id, map_address, nso_size);
+        }
+
+        Result SetAutoLoadModulePermissions(os::NativeHandle process_handle, const NsoHeader *nso_header, uintptr_t nso_address) {
             /* Set permissions. */
             const size_t text_size = util::AlignUp(nso_header->text_size, os::MemoryPageSize);
             const size_t ro_size   = util::AlignUp(nso_header->ro_size, os::MemoryPageSize);
@@ -583,13 +689,49 @@ namespace ams::ldr {
 
         Result LoadAutoLoadModules(const ProcessInfo *process_info, const NsoHeader *nso_headers, const bool *has_nso, const ArgumentStore::Entry *argument) {
             /* Load each NSO. */
+            {
+                /* Open and map each NSO. */
+                fs::FileHandle files[Nso_Count];
+                void *mapped_memory[Nso_Count] = {};
+                bool is_open[Nso_Count] = {};
+                ON_SCOPE_EXIT {
+                    for (size_t i = 0; i < Nso_Count; i++) {
+                        if (mapped_memory[i] != nullptr) {
+                            os::UnmapProcessMemory(mapped_memory[i], process_info->process_handle, process_info->nso_address[i], process_info->nso_size[i]);
+                        }
+                        if (is_open[i]) {
+                            fs::CloseFile(files[i]);
+                        }
+                    }
+                };
+
+                size_t task_count = 0;
+                for (size_t i = 0; i < Nso_Count; i++) {
+                    if (has_nso[i]) {
+                        R_TRY(fs::OpenFile(std::addressof(files[i]), GetNsoPath(i), fs::OpenMode_Read));
+                        is_open[i] = true;
+
+                        R_TRY(os::MapProcessMemory(std::addressof(mapped_memory[i]), process_info->process_handle, process_info->nso_address[i], process_info->nso_size[i], GenerateSecureRandom));
+
+                        task_count += AddLoadSegmentsTasks(g_load_segments_tasks + task_count, files[i], nso_headers + i, reinterpret_cast<uintptr_t>(mapped_memory[i]), process_info->nso_size[i]);
+                    }
+                }
+
+                /* Load the segments of every NSO, in parallel. */
+                R_TRY(RunLoadSegmentsTasksInParallel(task_count));
+
+                /* Finish loading each NSO. */
+                for (size_t i = 0; i < Nso_Count; i++) {
+                    if (has_nso[i]) {
+                        FinishAutoLoadModule(nso_headers + i, reinterpret_cast<uintptr_t>(mapped_memory[i]), process_info->nso_size[i]);
+                    }
+                }
+            }
+
+            /* Set the permissions of each NSO, now that they're unmapped. */
             for (size_t i = 0; i < Nso_Count; i++) {
                 if (has_nso[i]) {
-                    fs::FileHandle file;
-                    R_TRY(fs::OpenFile(std::addressof(file), GetNsoPath(i), fs::OpenMode_Read));
-                    ON_SCOPE_EXIT { fs::CloseFile(file); };
-
-                    R_TRY(LoadAutoLoadModule(process_info->process_handle, file, nso_headers + i, process_info->nso_address[i], process_info->nso_size[i]));
+                    R_TRY(SetAutoLoadModulePermissions(process_info->process_handle, nso_headers + i, process_info->nso_address[i]));
                 }
             }
 
@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) Atmosphère-NX
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include <stratosphere.hpp>
+
+namespace ams::sm::impl {
+
+    /* An open-addressed hash index over one of our info lists, so that infos can be found without scanning the list. */
+    /* Free infos are kept on a stack, so that they can be allocated without scanning, either. */
+    template<typename Info, size_t Count, typename Traits>
+    class InfoIndex {
+        static_assert(Count < std::numeric_limits<u16>::max());
+        private:
+            using Key  = typename Traits::Key;
+            using List = std::array<Info, Count>;
+
+            static constexpr size_t SlotCount = util::CeilingPowerOfTwo(Count * 2);
+            static constexpr size_t SlotMask  = SlotCount - 1;
+            static constexpr int SlotShift    = BITSIZEOF(u64) - util::CountTrailingZeros(SlotCount);
+            static constexpr u16 EmptySlot    = std::numeric_limits<u16>::max();
+        private:
+            std::array<u16, SlotCount> m_slots;
+            std::array<u16, Count> m_free_indices;
+            size_t m_free_count;
+        public:
+            constexpr InfoIndex() : m_slots(), m_free_indices(), m_free_count(Count) {
+                for (auto &slot : m_slots) {
+                    slot = EmptySlot;
+                }
+
+                /* Free infos are allocated lowest index first. */
+                for (size_t i = 0; i < Count; ++i) {
+                    m_free_indices[i] = static_cast<u16>(Count - 1 - i);
+                }
+            }
+
+            Info *Find(List &list, const Key &key) const {
+                for (size_t slot = GetHomeSlot(key); m_slots[slot] != EmptySlot; slot = (slot + 1) & SlotMask) {
+                    if (Info &info = list[m_slots[slot]]; Traits::GetKey(info) == key) {
+                        return std::addressof(info);
+                    }
+                }
+
+                return nullptr;
+            }
+
+            /* NOTE: The returned info must be added with Insert before another is allocated. */
+            Info *GetFree(List &list) const {
+                return m_free_count > 0 ? std::addressof(list[m_free_indices[m_free_count - 1]]) : nullptr;
+            }
+
+            void Insert(List &list, Info *info) {
+                const u16 index = GetIndex(list, info);
+
+                /* Take the info off of the free stack. */
+                AMS_ABORT_UNLESS(m_free_count > 0 && m_free_indices[m_free_count - 1] == index);
+                --m_free_count;
+
+                /* Add the info at the first empty slot from its home. */
+                size_t slot = GetHomeSlot(Traits::GetKey(*info));
+                while (m_slots[slot] != EmptySlot) {
+                    slot = (slot + 1) & SlotMask;
+                }
+                m_slots[slot] = index;
+            }
+
+            void Remove(List &list, Info *info) {
+                const u16 index = GetIndex(list, info);
+
+                /* Find the info's slot. */
+                size_t hole = GetHomeSlot(Traits::GetKey(*info));
+                while (m_slots[hole] != index) {
+                    AMS_ABORT_UNLESS(m_slots[hole] != EmptySlot);
+                    hole = (hole + 1) & SlotMask;
+                }
+
+                /* Shift back any later slots which could have used the hole, so that lookups still find them. */
+                for (size_t slot = (hole + 1) & SlotMask; m_slots[slot] != EmptySlot; slot = (slot + 1) & SlotMask) {
+                    const size_t home = GetHomeSlot(Traits::GetKey(list[m_slots[slot]]));
+                    if (((slot - home) & SlotMask) >= ((slot - hole) & SlotMask)) {
+                        m_slots[hole] = m_slots[slot];
+                        hole = slot;
+                    }
+                }
+                m_slots[hole] = EmptySlot;
+
+                /* Put the info back on the free stack. */
+                AMS_ABORT_UNLESS(m_free_count < Count);
+                m_free_indices[m_free_count++] = index;
+            }
+        private:
+            static size_t GetHomeSlot(const Key &key) {
+                /* Use fibonacci hashing, so that similar keys are spread across the table. */
+                return static_cast<size_t>((Traits::GetHash(key) * UINT64_C(0x9E3779B97F4A7C15)) >> SlotShift);
+            }
+
+            static u16 GetIndex(const List &list, const Info *info) {
+                AMS_ABORT_UNLESS(list.data() <= info && info < list.data() + Count);
+                return static_cast<u16>(info - list.data());
+            }
+    };
+
+}
@@ -15,6 +15,7 @@
  */
 #include <stratosphere.hpp>
 #include "sm_service_manager.hpp"
+#include "sm_info_index.hpp"
 #include "../sm_wait_list.hpp"
 
 namespace ams::hos {
@@ -38,20 +39,42 @@ namespace ams::sm::impl {
         };
 
         /* Types. */
+
+        /* An access control compiled into sorted exact names and a table of prefixes, for each of client and host access. */
+        /* Names are compared as little-endian integers, so that a prefix is the low bytes of a name. */
+        struct CompiledAccessControl {
+            static constexpr size_t EntryCountMax = 0x40;
+
+            enum Group {
+                Group_ClientExact,
+                Group_ClientPrefix,
+                Group_HostExact,
+                Group_HostPrefix,
+                Group_Count,
+            };
+
+            u64 names[EntryCountMax];
+            u8 prefix_lengths[EntryCountMax];
+            u8 group_ends[Group_Count];
+            bool is_valid;
+        };
+
         struct ProcessInfo {
             os::ProcessId process_id;
             ncm::ProgramId program_id;
             cfg::OverrideStatus override_status;
             size_t access_control_size;
             u8 access_control[AccessControlSizeMax];
+            CompiledAccessControl compiled_access_control;
         };
 
         constexpr const ProcessInfo InvalidProcessInfo = {
-            .process_id          = os::InvalidProcessId,
-            .program_id          = ncm::InvalidProgramId,
-            .override_status     = {},
-            .access_control_size = 0,
-            .access_control      = {},
+            .process_id              = os::InvalidProcessId,
+            .program_id              = ncm::InvalidProgramId,
+            .override_status         = {},
+            .access_control_size     = 0,
+            .access_control          = {},
+            .compiled_access_control = {},
         };
 
         struct ServiceInfo {
@@ -134,6 +157,32 @@ namespace ams::sm::impl {
                 }
         };
 
+        ALWAYS_INLINE u64 GetServiceNameValue(ServiceName name) {
+            static_assert(sizeof(name) == sizeof(u64));
+
+            u64 value;
+            std::memcpy(std::addressof(value), std::addressof(name), sizeof(value));
+            return value;
+        }
+
+        constexpr ALWAYS_INLINE u64 GetServiceNamePrefixMask(size_t prefix_length) {
+            return prefix_length > 0 ? (std::numeric_limits<u64>::max() >> (BITSIZEOF(u64) - BITSIZEOF(u8) * prefix_length)) : 0;
+        }
+
+        struct ProcessInfoTraits {
+            using Key = os::ProcessId;
+
+            static os::ProcessId GetKey(const ProcessInfo &info) { return info.process_id; }
+            static u64 GetHash(os::ProcessId process_id) { return process_id.value; }
+        };
+
+        struct ServiceInfoTraits {
+            using Key = ServiceName;
+
+            static ServiceName GetKey(const ServiceInfo &info) { return info.name; }
+            static u64 GetHash(ServiceName name) { return GetServiceNameValue(name); }
+        };
+
         class InitialProcessIdLimits {
             private:
                 os::ProcessId m_min;
@@ -184,6 +233,9 @@ namespace ams::sm::impl {
             return list;
         }();
 
+        constinit InfoIndex<ProcessInfo, ProcessCountMax, ProcessInfoTraits> g_process_index;
+        constinit InfoIndex<ServiceInfo, ServiceCountMax, ServiceInfoTraits> g_service_index;
+
         constinit std::array<ServiceName, MitmCountMax> g_future_mitm_list = [] {
             std::array<ServiceName, MitmCountMax> list = {};
 
@@ -252,6 +304,90 @@ namespace ams::sm::impl {
             R_SUCCEED();
         }
 
+        void CompileAccessControl(CompiledAccessControl *out, AccessControlEntry access_control) {
+            /* Clear the output. */
+            *out = {};
+
+            const auto GetGroup = [](const AccessControlEntry &entry) -> size_t {
+                return (entry.IsHost() ? CompiledAccessControl::Group_HostExact : CompiledAccessControl::Group_ClientExact) + (entry.IsWildcard() ? 1 : 0);
+            };
+
+            /* Count the entries in each group. If there are too many, we'll check the raw access control instead. */
+            size_t counts[CompiledAccessControl::Group_Count] = {};
+            size_t total_count = 0;
+            for (auto entry = access_control; entry.IsValid(); entry = entry.GetNextEntry()) {
+                ++counts[GetGroup(entry)];
+                ++total_count;
+            }
+
+            if (total_count > CompiledAccessControl::EntryCountMax) {
+                return;
+            }
+
+            /* Lay out the groups. */
+            size_t positions[CompiledAccessControl::Group_Count];
+            for (size_t group = 0, end = 0; group < CompiledAccessControl::Group_Count; ++group) {
+                positions[group]      = end;
+                end                  += counts[group];
+                out->group_ends[group] = static_cast<u8>(end);
+            }
+
+            /* Add each entry to its group. Wildcard entries match any name starting with their name, excluding the '*'. */
+            for (auto entry = access_control; entry.IsValid(); entry = entry.GetNextEntry()) {
+                const size_t index = positions[GetGroup(entry)]++;
+                const u64 name     = GetServiceNameValue(entry.GetServiceName());
+
+                if (entry.IsWildcard()) {
+                    const size_t prefix_length = entry.GetServiceNameSize() - 1;
+                    out->names[index]          = name & GetServiceNamePrefixMask(prefix_length);
+                    out->prefix_lengths[index] = static_cast<u8>(prefix_length);
+                } else {
+                    out->names[index] = name;
+                }
+            }
+
+            /* Sort the exact names, so that they can be binary searched. */
+            std::sort(out->names, out->names + out->group_ends[CompiledAccessControl::Group_ClientExact]);
+            std::sort(out->names + out->group_ends[CompiledAccessControl::Group_ClientPrefix], out->names + out->group_ends[CompiledAccessControl::Group_HostExact]);
+
+            out->is_valid = true;
+        }
+
+        bool IsAllowedByCompiledAccessControl(const CompiledAccessControl &access_control, ServiceName service, bool is_host) {
+            AMS_ASSERT(access_control.is_valid);
+
+            const u64 name = GetServiceNameValue(service);
+
+            /* Determine where our groups are. */
+            const size_t exact_begin = is_host ? access_control.group_ends[CompiledAccessControl::Group_ClientPrefix] : 0;
+            const size_t exact_end   = access_control.group_ends[is_host ? CompiledAccessControl::Group_HostExact : CompiledAccessControl::Group_ClientExact];
+            const size_t prefix_end  = access_control.group_ends[is_host ? CompiledAccessControl::Group_HostPrefix : CompiledAccessControl::Group_ClientPrefix];
+
+            /* Check for an exact match. */
+            if (std::binary_search(access_control.names + exact_begin, access_control.names + exact_end, name)) {
+                return true;
+            }
+
+            /* Check for a prefix match. */
+            for (size_t i = exact_end; i < prefix_end; ++i) {
+                if ((name & GetServiceNamePrefixMask(access_control.prefix_lengths[i])) == access_control.names[i]) {
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        Result ValidateAccessControl(const ProcessInfo *process_info, ServiceName service, bool is_host) {
+            /* If we compiled the process's access control, use it. */
+            if (process_info->compiled_access_control.is_valid) {
+                R_UNLESS(IsAllowedByCompiledAccessControl(process_info->compiled_access_control, service, is_host), sm::ResultNotAllowed());
+                R_SUCCEED();
+            }
+
+            R_RETURN(ValidateAccessControl(AccessControlEntry(process_info->access_control, process_info->access_control_size), service, is_host, false));
+        }
+
         Result ValidateServiceName(ServiceName service) {
             /* Service names must be non-empty. */
             R_UNLESS(service.name[0] != 0, sm::ResultInvalidServiceName());
@@ -290,18 +426,11 @@ namespace ams::sm::impl {
         }
 
         ProcessInfo *GetProcessInfo(os::ProcessId process_id) {
-            /* Find a process info with a matching id. */
-            for (auto &process_info : g_process_list) {
-                if (process_info.process_id == process_id) {
-                    return std::addressof(process_info);
-                }
-            }
-
-            return nullptr;
+            return g_process_index.Find(g_process_list, process_id);
         }
 
         ProcessInfo *GetFreeProcessInfo() {
-            return GetProcessInfo(os::InvalidProcessId);
+            return g_process_index.GetFree(g_process_list);
         }
 
         bool HasProcessInfo(os::ProcessId process_id) {
@@ -309,18 +438,11 @@ namespace ams::sm::impl {
         }
 
         ServiceInfo *GetServiceInfo(ServiceName service_name) {
-            /* Find a service with a matching name. */
-            for (auto &service_info : g_service_list) {
-                if (service_info.name == service_name) {
-                    return std::addressof(service_info);
-                }
-            }
-
-            return nullptr;
+            return g_service_index.Find(g_service_list, service_name);
         }
 
         ServiceInfo *GetFreeServiceInfo() {
-            return GetServiceInfo(InvalidServiceName);
+            return g_service_index.GetFree(g_service_list);
         }
 
         bool HasServiceInfo(ServiceName service) {
@@ -497,6 +619,7 @@ namespace ams::sm::impl {
             free_service->owner_process_id = process_id;
             free_service->max_sessions     = max_sessions;
             free_service->is_light         = is_light;
+            g_service_index.Insert(g_service_list, free_service);
 
             /* This might undefer some requests. */
             TriggerResume(service);
@@ -512,6 +635,7 @@ namespace ams::sm::impl {
             os::CloseNativeHandle(service_info->port_h);
 
             /* Reset the info's state. */
+            g_service_index.Remove(g_service_list, service_info);
             *service_info = InvalidServiceInfo;
 
             /* Reset the mitm info, if necessary. */
@@ -566,6 +690,8 @@ namespace ams::sm::impl {
         proc->override_status     = override_status;
         proc->access_control_size = aci_sac_size;
         std::memcpy(proc->access_control, aci_sac, proc->access_control_size);
+        CompileAccessControl(std::addressof(proc->compiled_access_control), AccessControlEntry(proc->access_control, proc->access_control_size));
+        g_process_index.Insert(g_process_list, proc);
 
         R_SUCCEED();
     }
@@ -579,6 +705,7 @@ namespace ams::sm::impl {
         R_UNLESS(proc != nullptr, sm::ResultInvalidClient());
 
         /* Free the process. */
+        g_process_index.Remove(g_process_list, proc);
         *proc = InvalidProcessInfo;
 
         R_SUCCEED();
@@ -621,7 +748,7 @@ namespace ams::sm::impl {
         if (!IsInitialProcess(process_id)) {
             ProcessInfo *proc = GetProcessInfo(process_id);
             R_UNLESS(proc != nullptr, sm::ResultInvalidClient());
-            R_TRY(ValidateAccessControl(AccessControlEntry(proc->access_control, proc->access_control_size), service, false, false));
+            R_TRY(ValidateAccessControl(proc, service, false));
         }
 
         /* Get service info/mitm info. */
@@ -654,7 +781,7 @@ namespace ams::sm::impl {
             ProcessInfo *proc = GetProcessInfo(process_id);
             R_UNLESS(proc != nullptr, sm::ResultInvalidClient());
 
-            R_TRY(ValidateAccessControl(AccessControlEntry(proc->access_control, proc->access_control_size), service, true, false));
+            R_TRY(ValidateAccessControl(proc, service, true));
         }
 
         /* Check that the service isn't already registered. */
@@ -734,7 +861,7 @@ namespace ams::sm::impl {
         if (!IsInitialProcess(process_id)) {
             ProcessInfo *proc = GetProcessInfo(process_id);
             R_UNLESS(proc != nullptr, sm::ResultInvalidClient());
-            R_TRY(ValidateAccessControl(AccessControlEntry(proc->access_control, proc->access_control_size), service, true, false));
+            R_TRY(ValidateAccessControl(proc, service, true));
         }
 
         /* Validate that the service exists. */
@@ -844,7 +971,7 @@ namespace ams::sm::impl {
         if (!IsInitialProcess(process_id)) {
             ProcessInfo *proc = GetProcessInfo(process_id);
             R_UNLESS(proc != nullptr, sm::ResultInvalidClient());
-            R_TRY(ValidateAccessControl(AccessControlEntry(proc->access_control, proc->access_control_size), service, true, false));
+            R_TRY(ValidateAccessControl(proc, service, true));
         }
 
         /* Check that mitm hasn't already been registered or declared. */
@@ -868,7 +995,7 @@ namespace ams::sm::impl {
         if (!IsInitialProcess(process_id)) {
             ProcessInfo *proc = GetProcessInfo(process_id);
             R_UNLESS(proc != nullptr, sm::ResultInvalidClient());
-            R_TRY(ValidateAccessControl(AccessControlEntry(proc->access_control, proc->access_control_size), service, true, false));
+            R_TRY(ValidateAccessControl(proc, service, true));
         }
 
         /* Validate that the service exists. */
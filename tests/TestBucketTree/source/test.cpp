@@ -0,0 +1,326 @@
+/*
+ * Copyright (c) Atmosphère-NX
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stratosphere.hpp>
+
+namespace ams {
+
+    namespace {
+
+        using Entry = fssystem::IndirectStorage::Entry;
+
+        constexpr size_t SmallNodeSize = fssystem::BucketTree::NodeSizeMin;
+        constexpr s32 SmallEntryCount  = 20000;
+        constexpr s32 TinyEntryCount   = 1000;
+
+        constexpr size_t LargeNodeSize = fssystem::IndirectStorage::NodeSize;
+        constexpr s32 LargeEntryCount  = 0x10000;
+
+        constexpr size_t NodeSizeMaxForTest = LargeNodeSize;
+        constexpr size_t EntrySizeMax       = 0x200;
+        constexpr size_t VirtualSizeMax     = LargeEntryCount * EntrySizeMax;
+
+        constexpr s32 FindCount      = 100000;
+        constexpr s32 ReadCount      = 200000;
+        constexpr size_t ReadSizeMax = 0x400;
+
+        constexpr size_t SmallNodeStorageSize  = fssystem::BucketTree::QueryNodeStorageSize(SmallNodeSize, sizeof(Entry), SmallEntryCount);
+        constexpr size_t SmallEntryStorageSize = fssystem::BucketTree::QueryEntryStorageSize(SmallNodeSize, sizeof(Entry), SmallEntryCount);
+        constexpr size_t LargeNodeStorageSize  = fssystem::IndirectStorage::QueryNodeStorageSize(LargeEntryCount);
+        constexpr size_t LargeEntryStorageSize = fssystem::IndirectStorage::QueryEntryStorageSize(LargeEntryCount);
+
+        constinit Entry g_entries[LargeEntryCount];
+        constinit s64 g_virtual_size;
+
+        alignas(os::MemoryPageSize) constinit u8 g_node_storage[std::max(SmallNodeStorageSize, LargeNodeStorageSize)];
+        alignas(os::MemoryPageSize) constinit u8 g_entry_storage[std::max(SmallEntryStorageSize, LargeEntryStorageSize)];
+
+        alignas(os::MemoryPageSize) constinit u8 g_data[fssystem::IndirectStorage::StorageCount][VirtualSizeMax];
+        alignas(os::MemoryPageSize) constinit u8 g_expected_data[VirtualSizeMax];
+        alignas(os::MemoryPageSize) constinit u8 g_read_buffer[ReadSizeMax];
+
+        alignas(os::MemoryPageSize) constinit u8 g_pooled_buffer[1_MB];
+
+        class MallocMemoryResource : public MemoryResource {
+            protected:
+                virtual void *AllocateImpl(size_t size, size_t align) override {
+                    return std::aligned_alloc(align, util::AlignUp(size, align));
+                }
+
+                virtual void DeallocateImpl(void *p, size_t size, size_t align) override {
+                    AMS_UNUSED(size, align);
+                    return std::free(p);
+                }
+
+                virtual bool IsEqualImpl(const MemoryResource &rhs) const override {
+                    return this == std::addressof(rhs);
+                }
+        };
+
+        MallocMemoryResource g_allocator;
+
+        /* A memory storage which counts how often it's read, standing in for table storages on slow media. */
+        class CountingMemoryStorage : public fs::MemoryStorage {
+            private:
+                s64 m_read_count;
+            public:
+                CountingMemoryStorage(void *b, s64 sz) : fs::MemoryStorage(b, sz), m_read_count(0) { /* ... */ }
+
+                virtual Result Read(s64 offset, void *buffer, size_t size) override {
+                    ++m_read_count;
+                    R_RETURN(fs::MemoryStorage::Read(offset, buffer, size));
+                }
+
+                s64 GetReadCount() const { return m_read_count; }
+                void ResetReadCount() { m_read_count = 0; }
+        };
+
+        void GenerateEntries(util::TinyMT &mt, s32 entry_count) {
+            /* Generate contiguous entries of random size, alternating randomly between storages. */
+            s64 offset = 0;
+            for (s32 i = 0; i < entry_count; ++i) {
+                g_entries[i].SetVirtualOffset(offset);
+                g_entries[i].SetPhysicalOffset(offset);
+                g_entries[i].storage_index = mt.GenerateRandomU32() % fssystem::IndirectStorage::StorageCount;
+
+                offset += 0x10 * (1 + mt.GenerateRandomU32() % (EntrySizeMax / 0x10));
+            }
+            g_virtual_size = offset;
+
+            /* Determine what reading each virtual offset should produce. */
+            for (s32 i = 0; i < entry_count; ++i) {
+                const s64 start = g_entries[i].GetVirtualOffset();
+                const s64 end   = (i + 1 < entry_count) ? g_entries[i + 1].GetVirtualOffset() : g_virtual_size;
+                std::memcpy(g_expected_data + start, g_data[g_entries[i].storage_index] + start, end - start);
+            }
+        }
+
+        void BuildTree(size_t node_size, s32 entry_count) {
+            const s32 entry_count_per_set = (node_size - sizeof(fssystem::BucketTree::NodeHeader)) / sizeof(Entry);
+            const s32 offset_count        = (node_size - sizeof(fssystem::BucketTree::NodeHeader)) / sizeof(s64);
+            const s32 entry_set_count     = util::DivideUp(entry_count, entry_count_per_set);
+
+            const auto GetEntrySetOffset = [&](s32 index) -> s64 { return index < entry_set_count ? g_entries[index * entry_count_per_set].GetVirtualOffset() : g_virtual_size; };
+
+            const auto WriteNode = [&](u8 *dst, s32 index, s32 count, s64 end_offset, const void *data, size_t data_size) {
+                const fssystem::BucketTree::NodeHeader header = { .index = index, .count = count, .offset = end_offset };
+                std::memset(dst, 0, node_size);
+                std::memcpy(dst, std::addressof(header), sizeof(header));
+                std::memcpy(dst + sizeof(header), data, data_size);
+            };
+
+            /* Write the entry sets. */
+            for (s32 i = 0; i < entry_set_count; ++i) {
+                const s32 start = i * entry_count_per_set;
+                const s32 count = std::min(entry_count_per_set, entry_count - start);
+                WriteNode(g_entry_storage + i * node_size, i, count, GetEntrySetOffset(i + 1), g_entries + start, count * sizeof(Entry));
+            }
+
+            /* Write the offset nodes. */
+            s64 offsets[NodeSizeMaxForTest / sizeof(s64)];
+            if (entry_set_count <= offset_count) {
+                /* Everything fits on the L1 node. */
+                for (s32 i = 0; i < entry_set_count; ++i) {
+                    offsets[i] = GetEntrySetOffset(i);
+                }
+                WriteNode(g_node_storage, 0, entry_set_count, g_virtual_size, offsets, entry_set_count * sizeof(s64));
+            } else {
+                /* The L1 node holds the L2 nodes' offsets, then the offsets of the entry sets which precede them. */
+                const s32 node_l2_count = fssystem::BucketTree::QueryNodeStorageSize(node_size, sizeof(Entry), entry_count) / node_size - 1;
+                const s32 direct_count  = offset_count - node_l2_count;
+                AMS_ABORT_UNLESS(direct_count + node_l2_count * offset_count >= entry_set_count);
+
+                for (s32 i = 0; i < node_l2_count; ++i) {
+                    const s32 first = direct_count + i * offset_count;
+                    const s32 count = std::min(offset_count, entry_set_count - first);
+                    AMS_ABORT_UNLESS(count > 0);
+
+                    s64 l2_offsets[NodeSizeMaxForTest / sizeof(s64)];
+                    for (s32 j = 0; j < count; ++j) {
+                        l2_offsets[j] = GetEntrySetOffset(first + j);
+                    }
+                    WriteNode(g_node_storage + (i + 1) * node_size, i, count, GetEntrySetOffset(first + count), l2_offsets, count * sizeof(s64));
+
+                    offsets[i] = l2_offsets[0];
+                }
+                for (s32 i = 0; i < direct_count; ++i) {
+                    offsets[node_l2_count + i] = GetEntrySetOffset(i);
+                }
+                WriteNode(g_node_storage, 0, node_l2_count, g_virtual_size, offsets, offset_count * sizeof(s64));
+            }
+        }
+
+        void CheckVisitorsEqual(const fssystem::BucketTree::Visitor &lhs, const fssystem::BucketTree::Visitor &rhs) {
+            AMS_ABORT_UNLESS(lhs.IsValid() == rhs.IsValid());
+            AMS_ABORT_UNLESS(lhs.CanMoveNext() == rhs.CanMoveNext());
+            AMS_ABORT_UNLESS(lhs.CanMovePrevious() == rhs.CanMovePrevious());
+            AMS_ABORT_UNLESS(std::memcmp(lhs.Get(), rhs.Get(), sizeof(Entry)) == 0);
+        }
+
+        void TestFind(size_t node_size, s32 entry_count) {
+            util::TinyMT mt;
+            mt.Initialize(0xB4C7 + entry_count);
+
+            GenerateEntries(mt, entry_count);
+            BuildTree(node_size, entry_count);
+
+            const size_t node_storage_size  = fssystem::BucketTree::QueryNodeStorageSize(node_size, sizeof(Entry), entry_count);
+            const size_t entry_storage_size = fssystem::BucketTree::QueryEntryStorageSize(node_size, sizeof(Entry), entry_count);
+            CountingMemoryStorage node_storage(g_node_storage, node_storage_size);
+            CountingMemoryStorage entry_storage(g_entry_storage, entry_storage_size);
+
+            /* Create one tree which reads its storages, and one which is cached. */
+            fssystem::BucketTree uncached_tree, cached_tree;
+
+            fssystem::BucketTree::SetCacheMemorySizeMax(0);
+            R_ABORT_UNLESS(uncached_tree.Initialize(std::addressof(g_allocator), fs::SubStorage(std::addressof(node_storage), 0, node_storage_size), fs::SubStorage(std::addressof(entry_storage), 0, entry_storage_size), node_size, sizeof(Entry), entry_count));
+            AMS_ABORT_UNLESS(!uncached_tree.IsCached());
+
+            fssystem::BucketTree::SetCacheMemorySizeMax(16_MB);
+            R_ABORT_UNLESS(cached_tree.Initialize(std::addressof(g_allocator), fs::SubStorage(std::addressof(node_storage), 0, node_storage_size), fs::SubStorage(std::addressof(entry_storage), 0, entry_storage_size), node_size, sizeof(Entry), entry_count));
+            AMS_ABORT_UNLESS(cached_tree.IsCached());
+            AMS_ABORT_UNLESS(fssystem::BucketTree::GetCacheMemorySize() > 0);
+
+            /* Check that both trees find the same entries, and move between them the same way. */
+            const auto CheckFind = [&](s64 virtual_address) {
+                fssystem::BucketTree::Visitor uncached_visitor, cached_visitor;
+                const Result uncached_result = uncached_tree.Find(std::addressof(uncached_visitor), virtual_address);
+                const Result cached_result   = cached_tree.Find(std::addressof(cached_visitor), virtual_address);
+                AMS_ABORT_UNLESS(uncached_result.GetValue() == cached_result.GetValue());
+                if (R_FAILED(cached_result)) {
+                    return;
+                }
+
+                CheckVisitorsEqual(uncached_visitor, cached_visitor);
+                AMS_ABORT_UNLESS(cached_visitor.Get<Entry>()->GetVirtualOffset() <= virtual_address);
+
+                for (s32 i = 0; i < 4 && cached_visitor.CanMoveNext(); ++i) {
+                    R_ABORT_UNLESS(uncached_visitor.MoveNext());
+                    R_ABORT_UNLESS(cached_visitor.MoveNext());
+                    CheckVisitorsEqual(uncached_visitor, cached_visitor);
+                }
+                for (s32 i = 0; i < 8 && cached_visitor.CanMovePrevious(); ++i) {
+                    R_ABORT_UNLESS(uncached_visitor.MovePrevious());
+                    R_ABORT_UNLESS(cached_visitor.MovePrevious());
+                    CheckVisitorsEqual(uncached_visitor, cached_visitor);
+                }
+            };
+
+            CheckFind(0);
+            CheckFind(g_virtual_size - 1);
+            CheckFind(g_virtual_size);
+            for (s32 i = 0; i < entry_count; ++i) {
+                CheckFind(g_entries[i].GetVirtualOffset());
+            }
+            for (s32 i = 0; i < FindCount; ++i) {
+                CheckFind(mt.GenerateRandomU64() % g_virtual_size);
+            }
+
+            /* The cached tree should never have read its storages after initializing. */
+            node_storage.ResetReadCount();
+            entry_storage.ResetReadCount();
+            for (s32 i = 0; i < 1000; ++i) {
+                fssystem::BucketTree::Visitor visitor;
+                R_ABORT_UNLESS(cached_tree.Find(std::addressof(visitor), mt.GenerateRandomU64() % g_virtual_size));
+            }
+            AMS_ABORT_UNLESS(node_storage.GetReadCount() == 0 && entry_storage.GetReadCount() == 0);
+
+            /* Invalidating the cached tree should reload its cache on the next lookup. */
+            R_ABORT_UNLESS(cached_tree.InvalidateCache());
+            AMS_ABORT_UNLESS(!cached_tree.IsCached());
+            CheckFind(g_virtual_size / 2);
+            AMS_ABORT_UNLESS(cached_tree.IsCached());
+
+            /* Finalizing should return the cache's memory to the budget. */
+            cached_tree.Finalize();
+            AMS_ABORT_UNLESS(fssystem::BucketTree::GetCacheMemorySize() == 0);
+
+            /* A budget too small for the tree should leave it uncached. */
+            fssystem::BucketTree::SetCacheMemorySizeMax(node_size);
+            R_ABORT_UNLESS(cached_tree.Initialize(std::addressof(g_allocator), fs::SubStorage(std::addressof(node_storage), 0, node_storage_size), fs::SubStorage(std::addressof(entry_storage), 0, entry_storage_size), node_size, sizeof(Entry), entry_count));
+            AMS_ABORT_UNLESS(!cached_tree.IsCached());
+            AMS_ABORT_UNLESS(fssystem::BucketTree::GetCacheMemorySize() == 0);
+
+            fssystem::BucketTree::SetCacheMemorySizeMax(0);
+            printf("  node size 0x%zx, %6d entries: ok\n", node_size, entry_count);
+        }
+
+        void DoBenchmark(bool cached) {
+            const size_t node_storage_size  = LargeNodeStorageSize;
+            const size_t entry_storage_size = LargeEntryStorageSize;
+            CountingMemoryStorage node_storage(g_node_storage, node_storage_size);
+            CountingMemoryStorage entry_storage(g_entry_storage, entry_storage_size);
+            fs::MemoryStorage data_storages[fssystem::IndirectStorage::StorageCount] = { { g_data[0], VirtualSizeMax }, { g_data[1], VirtualSizeMax } };
+
+            fssystem::BucketTree::SetCacheMemorySizeMax(cached ? 16_MB : 0);
+            ON_SCOPE_EXIT { fssystem::BucketTree::SetCacheMemorySizeMax(0); };
+
+            fssystem::IndirectStorage storage;
+            R_ABORT_UNLESS(storage.Initialize(std::addressof(g_allocator), fs::SubStorage(std::addressof(node_storage), 0, node_storage_size), fs::SubStorage(std::addressof(entry_storage), 0, entry_storage_size), LargeEntryCount));
+            for (s32 i = 0; i < fssystem::IndirectStorage::StorageCount; ++i) {
+                storage.SetStorage(i, fs::SubStorage(std::addressof(data_storages[i]), 0, VirtualSizeMax));
+            }
+
+            node_storage.ResetReadCount();
+            entry_storage.ResetReadCount();
+
+            /* Do random reads, checking each. */
+            util::TinyMT mt;
+            mt.Initialize(0x5EED);
+
+            const auto start_tick = os::GetSystemTick();
+            for (s32 i = 0; i < ReadCount; ++i) {
+                const size_t size = 1 + mt.GenerateRandomU32() % ReadSizeMax;
+                const s64 offset  = mt.GenerateRandomU64() % (g_virtual_size - size);
+
+                R_ABORT_UNLESS(storage.Read(offset, g_read_buffer, size));
+                AMS_ABORT_UNLESS(std::memcmp(g_read_buffer, g_expected_data + offset, size) == 0);
+            }
+            const auto elapsed = (os::GetSystemTick() - start_tick).ToTimeSpan();
+
+            printf("  %-8s %7.2f M reads/s, %6.2f table reads/read\n", cached ? "cached" : "uncached",
+                   ReadCount / static_cast<double>(elapsed.GetNanoSeconds()) * 1e3,
+                   static_cast<double>(node_storage.GetReadCount() + entry_storage.GetReadCount()) / ReadCount);
+        }
+
+    }
+
+    void Main() {
+        printf("Doing bucket tree test!\n");
+
+        R_ABORT_UNLESS(fssystem::InitializeBufferPool(reinterpret_cast<char *>(g_pooled_buffer), sizeof(g_pooled_buffer)));
+
+        /* Fill our data storages with distinct data. */
+        {
+            util::TinyMT mt;
+            mt.Initialize(0xDA7A);
+            for (auto &data : g_data) {
+                mt.GenerateRandomBytes(data, sizeof(data));
+            }
+        }
+
+        /* Check that cached lookups match uncached ones, with and without L2 nodes. */
+        TestFind(SmallNodeSize, TinyEntryCount);
+        TestFind(SmallNodeSize, SmallEntryCount);
+        TestFind(LargeNodeSize, LargeEntryCount);
+
+        /* Benchmark random reads through an indirect storage. */
+        DoBenchmark(false);
+        DoBenchmark(true);
+
+        printf("All tests completed!\n");
+    }
+
+}
@@ -0,0 +1,225 @@
+/*
+ * Copyright (c) Atmosphère-NX
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stratosphere.hpp>
+#include "../../../stratosphere/dmnt/source/cheat/impl/dmnt_cheat_memory_batcher.cpp"
+
+namespace ams {
+
+    namespace {
+
+        using dmnt::cheat::impl::CheatProcessMemoryAccessor;
+        using dmnt::cheat::impl::CheatProcessMemoryBatcher;
+
+        constexpr size_t PageSize = CheatProcessMemoryBatcher::PageSize;
+
+        constexpr u64 MockMemoryStart  = 0x10000000;
+        constexpr size_t MockPageCount = 0x40;
+        constexpr size_t MockMemorySize = MockPageCount * PageSize;
+
+        /* One page can't be accessed at all, and one can be read but not written. */
+        constexpr size_t UnmappedPageIndex = 0x05;
+        constexpr size_t ReadOnlyPageIndex = 0x28;
+
+        alignas(os::MemoryPageSize) constinit u8 g_memory[MockMemorySize];
+        alignas(os::MemoryPageSize) constinit u8 g_expected[MockMemorySize];
+
+        class MockAccessor : public CheatProcessMemoryAccessor {
+            public:
+                size_t read_count  = 0;
+                size_t write_count = 0;
+            public:
+                virtual Result ReadMemory(u64 address, void *dst, size_t size) override {
+                    ++this->read_count;
+                    R_TRY(CheckAccess(address, size, false));
+
+                    std::memcpy(dst, g_memory + (address - MockMemoryStart), size);
+                    R_SUCCEED();
+                }
+
+                virtual Result WriteMemory(u64 address, const void *src, size_t size) override {
+                    ++this->write_count;
+                    R_TRY(CheckAccess(address, size, true));
+
+                    std::memcpy(g_memory + (address - MockMemoryStart), src, size);
+                    R_SUCCEED();
+                }
+            private:
+                static Result CheckAccess(u64 address, size_t size, bool is_write) {
+                    R_UNLESS(MockMemoryStart <= address && address + size <= MockMemoryStart + MockMemorySize, svc::ResultInvalidCurrentMemory());
+
+                    for (u64 cur = util::AlignDown(address, PageSize); cur < address + size; cur += PageSize) {
+                        const size_t page_index = (cur - MockMemoryStart) / PageSize;
+                        R_UNLESS(page_index != UnmappedPageIndex,               svc::ResultInvalidCurrentMemory());
+                        R_UNLESS(!is_write || page_index != ReadOnlyPageIndex,  svc::ResultInvalidCurrentMemory());
+                    }
+
+                    R_SUCCEED();
+                }
+        };
+
+        CheatProcessMemoryBatcher g_batcher;
+        util::TinyMT g_mt;
+
+        u64 GetPageAddress(size_t page_index) {
+            return MockMemoryStart + page_index * PageSize;
+        }
+
+        bool IsUnmapped(u64 address, size_t size) {
+            return address < GetPageAddress(UnmappedPageIndex + 1) && GetPageAddress(UnmappedPageIndex) < address + size;
+        }
+
+        u64 GenerateAddress(size_t size) {
+            /* Pick a random page, other than the read-only one, and often access it across its end. */
+            size_t page_index;
+            do {
+                page_index = g_mt.GenerateRandomU32() % (MockPageCount - 1);
+            } while (page_index == ReadOnlyPageIndex || page_index + 1 == ReadOnlyPageIndex);
+
+            const size_t offset = (g_mt.GenerateRandomU32() % 4) == 0 ? PageSize - (g_mt.GenerateRandomU32() % size) - 1 : g_mt.GenerateRandomU32() % (PageSize - size);
+            return GetPageAddress(page_index) + offset;
+        }
+
+        void TestRandomTicks() {
+            MockAccessor accessor;
+
+            g_mt.GenerateRandomBytes(g_memory, sizeof(g_memory));
+            std::memcpy(g_expected, g_memory, sizeof(g_memory));
+
+            constexpr s32 TickCount = 20000;
+            for (s32 tick = 0; tick < TickCount; ++tick) {
+                g_batcher.Begin(std::addressof(accessor));
+
+                const size_t op_count = g_mt.GenerateRandomU32() % 64;
+                for (size_t i = 0; i < op_count; ++i) {
+                    const size_t size  = 1 + g_mt.GenerateRandomU32() % 16;
+                    const u64 address  = GenerateAddress(size);
+                    const u32 op       = g_mt.GenerateRandomU32() % 16;
+
+                    if (op < 8) {
+                        /* Reads must see what was written, even earlier in the tick. */
+                        u8 data[16];
+                        const Result result = g_batcher.Read(address, data, size);
+                        if (IsUnmapped(address, size)) {
+                            AMS_ABORT_UNLESS(R_FAILED(result));
+                        } else {
+                            R_ABORT_UNLESS(result);
+                            AMS_ABORT_UNLESS(std::memcmp(data, g_expected + (address - MockMemoryStart), size) == 0);
+                        }
+                    } else if (op < 15) {
+                        /* Writes to memory which can't be accessed must fail when made, and write nothing, as they did without batching. */
+                        u8 data[16];
+                        g_mt.GenerateRandomBytes(data, size);
+
+                        const Result result = g_batcher.Write(address, data, size);
+                        if (IsUnmapped(address, size)) {
+                            AMS_ABORT_UNLESS(R_FAILED(result));
+                        } else {
+                            R_ABORT_UNLESS(result);
+                            std::memcpy(g_expected + (address - MockMemoryStart), data, size);
+                        }
+                    } else {
+                        /* Pausing or resuming the process writes everything staged. */
+                        R_ABORT_UNLESS(g_batcher.Invalidate());
+                        AMS_ABORT_UNLESS(std::memcmp(g_memory, g_expected, sizeof(g_memory)) == 0);
+                    }
+                }
+
+                g_batcher.End();
+                AMS_ABORT_UNLESS(std::memcmp(g_memory, g_expected, sizeof(g_memory)) == 0);
+                AMS_ABORT_UNLESS(g_batcher.GetLastStatistics().write_failure_count == 0);
+            }
+
+            /* Statistics must account for every access the batcher made. */
+            const auto &statistics = g_batcher.GetLastStatistics();
+            AMS_ABORT_UNLESS(statistics.tick_count == TickCount);
+            AMS_ABORT_UNLESS(statistics.max_svc_count > 0);
+        }
+
+        void TestFailedStagedWrite() {
+            MockAccessor accessor;
+
+            g_batcher.ResetStatistics();
+            g_batcher.Begin(std::addressof(accessor));
+
+            /* Memory which can be read can't be known to be unwritable, so the write is staged and fails when flushed. */
+            const u64 address = GetPageAddress(ReadOnlyPageIndex) + 0x123;
+            const u32 value   = 0xCAFEBABE;
+            R_ABORT_UNLESS(g_batcher.Write(address, std::addressof(value), sizeof(value)));
+            AMS_ABORT_UNLESS(R_FAILED(g_batcher.Invalidate()));
+            AMS_ABORT_UNLESS(std::memcmp(g_memory + (address - MockMemoryStart), std::addressof(value), sizeof(value)) != 0);
+
+            /* Failures are also counted when the tick ends. */
+            R_ABORT_UNLESS(g_batcher.Write(address, std::addressof(value), sizeof(value)));
+            g_batcher.End();
+
+            AMS_ABORT_UNLESS(g_batcher.GetLastStatistics().write_failure_count == 2);
+            AMS_ABORT_UNLESS(g_batcher.GetLastStatistics().write_count == 2);
+        }
+
+        void TestEviction() {
+            MockAccessor accessor;
+
+            g_batcher.ResetStatistics();
+            g_batcher.Begin(std::addressof(accessor));
+
+            /* A page used between every access to other pages must never be evicted. */
+            constexpr size_t HotPageIndex = 0x30;
+            size_t cold_page_count = 0;
+            for (size_t i = 0; i < 0x100; ++i) {
+                u32 value;
+                R_ABORT_UNLESS(g_batcher.Read(GetPageAddress(HotPageIndex) + (i % (PageSize / sizeof(value))) * sizeof(value), std::addressof(value), sizeof(value)));
+
+                const size_t cold_page_index = i % 0x20;
+                if (cold_page_index == UnmappedPageIndex) {
+                    continue;
+                }
+                R_ABORT_UNLESS(g_batcher.Read(GetPageAddress(cold_page_index), std::addressof(value), sizeof(value)));
+                ++cold_page_count;
+            }
+
+            const size_t read_count = accessor.read_count;
+            g_batcher.End();
+
+            AMS_ABORT_UNLESS(read_count == 1 + cold_page_count);
+            AMS_ABORT_UNLESS(g_batcher.GetLastStatistics().read_svc_count == read_count);
+
+            /* Pages which fit in the batcher are read once per tick, however often they're used. */
+            accessor.read_count = 0;
+            g_batcher.Begin(std::addressof(accessor));
+            for (size_t i = 0; i < 0x100; ++i) {
+                u32 value;
+                R_ABORT_UNLESS(g_batcher.Read(GetPageAddress(0x10 + (i % CheatProcessMemoryBatcher::PageCount)), std::addressof(value), sizeof(value)));
+            }
+            g_batcher.End();
+
+            AMS_ABORT_UNLESS(accessor.read_count == CheatProcessMemoryBatcher::PageCount);
+        }
+
+    }
+
+    void Main() {
+        printf("Doing cheat memory batcher test!\n");
+
+        g_mt.Initialize(0);
+
+        TestRandomTicks();
+        TestFailedStagedWrite();
+        TestEviction();
+
+        printf("All tests completed!\n");
+    }
+
+}
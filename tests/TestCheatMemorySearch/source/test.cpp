@@ -0,0 +1,329 @@
+/*
+ * Copyright (c) Atmosphère-NX
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stratosphere.hpp>
+#include "../../../stratosphere/dmnt/source/cheat/impl/dmnt_cheat_memory_search.cpp"
+
+namespace ams {
+
+    namespace {
+
+        using dmnt::cheat::MemorySearchCondition;
+        using dmnt::cheat::MemorySearchRegionFilter;
+        using dmnt::cheat::MemorySearchResult;
+        using dmnt::cheat::impl::MemorySearcher;
+        using dmnt::cheat::impl::MemorySearchProvider;
+        using dmnt::cheat::impl::MemorySearchRegion;
+
+        constexpr u32 PermissionRead      = 1;
+        constexpr u32 PermissionReadWrite = 3;
+
+        constexpr u32 StateFree   = 0;
+        constexpr u32 StateCode   = 3;
+        constexpr u32 StateNormal = 5;
+
+        struct MockRegion {
+            u64 address;
+            u64 size;
+            u32 state;
+            u32 permission;
+            bool is_readable;
+        };
+
+        /* Mock a process, with a mix of region sizes and alignments. */
+        constexpr MockRegion MockRegions[] = {
+            { 0x0000000,  0x1000000, StateFree,   0,                   false },
+            { 0x1000000,    0x40000, StateCode,   PermissionRead,      true  },
+            { 0x1040000,    0x23000, StateNormal, PermissionReadWrite, true  },
+            { 0x1063000,     0x5000, StateNormal, PermissionReadWrite, false },
+            { 0x1068000,   0x1A8000, StateNormal, PermissionReadWrite, true  },
+            { 0x1210000,     0x1000, StateFree,   0,                   false },
+            { 0x1211000,    0x8F000, StateNormal, PermissionReadWrite, true  },
+        };
+
+        constexpr u64 MockMemoryStart = 0x1000000;
+        constexpr u64 MockMemoryEnd   = 0x12A0000;
+        constexpr size_t MockMemorySize = MockMemoryEnd - MockMemoryStart;
+
+        alignas(os::MemoryPageSize) constinit u8 g_memory[MockMemorySize];
+
+        class MockProvider : public MemorySearchProvider {
+            public:
+                virtual Result QueryMemory(MemorySearchRegion *out, u64 address) override {
+                    for (const auto &region : MockRegions) {
+                        if (region.address <= address && address < region.address + region.size) {
+                            *out = { region.address, region.size, region.state, region.permission };
+                            R_SUCCEED();
+                        }
+                    }
+
+                    /* Everything past our memory is one free region, up to the end of the address space. */
+                    *out = { MockMemoryEnd, 0 - MockMemoryEnd, StateFree, 0 };
+                    R_SUCCEED();
+                }
+
+                virtual Result ReadMemory(u64 address, void *dst, size_t size) override {
+                    for (u64 cur = util::AlignDown(address, os::MemoryPageSize); cur < address + size; cur += os::MemoryPageSize) {
+                        R_UNLESS(IsReadable(cur), svc::ResultInvalidCurrentMemory());
+                    }
+
+                    std::memcpy(dst, g_memory + (address - MockMemoryStart), size);
+                    R_SUCCEED();
+                }
+
+                static const MockRegion *FindRegion(u64 address) {
+                    for (const auto &region : MockRegions) {
+                        if (region.address <= address && address < region.address + region.size) {
+                            return std::addressof(region);
+                        }
+                    }
+                    return nullptr;
+                }
+
+                static bool IsReadable(u64 address) {
+                    const auto *region = FindRegion(address);
+                    return region != nullptr && region->is_readable;
+                }
+        };
+
+        constexpr size_t StorageSize = 512_KB;
+
+        alignas(alignof(u64)) constinit u8 g_storage[StorageSize];
+        alignas(alignof(u64)) constinit u8 g_chunk_buffer[MemorySearcher::ChunkSize];
+        constinit MemorySearchResult g_results[StorageSize];
+
+        util::TinyMT g_mt;
+
+        u64 ReadValue(u64 address, size_t width) {
+            u64 value = 0;
+            std::memcpy(std::addressof(value), g_memory + (address - MockMemoryStart), width);
+            return value;
+        }
+
+        void FillMemory(u32 value_max) {
+            for (size_t i = 0; i < MockMemorySize; ++i) {
+                g_memory[i] = g_mt.GenerateRandomU32() % value_max;
+            }
+        }
+
+        /* Scans one value at a time, as a client reading memory over ipc would. */
+        size_t ReferenceScan(MemorySearchResult *out, const MemorySearchCondition &condition, const MemorySearchRegionFilter &filter) {
+            const u64 address_max = filter.address_max != 0 ? filter.address_max : std::numeric_limits<u64>::max();
+
+            size_t count = 0;
+            for (u64 address = util::AlignUp(std::max(filter.address_min, MockMemoryStart), condition.width); address + condition.width <= std::min(address_max, MockMemoryEnd); address += condition.width) {
+                const auto *region = MockProvider::FindRegion(address);
+                if (!region->is_readable || (region->permission & filter.permission) != filter.permission) {
+                    continue;
+                }
+                if (filter.state_mask != 0 && (filter.state_mask & (1u << region->state)) == 0) {
+                    continue;
+                }
+                if (address + condition.width > region->address + region->size) {
+                    continue;
+                }
+
+                const u64 value = ReadValue(address, condition.width);
+                if (condition.value <= value && value <= (condition.comparison == dmnt::cheat::MemorySearchComparison_Equal ? condition.value : condition.value_max)) {
+                    out[count++] = { address, value };
+                }
+            }
+
+            return count;
+        }
+
+        size_t GetAllResults(MemorySearcher &searcher, size_t page_size) {
+            size_t total = 0;
+            while (true) {
+                u64 count;
+                R_ABORT_UNLESS(searcher.GetResults(g_results + total, page_size, std::addressof(count), total));
+                if (count == 0) {
+                    break;
+                }
+                total += count;
+            }
+
+            AMS_ABORT_UNLESS(total == searcher.GetCount());
+            return total;
+        }
+
+        void CheckResults(MemorySearcher &searcher, const MemorySearchResult *expected, size_t expected_count) {
+            AMS_ABORT_UNLESS(searcher.GetCount() == expected_count);
+
+            const size_t count = GetAllResults(searcher, 1 + g_mt.GenerateRandomU32() % 0x1000);
+            AMS_ABORT_UNLESS(count == expected_count);
+            for (size_t i = 0; i < count; ++i) {
+                AMS_ABORT_UNLESS(g_results[i].address == expected[i].address);
+                AMS_ABORT_UNLESS(g_results[i].value   == expected[i].value);
+            }
+        }
+
+        constinit MemorySearchResult g_expected[StorageSize];
+
+        void TestStart(MemorySearcher &searcher) {
+            MockProvider provider;
+
+            FillMemory(0x10);
+            for (const u8 width : { 1, 2, 4, 8 }) {
+                const MemorySearchCondition conditions[] = {
+                    { .value = 7,  .value_max = 0, .width = width, .comparison = dmnt::cheat::MemorySearchComparison_Equal   },
+                    { .value = 0,  .value_max = 4, .width = width, .comparison = dmnt::cheat::MemorySearchComparison_InRange },
+                };
+                const MemorySearchRegionFilter filters[] = {
+                    { .address_min = 0,         .address_max = 0,         .permission = 0,                   .state_mask = 0 },
+                    { .address_min = 0,         .address_max = 0,         .permission = PermissionReadWrite, .state_mask = 0 },
+                    { .address_min = 0,         .address_max = 0,         .permission = 0,                   .state_mask = (1u << StateCode) },
+                    { .address_min = 0x1050003, .address_max = 0x1212345, .permission = PermissionRead,      .state_mask = (1u << StateNormal) },
+                };
+
+                for (const auto &condition : conditions) {
+                    for (const auto &filter : filters) {
+                        const Result result = searcher.Start(std::addressof(provider), condition, filter);
+                        if (dmnt::cheat::ResultMemorySearchOutOfResource::Includes(result)) {
+                            AMS_ABORT_UNLESS(!searcher.IsStarted());
+                            continue;
+                        }
+                        R_ABORT_UNLESS(result);
+
+                        const size_t expected_count = ReferenceScan(g_expected, condition, filter);
+                        CheckResults(searcher, g_expected, expected_count);
+                    }
+                }
+            }
+        }
+
+        void TestNarrow(MemorySearcher &searcher) {
+            MockProvider provider;
+
+            /* Search for a wide range, then mutate memory between narrowing passes. */
+            FillMemory(0x100);
+            for (const u8 width : { 1, 2, 4, 8 }) {
+                const MemorySearchCondition start_condition = { .value = 0, .value_max = 0x0FFFFFFFFFFFFFFF, .width = width, .comparison = dmnt::cheat::MemorySearchComparison_InRange };
+                const MemorySearchRegionFilter filter       = { .address_min = 0x1080000, .address_max = 0x1080000 + StorageSize / 0x10, .permission = 0, .state_mask = 0 };
+
+                R_ABORT_UNLESS(searcher.Start(std::addressof(provider), start_condition, filter));
+                size_t count = ReferenceScan(g_expected, start_condition, filter);
+                CheckResults(searcher, g_expected, count);
+
+                for (const u8 comparison : { dmnt::cheat::MemorySearchComparison_Changed, dmnt::cheat::MemorySearchComparison_Increased, dmnt::cheat::MemorySearchComparison_InRange, dmnt::cheat::MemorySearchComparison_Equal }) {
+                    /* Change some of the values. */
+                    for (size_t i = 0; i < count; ++i) {
+                        if (g_mt.GenerateRandomU32() % 2 == 0) {
+                            g_memory[g_expected[i].address - MockMemoryStart] = g_mt.GenerateRandomU32();
+                        }
+                    }
+
+                    const MemorySearchCondition condition = { .value = 0x10, .value_max = 0xA0, .width = width, .comparison = comparison };
+                    R_ABORT_UNLESS(searcher.Narrow(std::addressof(provider), condition));
+
+                    size_t new_count = 0;
+                    for (size_t i = 0; i < count; ++i) {
+                        const u64 previous = g_expected[i].value;
+                        const u64 value    = ReadValue(g_expected[i].address, width);
+
+                        bool match;
+                        switch (comparison) {
+                            case dmnt::cheat::MemorySearchComparison_Changed:   match = value != previous; break;
+                            case dmnt::cheat::MemorySearchComparison_Increased: match = value > previous; break;
+                            case dmnt::cheat::MemorySearchComparison_InRange:   match = 0x10 <= value && value <= 0xA0; break;
+                            default:                                            match = value == 0x10; break;
+                        }
+
+                        if (match) {
+                            g_expected[new_count++] = { g_expected[i].address, value };
+                        }
+                    }
+
+                    count = new_count;
+                    CheckResults(searcher, g_expected, count);
+                }
+            }
+        }
+
+        void TestErrors(MemorySearcher &searcher) {
+            MockProvider provider;
+            const MemorySearchRegionFilter filter = {};
+
+            searcher.Clear();
+            u64 count;
+            AMS_ABORT_UNLESS(dmnt::cheat::ResultMemorySearchNotStarted::Includes(searcher.GetResults(g_results, 1, std::addressof(count), 0)));
+            AMS_ABORT_UNLESS(dmnt::cheat::ResultMemorySearchNotStarted::Includes(searcher.Narrow(std::addressof(provider), { .value = 0, .value_max = 0, .width = 4, .comparison = dmnt::cheat::MemorySearchComparison_Changed })));
+
+            /* Start can't compare against previous values, and values must fit their width. */
+            AMS_ABORT_UNLESS(dmnt::cheat::ResultMemorySearchInvalidCondition::Includes(searcher.Start(std::addressof(provider), { .value = 0,     .value_max = 0, .width = 4, .comparison = dmnt::cheat::MemorySearchComparison_Changed }, filter)));
+            AMS_ABORT_UNLESS(dmnt::cheat::ResultMemorySearchInvalidCondition::Includes(searcher.Start(std::addressof(provider), { .value = 0,     .value_max = 0, .width = 3, .comparison = dmnt::cheat::MemorySearchComparison_Equal   }, filter)));
+            AMS_ABORT_UNLESS(dmnt::cheat::ResultMemorySearchInvalidCondition::Includes(searcher.Start(std::addressof(provider), { .value = 0x100, .value_max = 0, .width = 1, .comparison = dmnt::cheat::MemorySearchComparison_Equal   }, filter)));
+            AMS_ABORT_UNLESS(dmnt::cheat::ResultMemorySearchInvalidCondition::Includes(searcher.Start(std::addressof(provider), { .value = 2,     .value_max = 1, .width = 1, .comparison = dmnt::cheat::MemorySearchComparison_InRange }, filter)));
+
+            /* Narrowing must use the width we searched with. */
+            R_ABORT_UNLESS(searcher.Start(std::addressof(provider), { .value = 0, .value_max = 0, .width = 8, .comparison = dmnt::cheat::MemorySearchComparison_Equal }, filter));
+            AMS_ABORT_UNLESS(dmnt::cheat::ResultMemorySearchInvalidCondition::Includes(searcher.Narrow(std::addressof(provider), { .value = 0, .value_max = 0, .width = 4, .comparison = dmnt::cheat::MemorySearchComparison_Changed })));
+
+            /* Too many results fails, and leaves no search behind. */
+            std::memset(g_memory, 0, sizeof(g_memory));
+            AMS_ABORT_UNLESS(dmnt::cheat::ResultMemorySearchOutOfResource::Includes(searcher.Start(std::addressof(provider), { .value = 0, .value_max = 0, .width = 1, .comparison = dmnt::cheat::MemorySearchComparison_Equal }, filter)));
+            AMS_ABORT_UNLESS(!searcher.IsStarted());
+        }
+
+        void DoBenchmark(MemorySearcher &searcher) {
+            MockProvider provider;
+
+            FillMemory(0x100);
+            for (const u8 width : { 1, 2, 4, 8 }) {
+                const MemorySearchCondition condition = { .value = 0x12, .value_max = 0, .width = width, .comparison = dmnt::cheat::MemorySearchComparison_Equal };
+                const MemorySearchRegionFilter filter = {};
+
+                constexpr s32 Iterations = 20;
+
+                const auto start_tick = os::GetSystemTick();
+                for (s32 i = 0; i < Iterations; ++i) {
+                    R_ABORT_UNLESS(searcher.Start(std::addressof(provider), condition, filter));
+                }
+                const auto search_time = (os::GetSystemTick() - start_tick).ToTimeSpan();
+
+                size_t expected_count = 0;
+                const auto reference_start_tick = os::GetSystemTick();
+                for (s32 i = 0; i < Iterations; ++i) {
+                    expected_count = ReferenceScan(g_expected, condition, filter);
+                }
+                const auto reference_time = (os::GetSystemTick() - reference_start_tick).ToTimeSpan();
+
+                AMS_ABORT_UNLESS(searcher.GetCount() == expected_count);
+
+                const double mb = static_cast<double>(MockMemorySize) / 1_MB;
+                printf("  width %u: search %7.1f MB/s, one value at a time %7.1f MB/s (%zu matches)\n", width,
+                       mb * Iterations / (search_time.GetNanoSeconds() / 1e9), mb * Iterations / (reference_time.GetNanoSeconds() / 1e9), expected_count);
+            }
+        }
+
+    }
+
+    void Main() {
+        printf("Doing cheat memory search test!\n");
+
+        g_mt.Initialize(0);
+
+        MemorySearcher searcher(g_storage, sizeof(g_storage), g_chunk_buffer);
+
+        TestStart(searcher);
+        TestNarrow(searcher);
+        TestErrors(searcher);
+
+        DoBenchmark(searcher);
+
+        printf("All tests completed!\n");
+    }
+
+}
@@ -0,0 +1,341 @@
+/*
+ * Copyright (c) Atmosphère-NX
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stratosphere.hpp>
+
+/* NOTE: The cheat api only passes svc::MemoryInfo by pointer, which the generic svc headers don't define. */
+namespace ams::svc { struct MemoryInfo; }
+
+#include "../../../stratosphere/dmnt/source/cheat/impl/dmnt_cheat_vm.cpp"
+
+namespace ams {
+
+    /* Mock the cheat process, with a flat buffer standing in for its memory. */
+    namespace {
+
+        constexpr size_t ProcessMemorySize = 64_KB;
+
+        constinit u8 g_process_memory[ProcessMemorySize];
+        constinit u64 g_keys_held = 0;
+
+        u8 *GetProcessMemory(u64 address, size_t size) {
+            AMS_ABORT_UNLESS(size <= sizeof(u64));
+            return g_process_memory + (address % (ProcessMemorySize - sizeof(u64)));
+        }
+
+    }
+
+    namespace hid {
+
+        Result GetKeysHeld(u64 *out) {
+            *out = g_keys_held;
+            R_SUCCEED();
+        }
+
+    }
+
+    namespace dmnt::cheat::impl {
+
+        Result ReadCheatProcessMemoryUnsafe(u64 process_addr, void *out_data, size_t size) {
+            std::memcpy(out_data, GetProcessMemory(process_addr, size), size);
+            R_SUCCEED();
+        }
+
+        Result WriteCheatProcessMemoryUnsafe(u64 process_addr, void *data, size_t size) {
+            std::memcpy(GetProcessMemory(process_addr, size), data, size);
+            R_SUCCEED();
+        }
+
+        Result PauseCheatProcessUnsafe() {
+            R_SUCCEED();
+        }
+
+        Result ResumeCheatProcessUnsafe() {
+            R_SUCCEED();
+        }
+
+    }
+
+    namespace {
+
+        using dmnt::cheat::CheatEntry;
+        using dmnt::cheat::CheatProcessMetadata;
+        using dmnt::cheat::impl::CheatVirtualMachine;
+
+        constexpr size_t CheatCountMax = CheatVirtualMachine::MaximumProgramOpcodeCount / util::size(CheatEntry{}.definition.opcodes);
+        constexpr s32 ExecuteCount     = 10'000;
+        constexpr u32 KeypressHeldMask = 0x3;
+
+        constinit CheatEntry g_cheats[CheatCountMax];
+        constinit CheatVirtualMachine g_vm;
+
+        constexpr CheatProcessMetadata ProcessMetadata = {};
+
+        /* Builds a cheat program, splitting it across as many cheats as needed. */
+        class ProgramBuilder {
+            private:
+                static constexpr s32 DepthMax        = 4;
+                static constexpr s32 ValueRegisters  = 8;
+                static constexpr size_t AddressRange = 0x1000;
+            private:
+                util::TinyMT m_mt;
+                u32 m_words[CheatVirtualMachine::MaximumProgramOpcodeCount];
+                size_t m_word_count;
+                u16 m_loop_registers;
+            public:
+                ProgramBuilder(u32 seed) : m_word_count(0), m_loop_registers(0) {
+                    m_mt.Initialize(seed);
+                }
+
+                void Emit(std::initializer_list<u32> words) {
+                    AMS_ABORT_UNLESS(m_word_count + words.size() <= util::size(m_words));
+                    for (const u32 word : words) {
+                        m_words[m_word_count++] = word;
+                    }
+                }
+
+                size_t GetWordCount() const { return m_word_count; }
+
+                size_t Load(CheatVirtualMachine &vm) const {
+                    constexpr size_t WordsPerCheat = util::size(CheatEntry{}.definition.opcodes);
+
+                    const size_t cheat_count = util::DivideUp(m_word_count, WordsPerCheat);
+                    for (size_t i = 0; i < cheat_count; ++i) {
+                        g_cheats[i].enabled                = true;
+                        g_cheats[i].cheat_id               = i;
+                        g_cheats[i].definition.num_opcodes = std::min(WordsPerCheat, m_word_count - i * WordsPerCheat);
+                        std::memcpy(g_cheats[i].definition.opcodes, m_words + i * WordsPerCheat, g_cheats[i].definition.num_opcodes * sizeof(u32));
+                    }
+
+                    AMS_ABORT_UNLESS(vm.LoadProgram(g_cheats, cheat_count));
+                    return cheat_count;
+                }
+
+                /* Generates random nested blocks, loops, loads, stores and arithmetic until the program is about the requested size. */
+                void GenerateRandom(size_t word_count) {
+                    while (m_word_count + 0x40 < std::min(word_count, util::size(m_words))) {
+                        this->GenerateStatement(0, word_count);
+                    }
+                }
+            private:
+                u32 Random(u32 max) { return m_mt.GenerateRandomU32() % max; }
+
+                u32 RandomWidth() {
+                    constexpr u32 Widths[] = { 1, 2, 4, 8 };
+                    return Widths[this->Random(util::size(Widths))];
+                }
+
+                void EmitValue(u32 width) {
+                    if (width == 8) {
+                        this->Emit({ this->Random(4), m_mt.GenerateRandomU32() });
+                    } else {
+                        this->Emit({ m_mt.GenerateRandomU32() & static_cast<u32>((1ul << (8 * width)) - 1) });
+                    }
+                }
+
+                void GenerateBlock(s32 depth, size_t word_count) {
+                    const u32 count = 1 + this->Random(6);
+                    for (u32 i = 0; i < count && m_word_count + 0x20 < word_count; ++i) {
+                        this->GenerateStatement(depth, word_count);
+                    }
+                }
+
+                void GenerateStatement(s32 depth, size_t word_count) {
+                    const u32 kind = this->Random(depth < DepthMax ? 10 : 7);
+                    const u32 reg  = this->Random(ValueRegisters);
+                    switch (kind) {
+                        case 0:
+                        case 1:
+                            {
+                                /* Store static: 0TMR00AA AAAAAAAA YYYYYYYY (YYYYYYYY) */
+                                const u32 width = this->RandomWidth();
+                                this->Emit({ (width << 24) | (reg << 16), this->Random(AddressRange) });
+                                this->EmitValue(width);
+                            }
+                            break;
+                        case 2:
+                            /* Load register static: 400R0000 VVVVVVVV VVVVVVVV */
+                            this->Emit({ 0x40000000 | (reg << 16), 0, this->Random(AddressRange) });
+                            break;
+                        case 3:
+                            {
+                                /* Load register memory: 5TMRI0AA AAAAAAAA */
+                                const u32 width = this->RandomWidth();
+                                this->Emit({ 0x50000000 | (width << 24) | (reg << 16), this->Random(AddressRange) });
+                            }
+                            break;
+                        case 4:
+                            /* Arithmetic static: 7T0RC000 VVVVVVVV */
+                            this->Emit({ 0x70000000 | (this->RandomWidth() << 24) | (reg << 16) | (this->Random(5) << 12), this->Random(0x100) });
+                            break;
+                        case 5:
+                            /* Store static to address: 6T0RIor0 VVVVVVVV VVVVVVVV */
+                            this->Emit({ 0x60000000 | (this->RandomWidth() << 24) | (reg << 16) | (this->Random(2) << 12), m_mt.GenerateRandomU32(), m_mt.GenerateRandomU32() });
+                            break;
+                        case 6:
+                            /* Arithmetic register: 9TCRSIs0 */
+                            this->Emit({ 0x90000000 | (this->RandomWidth() << 24) | (this->Random(5) << 20) | (reg << 16) | (this->Random(ValueRegisters) << 12) | (this->Random(ValueRegisters) << 4) });
+                            break;
+                        case 7:
+                            {
+                                /* Memory conditional: 1TMC00AA AAAAAAAA YYYYYYYY (YYYYYYYY) */
+                                const u32 width = this->RandomWidth();
+                                this->Emit({ 0x10000000 | (width << 24) | ((1 + this->Random(6)) << 16), this->Random(AddressRange) });
+                                this->EmitValue(width);
+                                this->GenerateConditionalBody(depth, word_count);
+                            }
+                            break;
+                        case 8:
+                            /* Keypress conditional: 8kkkkkkk */
+                            this->Emit({ 0x80000000 | (1 + this->Random(7)) });
+                            this->GenerateConditionalBody(depth, word_count);
+                            break;
+                        case 9:
+                            {
+                                /* Loop: 300R0000 VVVVVVVV ... 310R0000, using a register not used by an enclosing loop. */
+                                const u32 loop_reg = ValueRegisters + depth;
+                                AMS_ABORT_UNLESS((m_loop_registers & (1u << loop_reg)) == 0);
+                                m_loop_registers |= (1u << loop_reg);
+
+                                this->Emit({ 0x30000000 | (loop_reg << 16), 1 + this->Random(3) });
+                                this->GenerateBlock(depth + 1, word_count);
+                                this->Emit({ 0x31000000 | (loop_reg << 16) });
+
+                                m_loop_registers &= ~(1u << loop_reg);
+                            }
+                            break;
+                    }
+                }
+
+                void GenerateConditionalBody(s32 depth, size_t word_count) {
+                    this->GenerateBlock(depth + 1, word_count);
+                    if (this->Random(2) == 0) {
+                        this->Emit({ 0x21000000 });
+                        this->GenerateBlock(depth + 1, word_count);
+                    }
+                    this->Emit({ 0x20000000 });
+                }
+        };
+
+        void Execute(CheatVirtualMachine &vm) {
+            vm.Execute(std::addressof(ProcessMetadata));
+        }
+
+        u64 ReadProcessMemory(u64 address) {
+            u64 value;
+            R_ABORT_UNLESS(dmnt::cheat::impl::ReadCheatProcessMemoryUnsafe(address, std::addressof(value), sizeof(value)));
+            return value;
+        }
+
+        void TestConditionals() {
+            /* Check that failed ifs continue at their else, and that elses skip to the end of their block. */
+            ProgramBuilder builder(0);
+            builder.Emit({ 0x18050000, 0x100, 0x00000000, 0x00000001 }); /* if ([0x100].u64 == 1) */
+            builder.Emit({ 0x08000000, 0x200, 0x00000000, 0x00000011 }); /*     [0x200].u64 = 0x11 */
+            builder.Emit({ 0x80000004 });                                /*     if (keys & 4) */
+            builder.Emit({ 0x08000000, 0x208, 0x00000000, 0x00000022 }); /*         [0x208].u64 = 0x22 */
+            builder.Emit({ 0x21000000 });                                /*     else */
+            builder.Emit({ 0x08000000, 0x208, 0x00000000, 0x00000033 }); /*         [0x208].u64 = 0x33 */
+            builder.Emit({ 0x20000000 });                                /*     end */
+            builder.Emit({ 0x21000000 });                                /* else */
+            builder.Emit({ 0x08000000, 0x200, 0x00000000, 0x00000044 }); /*     [0x200].u64 = 0x44 */
+            builder.Emit({ 0x20000000 });                                /* end */
+            builder.Emit({ 0x08000000, 0x210, 0x00000000, 0x00000055 }); /* [0x210].u64 = 0x55 */
+            builder.Load(g_vm);
+
+            for (const u64 condition : { 0, 1 }) {
+                std::memset(g_process_memory, 0, sizeof(g_process_memory));
+                std::memcpy(GetProcessMemory(0x100, sizeof(condition)), std::addressof(condition), sizeof(condition));
+
+                Execute(g_vm);
+                AMS_ABORT_UNLESS(ReadProcessMemory(0x200) == (condition ? 0x11 : 0x44));
+                AMS_ABORT_UNLESS(ReadProcessMemory(0x208) == (condition ? 0x33 : 0x00));
+                AMS_ABORT_UNLESS(ReadProcessMemory(0x210) == 0x55);
+            }
+        }
+
+        void TestLoops() {
+            /* Check that loops jump back to their start, including from within a skipped conditional. */
+            ProgramBuilder builder(0);
+            builder.Emit({ 0x400A0000, 0x00000000, 0x00000000 });        /* R10 = 0 */
+            builder.Emit({ 0x300F0000, 0x00000005 });                    /* loop R15, 5 */
+            builder.Emit({ 0x780A0000, 0x00000001 });                    /*     R10 += 1 */
+            builder.Emit({ 0x18050000, 0x100, 0x00000000, 0x00000001 }); /*     if ([0x100].u64 == 1) */
+            builder.Emit({ 0x780A0000, 0x00000010 });                    /*         R10 += 0x10 */
+            builder.Emit({ 0x20000000 });                                /*     end */
+            builder.Emit({ 0x310F0000 });                                /* endloop R15 */
+            builder.Emit({ 0xA8AA0000 });                                /* [R10].u64 = R10 */
+            builder.Load(g_vm);
+
+            std::memset(g_process_memory, 0, sizeof(g_process_memory));
+            Execute(g_vm);
+            AMS_ABORT_UNLESS(ReadProcessMemory(5) == 5);
+        }
+
+        void TestTruncatedProgram() {
+            /* Check that execution stops at an opcode which fails to decode, even when skipping over it. */
+            ProgramBuilder builder(0);
+            builder.Emit({ 0x08000000, 0x200, 0x00000000, 0x00000011 }); /* [0x200].u64 = 0x11 */
+            builder.Emit({ 0x18050000, 0x100, 0x00000000, 0x00000001 }); /* if ([0x100].u64 == 1) */
+            builder.Emit({ 0x08000000 });                                /*     truncated */
+            builder.Load(g_vm);
+
+            std::memset(g_process_memory, 0, sizeof(g_process_memory));
+            Execute(g_vm);
+            AMS_ABORT_UNLESS(ReadProcessMemory(0x200) == 0x11);
+        }
+
+        void DoBenchmark(size_t word_count) {
+            ProgramBuilder builder(static_cast<u32>(word_count));
+            builder.GenerateRandom(word_count);
+            const size_t cheat_count = builder.Load(g_vm);
+
+            /* Execute the compiled program, as the vm thread does between reloads. */
+            const auto start_tick = os::GetSystemTick();
+            for (s32 i = 0; i < ExecuteCount; ++i) {
+                Execute(g_vm);
+            }
+            const auto execute_time = (os::GetSystemTick() - start_tick).ToTimeSpan();
+
+            /* Reload before every execution, which decodes the program each time as executing it used to. */
+            const auto reload_start_tick = os::GetSystemTick();
+            for (s32 i = 0; i < ExecuteCount; ++i) {
+                AMS_ABORT_UNLESS(g_vm.LoadProgram(g_cheats, cheat_count));
+                Execute(g_vm);
+            }
+            const auto reload_time = (os::GetSystemTick() - reload_start_tick).ToTimeSpan();
+
+            printf("  %4zu words: execute %7ld ns, reload + execute %7ld ns\n", builder.GetWordCount(), static_cast<long>(execute_time.GetNanoSeconds() / ExecuteCount), static_cast<long>(reload_time.GetNanoSeconds() / ExecuteCount));
+        }
+
+    }
+
+    void Main() {
+        printf("Doing cheat vm benchmark!\n");
+
+        g_keys_held = KeypressHeldMask;
+
+        TestConditionals();
+        TestLoops();
+        TestTruncatedProgram();
+
+        for (const size_t word_count : { 0x100, 0x200, 0x400 }) {
+            DoBenchmark(word_count);
+        }
+
+        printf("All tests completed!\n");
+    }
+
+}
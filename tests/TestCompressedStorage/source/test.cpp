@@ -0,0 +1,225 @@
+/*
+ * Copyright (c) Atmosphère-NX
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stratosphere.hpp>
+
+namespace ams {
+
+    namespace {
+
+        using Entry = fssystem::CompressedStorage::Entry;
+
+        constexpr size_t BlockSize   = 64_KB;
+        constexpr s32 BlockCount     = 512;
+        constexpr size_t VirtualSize = BlockSize * BlockCount;
+
+        constexpr s32 WorkerCount        = 4;
+        constexpr size_t WorkerStackSize = 16_KB;
+
+        constexpr s32 IterationCount = 4;
+
+        constexpr size_t NodeStorageSize  = fssystem::CompressedStorage::QueryNodeStorageSize(BlockCount);
+        constexpr size_t EntryStorageSize = fssystem::CompressedStorage::QueryEntryStorageSize(BlockCount);
+
+        alignas(os::MemoryPageSize) constinit u8 g_virtual_data[VirtualSize];
+        alignas(os::MemoryPageSize) constinit u8 g_physical_data[VirtualSize + BlockCount * fssystem::CompressionBlockAlignment];
+        alignas(os::MemoryPageSize) constinit u8 g_read_buffer[VirtualSize];
+        alignas(os::MemoryPageSize) constinit u8 g_node_storage[NodeStorageSize];
+        alignas(os::MemoryPageSize) constinit u8 g_entry_storage[EntryStorageSize];
+
+        alignas(os::MemoryPageSize) constinit u8 g_pooled_buffer[8_MB];
+        alignas(os::MemoryPageSize) constinit u8 g_buffer_manager_heap[4_MB];
+        alignas(os::ThreadStackAlignment) constinit u8 g_worker_stack[WorkerCount * WorkerStackSize];
+
+        fssystem::FileSystemBufferManager g_buffer_manager;
+        fssystem::DecompressionWorkerPool g_worker_pool;
+
+        class MallocMemoryResource : public MemoryResource {
+            protected:
+                virtual void *AllocateImpl(size_t size, size_t align) override {
+                    AMS_UNUSED(align);
+                    return std::malloc(size);
+                }
+
+                virtual void DeallocateImpl(void *p, size_t size, size_t align) override {
+                    AMS_UNUSED(size, align);
+                    return std::free(p);
+                }
+
+                virtual bool IsEqualImpl(const MemoryResource &rhs) const override {
+                    return this == std::addressof(rhs);
+                }
+        };
+
+        MallocMemoryResource g_allocator;
+
+        Result DecompressLz4(void *dst, size_t dst_size, const void *src, size_t src_size) {
+            AMS_ABORT_UNLESS(util::DecompressLZ4(dst, dst_size, src, src_size) == static_cast<int>(dst_size));
+            R_SUCCEED();
+        }
+
+        fssystem::DecompressorFunction GetDecompressor(fssystem::CompressionType type) {
+            return type == fssystem::CompressionType_Lz4 ? DecompressLz4 : nullptr;
+        }
+
+        void GenerateVirtualData() {
+            /* Generate moderately compressible data, made of short random words. */
+            util::TinyMT mt;
+            mt.Initialize(0x12345678);
+
+            for (s32 block = 0; block < BlockCount; ++block) {
+                u8 *dst = g_virtual_data + block * BlockSize;
+
+                /* Leave every sixteenth block as zeros. */
+                if ((block % 16) == 15) {
+                    std::memset(dst, 0, BlockSize);
+                    continue;
+                }
+
+                /* Leave every seventh block incompressible. */
+                if ((block % 7) == 6) {
+                    mt.GenerateRandomBytes(dst, BlockSize);
+                    continue;
+                }
+
+                for (size_t i = 0; i < BlockSize; ) {
+                    const size_t word_len = std::min<size_t>(1 + (mt.GenerateRandomU32() % 8), BlockSize - i);
+                    for (size_t j = 0; j < word_len; ++j) {
+                        dst[i++] = 'a' + (mt.GenerateRandomU32() % 6);
+                    }
+                }
+            }
+        }
+
+        void BuildCompressedImage() {
+            Entry entries[BlockCount];
+
+            /* Compress each block, laying out the physical data contiguously. */
+            s64 phys_offset = 0;
+            for (s32 block = 0; block < BlockCount; ++block) {
+                const u8 *src = g_virtual_data + block * BlockSize;
+
+                Entry &entry      = entries[block];
+                entry.virt_offset = block * BlockSize;
+                entry.phys_offset = phys_offset;
+
+                if (std::all_of(src, src + BlockSize, [](u8 c) { return c == 0; })) {
+                    /* Zero entries occupy no physical data, but must still have a non-zero physical size. */
+                    entry.compression_type = fssystem::CompressionType_Zeros;
+                    entry.phys_size        = BlockSize;
+                    continue;
+                }
+
+                const int compressed_size = util::CompressLZ4(g_physical_data + phys_offset, BlockSize - 1, src, BlockSize);
+                if (compressed_size > 0) {
+                    entry.compression_type = fssystem::CompressionType_Lz4;
+                    entry.phys_size        = compressed_size;
+                } else {
+                    std::memcpy(g_physical_data + phys_offset, src, BlockSize);
+                    entry.compression_type = fssystem::CompressionType_None;
+                    entry.phys_size        = BlockSize;
+                }
+
+                phys_offset = util::AlignUp(phys_offset + entry.phys_size, fssystem::CompressionBlockAlignment);
+            }
+
+            /* Write the entry sets. */
+            constexpr s32 EntriesPerSet = (fssystem::CompressedStorage::NodeSize - sizeof(fssystem::BucketTree::NodeHeader)) / sizeof(Entry);
+            const s32 set_count = util::DivideUp(BlockCount, EntriesPerSet);
+            AMS_ABORT_UNLESS(static_cast<size_t>(set_count) * sizeof(s64) + sizeof(fssystem::BucketTree::NodeHeader) <= fssystem::CompressedStorage::NodeSize);
+
+            for (s32 set = 0; set < set_count; ++set) {
+                const s32 start = set * EntriesPerSet;
+                const s32 count = std::min(EntriesPerSet, BlockCount - start);
+
+                u8 *node = g_entry_storage + set * fssystem::CompressedStorage::NodeSize;
+                const fssystem::BucketTree::NodeHeader header = { .index = set, .count = count, .offset = static_cast<s64>((start + count) * BlockSize) };
+                std::memcpy(node, std::addressof(header), sizeof(header));
+                std::memcpy(node + sizeof(header), entries + start, count * sizeof(Entry));
+            }
+
+            /* Write the L1 node. */
+            const fssystem::BucketTree::NodeHeader header = { .index = 0, .count = set_count, .offset = static_cast<s64>(VirtualSize) };
+            std::memcpy(g_node_storage, std::addressof(header), sizeof(header));
+            for (s32 set = 0; set < set_count; ++set) {
+                const s64 offset = static_cast<s64>(set) * EntriesPerSet * BlockSize;
+                std::memcpy(g_node_storage + sizeof(header) + set * sizeof(s64), std::addressof(offset), sizeof(offset));
+            }
+
+            printf("Built compressed image: virtual size 0x%zx, physical size 0x%zx\n", VirtualSize, static_cast<size_t>(phys_offset));
+        }
+
+        TimeSpan ReadWholeStorage(fssystem::CompressedStorage &storage, size_t read_size) {
+            std::memset(g_read_buffer, 0xCC, sizeof(g_read_buffer));
+
+            const auto start_tick = os::GetSystemTick();
+            for (size_t offset = 0; offset < VirtualSize; offset += read_size) {
+                R_ABORT_UNLESS(storage.Read(offset, g_read_buffer + offset, std::min(read_size, VirtualSize - offset)));
+            }
+            const auto elapsed = (os::GetSystemTick() - start_tick).ToTimeSpan();
+
+            /* Check that what we read is exactly what we compressed. */
+            AMS_ABORT_UNLESS(std::memcmp(g_read_buffer, g_virtual_data, VirtualSize) == 0);
+
+            return elapsed;
+        }
+
+        void DoBenchmark(fssystem::DecompressionWorkerPool *pool, size_t read_size) {
+            fs::MemoryStorage data_storage(g_physical_data, sizeof(g_physical_data));
+            fs::MemoryStorage node_storage(g_node_storage, sizeof(g_node_storage));
+            fs::MemoryStorage entry_storage(g_entry_storage, sizeof(g_entry_storage));
+
+            fssystem::CompressedStorage storage;
+            R_ABORT_UNLESS(storage.Initialize(std::addressof(g_allocator), std::addressof(g_buffer_manager), fs::SubStorage(std::addressof(data_storage), 0, sizeof(g_physical_data)), fs::SubStorage(std::addressof(node_storage), 0, sizeof(g_node_storage)), fs::SubStorage(std::addressof(entry_storage), 0, sizeof(g_entry_storage)), BlockCount, 64_KB, 640_KB, GetDecompressor, 16_KB, 16_KB, 0));
+            storage.SetDecompressionWorkerPool(pool);
+
+            /* Warm up, then measure. */
+            ReadWholeStorage(storage, read_size);
+
+            TimeSpan total = TimeSpan::FromNanoSeconds(0);
+            for (s32 i = 0; i < IterationCount; ++i) {
+                total += ReadWholeStorage(storage, read_size);
+            }
+
+            const s64 us = std::max<s64>(total.GetMicroSeconds() / IterationCount, 1);
+            printf("  %-8s read size 0x%07zx: %8ld us, %8.1f MB/s\n", pool != nullptr ? "parallel" : "serial", read_size, static_cast<long>(us), static_cast<double>(VirtualSize) / static_cast<double>(us));
+        }
+
+    }
+
+    void Main() {
+        printf("Doing CompressedStorage benchmark!\n");
+
+        /* Initialize the buffer pool and buffer manager. */
+        R_ABORT_UNLESS(fssystem::InitializeBufferPool(reinterpret_cast<char *>(g_pooled_buffer), sizeof(g_pooled_buffer)));
+        R_ABORT_UNLESS(g_buffer_manager.Initialize(32, reinterpret_cast<uintptr_t>(g_buffer_manager_heap), sizeof(g_buffer_manager_heap), 16_KB));
+
+        /* Build the synthetic image. */
+        GenerateVirtualData();
+        BuildCompressedImage();
+
+        /* Start our decompression workers. */
+        R_ABORT_UNLESS(g_worker_pool.Initialize(g_worker_stack, sizeof(g_worker_stack), WorkerCount, os::DefaultThreadPriority));
+        ON_SCOPE_EXIT { g_worker_pool.Finalize(); };
+
+        for (const size_t read_size : { 256_KB, 1_MB, 4_MB }) {
+            DoBenchmark(nullptr, read_size);
+            DoBenchmark(std::addressof(g_worker_pool), read_size);
+        }
+
+        printf("All tests completed!\n");
+    }
+
+}
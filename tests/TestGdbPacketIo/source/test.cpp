@@ -0,0 +1,321 @@
+/*
+ * Copyright (c) Atmosphère-NX
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stratosphere.hpp>
+#include "../../../stratosphere/dmnt.gen2/source/dmnt2_gdb_packet_io.cpp"
+#include "../../../stratosphere/dmnt.gen2/source/dmnt2_transport_layer.cpp"
+#include "../../../stratosphere/dmnt.gen2/source/dmnt2_transport_session.cpp"
+#include "../../../stratosphere/dmnt.gen2/source/dmnt2_transport_receive_buffer.cpp"
+
+namespace ams {
+
+    namespace dmnt {
+
+        void DebugLog(const char *prefix, const char *fmt, ...) {
+            AMS_UNUSED(prefix, fmt);
+        }
+
+    }
+
+    namespace {
+
+        using dmnt::GdbPacketBufferSize;
+
+        constexpr u16 GdbServerPort = 22225;
+
+        /* Replies carry as much memory as the m packet can, which is less than half the packet size. */
+        constexpr size_t MemoryPerPacket = GdbPacketBufferSize / 2 - 1;
+        constexpr size_t BenchmarkPacketCount = 0x800;
+
+        alignas(os::MemoryPageSize) constinit u8 g_client_thread_stack[256_KB];
+
+        constinit u8 g_memory[MemoryPerPacket * 4];
+        constinit char g_reply[GdbPacketBufferSize];
+
+        util::TypedStorage<dmnt::TransportSession> g_session;
+        util::TypedStorage<dmnt::GdbPacketIo> g_packet_io;
+
+        constexpr char EncodeHex(u8 v) {
+            return "0123456789abcdef"[v & 0xF];
+        }
+
+        constexpr u8 DecodeHex(char c) {
+            return ('a' <= c && c <= 'f') ? (10 + c - 'a') : (c - '0');
+        }
+
+        /* Encodes memory as the m packet does. */
+        size_t MemoryToHex(char *dst, const u8 *src, size_t size) {
+            for (size_t i = 0; i < size; ++i) {
+                dst[2 * i + 0] = EncodeHex(src[i] >> 4);
+                dst[2 * i + 1] = EncodeHex(src[i] >> 0);
+            }
+            return 2 * size;
+        }
+
+        /* Reads and checks packets on the client side of the connection, as gdb does. */
+        class ClientConnection {
+            private:
+                s32 m_fd;
+                char m_buffer[GdbPacketBufferSize + 4];
+                size_t m_offset;
+                size_t m_size;
+            public:
+                explicit ClientConnection(s32 fd) : m_fd(fd), m_offset(0), m_size(0) { /* ... */ }
+
+                char GetChar() {
+                    if (m_offset == m_size) {
+                        const auto received = socket::Recv(m_fd, m_buffer, sizeof(m_buffer), socket::MsgFlag::Msg_None);
+                        AMS_ABORT_UNLESS(received > 0);
+
+                        m_offset = 0;
+                        m_size   = received;
+                    }
+
+                    return m_buffer[m_offset++];
+                }
+
+                /* Receives a packet, returning its raw (escaped) data. */
+                size_t ReceivePacket(char *dst) {
+                    AMS_ABORT_UNLESS(this->GetChar() == '$');
+
+                    size_t size = 0;
+                    u8 checksum = 0;
+                    for (char c = this->GetChar(); c != '#'; c = this->GetChar()) {
+                        checksum += static_cast<u8>(c);
+                        dst[size++] = c;
+                    }
+
+                    const u8 high = DecodeHex(this->GetChar());
+                    const u8 low  = DecodeHex(this->GetChar());
+                    AMS_ABORT_UNLESS(checksum == ((high << 4) | low));
+
+                    return size;
+                }
+
+                void SendPacket(const char *src, size_t size) {
+                    char packet[1 + GdbPacketBufferSize + 3];
+
+                    u8 checksum = 0;
+                    packet[0] = '$';
+                    for (size_t i = 0; i < size; ++i) {
+                        checksum += static_cast<u8>(src[i]);
+                        packet[1 + i] = src[i];
+                    }
+                    packet[1 + size] = '#';
+                    packet[2 + size] = EncodeHex(checksum >> 4);
+                    packet[3 + size] = EncodeHex(checksum >> 0);
+
+                    AMS_ABORT_UNLESS(socket::Send(m_fd, packet, size + 4, socket::MsgFlag::Msg_None) == static_cast<ssize_t>(size + 4));
+                }
+        };
+
+        size_t UnescapeBinary(u8 *dst, const char *src, size_t size) {
+            size_t count = 0;
+            for (size_t i = 0; i < size; ++i) {
+                dst[count++] = (src[i] == '}') ? (src[++i] ^ 0x20) : src[i];
+            }
+            return count;
+        }
+
+        void ClientThread(void *arg) {
+            os::EventType *done_event = static_cast<os::EventType *>(arg);
+
+            const s32 fd = socket::Socket(socket::Family::Af_Inet, socket::Type::Sock_Stream, socket::Protocol::IpProto_Ip);
+            AMS_ABORT_UNLESS(fd >= 0);
+
+            socket::SockAddrIn addr = {};
+            addr.sin_family      = socket::Family::Af_Inet;
+            addr.sin_addr.s_addr = socket::InAddr_Loopback;
+            addr.sin_port        = socket::InetHtons(GdbServerPort);
+            AMS_ABORT_UNLESS(socket::Connect(fd, reinterpret_cast<socket::SockAddr *>(std::addressof(addr)), sizeof(addr)) == 0);
+
+            ClientConnection connection(fd);
+            char packet[GdbPacketBufferSize];
+
+            /* Send a binary write of every byte value. */
+            {
+                size_t size = util::TSNPrintf(packet, sizeof(packet), "X1000,%x:", 0x100);
+
+                u8 data[0x100];
+                for (size_t i = 0; i < sizeof(data); ++i) {
+                    data[i] = i;
+                }
+
+                size_t escaped_size;
+                size += dmnt::GdbPacketIo::EscapeBinaryData(std::addressof(escaped_size), packet + size, sizeof(packet) - size, data, sizeof(data));
+                AMS_ABORT_UNLESS(escaped_size == sizeof(data));
+
+                connection.SendPacket(packet, size);
+            }
+
+            /* Check the binary reply. */
+            {
+                const size_t size = connection.ReceivePacket(packet);
+                AMS_ABORT_UNLESS(packet[0] == 'b');
+
+                u8 data[0x100];
+                AMS_ABORT_UNLESS(UnescapeBinary(data, packet + 1, size - 1) == sizeof(data));
+                for (size_t i = 0; i < sizeof(data); ++i) {
+                    AMS_ABORT_UNLESS(data[i] == i);
+                }
+                os::SignalEvent(done_event);
+            }
+
+            /* Receive and decode the benchmark replies. */
+            for (const bool is_binary : { false, true }) {
+                for (size_t i = 0; i < BenchmarkPacketCount; ++i) {
+                    const size_t size = connection.ReceivePacket(packet);
+
+                    u8 data[MemoryPerPacket];
+                    size_t data_size;
+                    if (is_binary) {
+                        data_size = UnescapeBinary(data, packet + 1, size - 1);
+                    } else {
+                        for (data_size = 0; data_size < size / 2; ++data_size) {
+                            data[data_size] = (DecodeHex(packet[2 * data_size]) << 4) | DecodeHex(packet[2 * data_size + 1]);
+                        }
+                    }
+
+                    const u8 *expected = g_memory + (i % 4) * MemoryPerPacket;
+                    AMS_ABORT_UNLESS(data_size == MemoryPerPacket);
+                    AMS_ABORT_UNLESS(std::memcmp(data, expected, data_size) == 0);
+                }
+                os::SignalEvent(done_event);
+            }
+
+            AMS_ABORT_UNLESS(socket::Close(fd) == 0);
+        }
+
+        void TestReceiveBinary(dmnt::GdbPacketIo &io, dmnt::TransportSession &session) {
+            /* Check that escaped data, including nulls, comes through intact. */
+            bool do_break;
+            size_t size;
+            char packet[GdbPacketBufferSize];
+            AMS_ABORT_UNLESS(io.ReceivePacket(std::addressof(do_break), std::addressof(size), packet, sizeof(packet), std::addressof(session)) == packet);
+            AMS_ABORT_UNLESS(!do_break);
+
+            const char *data = std::strchr(packet, ':') + 1;
+            AMS_ABORT_UNLESS(std::memcmp(packet, "X1000,100:", data - packet) == 0);
+            AMS_ABORT_UNLESS(static_cast<size_t>(packet + size - data) == 0x100);
+            for (size_t i = 0; i < 0x100; ++i) {
+                AMS_ABORT_UNLESS(static_cast<u8>(data[i]) == i);
+            }
+        }
+
+        void TestSendBinary(dmnt::GdbPacketIo &io, dmnt::TransportSession &session) {
+            u8 data[0x100];
+            for (size_t i = 0; i < sizeof(data); ++i) {
+                data[i] = i;
+            }
+
+            g_reply[0] = 'b';
+
+            size_t escaped_size;
+            const size_t size = 1 + dmnt::GdbPacketIo::EscapeBinaryData(std::addressof(escaped_size), g_reply + 1, sizeof(g_reply) - 1, data, sizeof(data));
+            AMS_ABORT_UNLESS(escaped_size == sizeof(data));
+
+            /* Check that escaping stops when the destination fills. */
+            char small[3];
+            AMS_ABORT_UNLESS(dmnt::GdbPacketIo::EscapeBinaryData(std::addressof(escaped_size), small, sizeof(small), data + '#' - 1, 3) == 3);
+            AMS_ABORT_UNLESS(escaped_size == 2);
+
+            bool do_break;
+            io.SendPacket(std::addressof(do_break), g_reply, size, std::addressof(session));
+        }
+
+        void DoBenchmark(dmnt::GdbPacketIo &io, dmnt::TransportSession &session, os::EventType *done_event) {
+            for (const bool is_binary : { false, true }) {
+                os::ClearEvent(done_event);
+
+                size_t total_size = 0;
+                const auto start_tick = os::GetSystemTick();
+                for (size_t i = 0; i < BenchmarkPacketCount; ++i) {
+                    const u8 *memory = g_memory + (i % 4) * MemoryPerPacket;
+
+                    size_t size;
+                    if (is_binary) {
+                        size_t escaped_size;
+                        g_reply[0] = 'b';
+                        size = 1 + dmnt::GdbPacketIo::EscapeBinaryData(std::addressof(escaped_size), g_reply + 1, sizeof(g_reply) - 2, memory, MemoryPerPacket);
+                        AMS_ABORT_UNLESS(escaped_size == MemoryPerPacket);
+                    } else {
+                        size = MemoryToHex(g_reply, memory, MemoryPerPacket);
+                    }
+                    g_reply[size] = 0;
+
+                    bool do_break;
+                    io.SendPacket(std::addressof(do_break), g_reply, size, std::addressof(session));
+                    total_size += size + 4;
+                }
+                os::WaitEvent(done_event);
+                const auto time = (os::GetSystemTick() - start_tick).ToTimeSpan();
+
+                const double mb = static_cast<double>(MemoryPerPacket * BenchmarkPacketCount) / 1_MB;
+                printf("  %s: %6.1f MB of memory in %6.1f MB of packets, %7.1f MB/s\n", is_binary ? "x" : "m", mb, static_cast<double>(total_size) / 1_MB, mb / (time.GetNanoSeconds() / 1e9));
+            }
+        }
+
+    }
+
+    void Main() {
+        printf("Doing gdb packet io test!\n");
+
+        /* Make memory that looks like a process's: mostly code and data, with some zero-filled stretches. */
+        {
+            util::TinyMT mt;
+            mt.Initialize(0);
+            for (size_t i = 0; i < sizeof(g_memory); ++i) {
+                g_memory[i] = (i % 0x1000 < 0x300) ? 0 : mt.GenerateRandomU32();
+            }
+        }
+
+        dmnt::transport::InitializeByTcp();
+
+        const s32 listen_fd = dmnt::transport::Socket();
+        AMS_ABORT_UNLESS(listen_fd >= 0);
+        AMS_ABORT_UNLESS(dmnt::transport::Bind(listen_fd, dmnt::transport::PortName_GdbServer) == 0);
+        AMS_ABORT_UNLESS(dmnt::transport::Listen(listen_fd, 1) == 0);
+
+        os::EventType done_event;
+        os::InitializeEvent(std::addressof(done_event), false, os::EventClearMode_AutoClear);
+
+        os::ThreadType client_thread;
+        R_ABORT_UNLESS(os::CreateThread(std::addressof(client_thread), ClientThread, std::addressof(done_event), g_client_thread_stack, sizeof(g_client_thread_stack), os::DefaultThreadPriority));
+        os::StartThread(std::addressof(client_thread));
+
+        const s32 fd = dmnt::transport::Accept(listen_fd);
+        AMS_ABORT_UNLESS(fd >= 0);
+
+        auto &session = *util::ConstructAt(g_session, fd);
+        auto &io      = *util::ConstructAt(g_packet_io);
+        io.SetNoAck();
+
+        TestReceiveBinary(io, session);
+        TestSendBinary(io, session);
+        os::WaitEvent(std::addressof(done_event));
+
+        DoBenchmark(io, session, std::addressof(done_event));
+
+        os::WaitThread(std::addressof(client_thread));
+        os::DestroyThread(std::addressof(client_thread));
+
+        util::DestroyAt(g_session);
+        util::DestroyAt(g_packet_io);
+        dmnt::transport::Close(listen_fd);
+
+        printf("All tests completed!\n");
+    }
+
+}
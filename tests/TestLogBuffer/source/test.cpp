@@ -0,0 +1,277 @@
+/*
+ * Copyright (c) Atmosphère-NX
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stratosphere.hpp>
+#include "../../../libraries/libstratosphere/source/lm/srv/lm_log_buffer.hpp"
+
+namespace ams {
+
+    namespace {
+
+        using lm::srv::LogBuffer;
+
+        constexpr size_t ProducerCount        = 8;
+        constexpr size_t MessagesPerProducer  = 0x4000;
+        constexpr size_t MessageSizeMin       = sizeof(u32) * 4;
+        constexpr size_t MessageSizeMax       = 0x200;
+        constexpr size_t BenchmarkMessageSize = 0x100;
+
+        struct MessageHeader {
+            u32 size;
+            u32 producer;
+            u32 sequence;
+            u32 seed;
+        };
+        static_assert(sizeof(MessageHeader) == MessageSizeMin);
+
+        constinit u8 g_log_buffer_storage[64_KB];
+
+        alignas(os::MemoryPageSize) constinit u8 g_producer_thread_stacks[ProducerCount][16_KB];
+        alignas(os::MemoryPageSize) constinit u8 g_flush_thread_stack[16_KB];
+
+        constinit u32 g_next_sequences[ProducerCount];
+        constinit size_t g_flush_count;
+        constinit size_t g_flush_failure_interval;
+        constinit bool g_verify_messages;
+
+        constinit std::atomic<size_t> g_received_message_count;
+        constinit std::atomic<bool> g_stop_flush;
+
+        constexpr u8 GetMessageByte(u32 seed, size_t i) {
+            return static_cast<u8>(seed + i * 0x1F);
+        }
+
+        bool FlushFunction(const u8 *data, size_t size) {
+            /* Periodically fail, to check that failed flushes are retried without loss. */
+            if (g_flush_failure_interval != 0 && (++g_flush_count % g_flush_failure_interval) == 0) {
+                return false;
+            }
+
+            /* Check every message in the flushed data. */
+            size_t offset = 0;
+            size_t message_count = 0;
+            while (offset < size) {
+                MessageHeader header;
+                AMS_ABORT_UNLESS(size - offset >= sizeof(header));
+                std::memcpy(std::addressof(header), data + offset, sizeof(header));
+                AMS_ABORT_UNLESS(header.size >= sizeof(header) && header.size <= size - offset);
+
+                if (g_verify_messages) {
+                    /* Messages from each producer must arrive exactly once, in order. */
+                    AMS_ABORT_UNLESS(header.producer < ProducerCount);
+                    AMS_ABORT_UNLESS(header.sequence == g_next_sequences[header.producer]++);
+
+                    for (size_t i = sizeof(header); i < header.size; ++i) {
+                        AMS_ABORT_UNLESS(data[offset + i] == GetMessageByte(header.seed, i));
+                    }
+                }
+
+                offset += header.size;
+                ++message_count;
+            }
+
+            g_received_message_count += message_count;
+            return true;
+        }
+
+        constinit util::TypedStorage<LogBuffer> g_log_buffer;
+
+        LogBuffer &GetLogBuffer() {
+            return util::GetReference(g_log_buffer);
+        }
+
+        void ProducerThread(void *arg) {
+            const u32 producer = static_cast<u32>(reinterpret_cast<uintptr_t>(arg));
+
+            u8 message[MessageSizeMax];
+            for (u32 sequence = 0; sequence < MessagesPerProducer; ++sequence) {
+                /* Make a message of varying size. */
+                const u32 seed = producer * 0x10000 + sequence;
+                const size_t size = g_verify_messages ? MessageSizeMin + (seed * 0x9E3779B1u) % (MessageSizeMax - MessageSizeMin + 1) : BenchmarkMessageSize;
+
+                const MessageHeader header = { static_cast<u32>(size), producer, sequence, seed };
+                std::memcpy(message, std::addressof(header), sizeof(header));
+                for (size_t i = sizeof(header); i < size; ++i) {
+                    message[i] = GetMessageByte(seed, i);
+                }
+
+                AMS_ABORT_UNLESS(GetLogBuffer().Push(message, size));
+            }
+        }
+
+        void FlushThread(void *) {
+            while (!g_stop_flush) {
+                GetLogBuffer().Flush();
+            }
+        }
+
+        void StartFlushThread(os::ThreadType *thread) {
+            g_stop_flush = false;
+            R_ABORT_UNLESS(os::CreateThread(thread, FlushThread, nullptr, g_flush_thread_stack, sizeof(g_flush_thread_stack), os::DefaultThreadPriority));
+            os::StartThread(thread);
+        }
+
+        void StopFlushThread(os::ThreadType *thread) {
+            /* Push an empty-bodied message, so that the flush thread wakes up to see it should stop. */
+            g_stop_flush = true;
+
+            const MessageHeader header = { sizeof(MessageHeader), 0, 0, 0 };
+            const bool verify = g_verify_messages;
+            g_verify_messages = false;
+            AMS_ABORT_UNLESS(GetLogBuffer().Push(std::addressof(header), sizeof(header)));
+
+            os::WaitThread(thread);
+            os::DestroyThread(thread);
+            g_verify_messages = verify;
+        }
+
+        TimeSpan RunProducers() {
+            os::ThreadType threads[ProducerCount];
+
+            const auto start_tick = os::GetSystemTick();
+            for (size_t i = 0; i < ProducerCount; ++i) {
+                R_ABORT_UNLESS(os::CreateThread(threads + i, ProducerThread, reinterpret_cast<void *>(i), g_producer_thread_stacks[i], sizeof(g_producer_thread_stacks[i]), os::DefaultThreadPriority));
+                os::StartThread(threads + i);
+            }
+
+            for (size_t i = 0; i < ProducerCount; ++i) {
+                os::WaitThread(threads + i);
+                os::DestroyThread(threads + i);
+            }
+
+            /* Wait for everything to be flushed. */
+            while (g_received_message_count < ProducerCount * MessagesPerProducer) {
+                os::SleepThread(TimeSpan::FromMilliSeconds(1));
+            }
+
+            return (os::GetSystemTick() - start_tick).ToTimeSpan();
+        }
+
+        void TestConcurrentPush(size_t failure_interval) {
+            /* Reset state. */
+            std::memset(g_next_sequences, 0, sizeof(g_next_sequences));
+            g_flush_count            = 0;
+            g_flush_failure_interval = failure_interval;
+            g_verify_messages        = true;
+            g_received_message_count = 0;
+
+            os::ThreadType flush_thread;
+            StartFlushThread(std::addressof(flush_thread));
+
+            RunProducers();
+
+            StopFlushThread(std::addressof(flush_thread));
+
+            /* Check that every message arrived. */
+            for (size_t i = 0; i < ProducerCount; ++i) {
+                AMS_ABORT_UNLESS(g_next_sequences[i] == MessagesPerProducer);
+            }
+        }
+
+        void TestTryPushAndCancel() {
+            /* With nothing flushing, the buffer should fill up. */
+            u8 message[MessageSizeMax] = {};
+            const MessageHeader header = { sizeof(message), 0, 0, 0 };
+            std::memcpy(message, std::addressof(header), sizeof(header));
+
+            size_t pushed_size = 0;
+            while (GetLogBuffer().TryPush(message, sizeof(message))) {
+                pushed_size += sizeof(message);
+            }
+            AMS_ABORT_UNLESS(pushed_size > sizeof(g_log_buffer_storage) / 2);
+            AMS_ABORT_UNLESS(pushed_size <= sizeof(g_log_buffer_storage));
+
+            /* Data larger than a chunk can never be pushed. */
+            AMS_ABORT_UNLESS(!GetLogBuffer().TryPush(g_log_buffer_storage, GetLogBuffer().GetPushSizeMax() + 1));
+
+            /* A blocked push should fail once canceled. */
+            os::ThreadType thread;
+            R_ABORT_UNLESS(os::CreateThread(std::addressof(thread), [](void *arg) {
+                u8 *message = static_cast<u8 *>(arg);
+                AMS_ABORT_UNLESS(!GetLogBuffer().Push(message, MessageSizeMax));
+            }, message, g_producer_thread_stacks[0], sizeof(g_producer_thread_stacks[0]), os::DefaultThreadPriority));
+            os::StartThread(std::addressof(thread));
+
+            os::SleepThread(TimeSpan::FromMilliSeconds(50));
+            GetLogBuffer().CancelPush();
+
+            os::WaitThread(std::addressof(thread));
+            os::DestroyThread(std::addressof(thread));
+
+            /* Flushing should drain everything that was pushed. */
+            g_verify_messages        = false;
+            g_flush_failure_interval = 0;
+            g_received_message_count = 0;
+            while (GetLogBuffer().TryFlush()) {
+                /* ... */
+            }
+            AMS_ABORT_UNLESS(g_received_message_count * sizeof(message) == pushed_size);
+        }
+
+        void TestTimedFlush() {
+            /* With nothing pushed, a timed flush should give up. */
+            const auto start_tick = os::GetSystemTick();
+            AMS_ABORT_UNLESS(!GetLogBuffer().TimedFlush(TimeSpan::FromMilliSeconds(20)));
+            AMS_ABORT_UNLESS((os::GetSystemTick() - start_tick).ToTimeSpan() >= TimeSpan::FromMilliSeconds(20));
+
+            /* Once something is pushed, a timed flush should flush it. */
+            u8 message[0x20] = {};
+            const MessageHeader header = { sizeof(message), 0, 0, 0 };
+            std::memcpy(message, std::addressof(header), sizeof(header));
+
+            g_received_message_count = 0;
+            AMS_ABORT_UNLESS(GetLogBuffer().TryPush(message, sizeof(message)));
+            AMS_ABORT_UNLESS(GetLogBuffer().TimedFlush(TimeSpan::FromMilliSeconds(20)));
+            AMS_ABORT_UNLESS(g_received_message_count == 1);
+        }
+
+        void DoBenchmark() {
+            g_flush_failure_interval = 0;
+            g_verify_messages        = false;
+            g_received_message_count = 0;
+
+            os::ThreadType flush_thread;
+            StartFlushThread(std::addressof(flush_thread));
+
+            const auto time = RunProducers();
+
+            StopFlushThread(std::addressof(flush_thread));
+
+            const size_t message_count = ProducerCount * MessagesPerProducer;
+            printf("  %zu threads: %7.2f M messages/s, %7.1f MB/s\n", ProducerCount,
+                   message_count / (time.GetNanoSeconds() / 1e3),
+                   static_cast<double>(message_count * BenchmarkMessageSize) / 1_MB / (time.GetNanoSeconds() / 1e9));
+        }
+
+    }
+
+    void Main() {
+        printf("Doing log buffer test!\n");
+
+        util::ConstructAt(g_log_buffer, g_log_buffer_storage, sizeof(g_log_buffer_storage), FlushFunction);
+
+        TestTryPushAndCancel();
+        TestTimedFlush();
+        TestConcurrentPush(0);
+        TestConcurrentPush(7);
+
+        DoBenchmark();
+
+        util::DestroyAt(g_log_buffer);
+
+        printf("All tests completed!\n");
+    }
+
+}
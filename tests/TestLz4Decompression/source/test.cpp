@@ -0,0 +1,275 @@
+/*
+ * Copyright (c) Atmosphère-NX
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stratosphere.hpp>
+
+namespace ams {
+
+    namespace {
+
+        constexpr size_t DataSizeMax   = 256_KB;
+        constexpr size_t CompressedMax = DataSizeMax + DataSizeMax / 255 + 16;
+        constexpr size_t GuardSize     = 64;
+        constexpr u8 GuardValue        = 0xA5;
+
+        constexpr s32 ValidIterationCount    = 200;
+        constexpr s32 MutationIterationCount = 20000;
+
+        constinit u8 g_data[DataSizeMax];
+        constinit u8 g_compressed[CompressedMax];
+        constinit u8 g_input[CompressedMax];
+        constinit u8 g_expected[DataSizeMax];
+        constinit u8 g_output[GuardSize + DataSizeMax + GuardSize];
+        constinit u8 g_reported[DataSizeMax];
+        constinit u8 g_in_place[DataSizeMax + CompressedMax];
+
+        size_t GenerateRandom(util::TinyMT &mt, size_t n) {
+            return static_cast<size_t>(mt.GenerateRandomU32()) % n;
+        }
+
+        struct CallbackContext {
+            const u8 *output;
+            size_t unit_size;
+            size_t reported_size;
+            bool is_valid;
+        };
+
+        bool OnUnitDecompressed(const void *data, size_t size, void *arg) {
+            auto *ctx = static_cast<CallbackContext *>(arg);
+
+            /* Units must be reported in order, and all but the last must be full. */
+            if (data != ctx->output + ctx->reported_size || size == 0 || size > ctx->unit_size || (ctx->reported_size % ctx->unit_size) != 0) {
+                ctx->is_valid = false;
+                return false;
+            }
+
+            std::memcpy(g_reported + ctx->reported_size, data, size);
+            ctx->reported_size += size;
+            return true;
+        }
+
+        /* Decompresses with the callback decoder into a guarded buffer, checking that nothing outside the output was written. */
+        int DecompressChecked(size_t dst_size, const void *src, size_t src_size, size_t unit_size, CallbackContext *ctx) {
+            std::memset(g_output, GuardValue, sizeof(g_output));
+
+            u8 * const dst = g_output + GuardSize;
+            *ctx = { dst, unit_size, 0, true };
+
+            const int result = util::DecompressLZ4(dst, dst_size, src, src_size, unit_size, OnUnitDecompressed, ctx);
+
+            for (size_t i = 0; i < GuardSize; ++i) {
+                AMS_ABORT_UNLESS(g_output[i] == GuardValue);
+            }
+            for (size_t i = GuardSize + dst_size; i < sizeof(g_output); ++i) {
+                AMS_ABORT_UNLESS(g_output[i] == GuardValue);
+            }
+
+            AMS_ABORT_UNLESS(ctx->is_valid);
+            return result;
+        }
+
+        void GenerateData(util::TinyMT &mt, size_t size) {
+            /* Mix runs, repeated short patterns and noise, so that every kind of sequence is exercised. */
+            size_t offset = 0;
+            while (offset < size) {
+                const size_t run_size = std::min<size_t>(size - offset, 1 + GenerateRandom(mt, 600));
+                switch (GenerateRandom(mt, 4)) {
+                    case 0:
+                        std::memset(g_data + offset, GenerateRandom(mt, 0x100), run_size);
+                        break;
+                    case 1:
+                        {
+                            const size_t period = 1 + GenerateRandom(mt, 20);
+                            for (size_t i = 0; i < run_size; ++i) {
+                                g_data[offset + i] = (offset + i >= period && i >= period) ? g_data[offset + i - period] : static_cast<u8>(GenerateRandom(mt, 4));
+                            }
+                        }
+                        break;
+                    case 2:
+                        if (offset > 0) {
+                            const size_t src = GenerateRandom(mt, offset);
+                            for (size_t i = 0; i < run_size; ++i) {
+                                g_data[offset + i] = g_data[src + i];
+                            }
+                            break;
+                        }
+                        [[fallthrough]];
+                    default:
+                        mt.GenerateRandomBytes(g_data + offset, run_size);
+                        break;
+                }
+                offset += run_size;
+            }
+        }
+
+        void TestValidStreams() {
+            util::TinyMT mt;
+            mt.Initialize(0x4C5A3444);
+
+            for (s32 i = 0; i < ValidIterationCount; ++i) {
+                const size_t size = i < 16 ? static_cast<size_t>(i) : 1 + GenerateRandom(mt, DataSizeMax);
+                GenerateData(mt, size);
+
+                const int compressed_size = util::CompressLZ4(g_compressed, sizeof(g_compressed), g_data, size);
+                AMS_ABORT_UNLESS(compressed_size > 0);
+
+                /* The vetted decoder must round trip. */
+                AMS_ABORT_UNLESS(util::DecompressLZ4(g_expected, size, g_compressed, compressed_size) == static_cast<int>(size));
+                AMS_ABORT_UNLESS(std::memcmp(g_expected, g_data, size) == 0);
+
+                /* Ours must match it, and report exactly what it decompressed. */
+                const size_t unit_size = 1 + GenerateRandom(mt, 64_KB);
+                CallbackContext ctx;
+                AMS_ABORT_UNLESS(DecompressChecked(size, g_compressed, compressed_size, unit_size, std::addressof(ctx)) == static_cast<int>(size));
+                AMS_ABORT_UNLESS(std::memcmp(g_output + GuardSize, g_data, size) == 0);
+                AMS_ABORT_UNLESS(ctx.reported_size == size);
+                AMS_ABORT_UNLESS(std::memcmp(g_reported, g_data, size) == 0);
+
+                /* Output that doesn't fit must fail. */
+                if (size > 0) {
+                    AMS_ABORT_UNLESS(DecompressChecked(size - 1, g_compressed, compressed_size, unit_size, std::addressof(ctx)) < 0);
+                }
+
+                /* Decompressing in place, with the input at the end of the output, as the loader does, must also work. */
+                {
+                    const size_t in_place_size = std::max<size_t>(size, compressed_size) + 16;
+                    u8 * const src = g_in_place + in_place_size - compressed_size;
+                    std::memcpy(src, g_compressed, compressed_size);
+
+                    CallbackContext in_place_ctx = { g_in_place, unit_size, 0, true };
+                    const int result = util::DecompressLZ4(g_in_place, in_place_size, src, compressed_size, unit_size, OnUnitDecompressed, std::addressof(in_place_ctx));
+                    AMS_ABORT_UNLESS(result == static_cast<int>(size));
+                    AMS_ABORT_UNLESS(in_place_ctx.is_valid);
+                    AMS_ABORT_UNLESS(std::memcmp(g_in_place, g_data, size) == 0);
+                }
+
+                /* Every truncation must fail or decode a prefix of the data identically to the vetted decoder. */
+                for (size_t truncated_size = 0; truncated_size < static_cast<size_t>(compressed_size); truncated_size += 1 + truncated_size / 8) {
+                    const int result = DecompressChecked(size, g_compressed, truncated_size, unit_size, std::addressof(ctx));
+                    if (result >= 0) {
+                        AMS_ABORT_UNLESS(util::DecompressLZ4(g_expected, size, g_compressed, truncated_size) == result);
+                        AMS_ABORT_UNLESS(std::memcmp(g_output + GuardSize, g_expected, result) == 0);
+                        AMS_ABORT_UNLESS(std::memcmp(g_output + GuardSize, g_data, result) == 0);
+                    }
+                }
+            }
+
+            printf("  valid streams: ok\n");
+        }
+
+        void TestMalformedStreams() {
+            CallbackContext ctx;
+
+            /* Match offset of zero. */
+            {
+                const u8 stream[] = { 0x10, 'a', 0x00, 0x00, 0x00 };
+                AMS_ABORT_UNLESS(DecompressChecked(64, stream, sizeof(stream), 16, std::addressof(ctx)) < 0);
+            }
+
+            /* Match offset before the start of the output. */
+            {
+                const u8 stream[] = { 0x10, 'a', 0x02, 0x00, 0x00 };
+                AMS_ABORT_UNLESS(DecompressChecked(64, stream, sizeof(stream), 16, std::addressof(ctx)) < 0);
+            }
+
+            /* Literal length running past the end of the input. */
+            {
+                const u8 stream[] = { 0xF0, 0xFF, 0xFF, 0x10, 'a', 'b' };
+                AMS_ABORT_UNLESS(DecompressChecked(64_KB, stream, sizeof(stream), 16, std::addressof(ctx)) < 0);
+            }
+
+            /* Literal length extension bytes running off the end of the input. */
+            {
+                const u8 stream[] = { 0xF0, 0xFF, 0xFF, 0xFF };
+                AMS_ABORT_UNLESS(DecompressChecked(64_KB, stream, sizeof(stream), 16, std::addressof(ctx)) < 0);
+            }
+
+            /* Match length running past the end of the output. */
+            {
+                u8 stream[0x100] = { 0x1F, 'a', 0x01, 0x00 };
+                std::memset(stream + 4, 0xFF, 200);
+                stream[204] = 0x00;
+                stream[205] = 0x00;
+                AMS_ABORT_UNLESS(DecompressChecked(1000, stream, 206, 16, std::addressof(ctx)) < 0);
+            }
+
+            /* A missing match offset. */
+            {
+                const u8 stream[] = { 0x11, 'a', 0x01 };
+                AMS_ABORT_UNLESS(DecompressChecked(64, stream, sizeof(stream), 16, std::addressof(ctx)) < 0);
+            }
+
+            /* An empty input. */
+            AMS_ABORT_UNLESS(DecompressChecked(64, g_compressed, 0, 16, std::addressof(ctx)) < 0);
+
+            printf("  malformed streams: ok\n");
+        }
+
+        void TestMutatedStreams() {
+            util::TinyMT mt;
+            mt.Initialize(0x6D757461);
+
+            size_t size = 0;
+            int compressed_size = 0;
+            for (s32 i = 0; i < MutationIterationCount; ++i) {
+                /* Periodically generate a new stream to mutate. */
+                if ((i % 500) == 0) {
+                    size = 1 + GenerateRandom(mt, 16_KB);
+                    GenerateData(mt, size);
+                    compressed_size = util::CompressLZ4(g_compressed, sizeof(g_compressed), g_data, size);
+                    AMS_ABORT_UNLESS(compressed_size > 0);
+                }
+
+                /* Corrupt a few bytes, favoring tokens, lengths and offsets by writing extreme values. */
+                std::memcpy(g_input, g_compressed, compressed_size);
+                const s32 mutation_count = 1 + GenerateRandom(mt, 4);
+                for (s32 j = 0; j < mutation_count; ++j) {
+                    const u8 values[] = { 0x00, 0xFF, 0xF0, 0x0F, static_cast<u8>(GenerateRandom(mt, 0x100)) };
+                    g_input[GenerateRandom(mt, compressed_size)] = values[GenerateRandom(mt, util::size(values))];
+                }
+
+                /* Ours must never write out of bounds, and must agree with the vetted decoder whenever both succeed. */
+                const size_t dst_size = GenerateRandom(mt, 2) ? size : static_cast<size_t>(GenerateRandom(mt, DataSizeMax));
+                CallbackContext ctx;
+                const int result   = DecompressChecked(dst_size, g_input, compressed_size, 1 + GenerateRandom(mt, 4_KB), std::addressof(ctx));
+                const int expected = util::DecompressLZ4(g_expected, dst_size, g_input, compressed_size);
+
+                AMS_ABORT_UNLESS(result <= static_cast<int>(dst_size));
+                if (result >= 0) {
+                    AMS_ABORT_UNLESS(ctx.reported_size == static_cast<size_t>(result));
+                    AMS_ABORT_UNLESS(std::memcmp(g_reported, g_output + GuardSize, result) == 0);
+                }
+                if (result >= 0 && expected >= 0) {
+                    AMS_ABORT_UNLESS(result == expected);
+                    AMS_ABORT_UNLESS(std::memcmp(g_output + GuardSize, g_expected, result) == 0);
+                }
+            }
+
+            printf("  mutated streams: ok\n");
+        }
+
+    }
+
+    void Main() {
+        printf("Doing LZ4 decompression test!\n");
+
+        TestValidStreams();
+        TestMalformedStreams();
+        TestMutatedStreams();
+
+        printf("All tests completed!\n");
+    }
+
+}
@@ -0,0 +1,368 @@
+/*
+ * Copyright (c) Atmosphère-NX
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stratosphere.hpp>
+
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+
+namespace ams {
+
+    namespace {
+
+        /* NOTE: The generic hipc backend can't create sessions yet, so this drives the same multi wait */
+        /* loop that sf::hipc::ServerManagerBase uses, with eventfds standing in for session handles. */
+        constexpr s32 SessionCountMax  = 1024;
+        constexpr s32 RequestBatchSize = 16;
+        constexpr s32 RequestCount     = 100'000;
+
+        struct Session {
+            os::NativeHandle handle;
+            os::MultiWaitHolderType holder;
+            s32 received_count;
+        };
+
+        constinit Session g_sessions[SessionCountMax];
+
+        void SendRequest(Session &session) {
+            const u64 value = 1;
+            AMS_ABORT_UNLESS(::write(session.handle, std::addressof(value), sizeof(value)) == sizeof(value));
+        }
+
+        void ReceiveRequest(Session &session) {
+            u64 value;
+            AMS_ABORT_UNLESS(::read(session.handle, std::addressof(value), sizeof(value)) == sizeof(value));
+            AMS_ABORT_UNLESS(value == 1);
+
+            ++session.received_count;
+        }
+
+        /* Mirrors the wait loop of sf::hipc::ServerManagerBase. */
+        class ServerLoop {
+            NON_COPYABLE(ServerLoop);
+            NON_MOVEABLE(ServerLoop);
+            private:
+                os::MultiWaitType m_multi_wait;
+                os::MultiWaitType m_deferred_list;
+                os::EventType m_request_stop_event;
+                os::EventType m_notify_event;
+                os::MultiWaitHolderType m_request_stop_event_holder;
+                os::MultiWaitHolderType m_notify_event_holder;
+                os::SdkMutex m_deferred_list_mutex;
+            public:
+                ServerLoop() : m_deferred_list_mutex() {
+                    os::InitializeMultiWait(std::addressof(m_multi_wait));
+                    os::InitializeMultiWait(std::addressof(m_deferred_list));
+
+                    os::InitializeEvent(std::addressof(m_request_stop_event), false, os::EventClearMode_ManualClear);
+                    os::InitializeEvent(std::addressof(m_notify_event), false, os::EventClearMode_ManualClear);
+
+                    os::InitializeMultiWaitHolder(std::addressof(m_request_stop_event_holder), std::addressof(m_request_stop_event));
+                    os::InitializeMultiWaitHolder(std::addressof(m_notify_event_holder), std::addressof(m_notify_event));
+                    os::LinkMultiWaitHolder(std::addressof(m_multi_wait), std::addressof(m_request_stop_event_holder));
+                    os::LinkMultiWaitHolder(std::addressof(m_multi_wait), std::addressof(m_notify_event_holder));
+                }
+
+                ~ServerLoop() {
+                    os::UnlinkAllMultiWaitHolder(std::addressof(m_deferred_list));
+                    os::UnlinkAllMultiWaitHolder(std::addressof(m_multi_wait));
+
+                    os::FinalizeMultiWaitHolder(std::addressof(m_request_stop_event_holder));
+                    os::FinalizeMultiWaitHolder(std::addressof(m_notify_event_holder));
+                    os::FinalizeEvent(std::addressof(m_request_stop_event));
+                    os::FinalizeEvent(std::addressof(m_notify_event));
+
+                    os::FinalizeMultiWait(std::addressof(m_deferred_list));
+                    os::FinalizeMultiWait(std::addressof(m_multi_wait));
+                }
+
+                void LinkToDeferredList(os::MultiWaitHolderType *holder) {
+                    std::scoped_lock lk(m_deferred_list_mutex);
+                    os::LinkMultiWaitHolder(std::addressof(m_deferred_list), holder);
+                    os::SignalEvent(std::addressof(m_notify_event));
+                }
+
+                Session *WaitSignaled() {
+                    while (true) {
+                        this->LinkDeferred();
+                        auto selected = os::WaitAny(std::addressof(m_multi_wait));
+                        if (selected == std::addressof(m_request_stop_event_holder)) {
+                            return nullptr;
+                        } else if (selected == std::addressof(m_notify_event_holder)) {
+                            os::ClearEvent(std::addressof(m_notify_event));
+                        } else {
+                            os::UnlinkMultiWaitHolder(selected);
+                            return reinterpret_cast<Session *>(os::GetMultiWaitHolderUserData(selected));
+                        }
+                    }
+                }
+
+                void ProcessForSession(Session *session) {
+                    ReceiveRequest(*session);
+                    this->LinkToDeferredList(std::addressof(session->holder));
+                }
+            private:
+                void LinkDeferred() {
+                    std::scoped_lock lk(m_deferred_list_mutex);
+                    os::MoveAllMultiWaitHolder(std::addressof(m_multi_wait), std::addressof(m_deferred_list));
+                }
+        };
+
+        /* Mirrors the previous linux multi wait backend, which built and scanned a pollfd array for every wait. */
+        class PollServerLoop {
+            NON_COPYABLE(PollServerLoop);
+            NON_MOVEABLE(PollServerLoop);
+            private:
+                std::vector<Session *> m_linked;
+                std::vector<struct pollfd> m_pfds;
+            public:
+                PollServerLoop() = default;
+
+                void Link(Session *session) {
+                    m_linked.push_back(session);
+                }
+
+                Session *WaitSignaled() {
+                    m_pfds.resize(m_linked.size());
+                    for (size_t i = 0; i < m_linked.size(); ++i) {
+                        m_pfds[i] = { .fd = m_linked[i]->handle, .events = POLLIN, .revents = 0 };
+                    }
+
+                    AMS_ABORT_UNLESS(::ppoll(m_pfds.data(), m_pfds.size(), nullptr, nullptr) > 0);
+
+                    for (size_t i = 0; i < m_pfds.size(); ++i) {
+                        if (m_pfds[i].revents != 0) {
+                            Session *session = m_linked[i];
+                            m_linked.erase(m_linked.begin() + i);
+                            return session;
+                        }
+                    }
+
+                    AMS_ABORT("This should be impossible?");
+                }
+
+                void ProcessForSession(Session *session) {
+                    ReceiveRequest(*session);
+                    this->Link(session);
+                }
+        };
+
+        void SendRequestBatch(util::TinyMT &mt, s32 session_count, s32 batch_size) {
+            /* Pick distinct sessions, so that every request is received separately. */
+            bool picked[SessionCountMax] = {};
+            for (s32 i = 0; i < batch_size; ) {
+                const s32 index = mt.GenerateRandomU32() % session_count;
+                if (!picked[index]) {
+                    picked[index] = true;
+                    SendRequest(g_sessions[index]);
+                    ++i;
+                }
+            }
+        }
+
+        template<typename Loop>
+        TimeSpan RunRequests(Loop &loop, s32 session_count) {
+            util::TinyMT mt;
+            mt.Initialize(static_cast<u32>(session_count));
+
+            const s32 batch_size = std::min(RequestBatchSize, session_count);
+
+            const auto start_tick = os::GetSystemTick();
+            for (s32 sent = 0; sent < RequestCount; sent += batch_size) {
+                SendRequestBatch(mt, session_count, batch_size);
+
+                for (s32 i = 0; i < batch_size; ++i) {
+                    Session *session = loop.WaitSignaled();
+                    AMS_ABORT_UNLESS(session != nullptr);
+
+                    loop.ProcessForSession(session);
+                }
+            }
+            return (os::GetSystemTick() - start_tick).ToTimeSpan();
+        }
+
+        s32 GetTotalReceivedCount(s32 session_count) {
+            s32 total = 0;
+            for (s32 i = 0; i < session_count; ++i) {
+                total += g_sessions[i].received_count;
+                g_sessions[i].received_count = 0;
+            }
+            return total;
+        }
+
+        void DoBenchmark(s32 session_count) {
+            const s32 expected = util::AlignUp(RequestCount, std::min(RequestBatchSize, session_count));
+
+            /* Run the requests through a server manager style multi wait loop. */
+            TimeSpan multi_wait_time;
+            {
+                ServerLoop loop;
+                for (s32 i = 0; i < session_count; ++i) {
+                    os::InitializeMultiWaitHolder(std::addressof(g_sessions[i].holder), g_sessions[i].handle);
+                    os::SetMultiWaitHolderUserData(std::addressof(g_sessions[i].holder), reinterpret_cast<uintptr_t>(std::addressof(g_sessions[i])));
+                    loop.LinkToDeferredList(std::addressof(g_sessions[i].holder));
+                }
+
+                multi_wait_time = RunRequests(loop, session_count);
+                AMS_ABORT_UNLESS(GetTotalReceivedCount(session_count) == expected);
+            }
+
+            for (s32 i = 0; i < session_count; ++i) {
+                os::FinalizeMultiWaitHolder(std::addressof(g_sessions[i].holder));
+            }
+
+            /* Run the same requests through a loop which polls every session for each wait. */
+            TimeSpan poll_time;
+            {
+                PollServerLoop loop;
+                for (s32 i = 0; i < session_count; ++i) {
+                    loop.Link(std::addressof(g_sessions[i]));
+                }
+
+                poll_time = RunRequests(loop, session_count);
+                AMS_ABORT_UNLESS(GetTotalReceivedCount(session_count) == expected);
+            }
+
+            printf("  %4d sessions: multi wait %6ld ns/request, ppoll %6ld ns/request\n", session_count, static_cast<long>(multi_wait_time.GetNanoSeconds() / expected), static_cast<long>(poll_time.GetNanoSeconds() / expected));
+        }
+
+        /* Lists with more native handles than this wait on handles registered with an epoll instance. */
+        constexpr s32 ArrayHandleCountMax = 64;
+
+        void LinkFillerHolders(os::MultiWaitType *multi_wait, os::MultiWaitHolderType *holders, s32 count) {
+            /* Link holders for sessions other than the first two, which we'll test with. */
+            for (s32 i = 0; i < count; ++i) {
+                os::InitializeMultiWaitHolder(std::addressof(holders[i]), g_sessions[2 + i].handle);
+                os::LinkMultiWaitHolder(multi_wait, std::addressof(holders[i]));
+            }
+        }
+
+        void FinalizeFillerHolders(os::MultiWaitHolderType *holders, s32 count) {
+            for (s32 i = 0; i < count; ++i) {
+                os::UnlinkMultiWaitHolder(std::addressof(holders[i]));
+                os::FinalizeMultiWaitHolder(std::addressof(holders[i]));
+            }
+        }
+
+        void TestDuplicateHandles(s32 filler_count) {
+            os::MultiWaitType multi_wait;
+            os::InitializeMultiWait(std::addressof(multi_wait));
+
+            os::MultiWaitHolderType filler_holders[ArrayHandleCountMax];
+            LinkFillerHolders(std::addressof(multi_wait), filler_holders, filler_count);
+
+            /* Link two holders for the same handle. */
+            os::MultiWaitHolderType holders[2];
+            for (auto &holder : holders) {
+                os::InitializeMultiWaitHolder(std::addressof(holder), g_sessions[0].handle);
+                os::LinkMultiWaitHolder(std::addressof(multi_wait), std::addressof(holder));
+            }
+
+            /* Check that we can still wait on the handle after unlinking either holder. */
+            SendRequest(g_sessions[0]);
+            for (auto &holder : holders) {
+                auto selected = os::WaitAny(std::addressof(multi_wait));
+                AMS_ABORT_UNLESS(selected == std::addressof(holders[0]) || selected == std::addressof(holders[1]));
+
+                os::UnlinkMultiWaitHolder(std::addressof(holder));
+            }
+            AMS_ABORT_UNLESS(os::TryWaitAny(std::addressof(multi_wait)) == nullptr);
+
+            ReceiveRequest(g_sessions[0]);
+            g_sessions[0].received_count = 0;
+
+            for (auto &holder : holders) {
+                os::FinalizeMultiWaitHolder(std::addressof(holder));
+            }
+
+            FinalizeFillerHolders(filler_holders, filler_count);
+            os::FinalizeMultiWait(std::addressof(multi_wait));
+        }
+
+        void TestReusedHandle(s32 filler_count) {
+            os::MultiWaitType multi_wait;
+            os::InitializeMultiWait(std::addressof(multi_wait));
+
+            os::MultiWaitHolderType filler_holders[ArrayHandleCountMax];
+            LinkFillerHolders(std::addressof(multi_wait), filler_holders, filler_count);
+
+            /* Link a holder, then unlink it and close its handle. */
+            os::MultiWaitHolderType holder;
+            os::InitializeMultiWaitHolder(std::addressof(holder), g_sessions[1].handle);
+            os::LinkMultiWaitHolder(std::addressof(multi_wait), std::addressof(holder));
+            os::UnlinkMultiWaitHolder(std::addressof(holder));
+            os::FinalizeMultiWaitHolder(std::addressof(holder));
+
+            const os::NativeHandle closed_handle = g_sessions[1].handle;
+            ::close(closed_handle);
+
+            /* Create a new handle, which reuses the closed handle's number, and check that it can be waited on. */
+            g_sessions[1].handle = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            AMS_ABORT_UNLESS(g_sessions[1].handle == closed_handle);
+
+            os::InitializeMultiWaitHolder(std::addressof(holder), g_sessions[1].handle);
+            os::LinkMultiWaitHolder(std::addressof(multi_wait), std::addressof(holder));
+            AMS_ABORT_UNLESS(os::TryWaitAny(std::addressof(multi_wait)) == nullptr);
+
+            SendRequest(g_sessions[1]);
+            AMS_ABORT_UNLESS(os::TimedWaitAny(std::addressof(multi_wait), TimeSpan::FromMilliSeconds(100)) == std::addressof(holder));
+
+            ReceiveRequest(g_sessions[1]);
+            g_sessions[1].received_count = 0;
+
+            os::UnlinkMultiWaitHolder(std::addressof(holder));
+            os::FinalizeMultiWaitHolder(std::addressof(holder));
+
+            FinalizeFillerHolders(filler_holders, filler_count);
+            os::FinalizeMultiWait(std::addressof(multi_wait));
+        }
+
+    }
+
+    void Main() {
+        printf("Doing multi wait server loop benchmark!\n");
+
+        /* Ensure we can open an fd for every session. */
+        struct rlimit limit;
+        AMS_ABORT_UNLESS(::getrlimit(RLIMIT_NOFILE, std::addressof(limit)) == 0);
+        limit.rlim_cur = limit.rlim_max;
+        AMS_ABORT_UNLESS(::setrlimit(RLIMIT_NOFILE, std::addressof(limit)) == 0);
+
+        /* Create our sessions. */
+        for (auto &session : g_sessions) {
+            session.handle = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            AMS_ABORT_UNLESS(session.handle != os::InvalidNativeHandle);
+        }
+
+        /* Test both with handles that fit in a wait's array, and with handles registered with epoll. */
+        for (const s32 filler_count : { 0, ArrayHandleCountMax }) {
+            TestDuplicateHandles(filler_count);
+            TestReusedHandle(filler_count);
+        }
+
+        for (const s32 session_count : { 4, 16, 64, 65, 256, 1024 }) {
+            DoBenchmark(session_count);
+        }
+
+        for (auto &session : g_sessions) {
+            ::close(session.handle);
+        }
+
+        printf("All tests completed!\n");
+    }
+
+}
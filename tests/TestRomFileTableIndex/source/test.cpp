@@ -0,0 +1,207 @@
+/*
+ * Copyright (c) Atmosphère-NX
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stratosphere.hpp>
+
+namespace ams {
+
+    namespace {
+
+        using RomFileTable = fs::HierarchicalRomFileTable;
+
+        constexpr size_t DirectoryCount = 1'000;
+        constexpr size_t FileCount      = 9'000;
+
+        /* Few buckets, so that every chain is long. */
+        constexpr u32 DirectoryBucketCount = 0x20;
+        constexpr u32 FileBucketCount      = 0x40;
+
+        constexpr size_t EntryStorageSize = 1_MB;
+
+        /* NOTE: Each bucket holds a u32 position; Main checks that this matches the table's own size queries. */
+        alignas(u64) constinit u8 g_dir_bucket_buffer[DirectoryBucketCount * sizeof(u32)];
+        alignas(u64) constinit u8 g_file_bucket_buffer[FileBucketCount * sizeof(u32)];
+        alignas(u64) constinit u8 g_dir_entry_buffer[EntryStorageSize];
+        alignas(u64) constinit u8 g_file_entry_buffer[EntryStorageSize];
+
+        fs::MemoryStorage g_dir_bucket_storage(g_dir_bucket_buffer, sizeof(g_dir_bucket_buffer));
+        fs::MemoryStorage g_file_bucket_storage(g_file_bucket_buffer, sizeof(g_file_bucket_buffer));
+        fs::MemoryStorage g_dir_entry_storage(g_dir_entry_buffer, sizeof(g_dir_entry_buffer));
+        fs::MemoryStorage g_file_entry_storage(g_file_entry_buffer, sizeof(g_file_entry_buffer));
+
+        Result InitializeTable(RomFileTable *table) {
+            R_RETURN(table->Initialize(fs::SubStorage(std::addressof(g_dir_bucket_storage), 0, sizeof(g_dir_bucket_buffer)),
+                                       fs::SubStorage(std::addressof(g_dir_entry_storage), 0, sizeof(g_dir_entry_buffer)),
+                                       fs::SubStorage(std::addressof(g_file_bucket_storage), 0, sizeof(g_file_bucket_buffer)),
+                                       fs::SubStorage(std::addressof(g_file_entry_storage), 0, sizeof(g_file_entry_buffer))));
+        }
+
+        void GenerateTable(std::vector<std::string> *out_dirs, std::vector<std::string> *out_files) {
+            R_ABORT_UNLESS(RomFileTable::Format(fs::SubStorage(std::addressof(g_dir_bucket_storage), 0, sizeof(g_dir_bucket_buffer)), fs::SubStorage(std::addressof(g_file_bucket_storage), 0, sizeof(g_file_bucket_buffer))));
+
+            RomFileTable table;
+            R_ABORT_UNLESS(InitializeTable(std::addressof(table)));
+            R_ABORT_UNLESS(table.CreateRootDirectory());
+
+            util::TinyMT mt;
+            mt.Initialize(0x10000);
+
+            /* Make a random tree, reusing names under different parents so that lookups must check the parent. */
+            out_dirs->push_back("");
+            for (size_t i = 0; i < DirectoryCount; ++i) {
+                char name[0x20];
+                util::SNPrintf(name, sizeof(name), "/dir_%zu", i % 64);
+
+                const std::string path = (*out_dirs)[mt.GenerateRandomU32() % out_dirs->size()] + name;
+
+                fs::RomDirectoryId id;
+                const Result result = table.CreateDirectory(std::addressof(id), path.c_str());
+                if (R_SUCCEEDED(result)) {
+                    out_dirs->push_back(path);
+                } else {
+                    AMS_ABORT_UNLESS(fs::ResultDbmAlreadyExists::Includes(result));
+                }
+            }
+
+            for (size_t i = 0; i < FileCount; ++i) {
+                char name[0x20];
+                util::SNPrintf(name, sizeof(name), "/file_%zu.bin", i % 256);
+
+                const std::string path = (*out_dirs)[mt.GenerateRandomU32() % out_dirs->size()] + name;
+
+                RomFileTable::FileInfo info;
+                info.offset = static_cast<s64>(i) * 0x1000;
+                info.size   = mt.GenerateRandomU32() % 1_MB;
+
+                fs::RomFileId id;
+                const Result result = table.CreateFile(std::addressof(id), path.c_str(), info);
+                if (R_SUCCEEDED(result)) {
+                    out_files->push_back(path);
+                } else {
+                    AMS_ABORT_UNLESS(fs::ResultDbmAlreadyExists::Includes(result));
+                }
+            }
+
+            /* The root directory is looked up as "/". */
+            (*out_dirs)[0] = "/";
+        }
+
+        void CheckSameResult(Result lhs, Result rhs) {
+            AMS_ABORT_UNLESS(lhs.GetValue() == rhs.GetValue());
+        }
+
+        void CheckFile(RomFileTable *indexed, RomFileTable *walked, const std::string &path) {
+            RomFileTable::FileInfo indexed_info{}, walked_info{};
+            const Result indexed_result = indexed->OpenFile(std::addressof(indexed_info), path.c_str());
+            const Result walked_result  = walked->OpenFile(std::addressof(walked_info), path.c_str());
+            CheckSameResult(indexed_result, walked_result);
+            if (R_SUCCEEDED(indexed_result)) {
+                AMS_ABORT_UNLESS(indexed_info.offset.Get() == walked_info.offset.Get());
+                AMS_ABORT_UNLESS(indexed_info.size.Get() == walked_info.size.Get());
+            }
+
+            fs::RomFileId indexed_id = 0, walked_id = 0;
+            CheckSameResult(indexed->ConvertPathToFileId(std::addressof(indexed_id), path.c_str()), walked->ConvertPathToFileId(std::addressof(walked_id), path.c_str()));
+            AMS_ABORT_UNLESS(indexed_id == walked_id);
+        }
+
+        void CheckDirectory(RomFileTable *indexed, RomFileTable *walked, const std::string &path) {
+            fs::RomDirectoryId indexed_id = 0, walked_id = 0;
+            CheckSameResult(indexed->ConvertPathToDirectoryId(std::addressof(indexed_id), path.c_str()), walked->ConvertPathToDirectoryId(std::addressof(walked_id), path.c_str()));
+            AMS_ABORT_UNLESS(indexed_id == walked_id);
+
+            RomFileTable::FindPosition indexed_find{}, walked_find{};
+            const Result indexed_result = indexed->FindOpen(std::addressof(indexed_find), path.c_str());
+            const Result walked_result  = walked->FindOpen(std::addressof(walked_find), path.c_str());
+            CheckSameResult(indexed_result, walked_result);
+            if (R_FAILED(indexed_result)) {
+                return;
+            }
+
+            /* Check that the directory's children are enumerated identically. */
+            for (const bool is_dir : { true, false }) {
+                while (true) {
+                    char indexed_name[fs::EntryNameLengthMax + 1], walked_name[fs::EntryNameLengthMax + 1];
+                    const Result indexed_next = is_dir ? indexed->FindNextDirectory(indexed_name, std::addressof(indexed_find), sizeof(indexed_name)) : indexed->FindNextFile(indexed_name, std::addressof(indexed_find), sizeof(indexed_name));
+                    const Result walked_next  = is_dir ? walked->FindNextDirectory(walked_name, std::addressof(walked_find), sizeof(walked_name))     : walked->FindNextFile(walked_name, std::addressof(walked_find), sizeof(walked_name));
+                    CheckSameResult(indexed_next, walked_next);
+                    if (R_FAILED(indexed_next)) {
+                        break;
+                    }
+
+                    AMS_ABORT_UNLESS(std::strcmp(indexed_name, walked_name) == 0);
+                }
+            }
+        }
+
+        /* Rewrites a path's last separator as "/./" or "/<sibling>/../", which must resolve to the same entry. */
+        std::string MakeDotPath(const std::string &path, bool use_dot_dot) {
+            const size_t separator = path.rfind('/');
+            return path.substr(0, separator) + (use_dot_dot ? "/dir_0/.." : "/.") + path.substr(separator);
+        }
+
+    }
+
+    void Main() {
+        printf("Doing rom file table index test!\n");
+
+        AMS_ABORT_UNLESS(RomFileTable::QueryDirectoryEntryBucketStorageSize(DirectoryBucketCount) == sizeof(g_dir_bucket_buffer));
+        AMS_ABORT_UNLESS(RomFileTable::QueryFileEntryBucketStorageSize(FileBucketCount) == sizeof(g_file_bucket_buffer));
+
+        std::vector<std::string> dirs, files;
+        GenerateTable(std::addressof(dirs), std::addressof(files));
+        printf("  %zu directories, %zu files\n", dirs.size(), files.size());
+
+        /* Open the same tables twice, only indexing one of them. */
+        RomFileTable indexed, walked;
+        R_ABORT_UNLESS(InitializeTable(std::addressof(indexed)));
+        R_ABORT_UNLESS(InitializeTable(std::addressof(walked)));
+        R_ABORT_UNLESS(indexed.InitializeIndex(g_dir_entry_buffer, g_file_entry_buffer));
+
+        size_t check_count = 0;
+        for (const auto &path : files) {
+            CheckFile(std::addressof(indexed), std::addressof(walked), path);
+            CheckFile(std::addressof(indexed), std::addressof(walked), MakeDotPath(path, false));
+            CheckFile(std::addressof(indexed), std::addressof(walked), MakeDotPath(path, true));
+
+            /* Missing files, and files looked up as directories. */
+            CheckFile(std::addressof(indexed), std::addressof(walked), path + "x");
+            CheckDirectory(std::addressof(indexed), std::addressof(walked), path);
+
+            check_count += 5;
+        }
+
+        for (const auto &path : dirs) {
+            CheckDirectory(std::addressof(indexed), std::addressof(walked), path);
+            if (path != "/") {
+                CheckDirectory(std::addressof(indexed), std::addressof(walked), MakeDotPath(path, false));
+                CheckDirectory(std::addressof(indexed), std::addressof(walked), MakeDotPath(path, true));
+
+                /* Missing directories, and directories looked up as files. */
+                CheckDirectory(std::addressof(indexed), std::addressof(walked), path + "x");
+                CheckFile(std::addressof(indexed), std::addressof(walked), path);
+
+                check_count += 4;
+            }
+
+            ++check_count;
+        }
+
+        printf("  %zu lookups matched the chain walk\n", check_count);
+
+        printf("All tests completed!\n");
+    }
+
+}
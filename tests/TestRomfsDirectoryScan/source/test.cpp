@@ -0,0 +1,293 @@
+/*
+ * Copyright (c) Atmosphère-NX
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stratosphere.hpp>
+#include "../../../stratosphere/ams_mitm/source/fs_mitm/fsmitm_romfs_directory_scanner.hpp"
+
+namespace ams {
+
+    namespace {
+
+        using mitm::fs::romfs::DirectoryEntryList;
+
+        constexpr size_t FilesPerDirectory   = 48;
+        constexpr size_t ChildrenPerDirectory = 6;
+        constexpr size_t ReadEntryCount       = 8;
+
+        /* Simulated cost of the IPC the real builder performs for each directory open and read. */
+        constexpr TimeSpan OpenLatency = TimeSpan::FromMicroSeconds(40);
+        constexpr TimeSpan ReadLatency = TimeSpan::FromMicroSeconds(20);
+
+        /* Lets us check the scanner copes with allocation failure, and frees everything it allocates. */
+        constinit std::atomic<size_t> g_allocated_size = 0;
+        constinit std::atomic<s64> g_allocation_count  = 0;
+        constinit s64 g_allocation_count_max           = -1;
+        constinit size_t g_allocation_size_max         = std::numeric_limits<size_t>::max();
+
+        void SetAllocationLimits(s64 count_max, size_t size_max) {
+            g_allocation_count     = 0;
+            g_allocation_count_max = count_max;
+            g_allocation_size_max  = size_max;
+        }
+
+        /* A synthetic sd card directory tree. */
+        struct SourceDirectory {
+            std::string name;
+            std::vector<std::pair<std::string, s64>> files;
+            std::vector<std::unique_ptr<SourceDirectory>> children;
+        };
+
+        std::unique_ptr<SourceDirectory> GenerateTree(size_t file_count) {
+            util::TinyMT mt;
+            mt.Initialize(static_cast<u32>(file_count));
+
+            auto root = std::make_unique<SourceDirectory>();
+
+            /* Fill directories breadth-first, so the tree stays shallow. */
+            std::vector<SourceDirectory *> queue = { root.get() };
+            size_t generated = 0;
+            for (size_t i = 0; generated < file_count; ++i) {
+                SourceDirectory *dir = queue[i];
+
+                const size_t count = std::min<size_t>(1 + (mt.GenerateRandomU32() % (2 * FilesPerDirectory)), file_count - generated);
+                for (size_t j = 0; j < count; ++j) {
+                    char name[0x20];
+                    util::SNPrintf(name, sizeof(name), "file_%08x.bin", mt.GenerateRandomU32());
+                    dir->files.emplace_back(name, mt.GenerateRandomU32() % 1_MB);
+                }
+                generated += count;
+
+                for (size_t j = 0; j < ChildrenPerDirectory; ++j) {
+                    auto child = std::make_unique<SourceDirectory>();
+
+                    char name[0x20];
+                    util::SNPrintf(name, sizeof(name), "dir_%08x", mt.GenerateRandomU32());
+                    child->name = name;
+
+                    queue.push_back(child.get());
+                    dir->children.emplace_back(std::move(child));
+                }
+            }
+
+            return root;
+        }
+
+        /* Mirrors the builder's contexts, whose ordering compares full paths. */
+        struct Context {
+            const Context *parent;
+            std::string name;
+            s64 size;
+            const SourceDirectory *source;
+
+            void GetPath(std::string *out) const {
+                if (parent != nullptr) {
+                    parent->GetPath(out);
+                    out->push_back('/');
+                    out->append(name);
+                }
+            }
+        };
+
+        struct ContextComparator {
+            bool operator()(const std::unique_ptr<Context> &lhs, const std::unique_ptr<Context> &rhs) const {
+                std::string lhs_path, rhs_path;
+                lhs->GetPath(std::addressof(lhs_path));
+                rhs->GetPath(std::addressof(rhs_path));
+                return lhs_path < rhs_path;
+            }
+        };
+
+        class Visitor {
+            public:
+                using DirectoryType = Context;
+            private:
+                std::set<std::unique_ptr<Context>, ContextComparator> m_directories;
+                std::set<std::unique_ptr<Context>, ContextComparator> m_files;
+                std::atomic<size_t> m_read_count;
+            public:
+                Visitor() : m_read_count(0) { /* ... */ }
+
+                Context *GetRoot(const SourceDirectory *source) {
+                    return m_directories.emplace(new Context{ nullptr, "", 0, source }).first->get();
+                }
+
+                Result ReadDirectory(DirectoryEntryList *out, Context *directory) {
+                    os::SleepThread(OpenLatency);
+
+                    const SourceDirectory *source = directory->source;
+                    const size_t entry_count = source->children.size() + source->files.size();
+                    for (size_t i = 0; i < entry_count; ++i) {
+                        if ((i % ReadEntryCount) == 0) {
+                            os::SleepThread(ReadLatency);
+                        }
+
+                        if (i < source->children.size()) {
+                            R_UNLESS(out->AddDirectory(source->children[i]->name.c_str(), source->children[i]->name.length()), fs::ResultAllocationMemoryFailedNew());
+                        } else {
+                            const auto &file = source->files[i - source->children.size()];
+                            R_UNLESS(out->AddFile(file.first.c_str(), file.first.length(), file.second), fs::ResultAllocationMemoryFailedNew());
+                        }
+                    }
+
+                    ++m_read_count;
+                    R_SUCCEED();
+                }
+
+                Context *AddDirectory(Context *parent, const char *name, size_t name_len) {
+                    /* Find the source directory, which only the benchmark needs. */
+                    const SourceDirectory *source = nullptr;
+                    for (const auto &child : parent->source->children) {
+                        if (child->name.length() == name_len && std::memcmp(child->name.c_str(), name, name_len) == 0) {
+                            source = child.get();
+                            break;
+                        }
+                    }
+                    AMS_ABORT_UNLESS(source != nullptr);
+
+                    return m_directories.emplace(new Context{ parent, std::string(name, name_len), 0, source }).first->get();
+                }
+
+                void AddFile(Context *parent, const char *name, size_t name_len, s64 size) {
+                    m_files.emplace(new Context{ parent, std::string(name, name_len), size, nullptr });
+                }
+
+                static void *Allocate(size_t size) {
+                    if (size > g_allocation_size_max) {
+                        return nullptr;
+                    }
+                    if (g_allocation_count_max >= 0 && g_allocation_count++ >= g_allocation_count_max) {
+                        return nullptr;
+                    }
+
+                    void *p = std::malloc(size);
+                    if (p != nullptr) {
+                        g_allocated_size += size;
+                    }
+                    return p;
+                }
+
+                static void Free(void *p, size_t size) {
+                    g_allocated_size -= size;
+                    std::free(p);
+                }
+
+                size_t GetFileCount() const { return m_files.size(); }
+                size_t GetReadCount() const { return m_read_count; }
+
+                void CalculateDigest(u8 *dst) const {
+                    /* Hash everything which determines the built romfs' layout. */
+                    crypto::Sha256Generator generator;
+                    generator.Initialize();
+
+                    for (const auto *set : { std::addressof(m_directories), std::addressof(m_files) }) {
+                        for (const auto &ctx : *set) {
+                            std::string path;
+                            ctx->GetPath(std::addressof(path));
+                            generator.Update(path.c_str(), path.length() + 1);
+                            generator.Update(std::addressof(ctx->size), sizeof(ctx->size));
+                        }
+                    }
+
+                    generator.GetHash(dst, crypto::Sha256Generator::HashSize);
+                }
+        };
+
+        void DoBenchmark(const SourceDirectory *tree, size_t file_count) {
+            printf("Tree with %zu files:\n", file_count);
+
+            u8 serial_digest[crypto::Sha256Generator::HashSize];
+            for (const s32 thread_count : { 0, 1, 2, 4, 8 }) {
+                Visitor visitor;
+                mitm::fs::romfs::ParallelDirectoryScanner<Visitor> scanner(visitor);
+
+                const auto start_tick = os::GetSystemTick();
+                R_ABORT_UNLESS(scanner.Scan(visitor.GetRoot(tree), thread_count, os::DefaultThreadPriority));
+                const auto elapsed = (os::GetSystemTick() - start_tick).ToTimeSpan();
+
+                AMS_ABORT_UNLESS(visitor.GetFileCount() == file_count);
+
+                /* Check that the merged result is identical to the serial scan's. */
+                u8 digest[crypto::Sha256Generator::HashSize];
+                visitor.CalculateDigest(digest);
+                if (thread_count == 0) {
+                    std::memcpy(serial_digest, digest, sizeof(digest));
+                } else {
+                    AMS_ABORT_UNLESS(std::memcmp(serial_digest, digest, sizeof(digest)) == 0);
+                }
+
+                printf("  %d scan threads: %8ld us (%zu directories)\n", thread_count, static_cast<long>(elapsed.GetMicroSeconds()), visitor.GetReadCount());
+            }
+
+            AMS_ABORT_UNLESS(g_allocated_size == 0);
+
+            /* If we can't allocate stacks, directories should be read on the calling thread. */
+            {
+                Visitor visitor;
+                {
+                    mitm::fs::romfs::ParallelDirectoryScanner<Visitor> scanner(visitor);
+
+                    SetAllocationLimits(-1, mitm::fs::romfs::ParallelDirectoryScanner<Visitor>::ThreadStackSize);
+                    R_ABORT_UNLESS(scanner.Scan(visitor.GetRoot(tree), 4, os::DefaultThreadPriority));
+                    SetAllocationLimits(-1, std::numeric_limits<size_t>::max());
+                }
+                AMS_ABORT_UNLESS(g_allocated_size == 0);
+
+                u8 digest[crypto::Sha256Generator::HashSize];
+                visitor.CalculateDigest(digest);
+                AMS_ABORT_UNLESS(std::memcmp(serial_digest, digest, sizeof(digest)) == 0);
+            }
+
+            /* Any other allocation failure should fail the scan, and scanning again should complete what was merged. */
+            for (const s64 count_max : { 0, 1, 10, 100, 1000 }) {
+                Visitor visitor;
+                {
+                    mitm::fs::romfs::ParallelDirectoryScanner<Visitor> scanner(visitor);
+
+                    SetAllocationLimits(count_max, std::numeric_limits<size_t>::max());
+                    const Result result = scanner.Scan(visitor.GetRoot(tree), 4, os::DefaultThreadPriority);
+                    SetAllocationLimits(-1, std::numeric_limits<size_t>::max());
+
+                    AMS_ABORT_UNLESS(fs::ResultAllocationMemoryFailed::Includes(result));
+                }
+                AMS_ABORT_UNLESS(g_allocated_size == 0);
+
+                {
+                    mitm::fs::romfs::ParallelDirectoryScanner<Visitor> scanner(visitor);
+                    R_ABORT_UNLESS(scanner.Scan(visitor.GetRoot(tree), 0, os::DefaultThreadPriority));
+                }
+                AMS_ABORT_UNLESS(g_allocated_size == 0);
+
+                u8 digest[crypto::Sha256Generator::HashSize];
+                visitor.CalculateDigest(digest);
+                AMS_ABORT_UNLESS(std::memcmp(serial_digest, digest, sizeof(digest)) == 0);
+            }
+
+            printf("  allocation failure handling ok\n");
+        }
+
+    }
+
+    void Main() {
+        printf("Doing romfs directory scan benchmark!\n");
+
+        for (const size_t file_count : { 10'000, 30'000, 100'000 }) {
+            const auto tree = GenerateTree(file_count);
+            DoBenchmark(tree.get(), file_count);
+        }
+
+        printf("All tests completed!\n");
+    }
+
+}
@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) Atmosphère-NX
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stratosphere.hpp>
+
+namespace ams {
+
+    namespace {
+
+        constexpr size_t HashSize = crypto::Sha256Generator::HashSize;
+
+        /* Sizes around the padding boundaries, plus the sizes integrity verification storage actually uses. */
+        constexpr size_t BlockSizes[] = {
+            1, 31, 55, 56, 63, 64, 65, 119, 120, 127, 128, 129, 1000, 0x200, 0x1000, 0x4000,
+        };
+
+        /* Counts which are and aren't multiples of every implementation's lane count. */
+        constexpr size_t BlockCounts[] = {
+            1, 2, 3, 4, 5, 7, 8, 9, 15, 16, 17, 31,
+        };
+
+        void TestGenerateHashes(util::TinyMT &mt, size_t block_size, size_t block_count) {
+            const size_t src_size = block_size * block_count;
+            const size_t dst_size = HashSize * block_count;
+
+            auto src      = std::make_unique<u8[]>(src_size);
+            auto expected = std::make_unique<u8[]>(dst_size);
+            auto actual   = std::make_unique<u8[]>(dst_size + HashSize);
+
+            mt.GenerateRandomBytes(src.get(), src_size);
+
+            for (size_t i = 0; i < block_count; ++i) {
+                crypto::GenerateSha256(expected.get() + i * HashSize, HashSize, src.get() + i * block_size, block_size);
+            }
+
+            /* Fill the output with a pattern, so we notice writes past the end. */
+            std::memset(actual.get(), 0xCC, dst_size + HashSize);
+            crypto::GenerateSha256Hashes(actual.get(), dst_size, src.get(), src_size, block_size);
+
+            for (size_t i = 0; i < block_count; ++i) {
+                if (std::memcmp(expected.get() + i * HashSize, actual.get() + i * HashSize, HashSize) != 0) {
+                    printf("Mismatch: block size 0x%zx, block count %zu, block %zu\n", block_size, block_count, i);
+                    AMS_ABORT("GenerateSha256Hashes mismatch");
+                }
+            }
+
+            for (size_t i = 0; i < HashSize; ++i) {
+                AMS_ABORT_UNLESS(actual[dst_size + i] == 0xCC);
+            }
+        }
+
+    }
+
+    void Main() {
+        printf("Doing sha256 GenerateHashes differential test!\n");
+
+        util::TinyMT mt;
+        mt.Initialize(0x5A256);
+
+        size_t test_count = 0;
+        for (const size_t block_size : BlockSizes) {
+            for (const size_t block_count : BlockCounts) {
+                TestGenerateHashes(mt, block_size, block_count);
+                ++test_count;
+            }
+        }
+
+        printf("  %zu block size/count combinations ok\n", test_count);
+
+        printf("All tests completed!\n");
+    }
+
+}
@@ -0,0 +1,175 @@
+/*
+ * Copyright (c) Atmosphère-NX
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stratosphere.hpp>
+
+#if defined(ATMOSPHERE_ARCH_X64)
+#include "../../../libraries/libvapours/source/crypto/impl/crypto_sha_impl.arch.x64.hpp"
+#endif
+
+namespace ams {
+
+    namespace {
+
+        /* NOTE: The message is repeated repeat_count times. Digests are hex. */
+        struct ShaTestVector {
+            const char *message;
+            size_t repeat_count;
+            const char *sha1;
+            const char *sha256;
+        };
+
+        /* FIPS 180 examples: one block, empty, two blocks (the padding doesn't fit), 896 bits, and one million 'a's. */
+        constexpr const ShaTestVector FipsTestVectors[] = {
+            {
+                "abc", 1,
+                "a9993e364706816aba3e25717850c26c9cd0d89d",
+                "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad",
+            },
+            {
+                "", 1,
+                "da39a3ee5e6b4b0d3255bfef95601890afd80709",
+                "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855",
+            },
+            {
+                "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq", 1,
+                "84983e441c3bd26ebaae4aa1f95129e5e54670f1",
+                "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1",
+            },
+            {
+                "abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmnhijklmnoijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu", 1,
+                "a49b2446a02c645bf419f995b67091253a04a259",
+                "cf5b16a778af8380036ce59e7b0492370b249b11e8f07a51afac45037afee9d1",
+            },
+            {
+                "a", 1'000'000,
+                "34aa973cd4c4daa4f61eeb2bdbad27316534016f",
+                "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0",
+            },
+        };
+
+        /* Chunk sizes around the block size, so that updates both fill and span the internal buffer. */
+        constexpr size_t ChunkSizes[] = { 1, 3, 55, 63, 64, 65, 127, 128, 1000, std::numeric_limits<size_t>::max() };
+
+        void ParseHex(u8 *dst, size_t dst_size, const char *hex) {
+            AMS_ABORT_UNLESS(std::strlen(hex) == 2 * dst_size);
+
+            for (size_t i = 0; i < dst_size; ++i) {
+                char byte[3] = { hex[2 * i], hex[2 * i + 1], '\x00' };
+                dst[i] = static_cast<u8>(std::strtoul(byte, nullptr, 16));
+            }
+        }
+
+        template<typename Generator>
+        void GenerateHash(u8 *dst, const void *src, size_t size, size_t chunk_size) {
+            Generator generator;
+            generator.Initialize();
+
+            const u8 *src8 = static_cast<const u8 *>(src);
+            for (size_t offset = 0; offset < size; offset += chunk_size) {
+                generator.Update(src8 + offset, std::min(chunk_size, size - offset));
+            }
+
+            generator.GetHash(dst, Generator::HashSize);
+        }
+
+        template<typename Generator>
+        void TestKnownAnswers(const char *name, const char * const ShaTestVector::*digest) {
+            for (const auto &vector : FipsTestVectors) {
+                std::string message;
+                for (size_t i = 0; i < vector.repeat_count; ++i) {
+                    message.append(vector.message);
+                }
+
+                u8 expected[Generator::HashSize];
+                ParseHex(expected, sizeof(expected), vector.*digest);
+
+                for (const size_t chunk_size : ChunkSizes) {
+                    u8 hash[Generator::HashSize];
+                    GenerateHash<Generator>(hash, message.data(), message.size(), chunk_size);
+
+                    if (std::memcmp(hash, expected, sizeof(hash)) != 0) {
+                        printf("%s: mismatch for %zu bytes (chunk size %zu)\n", name, message.size(), chunk_size);
+                        AMS_ABORT("SHA known-answer mismatch");
+                    }
+                }
+            }
+        }
+
+        /* Checks that streaming arbitrary data in random chunks matches hashing it in one call. */
+        template<typename Generator>
+        void TestStreaming(util::TinyMT &mt) {
+            constexpr size_t DataSizeMax = 0x2000;
+            auto data = std::make_unique<u8[]>(DataSizeMax);
+            mt.GenerateRandomBytes(data.get(), DataSizeMax);
+
+            for (size_t size = 0; size <= DataSizeMax; size += 1 + (mt.GenerateRandomU32() % 0x80)) {
+                u8 expected[Generator::HashSize];
+                GenerateHash<Generator>(expected, data.get(), size, std::numeric_limits<size_t>::max());
+
+                Generator generator;
+                generator.Initialize();
+                for (size_t offset = 0; offset < size; /* ... */) {
+                    const size_t cur_size = std::min<size_t>(mt.GenerateRandomU32() % 0x200, size - offset);
+                    generator.Update(data.get() + offset, cur_size);
+                    offset += cur_size;
+                }
+
+                u8 hash[Generator::HashSize];
+                generator.GetHash(hash, sizeof(hash));
+                AMS_ABORT_UNLESS(std::memcmp(hash, expected, sizeof(hash)) == 0);
+            }
+        }
+
+        void TestAll(const char *implementation) {
+            util::TinyMT mt;
+            mt.Initialize(0x180);
+
+            TestKnownAnswers<crypto::Sha1Generator>("SHA-1", &ShaTestVector::sha1);
+            TestKnownAnswers<crypto::Sha256Generator>("SHA-256", &ShaTestVector::sha256);
+
+            TestStreaming<crypto::Sha1Generator>(mt);
+            TestStreaming<crypto::Sha256Generator>(mt);
+
+            printf("  %s implementation ok\n", implementation);
+        }
+
+    }
+
+    void Main() {
+        printf("Doing SHA-1/SHA-256 known-answer test!\n");
+
+        #if defined(ATMOSPHERE_ARCH_X64)
+        {
+            /* Test the SHA-NI implementation if we have it, and then the generic one. */
+            const bool is_sha_ni_available = crypto::impl::IsShaNiAvailable();
+            if (is_sha_ni_available) {
+                TestAll("SHA-NI");
+            } else {
+                printf("  SHA-NI is unavailable, skipping\n");
+            }
+
+            crypto::impl::SetShaNiAvailableForTest(false);
+            TestAll("generic");
+            crypto::impl::SetShaNiAvailableForTest(is_sha_ni_available);
+        }
+        #else
+        TestAll("default");
+        #endif
+
+        printf("All tests completed!\n");
+    }
+
+}
@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) Atmosphère-NX
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stratosphere.hpp>
+#include "../../../stratosphere/sm/source/impl/sm_info_index.hpp"
+
+namespace ams {
+
+    namespace {
+
+        constexpr size_t InfoCount     = 0x180;
+        constexpr u64 InvalidKey       = 0;
+        constexpr s32 OperationCount   = 100'000;
+
+        struct TestInfo {
+            u64 key;
+        };
+
+        /* Hash keys in small groups, so that every group collides at a single home slot. */
+        constexpr u64 CollisionGroupSize = 8;
+
+        struct GroupedTraits {
+            using Key = u64;
+
+            static u64 GetKey(const TestInfo &info) { return info.key; }
+            static u64 GetHash(u64 key) { return key / CollisionGroupSize; }
+        };
+
+        /* Hash every key to the same value, so that a single run of slots wraps around the end of the table. */
+        constinit u64 g_constant_hash = 0;
+
+        struct ConstantTraits {
+            using Key = u64;
+
+            static u64 GetKey(const TestInfo &info) { return info.key; }
+            static u64 GetHash(u64) { return g_constant_hash; }
+        };
+
+        constinit std::array<TestInfo, InfoCount> g_list = {};
+
+        template<typename Traits>
+        void TestIndex(util::TinyMT &mt, u64 key_range) {
+            using Index = sm::impl::InfoIndex<TestInfo, InfoCount, Traits>;
+
+            for (auto &info : g_list) {
+                info.key = InvalidKey;
+            }
+            Index index;
+
+            /* Track which info holds each key, to check the index against. */
+            std::unique_ptr<TestInfo *[]> expected(new TestInfo *[key_range + 1]());
+            size_t count = 0;
+
+            auto CheckAll = [&]() {
+                for (u64 key = 1; key <= key_range; ++key) {
+                    AMS_ABORT_UNLESS(index.Find(g_list, key) == expected[key]);
+                }
+            };
+
+            for (s32 i = 0; i < OperationCount; ++i) {
+                const u64 key = 1 + mt.GenerateRandomU64() % key_range;
+
+                if (TestInfo *info = index.Find(g_list, key); info != nullptr) {
+                    /* Remove the key, and check that nothing else was lost. */
+                    AMS_ABORT_UNLESS(info == expected[key]);
+                    index.Remove(g_list, info);
+                    info->key = InvalidKey;
+                    expected[key] = nullptr;
+                    --count;
+                } else {
+                    AMS_ABORT_UNLESS(expected[key] == nullptr);
+
+                    /* Insert the key, if we have a free info. */
+                    TestInfo *free_info = index.GetFree(g_list);
+                    if (count == InfoCount) {
+                        AMS_ABORT_UNLESS(free_info == nullptr);
+                        continue;
+                    }
+                    AMS_ABORT_UNLESS(free_info != nullptr && free_info->key == InvalidKey);
+
+                    free_info->key = key;
+                    index.Insert(g_list, free_info);
+                    expected[key] = free_info;
+                    ++count;
+                }
+
+                if ((i % 0x400) == 0) {
+                    CheckAll();
+                }
+            }
+
+            CheckAll();
+
+            /* Remove everything, and check that every info is free again. */
+            for (u64 key = 1; key <= key_range; ++key) {
+                if (TestInfo *info = expected[key]; info != nullptr) {
+                    index.Remove(g_list, info);
+                    info->key = InvalidKey;
+                    expected[key] = nullptr;
+                }
+            }
+            CheckAll();
+
+            for (size_t i = 0; i < InfoCount; ++i) {
+                TestInfo *free_info = index.GetFree(g_list);
+                AMS_ABORT_UNLESS(free_info != nullptr);
+
+                free_info->key = key_range + 1 + i;
+                index.Insert(g_list, free_info);
+            }
+            AMS_ABORT_UNLESS(index.GetFree(g_list) == nullptr);
+        }
+
+        u64 FindHashForLastSlot() {
+            /* Mirror the index's fibonacci hashing, to find a hash whose home is the last slot. */
+            constexpr size_t SlotCount = util::CeilingPowerOfTwo(InfoCount * 2);
+            constexpr int SlotShift    = BITSIZEOF(u64) - util::CountTrailingZeros(SlotCount);
+
+            for (u64 hash = 0; true; ++hash) {
+                if (static_cast<size_t>((hash * UINT64_C(0x9E3779B97F4A7C15)) >> SlotShift) == SlotCount - 1) {
+                    return hash;
+                }
+            }
+        }
+
+    }
+
+    void Main() {
+        util::TinyMT mt;
+        mt.Initialize(0);
+
+        /* Test with keys which collide in groups, both with a sparse and a full table. */
+        printf("Testing grouped collisions...\n");
+        TestIndex<GroupedTraits>(mt, InfoCount / 2);
+        TestIndex<GroupedTraits>(mt, InfoCount * 2);
+
+        /* Test with every key colliding, starting from the last slot so that the run wraps. */
+        printf("Testing wrapped collisions...\n");
+        g_constant_hash = FindHashForLastSlot();
+        TestIndex<ConstantTraits>(mt, InfoCount + InfoCount / 4);
+
+        printf("All tests completed!\n");
+    }
+
+}
@@ -0,0 +1,306 @@
+/*
+ * Copyright (c) Atmosphère-NX
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stratosphere.hpp>
+
+namespace ams {
+
+    namespace {
+
+        constexpr size_t BlockSize = crypto::Aes128XtsEncryptor::BlockSize;
+        constexpr size_t DataSizeMax = 0x200;
+
+        /* NOTE: Keys, tweaks and data are hex. The tweak is the data unit sequence number, little-endian. */
+        /* A null plaintext means the bytes 00, 01, ..., ff, repeating. */
+        struct XtsTestVector {
+            const char *name;
+            size_t key_size;
+            const char *key1;
+            const char *key2;
+            const char *tweak;
+            size_t size;
+            const char *plaintext;
+            const char *ciphertext;
+        };
+
+        /* IEEE 1619-2007 Annex B vectors 1, 2, 4, 10 and 15-19. */
+        /* 4, 10 and 19 cover the 16-block VAES loop, and 15-18 cover ciphertext stealing. */
+        constexpr const XtsTestVector IeeeTestVectors[] = {
+            {
+                "IEEE 1619 vector 1", 16,
+                "00000000000000000000000000000000",
+                "00000000000000000000000000000000",
+                "00000000000000000000000000000000",
+                0x20,
+                "0000000000000000000000000000000000000000000000000000000000000000",
+                "917cf69ebd68b2ec9b9fe9a3eadda692cd43d2f59598ed858c02c2652fbf922e",
+            },
+            {
+                "IEEE 1619 vector 2", 16,
+                "11111111111111111111111111111111",
+                "22222222222222222222222222222222",
+                "33333333330000000000000000000000",
+                0x20,
+                "4444444444444444444444444444444444444444444444444444444444444444",
+                "c454185e6a16936e39334038acef838bfb186fff7480adc4289382ecd6d394f0",
+            },
+            {
+                "IEEE 1619 vector 4", 16,
+                "27182818284590452353602874713526",
+                "31415926535897932384626433832795",
+                "00000000000000000000000000000000",
+                0x200,
+                nullptr,
+                "27a7479befa1d476489f308cd4cfa6e2a96e4bbe3208ff25287dd3819616e89c"
+                "c78cf7f5e543445f8333d8fa7f56000005279fa5d8b5e4ad40e736ddb4d35412"
+                "328063fd2aab53e5ea1e0a9f332500a5df9487d07a5c92cc512c8866c7e860ce"
+                "93fdf166a24912b422976146ae20ce846bb7dc9ba94a767aaef20c0d61ad0265"
+                "5ea92dc4c4e41a8952c651d33174be51a10c421110e6d81588ede82103a252d8"
+                "a750e8768defffed9122810aaeb99f9172af82b604dc4b8e51bcb08235a6f434"
+                "1332e4ca60482a4ba1a03b3e65008fc5da76b70bf1690db4eae29c5f1badd03c"
+                "5ccf2a55d705ddcd86d449511ceb7ec30bf12b1fa35b913f9f747a8afd1b130e"
+                "94bff94effd01a91735ca1726acd0b197c4e5b03393697e126826fb6bbde8ecc"
+                "1e08298516e2c9ed03ff3c1b7860f6de76d4cecd94c8119855ef5297ca67e9f3"
+                "e7ff72b1e99785ca0a7e7720c5b36dc6d72cac9574c8cbbc2f801e23e56fd344"
+                "b07f22154beba0f08ce8891e643ed995c94d9a69c9f1b5f499027a78572aeebd"
+                "74d20cc39881c213ee770b1010e4bea718846977ae119f7a023ab58cca0ad752"
+                "afe656bb3c17256a9f6e9bf19fdd5a38fc82bbe872c5539edb609ef4f79c203e"
+                "bb140f2e583cb2ad15b4aa5b655016a8449277dbd477ef2c8d6c017db738b18d"
+                "eb4a427d1923ce3ff262735779a418f20a282df920147beabe421ee5319d0568",
+            },
+            {
+                "IEEE 1619 vector 10", 32,
+                "2718281828459045235360287471352662497757247093699959574966967627",
+                "3141592653589793238462643383279502884197169399375105820974944592",
+                "ff000000000000000000000000000000",
+                0x200,
+                nullptr,
+                "1c3b3a102f770386e4836c99e370cf9bea00803f5e482357a4ae12d414a3e63b"
+                "5d31e276f8fe4a8d66b317f9ac683f44680a86ac35adfc3345befecb4bb188fd"
+                "5776926c49a3095eb108fd1098baec70aaa66999a72a82f27d848b21d4a741b0"
+                "c5cd4d5fff9dac89aeba122961d03a757123e9870f8acf1000020887891429ca"
+                "2a3e7a7d7df7b10355165c8b9a6d0a7de8b062c4500dc4cd120c0f7418dae3d0"
+                "b5781c34803fa75421c790dfe1de1834f280d7667b327f6c8cd7557e12ac3a0f"
+                "93ec05c52e0493ef31a12d3d9260f79a289d6a379bc70c50841473d1a8cc81ec"
+                "583e9645e07b8d9670655ba5bbcfecc6dc3966380ad8fecb17b6ba02469a020a"
+                "84e18e8f84252070c13e9f1f289be54fbc481457778f616015e1327a02b140f1"
+                "505eb309326d68378f8374595c849d84f4c333ec4423885143cb47bd71c5edae"
+                "9be69a2ffeceb1bec9de244fbe15992b11b77c040f12bd8f6a975a44a0f90c29"
+                "a9abc3d4d893927284c58754cce294529f8614dcd2aba991925fedc4ae74ffac"
+                "6e333b93eb4aff0479da9a410e4450e0dd7ae4c6e2910900575da401fc07059f"
+                "645e8b7e9bfdef33943054ff84011493c27b3429eaedb4ed5376441a77ed4385"
+                "1ad77f16f541dfd269d50d6a5f14fb0aab1cbb4c1550be97f7ab4066193c4caa"
+                "773dad38014bd2092fa755c824bb5e54c4f36ffda9fcea70b9c6e693e148c151",
+            },
+            {
+                "IEEE 1619 vector 15", 16,
+                "fffefdfcfbfaf9f8f7f6f5f4f3f2f1f0",
+                "bfbebdbcbbbab9b8b7b6b5b4b3b2b1b0",
+                "9a785634120000000000000000000000",
+                0x11,
+                nullptr,
+                "6c1625db4671522d3d7599601de7ca09ed",
+            },
+            {
+                "IEEE 1619 vector 16", 16,
+                "fffefdfcfbfaf9f8f7f6f5f4f3f2f1f0",
+                "bfbebdbcbbbab9b8b7b6b5b4b3b2b1b0",
+                "9a785634120000000000000000000000",
+                0x12,
+                nullptr,
+                "d069444b7a7e0cab09e24447d24deb1fedbf",
+            },
+            {
+                "IEEE 1619 vector 17", 16,
+                "fffefdfcfbfaf9f8f7f6f5f4f3f2f1f0",
+                "bfbebdbcbbbab9b8b7b6b5b4b3b2b1b0",
+                "9a785634120000000000000000000000",
+                0x13,
+                nullptr,
+                "e5df1351c0544ba1350b3363cd8ef4beedbf9d",
+            },
+            {
+                "IEEE 1619 vector 18", 16,
+                "fffefdfcfbfaf9f8f7f6f5f4f3f2f1f0",
+                "bfbebdbcbbbab9b8b7b6b5b4b3b2b1b0",
+                "9a785634120000000000000000000000",
+                0x14,
+                nullptr,
+                "9d84c813f719aa2c7be3f66171c7c5c2edbf9dac",
+            },
+            {
+                "IEEE 1619 vector 19", 16,
+                "e0e1e2e3e4e5e6e7e8e9eaebecedeeef",
+                "c0c1c2c3c4c5c6c7c8c9cacbcccdcecf",
+                "a9876543210000000000000000000000",
+                0x200,
+                nullptr,
+                "c4e60104e27aed4deff63b72b054ac82cc0175a5b8aeeeaa017ec12249aa641b"
+                "36438dab0589e8903bf23327127c12362e7d6864522c44538e4e979d97393ba6"
+                "7eab768517e2c70b98035fc1bbebfed48a9ff017eb3e04dc8e19aad6be04c23a"
+                "6675726a4388c8a297fef753bf71e9ea07dd354d42dc2393888a401188554a53"
+                "315eb9a0624ae44e5b674b3607b73ee0e5feb44f5be7178ef54cbd460b1d6a2e"
+                "93923f6b63210b06d74367bbb02884639af3b958cacc041618a7940a983f8438"
+                "123348f3d87f254377152302d821ece64588f8bb1af85cf934bd49c703186e48"
+                "624772c9802228484249e887ebfd7440514130d8d38c2b1219241a42630bdfbd"
+                "4135fac6bec92462d3ea9beb95c797d23a8c04799e3ea2ba733c5e00718649e7"
+                "af0fdd6eaa5bfd5df7f3fa9953a3b5266806709d17ddd0a0f5b7535bc9f986c1"
+                "09a848ef8c3a45f9033056817ce08de8019ea103e28836b82d08c5d1fdeec254"
+                "e508bf253f6b90963fe43d7d8b8d66d30419c4733a32da1505de5dfd7a976e78"
+                "52455dd454327ee8a1cb71d40f392a89eee266a8f42772bb519f4044902d939e"
+                "9716734f622f46e3c48f31d09e7859a14b54693f9eeb14fc021dc5b66589ca3f"
+                "e16b7bc7166a3686cc869730656ae76285a518b290745e852c6ac626eb0da25d"
+                "ff404b83f001d6d23a65d91f3f38a097da03a59b275b4f5a5480c9608e12f93b",
+            },
+            /* IEEE 1619 has no vector which steals from a run of more than one block, so these use vector 4's key with truncated */
+            /* data (reference ciphertext from OpenSSL). 0x135 bytes is one VAES iteration, three AES-NI blocks and a 5 byte tail. */
+            {
+                "Vector 4 key, 0x135 bytes", 16,
+                "27182818284590452353602874713526",
+                "31415926535897932384626433832795",
+                "00000000000000000000000000000000",
+                0x135,
+                nullptr,
+                "27a7479befa1d476489f308cd4cfa6e2a96e4bbe3208ff25287dd3819616e89c"
+                "c78cf7f5e543445f8333d8fa7f56000005279fa5d8b5e4ad40e736ddb4d35412"
+                "328063fd2aab53e5ea1e0a9f332500a5df9487d07a5c92cc512c8866c7e860ce"
+                "93fdf166a24912b422976146ae20ce846bb7dc9ba94a767aaef20c0d61ad0265"
+                "5ea92dc4c4e41a8952c651d33174be51a10c421110e6d81588ede82103a252d8"
+                "a750e8768defffed9122810aaeb99f9172af82b604dc4b8e51bcb08235a6f434"
+                "1332e4ca60482a4ba1a03b3e65008fc5da76b70bf1690db4eae29c5f1badd03c"
+                "5ccf2a55d705ddcd86d449511ceb7ec30bf12b1fa35b913f9f747a8afd1b130e"
+                "94bff94effd01a91735ca1726acd0b197c4e5b03393697e126826fb6bbde8ecc"
+                "f8fe9713148707998cc6892b386fa8d71e08298516",
+            },
+            {
+                "Vector 4 key, 0x1FF bytes", 16,
+                "27182818284590452353602874713526",
+                "31415926535897932384626433832795",
+                "00000000000000000000000000000000",
+                0x1FF,
+                nullptr,
+                "27a7479befa1d476489f308cd4cfa6e2a96e4bbe3208ff25287dd3819616e89c"
+                "c78cf7f5e543445f8333d8fa7f56000005279fa5d8b5e4ad40e736ddb4d35412"
+                "328063fd2aab53e5ea1e0a9f332500a5df9487d07a5c92cc512c8866c7e860ce"
+                "93fdf166a24912b422976146ae20ce846bb7dc9ba94a767aaef20c0d61ad0265"
+                "5ea92dc4c4e41a8952c651d33174be51a10c421110e6d81588ede82103a252d8"
+                "a750e8768defffed9122810aaeb99f9172af82b604dc4b8e51bcb08235a6f434"
+                "1332e4ca60482a4ba1a03b3e65008fc5da76b70bf1690db4eae29c5f1badd03c"
+                "5ccf2a55d705ddcd86d449511ceb7ec30bf12b1fa35b913f9f747a8afd1b130e"
+                "94bff94effd01a91735ca1726acd0b197c4e5b03393697e126826fb6bbde8ecc"
+                "1e08298516e2c9ed03ff3c1b7860f6de76d4cecd94c8119855ef5297ca67e9f3"
+                "e7ff72b1e99785ca0a7e7720c5b36dc6d72cac9574c8cbbc2f801e23e56fd344"
+                "b07f22154beba0f08ce8891e643ed995c94d9a69c9f1b5f499027a78572aeebd"
+                "74d20cc39881c213ee770b1010e4bea718846977ae119f7a023ab58cca0ad752"
+                "afe656bb3c17256a9f6e9bf19fdd5a38fc82bbe872c5539edb609ef4f79c203e"
+                "bb140f2e583cb2ad15b4aa5b655016a8449277dbd477ef2c8d6c017db738b18d"
+                "4d8e0f3e639dd70ca7f0ed5335522514eb4a427d1923ce3ff262735779a418",
+            },
+        };
+
+        void ParseHex(u8 *dst, size_t dst_size, const char *hex) {
+            AMS_ABORT_UNLESS(std::strlen(hex) == 2 * dst_size);
+
+            for (size_t i = 0; i < dst_size; ++i) {
+                char byte[3] = { hex[2 * i], hex[2 * i + 1], '\x00' };
+                dst[i] = static_cast<u8>(std::strtoul(byte, nullptr, 16));
+            }
+        }
+
+        template<typename Cryptor>
+        void Process(u8 *dst, const XtsTestVector &vector, const u8 *src, size_t size, size_t chunk_size) {
+            u8 key1[0x20], key2[0x20], tweak[BlockSize];
+            ParseHex(key1, vector.key_size, vector.key1);
+            ParseHex(key2, vector.key_size, vector.key2);
+            ParseHex(tweak, sizeof(tweak), vector.tweak);
+
+            Cryptor cryptor;
+            cryptor.Initialize(key1, key2, vector.key_size, tweak, sizeof(tweak));
+
+            /* Feed the data in chunks, to check that partial blocks are carried between updates. */
+            size_t written = 0;
+            for (size_t offset = 0; offset < size; offset += chunk_size) {
+                const size_t cur_size = std::min(chunk_size, size - offset);
+                written += cryptor.Update(dst + written, DataSizeMax - written, src + offset, cur_size);
+            }
+            written += cryptor.Finalize(dst + written, DataSizeMax - written);
+
+            AMS_ABORT_UNLESS(written == size);
+        }
+
+        template<typename Encryptor, typename Decryptor>
+        void TestVector(const XtsTestVector &vector) {
+            u8 plaintext[DataSizeMax], ciphertext[DataSizeMax];
+            AMS_ABORT_UNLESS(vector.size <= DataSizeMax);
+
+            if (vector.plaintext != nullptr) {
+                ParseHex(plaintext, vector.size, vector.plaintext);
+            } else {
+                for (size_t i = 0; i < vector.size; ++i) {
+                    plaintext[i] = static_cast<u8>(i);
+                }
+            }
+            ParseHex(ciphertext, vector.size, vector.ciphertext);
+
+            for (const size_t chunk_size : { DataSizeMax, BlockSize, static_cast<size_t>(1), static_cast<size_t>(7), static_cast<size_t>(0x101) }) {
+                u8 out[DataSizeMax];
+
+                Process<Encryptor>(out, vector, plaintext, vector.size, chunk_size);
+                if (std::memcmp(out, ciphertext, vector.size) != 0) {
+                    printf("%s: encryption mismatch (chunk size 0x%zx)\n", vector.name, chunk_size);
+                    AMS_ABORT("XTS encryption mismatch");
+                }
+
+                Process<Decryptor>(out, vector, ciphertext, vector.size, chunk_size);
+                if (std::memcmp(out, plaintext, vector.size) != 0) {
+                    printf("%s: decryption mismatch (chunk size 0x%zx)\n", vector.name, chunk_size);
+                    AMS_ABORT("XTS decryption mismatch");
+                }
+            }
+
+            /* Without stealing, the first n blocks of ciphertext only depend on the first n blocks of plaintext. */
+            /* Checking every whole-block prefix covers every split between the VAES loop and the AES-NI tail. */
+            const size_t prefix_size_max = util::IsAligned(vector.size, BlockSize) ? vector.size : 0;
+            for (size_t size = BlockSize; size <= prefix_size_max; size += BlockSize) {
+                u8 out[DataSizeMax];
+
+                Process<Encryptor>(out, vector, plaintext, size, DataSizeMax);
+                AMS_ABORT_UNLESS(std::memcmp(out, ciphertext, size) == 0);
+
+                Process<Decryptor>(out, vector, ciphertext, size, DataSizeMax);
+                AMS_ABORT_UNLESS(std::memcmp(out, plaintext, size) == 0);
+            }
+
+            printf("  %s ok\n", vector.name);
+        }
+
+    }
+
+    void Main() {
+        printf("Doing XTS known-answer test!\n");
+
+        for (const auto &vector : IeeeTestVectors) {
+            if (vector.key_size == crypto::Aes128XtsEncryptor::KeySize) {
+                TestVector<crypto::Aes128XtsEncryptor, crypto::Aes128XtsDecryptor>(vector);
+            } else {
+                AMS_ABORT_UNLESS(vector.key_size == crypto::Aes256XtsEncryptor::KeySize);
+                TestVector<crypto::Aes256XtsEncryptor, crypto::Aes256XtsDecryptor>(vector);
+            }
+        }
+
+        printf("All tests completed!\n");
+    }
+
+}
@@ -29,7 +29,14 @@ namespace haze {
             Result Initialize(const UsbCommsInterfaceInfo *interface_info, u16 id_vendor, u16 id_product, EventReactor *reactor);
             void Finalize();
         private:
-            Result TransferPacketImpl(bool read, void *page, u32 size, u32 *out_size_transferred) const;
+            Result BeginTransferPacketImpl(bool read, void *page, u32 size, u32 *out_urb_id) const;
+            Result EndTransferPacketImpl(bool read, u32 urb_id, u32 *out_size_transferred) const;
+
+            Result TransferPacketImpl(bool read, void *page, u32 size, u32 *out_size_transferred) const {
+                u32 urb_id;
+                R_TRY(this->BeginTransferPacketImpl(read, page, size, std::addressof(urb_id)));
+                R_RETURN(this->EndTransferPacketImpl(read, urb_id, out_size_transferred));
+            }
         public:
             Result ReadPacket(void *page, u32 size, u32 *out_size_transferred) const {
                 R_RETURN(this->TransferPacketImpl(true, page, size, out_size_transferred));
@@ -39,6 +46,25 @@ namespace haze {
                 u32 size_transferred;
                 R_RETURN(this->TransferPacketImpl(false, page, size, std::addressof(size_transferred)));
             }
+
+            /* NOTE: Only one transfer may be in progress on each endpoint. */
+            /* The page must not be touched until the transfer has been ended. */
+            Result BeginReadPacket(void *page, u32 size, u32 *out_urb_id) const {
+                R_RETURN(this->BeginTransferPacketImpl(true, page, size, out_urb_id));
+            }
+
+            Result EndReadPacket(u32 urb_id, u32 *out_size_transferred) const {
+                R_RETURN(this->EndTransferPacketImpl(true, urb_id, out_size_transferred));
+            }
+
+            Result BeginWritePacket(void *page, u32 size, u32 *out_urb_id) const {
+                R_RETURN(this->BeginTransferPacketImpl(false, page, size, out_urb_id));
+            }
+
+            Result EndWritePacket(u32 urb_id) const {
+                u32 size_transferred;
+                R_RETURN(this->EndTransferPacketImpl(false, urb_id, std::addressof(size_transferred)));
+            }
     };
 
 }
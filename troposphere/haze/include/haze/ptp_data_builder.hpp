@@ -27,6 +27,9 @@ namespace haze {
             u32 m_transmitted_size;
             u32 m_offset;
             u8 *m_data;
+            u8 *m_next_data;
+            u32 m_write_urb_id;
+            bool m_write_pending;
             bool m_disabled;
         private:
             Result Flush() {
@@ -38,11 +41,39 @@ namespace haze {
                 /* If we're disabled, we have nothing to do. */
                 R_SUCCEED_IF(m_disabled);
 
-                /* Otherwise, we should write our buffered data. */
-                R_RETURN(m_server->WritePacket(m_data, m_offset));
+                /* If we only have one buffer, we must write our buffered data now. */
+                if (m_next_data == nullptr) {
+                    R_RETURN(m_server->WritePacket(m_data, m_offset));
+                }
+
+                /* Otherwise, wait for our previous write, and begin writing our buffered data. */
+                /* We'll fill our other buffer while the write is in progress. */
+                R_TRY(this->WaitForPendingWrite());
+                R_TRY(m_server->BeginWritePacket(m_data, m_offset, std::addressof(m_write_urb_id)));
+
+                m_write_pending = true;
+                std::swap(m_data, m_next_data);
+
+                R_SUCCEED();
             }
         public:
-            constexpr explicit PtpDataBuilder(void *data, AsyncUsbServer *server) : m_server(server),  m_transmitted_size(), m_offset(), m_data(static_cast<u8 *>(data)), m_disabled() { /* ... */ }
+            constexpr explicit PtpDataBuilder(void *data, AsyncUsbServer *server) : PtpDataBuilder(data, nullptr, server) { /* ... */ }
+
+            /* NOTE: With a second buffer, packets are written while the next is being built. */
+            constexpr explicit PtpDataBuilder(void *data, void *next_data, AsyncUsbServer *server) : m_server(server),  m_transmitted_size(), m_offset(), m_data(static_cast<u8 *>(data)), m_next_data(static_cast<u8 *>(next_data)), m_write_urb_id(), m_write_pending(), m_disabled() { /* ... */ }
+
+            ~PtpDataBuilder() {
+                /* Ensure our buffers are no longer in use. */
+                /* NOTE: Users with a second buffer must call WaitForPendingWrite themselves, even on failure, to learn whether the write failed. */
+                this->WaitForPendingWrite();
+            }
+
+            Result WaitForPendingWrite() {
+                R_SUCCEED_IF(!m_write_pending);
+
+                m_write_pending = false;
+                R_RETURN(m_server->EndWritePacket(m_write_urb_id));
+            }
 
             Result Commit() {
                 if (m_offset > 0) {
@@ -55,7 +86,8 @@ namespace haze {
                     R_TRY(this->Flush());
                 }
 
-                R_SUCCEED();
+                /* Wait for all data to be written. */
+                R_RETURN(this->WaitForPendingWrite());
             }
 
             Result AddBuffer(const u8 *buffer, u32 count) {
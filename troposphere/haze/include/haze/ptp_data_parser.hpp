@@ -27,6 +27,9 @@ namespace haze {
             u32 m_received_size;
             u32 m_offset;
             u8 *m_data;
+            u8 *m_next_data;
+            u32 m_read_urb_id;
+            bool m_read_pending;
             bool m_eot;
         private:
             Result Flush() {
@@ -41,10 +44,51 @@ namespace haze {
                     m_eot = m_received_size < haze::UsbBulkPacketBufferSize;
                 };
 
-                R_RETURN(m_server->ReadPacket(m_data, haze::UsbBulkPacketBufferSize, std::addressof(m_received_size)));
+                /* If we only have one buffer, we must read the next packet now. */
+                if (m_next_data == nullptr) {
+                    R_RETURN(m_server->ReadPacket(m_data, haze::UsbBulkPacketBufferSize, std::addressof(m_received_size)));
+                }
+
+                /* Otherwise, receive the packet we began reading ahead, if any. */
+                if (!m_read_pending) {
+                    R_TRY(m_server->BeginReadPacket(m_next_data, haze::UsbBulkPacketBufferSize, std::addressof(m_read_urb_id)));
+                }
+
+                m_read_pending = false;
+                R_TRY(m_server->EndReadPacket(m_read_urb_id, std::addressof(m_received_size)));
+
+                std::swap(m_data, m_next_data);
+
+                /* If the transmission continues, begin reading the next packet while this one is consumed. */
+                /* A full packet is always followed by another, so this never reads past the end of the transmission. */
+                if (m_received_size == haze::UsbBulkPacketBufferSize) {
+                    R_TRY(m_server->BeginReadPacket(m_next_data, haze::UsbBulkPacketBufferSize, std::addressof(m_read_urb_id)));
+                    m_read_pending = true;
+                }
+
+                R_SUCCEED();
             }
         public:
-            constexpr explicit PtpDataParser(void *data, AsyncUsbServer *server) : m_server(server), m_received_size(), m_offset(), m_data(static_cast<u8 *>(data)), m_eot() { /* ... */ }
+            constexpr explicit PtpDataParser(void *data, AsyncUsbServer *server) : PtpDataParser(data, nullptr, server) { /* ... */ }
+
+            /* NOTE: With a second buffer, packets are read ahead while the previous is being parsed. */
+            constexpr explicit PtpDataParser(void *data, void *next_data, AsyncUsbServer *server) : m_server(server), m_received_size(), m_offset(), m_data(static_cast<u8 *>(data)), m_next_data(static_cast<u8 *>(next_data)), m_read_urb_id(), m_read_pending(), m_eot() { /* ... */ }
+
+            ~PtpDataParser() {
+                /* Ensure our buffers are no longer in use. */
+                /* NOTE: Users with a second buffer must call WaitForPendingRead themselves, even on failure, to learn whether the read failed. */
+                this->WaitForPendingRead();
+            }
+
+            Result WaitForPendingRead() {
+                R_SUCCEED_IF(!m_read_pending);
+
+                /* The packet we read ahead is discarded. */
+                m_read_pending = false;
+
+                u32 received_size;
+                R_RETURN(m_server->EndReadPacket(m_read_urb_id, std::addressof(received_size)));
+            }
 
             Result Finalize() {
                 /* Read until the transmission completes. */
@@ -27,6 +27,9 @@ namespace haze {
             util::IntrusiveRedBlackTreeNode m_object_id_node;
             u32 m_parent_id;
             u32 m_object_id;
+            FsDirEntryType m_entry_type;
+            s64 m_size;
+            bool m_has_metadata;
             char m_name[];
         public:
             const char *GetName()  const { return m_name; }
@@ -36,6 +39,25 @@ namespace haze {
             bool GetIsRegistered() const { return m_object_id != 0; }
             void Register(u32 object_id) { m_object_id = object_id; }
             void Unregister()            { m_object_id = 0; }
+        public:
+            /* Metadata is cached from directory enumeration, so that property queries need not access the filesystem. */
+            bool GetMetadata(FsDirEntryType *out_entry_type, s64 *out_size) const {
+                if (!m_has_metadata) {
+                    return false;
+                }
+
+                *out_entry_type = m_entry_type;
+                *out_size       = m_size;
+                return true;
+            }
+
+            void SetMetadata(FsDirEntryType entry_type, s64 size) {
+                m_entry_type   = entry_type;
+                m_size         = entry_type == FsDirEntryType_File ? size : 0;
+                m_has_metadata = true;
+            }
+
+            void InvalidateMetadata() { m_has_metadata = false; }
         public:
             struct NameComparator {
                 struct RedBlackKeyType {
@@ -99,6 +121,9 @@ namespace haze {
             void DeleteObject(PtpObject *obj);
 
             Result CreateAndRegisterObjectId(const char *parent_name, const char *name, u32 parent_id, u32 *out_object_id);
+
+            /* Invalidates the cached metadata of an object and everything beneath it. */
+            void InvalidateObjectMetadata(const char *name);
         public:
             PtpObject *GetObjectById(u32 object_id);
             PtpObject *GetObjectByName(const char *name);
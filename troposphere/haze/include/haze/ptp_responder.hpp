@@ -23,6 +23,7 @@
 
 namespace haze {
 
+    class PtpDataBuilder;
     class PtpDataParser;
 
     class PtpResponder final {
@@ -58,6 +59,9 @@ namespace haze {
                 R_RETURN(this->WriteResponse(code, std::addressof(data), sizeof(data)));
             }
 
+            /* Object metadata. */
+            Result GetObjectMetadata(PtpObject *obj, FsDirEntryType *out_entry_type, s64 *out_size);
+
             /* PTP operations. */
             Result GetDeviceInfo(PtpDataParser &dp);
             Result OpenSession(PtpDataParser &dp);
@@ -67,13 +71,17 @@ namespace haze {
             Result GetObjectHandles(PtpDataParser &dp);
             Result GetObjectInfo(PtpDataParser &dp);
             Result GetObject(PtpDataParser &dp);
+            Result GetObjectImpl(PtpDataParser &dp, PtpDataBuilder &db);
             Result SendObjectInfo(PtpDataParser &dp);
             Result SendObject(PtpDataParser &dp);
+            Result SendObjectImpl(PtpDataParser &dp);
             Result DeleteObject(PtpDataParser &dp);
 
             /* Android operations. */
             Result GetPartialObject64(PtpDataParser &dp);
+            Result GetPartialObject64Impl(PtpDataParser &dp, PtpDataBuilder &db);
             Result SendPartialObject(PtpDataParser &dp);
+            Result SendPartialObjectImpl(PtpDataParser &rdp, PtpDataParser &dp);
             Result TruncateObject(PtpDataParser &dp);
             Result BeginEditObject(PtpDataParser &dp);
             Result EndEditObject(PtpDataParser &dp);
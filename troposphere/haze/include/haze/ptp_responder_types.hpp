@@ -178,6 +178,9 @@ namespace haze {
 
         alignas(4_KB) u8 usb_bulk_write_buffer[UsbBulkPacketBufferSize];
         alignas(4_KB) u8 usb_bulk_read_buffer[UsbBulkPacketBufferSize];
+
+        /* Object transfers use this as a second bulk buffer, to overlap file system access with USB transfers. */
+        alignas(4_KB) u8 usb_bulk_pipeline_buffer[UsbBulkPacketBufferSize];
     };
 
 }
@@ -73,6 +73,7 @@ namespace haze {
         /* Set object properties. */
         object->m_parent_id = parent_id;
         object->m_object_id = 0;
+        object->InvalidateMetadata();
 
         /* Set output. */
         *out_object = object;
@@ -132,6 +133,22 @@ namespace haze {
         R_SUCCEED();
     }
 
+    void PtpObjectDatabase::InvalidateObjectMetadata(const char *name) {
+        const size_t name_len = util::Strlen(name);
+
+        /* Names beginning with the object's name are adjacent in the name tree, so visit them in order. */
+        for (auto it = m_name_tree.nfind_key(name); it != m_name_tree.end(); ++it) {
+            if (strncasecmp(it->GetName(), name, name_len) != 0) {
+                break;
+            }
+
+            /* Skip siblings which merely share a prefix with the object. */
+            if (const char next = it->GetName()[name_len]; next == '\x00' || next == '/') {
+                it->InvalidateMetadata();
+            }
+        }
+    }
+
     PtpObject *PtpObjectDatabase::GetObjectById(u32 object_id) {
         /* Find in ID mapping. */
         if (auto it = m_object_id_tree.find_key(object_id); it != m_object_id_tree.end()) {
@@ -157,6 +157,34 @@ namespace haze {
         }
     }
 
+    Result PtpResponder::GetObjectMetadata(PtpObject *obj, FsDirEntryType *out_entry_type, s64 *out_size) {
+        /* If we already know about the object, we're done. */
+        R_SUCCEED_IF(obj->GetMetadata(out_entry_type, out_size));
+
+        /* Figure out what type of object this is. */
+        FsDirEntryType entry_type;
+        R_TRY(m_fs.GetEntryType(obj->GetName(), std::addressof(entry_type)));
+
+        /* Get the size, if this is a file. */
+        s64 size = 0;
+        if (entry_type == FsDirEntryType_File) {
+            FsFile file;
+            R_TRY(m_fs.OpenFile(obj->GetName(), FsOpenMode_Read, std::addressof(file)));
+
+            /* Ensure we maintain a clean state on exit. */
+            ON_SCOPE_EXIT { m_fs.CloseFile(std::addressof(file)); };
+
+            R_TRY(m_fs.GetFileSize(std::addressof(file), std::addressof(size)));
+        }
+
+        /* Remember the metadata for next time. */
+        obj->SetMetadata(entry_type, size);
+
+        *out_entry_type = entry_type;
+        *out_size       = size;
+        R_SUCCEED();
+    }
+
     Result PtpResponder::WriteResponse(PtpResponseCode code, const void* data, size_t size) {
         PtpDataBuilder db(m_buffers->usb_bulk_write_buffer, std::addressof(m_usb_server));
         R_TRY(db.AddResponseHeader(m_request_header, code, size));
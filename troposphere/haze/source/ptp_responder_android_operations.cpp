@@ -21,8 +21,18 @@
 namespace haze {
 
     Result PtpResponder::GetPartialObject64(PtpDataParser &dp) {
-        PtpDataBuilder db(m_buffers->usb_bulk_write_buffer, std::addressof(m_usb_server));
+        PtpDataBuilder db(m_buffers->usb_bulk_write_buffer, m_buffers->usb_bulk_pipeline_buffer, std::addressof(m_usb_server));
 
+        /* Send the object's data, then wait for our last write even if we failed, so that a failed transfer is what we report. */
+        const Result result = this->GetPartialObject64Impl(dp, db);
+        R_TRY(db.WaitForPendingWrite());
+        R_TRY(result);
+
+        /* Write the success response. */
+        R_RETURN(this->WriteResponse(PtpResponseCode_Ok));
+    }
+
+    Result PtpResponder::GetPartialObject64Impl(PtpDataParser &dp, PtpDataBuilder &db) {
         /* Get the object ID, offset, and size for the file we want to read. */
         u32 object_id, size;
         u64 offset;
@@ -75,13 +85,23 @@ namespace haze {
         }
 
         /* Flush the data response. */
-        R_TRY(db.Commit());
+        R_RETURN(db.Commit());
+    }
+
+    Result PtpResponder::SendPartialObject(PtpDataParser &rdp) {
+        /* Prepare a data parser for the data we are about to receive. */
+        PtpDataParser dp(m_buffers->usb_bulk_read_buffer, m_buffers->usb_bulk_pipeline_buffer, std::addressof(m_usb_server));
+
+        /* Receive the object's data, then wait for our last read even if we failed, so that a failed transfer is what we report. */
+        const Result result = this->SendPartialObjectImpl(rdp, dp);
+        R_TRY(dp.WaitForPendingRead());
+        R_TRY(result);
 
         /* Write the success response. */
         R_RETURN(this->WriteResponse(PtpResponseCode_Ok));
     }
 
-    Result PtpResponder::SendPartialObject(PtpDataParser &rdp) {
+    Result PtpResponder::SendPartialObjectImpl(PtpDataParser &rdp, PtpDataParser &dp) {
         /* Get the object ID, offset, and size for the file we want to write. */
         u32 object_id, size;
         u64 offset;
@@ -101,6 +121,9 @@ namespace haze {
         /* Ensure we maintain a clean state on exit. */
         ON_SCOPE_EXIT { m_fs.CloseFile(std::addressof(file)); };
 
+        /* The file's size may change, so forget what we know about it. */
+        obj->InvalidateMetadata();
+
         /* Get the file's size. */
         s64 file_size = 0;
         R_TRY(m_fs.GetFileSize(std::addressof(file), std::addressof(file_size)));
@@ -109,9 +132,6 @@ namespace haze {
         R_UNLESS(offset + size > offset, haze::ResultInvalidArgument());
         R_UNLESS(static_cast<u64>(file_size) <= offset, haze::ResultInvalidArgument());
 
-        /* Prepare a data parser for the data we are about to receive. */
-        PtpDataParser dp(m_buffers->usb_bulk_read_buffer, std::addressof(m_usb_server));
-
         /* Ensure we have a data header. */
         PtpUsbBulkContainer data_header;
         R_TRY(dp.Read(std::addressof(data_header)));
@@ -141,8 +161,7 @@ namespace haze {
             R_TRY(read_res);
         }
 
-        /* Write the success response. */
-        R_RETURN(this->WriteResponse(PtpResponseCode_Ok));
+        R_SUCCEED();
     }
 
     Result PtpResponder::TruncateObject(PtpDataParser &dp) {
@@ -165,6 +184,7 @@ namespace haze {
         ON_SCOPE_EXIT { m_fs.CloseFile(std::addressof(file)); };
 
         /* Truncate the file. */
+        obj->InvalidateMetadata();
         R_TRY(m_fs.SetFileSize(std::addressof(file), size));
 
         /* Write the success response. */
@@ -120,31 +120,12 @@ namespace haze {
         auto * const obj = m_object_database.GetObjectById(object_id);
         R_UNLESS(obj != nullptr, haze::ResultInvalidObjectId());
 
-        /* Define helper for getting the object type. */
-        const auto GetObjectType = [&] (FsDirEntryType *out_entry_type) {
-            R_RETURN(m_fs.GetEntryType(obj->GetName(), out_entry_type));
-        };
-
-        /* Define helper for getting the object size. */
-        const auto GetObjectSize = [&] (s64 *out_size) {
-            *out_size = 0;
-
-            /* Check if this is a directory. */
-            FsDirEntryType entry_type;
-            R_TRY(GetObjectType(std::addressof(entry_type)));
-
-            /* If it is, we're done. */
-            R_SUCCEED_IF(entry_type == FsDirEntryType_Dir);
-
-            /* Otherwise, open as a file. */
-            FsFile file;
-            R_TRY(m_fs.OpenFile(obj->GetName(), FsOpenMode_Read, std::addressof(file)));
-
-            /* Ensure we maintain a clean state on exit. */
-            ON_SCOPE_EXIT { m_fs.CloseFile(std::addressof(file)); };
-
-            R_RETURN(m_fs.GetFileSize(std::addressof(file), out_size));
-        };
+        /* Get the object's type and size, if the property needs them. */
+        FsDirEntryType entry_type = FsDirEntryType_File;
+        s64 size = 0;
+        if (property_code == PtpObjectPropertyCode_ObjectSize || property_code == PtpObjectPropertyCode_ObjectFormat) {
+            R_TRY(this->GetObjectMetadata(obj, std::addressof(entry_type), std::addressof(size)));
+        }
 
         /* Begin writing the requested object property. */
         PtpDataBuilder db(m_buffers->usb_bulk_write_buffer, std::addressof(m_usb_server));
@@ -158,8 +139,6 @@ namespace haze {
                     break;
                 case PtpObjectPropertyCode_ObjectSize:
                     {
-                        s64 size;
-                        R_TRY(GetObjectSize(std::addressof(size)));
                         R_TRY(db.Add<u64>(size));
                     }
                     break;
@@ -175,8 +154,6 @@ namespace haze {
                     break;
                 case PtpObjectPropertyCode_ObjectFormat:
                     {
-                        FsDirEntryType entry_type;
-                        R_TRY(GetObjectType(std::addressof(entry_type)));
                         R_TRY(db.Add(entry_type == FsDirEntryType_File ? PtpObjectFormatCode_Undefined : PtpObjectFormatCode_Association));
                     }
                     break;
@@ -225,32 +202,6 @@ namespace haze {
         auto * const obj = m_object_database.GetObjectById(object_id);
         R_UNLESS(obj != nullptr, haze::ResultInvalidObjectId());
 
-        /* Define helper for getting the object type. */
-        const auto GetObjectType = [&] (FsDirEntryType *out_entry_type) {
-            R_RETURN(m_fs.GetEntryType(obj->GetName(), out_entry_type));
-        };
-
-        /* Define helper for getting the object size. */
-        const auto GetObjectSize = [&] (s64 *out_size) {
-            *out_size = 0;
-
-            /* Check if this is a directory. */
-            FsDirEntryType entry_type;
-            R_TRY(GetObjectType(std::addressof(entry_type)));
-
-            /* If it is, we're done. */
-            R_SUCCEED_IF(entry_type == FsDirEntryType_Dir);
-
-            /* Otherwise, open as a file. */
-            FsFile file;
-            R_TRY(m_fs.OpenFile(obj->GetName(), FsOpenMode_Read, std::addressof(file)));
-
-            /* Ensure we maintain a clean state on exit. */
-            ON_SCOPE_EXIT { m_fs.CloseFile(std::addressof(file)); };
-
-            R_RETURN(m_fs.GetFileSize(std::addressof(file), out_size));
-        };
-
         /* Define helper for determining if the property should be included. */
         const auto ShouldIncludeProperty = [&] (PtpObjectPropertyCode code) {
             /* If all properties were requested, or it was the requested property, we should include the property. */
@@ -265,6 +216,13 @@ namespace haze {
             }
         }
 
+        /* Get the object's type and size once, if any property needs them. */
+        FsDirEntryType entry_type = FsDirEntryType_File;
+        s64 size = 0;
+        if (ShouldIncludeProperty(PtpObjectPropertyCode_ObjectSize) || ShouldIncludeProperty(PtpObjectPropertyCode_ObjectFormat)) {
+            R_TRY(this->GetObjectMetadata(obj, std::addressof(entry_type), std::addressof(size)));
+        }
+
         /* Begin writing the requested object properties. */
         PtpDataBuilder db(m_buffers->usb_bulk_write_buffer, std::addressof(m_usb_server));
 
@@ -293,8 +251,6 @@ namespace haze {
                         break;
                     case PtpObjectPropertyCode_ObjectSize:
                         {
-                            s64 size;
-                            R_TRY(GetObjectSize(std::addressof(size)));
                             R_TRY(db.Add(PtpDataTypeCode_U64));
                             R_TRY(db.Add<u64>(size));
                         }
@@ -313,8 +269,6 @@ namespace haze {
                         break;
                     case PtpObjectPropertyCode_ObjectFormat:
                         {
-                            FsDirEntryType entry_type;
-                            R_TRY(GetObjectType(std::addressof(entry_type)));
                             R_TRY(db.Add(PtpDataTypeCode_U16));
                             R_TRY(db.Add(entry_type == FsDirEntryType_File ? PtpObjectFormatCode_Undefined : PtpObjectFormatCode_Association));
                         }
@@ -405,6 +359,10 @@ namespace haze {
             }
         }
 
+        /* Forget what we knew about both names, as the filesystem has changed beneath them. */
+        m_object_database.InvalidateObjectMetadata(obj->GetName());
+        m_object_database.InvalidateObjectMetadata(newobj->GetName());
+
         /* Unregister and free the old object. */
         m_object_database.DeleteObject(obj);
 
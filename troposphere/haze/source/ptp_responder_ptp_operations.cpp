@@ -185,11 +185,16 @@ namespace haze {
 
             /* Write to output. */
             for (s64 i = 0; i < read_count; i++) {
-                const char *name = m_buffers->file_system_entry_buffer[i].name;
-                u32 handle;
+                const auto &entry = m_buffers->file_system_entry_buffer[i];
 
-                R_TRY(m_object_database.CreateAndRegisterObjectId(obj->GetName(), name, obj->GetObjectId(), std::addressof(handle)));
-                R_TRY(db.Add(handle));
+                PtpObject *child;
+                R_TRY(m_object_database.CreateOrFindObject(obj->GetName(), entry.name, obj->GetObjectId(), std::addressof(child)));
+                m_object_database.RegisterObject(child);
+
+                /* Remember the entry's metadata, as hosts typically query it for every object next. */
+                child->SetMetadata(static_cast<FsDirEntryType>(entry.type), entry.file_size);
+
+                R_TRY(db.Add(child->GetObjectId()));
             }
 
             /* If we read fewer than the batch size, we're done. */
@@ -226,21 +231,10 @@ namespace haze {
             object_info.association_type = PtpAssociationType_GenericFolder;
             object_info.filename         = "SD Card";
         } else {
-            /* Figure out what type of object this is. */
+            /* Figure out what type of object this is, and its size if it is a file. */
             FsDirEntryType entry_type;
-            R_TRY(m_fs.GetEntryType(obj->GetName(), std::addressof(entry_type)));
-
-            /* Get the size, if we are requesting info about a file. */
-            s64 size = 0;
-            if (entry_type == FsDirEntryType_File) {
-                FsFile file;
-                R_TRY(m_fs.OpenFile(obj->GetName(), FsOpenMode_Read, std::addressof(file)));
-
-                /* Ensure we maintain a clean state on exit. */
-                ON_SCOPE_EXIT { m_fs.CloseFile(std::addressof(file)); };
-
-                R_TRY(m_fs.GetFileSize(std::addressof(file), std::addressof(size)));
-            }
+            s64 size;
+            R_TRY(this->GetObjectMetadata(obj, std::addressof(entry_type), std::addressof(size)));
 
             object_info.filename               = std::strrchr(obj->GetName(), '/') + 1;
             object_info.object_compressed_size = size;
@@ -285,8 +279,18 @@ namespace haze {
     }
 
     Result PtpResponder::GetObject(PtpDataParser &dp) {
-        PtpDataBuilder db(m_buffers->usb_bulk_write_buffer, std::addressof(m_usb_server));
+        PtpDataBuilder db(m_buffers->usb_bulk_write_buffer, m_buffers->usb_bulk_pipeline_buffer, std::addressof(m_usb_server));
 
+        /* Send the object, then wait for our last write even if we failed, so that a failed transfer is what we report. */
+        const Result result = this->GetObjectImpl(dp, db);
+        R_TRY(db.WaitForPendingWrite());
+        R_TRY(result);
+
+        /* Write the success response. */
+        R_RETURN(this->WriteResponse(PtpResponseCode_Ok));
+    }
+
+    Result PtpResponder::GetObjectImpl(PtpDataParser &dp, PtpDataBuilder &db) {
         /* Get the object ID the client requested. */
         u32 object_id;
         R_TRY(dp.Read(std::addressof(object_id)));
@@ -329,10 +333,7 @@ namespace haze {
         }
 
         /* Flush the data response. */
-        R_TRY(db.Commit());
-
-        /* Write the success response. */
-        R_RETURN(this->WriteResponse(PtpResponseCode_Ok));
+        R_RETURN(db.Commit());
     }
 
     Result PtpResponder::SendObjectInfo(PtpDataParser &rdp) {
@@ -402,9 +403,11 @@ namespace haze {
         /* Create the object on the filesystem. */
         if (info.object_format == PtpObjectFormatCode_Association) {
             R_TRY(m_fs.CreateDirectory(obj->GetName()));
+            obj->SetMetadata(FsDirEntryType_Dir, 0);
             m_send_object_id = 0;
         } else {
             R_TRY(m_fs.CreateFile(obj->GetName(), 0, 0));
+            obj->SetMetadata(FsDirEntryType_File, 0);
             m_send_object_id = new_object_info.object_id;
         }
 
@@ -418,8 +421,18 @@ namespace haze {
 
         R_TRY(rdp.Finalize());
 
-        PtpDataParser dp(m_buffers->usb_bulk_read_buffer, std::addressof(m_usb_server));
+        PtpDataParser dp(m_buffers->usb_bulk_read_buffer, m_buffers->usb_bulk_pipeline_buffer, std::addressof(m_usb_server));
+
+        /* Receive the object, then wait for our last read even if we failed, so that a failed transfer is what we report. */
+        const Result result = this->SendObjectImpl(dp);
+        R_TRY(dp.WaitForPendingRead());
+        R_TRY(result);
+
+        /* Write the success response. */
+        R_RETURN(this->WriteResponse(PtpResponseCode_Ok));
+    }
 
+    Result PtpResponder::SendObjectImpl(PtpDataParser &dp) {
         /* Ensure we have a data header. */
         PtpUsbBulkContainer data_header;
         R_TRY(dp.Read(std::addressof(data_header)));
@@ -438,6 +451,9 @@ namespace haze {
         /* Ensure we maintain a clean state on exit. */
         ON_SCOPE_EXIT { m_fs.CloseFile(std::addressof(file)); };
 
+        /* The file's size will change, so forget what we know about it. */
+        obj->InvalidateMetadata();
+
         /* Truncate the file after locking for write. */
         s64 offset = 0;
         R_TRY(m_fs.SetFileSize(std::addressof(file), 0));
@@ -468,9 +484,9 @@ namespace haze {
 
         /* Truncate the file to the received size. */
         R_TRY(m_fs.SetFileSize(std::addressof(file), offset));
+        obj->SetMetadata(FsDirEntryType_File, offset);
 
-        /* Write the success response. */
-        R_RETURN(this->WriteResponse(PtpResponseCode_Ok));
+        R_SUCCEED();
     }
 
     Result PtpResponder::DeleteObject(PtpDataParser &dp) {
@@ -497,7 +513,8 @@ namespace haze {
             R_TRY(m_fs.DeleteFile(obj->GetName()));
         }
 
-        /* Remove the object from the database. */
+        /* Remove the object from the database, forgetting about anything that was beneath it. */
+        m_object_database.InvalidateObjectMetadata(obj->GetName());
         m_object_database.DeleteObject(obj);
 
         /* Write the success response. */